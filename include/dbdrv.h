@@ -51,6 +51,7 @@ typedef void * DBDRV_CONNECTION;
 typedef void * DBDRV_STATEMENT;
 typedef void * DBDRV_RESULT;
 typedef void * DBDRV_UNBUFFERED_RESULT;
+typedef void * DBDRV_BULK_INSERT;
 
 //
 // Error codes
@@ -136,7 +136,7 @@
 #define MAX_SSH_PASSWORD_LEN     64
 #define GROUP_FLAG               ((UINT32)0x80000000)
 
-#define NETXMS_MAX_CIPHERS       6
+#define NETXMS_MAX_CIPHERS       7
 #define NETXMS_RSA_KEYLEN        2048
 
 #ifndef LLONG_MAX
@@ -36,6 +36,8 @@
 #define NXCP_ENCRYPTION_HEADER_SIZE    16
 #define NXCP_EH_UNENCRYPTED_BYTES      8
 #define NXCP_EH_ENCRYPTED_BYTES        (NXCP_ENCRYPTION_HEADER_SIZE - NXCP_EH_UNENCRYPTED_BYTES)
+#define NXCP_AEAD_NONCE_SIZE           12
+#define NXCP_AEAD_TAG_SIZE             16
 #ifdef __64BIT__
 #define PROXY_ENCRYPTION_CTX           ((NXCPEncryptionContext *)_ULL(0xFFFFFFFFFFFFFFFF))
 #else
@@ -60,6 +62,7 @@
 #define NXCP_CIPHER_3DES          3
 #define NXCP_CIPHER_AES_128       4
 #define NXCP_CIPHER_BLOWFISH_128  5
+#define NXCP_CIPHER_AES_256_GCM   6
 
 #define NXCP_SUPPORT_AES_256      0x01
 #define NXCP_SUPPORT_BLOWFISH_256 0x02
@@ -67,6 +70,7 @@
 #define NXCP_SUPPORT_3DES         0x08
 #define NXCP_SUPPORT_AES_128      0x10
 #define NXCP_SUPPORT_BLOWFISH_128 0x20
+#define NXCP_SUPPORT_AES_256_GCM  0x40
 
 #ifdef __HP_aCC
 #pragma pack 1
@@ -241,8 +245,15 @@ typedef struct
 #define MF_COMPRESSED         0x0040   /* compressed message indicator */
 #define MF_STREAM             0x0080   /* indicates that this message is part of data stream */
 #define MF_DONT_COMPRESS      0x0100   /* prevent message compression */
+#define MF_COMPRESSED_LZ4     0x0200   /* compressed message payload uses LZ4 instead of deflate (only together with MF_COMPRESSED) */
 #define MF_NXCP_VERSION(v)    (((v) & 0x0F) << 12) /* protocol version encoded in highest 4 bits */
 
+/**
+ * Message compression methods (bit mask used in VID_COMPRESSION_METHODS)
+ */
+#define NXCP_COMPRESSION_METHOD_DEFLATE   0x0001
+#define NXCP_COMPRESSION_METHOD_LZ4       0x0002
+
 /**
  * Message (command) codes
  */
@@ -1337,6 +1348,7 @@ typedef struct
 #define VID_REQUEST_TYPE            ((UINT32)677)
 #define VID_VERIFY_CERT             ((UINT32)678)
 #define VID_SYNC_NODE_COMPONENTS    ((UINT32)679)
+#define VID_COMPRESSION_METHODS     ((UINT32)680)
 
 // Base variabe for single threshold in message
 #define VID_THRESHOLD_BASE          ((UINT32)0x00800000)
@@ -1176,6 +1176,11 @@ class StringList;
  */
 struct ThreadPool;
 
+/**
+ * Number of buckets in thread pool scheduler lateness histogram
+ */
+#define THREAD_POOL_LATENESS_BUCKETS   5
+
 /**
  * Thread pool information
  */
@@ -1195,6 +1200,7 @@ struct ThreadPoolInfo
    int load;               // Pool current load in % (can be more than 100% if there are more requests then threads available)
    double loadAvg[3];      // Pool load average
    UINT32 averageWaitTime; // Average task wait time
+   UINT64 schedulerLateness[THREAD_POOL_LATENESS_BUCKETS]; // Scheduled task dispatch delay histogram (up to 1 ms, 10 ms, 100 ms, 1 s, over 1 s)
 };
 
 /**
@@ -1202,10 +1208,16 @@ struct ThreadPoolInfo
  */
 typedef void (* ThreadPoolWorkerFunction)(void *);
 
+/**
+ * Thread pool creation flags
+ */
+#define THREAD_POOL_WORK_STEALING   0x0001
+
 /* Thread pool functions */
-ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThreads, int maxThreads, int stackSize = 0);
+ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThreads, int maxThreads, int stackSize = 0, UINT32 flags = 0);
 void LIBNETXMS_EXPORTABLE ThreadPoolDestroy(ThreadPool *p);
 void LIBNETXMS_EXPORTABLE ThreadPoolExecute(ThreadPool *p, ThreadPoolWorkerFunction f, void *arg);
+void LIBNETXMS_EXPORTABLE ThreadPoolExecuteBatch(ThreadPool *p, ThreadPoolWorkerFunction f, void **args, int count);
 void LIBNETXMS_EXPORTABLE ThreadPoolExecuteSerialized(ThreadPool *p, const TCHAR *key, ThreadPoolWorkerFunction f, void *arg);
 void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsolute(ThreadPool *p, time_t runTime, ThreadPoolWorkerFunction f, void *arg);
 void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runTime, ThreadPoolWorkerFunction f, void *arg);
@@ -1259,6 +1271,18 @@ template <typename T> inline void ThreadPoolExecute(ThreadPool *p, void (*f)(sha
    ThreadPoolExecute(p, __ThreadPoolExecute_SharedPtr_Wrapper<T>, new __ThreadPoolExecute_SharedPtr_WrapperData<T>(arg, f));
 }
 
+/**
+ * Wrapper for ThreadPoolExecuteBatch to use smart pointers to given type as arguments
+ */
+template <typename T> inline void ThreadPoolExecuteBatch(ThreadPool *p, void (*f)(shared_ptr<T>), const shared_ptr<T> **args, int count)
+{
+   void **data = MemAllocArrayNoInit<void*>(count);
+   for(int i = 0; i < count; i++)
+      data[i] = new __ThreadPoolExecute_SharedPtr_WrapperData<T>(*args[i], f);
+   ThreadPoolExecuteBatch(p, __ThreadPoolExecute_SharedPtr_Wrapper<T>, data, count);
+   MemFree(data);
+}
+
 /**
  * Wrapper for ThreadPoolExecuteSerialized to use pointer to given type as argument
  */
@@ -2937,6 +2937,15 @@ class LIBNETXMS_EXPORTABLE SocketPoller
    void reset();
 };
 
+/**
+ * Data buffer for scatter-gather I/O
+ */
+struct SGBuffer
+{
+   const void *data;
+   size_t size;
+};
+
 /**
  * Abstract communication channel
  */
@@ -2951,10 +2960,13 @@ class LIBNETXMS_EXPORTABLE AbstractCommChannel : public RefCountObject
    AbstractCommChannel();
 
    virtual int send(const void *data, size_t size, MUTEX mutex = INVALID_MUTEX_HANDLE) = 0;
+   virtual int sendv(const SGBuffer *buffers, int count, MUTEX mutex = INVALID_MUTEX_HANDLE);
    virtual int recv(void *buffer, size_t size, UINT32 timeout = INFINITE) = 0;
    virtual int poll(UINT32 timeout, bool write = false) = 0;
    virtual int shutdown() = 0;
    virtual void close() = 0;
+
+   virtual SOCKET getSocket() const;
 };
 
 /**
@@ -2978,10 +2990,13 @@ class LIBNETXMS_EXPORTABLE SocketCommChannel : public AbstractCommChannel
    SocketCommChannel(SOCKET socket, bool owner = true);
 
    virtual int send(const void *data, size_t size, MUTEX mutex = INVALID_MUTEX_HANDLE) override;
+   virtual int sendv(const SGBuffer *buffers, int count, MUTEX mutex = INVALID_MUTEX_HANDLE) override;
    virtual int recv(void *buffer, size_t size, UINT32 timeout = INFINITE) override;
    virtual int poll(UINT32 timeout, bool write = false) override;
    virtual int shutdown() override;
    virtual void close() override;
+
+   virtual SOCKET getSocket() const override;
 };
 
 #endif   /* __cplusplus */
@@ -3104,6 +3119,7 @@ typedef struct _dir_struc_w
 
 int LIBNETXMS_EXPORTABLE ConnectEx(SOCKET s, struct sockaddr *addr, int len, UINT32 timeout, bool *isTimeout = NULL);
 int LIBNETXMS_EXPORTABLE SendEx(SOCKET hSocket, const void *data, size_t len, int flags, MUTEX mutex);
+int LIBNETXMS_EXPORTABLE SendVectorEx(SOCKET hSocket, const SGBuffer *buffers, int count, MUTEX mutex);
 int LIBNETXMS_EXPORTABLE RecvEx(SOCKET hSocket, void *data, size_t len, int flags, UINT32 timeout, SOCKET controlSocket = INVALID_SOCKET);
 bool LIBNETXMS_EXPORTABLE RecvAll(SOCKET s, void *buffer, size_t size, UINT32 timeout);
 
@@ -65,6 +65,16 @@ FORCEINLINE LONGLONG InterlockedDecrement64(LONGLONG volatile *v)
    return old - 1;
 }
 
+FORCEINLINE LONGLONG InterlockedAdd64(LONGLONG volatile *v, LONGLONG delta)
+{
+   LONGLONG old;
+   do 
+   {
+      old = *v;
+   } while(_InterlockedCompareExchange64(v, old + delta, old) != old);
+   return old + delta;
+}
+
 #endif
 
 #else
@@ -114,6 +124,14 @@ inline VolatileCounter64 InterlockedDecrement64(VolatileCounter64 *v)
    return atomic_dec_64_nv(v);
 }
 
+/**
+ * Atomically add value to 64-bit value
+ */
+inline VolatileCounter64 InterlockedAdd64(VolatileCounter64 *v, INT64 delta)
+{
+   return atomic_add_64_nv(v, delta);
+}
+
 /**
  * Atomically set pointer
  */
@@ -187,6 +205,24 @@ inline VolatileCounter64 InterlockedDecrement64(VolatileCounter64 *v)
 #endif
 }
 
+/**
+ * Atomically add value to 64-bit value
+ */
+inline VolatileCounter64 InterlockedAdd64(VolatileCounter64 *v, INT64 delta)
+{
+#if HAVE_ATOMIC_H
+   return atomic_add_64(v, delta) + delta;
+#else
+   uint64_t oldval;
+   do
+   {
+      oldval = *v;
+      _Asm_mov_to_ar(_AREG_CCV, oldval);
+   } while((uint64_t)_Asm_cmpxchg(_SZ_D, _SEM_ACQ, (void *)v, oldval + delta, _LDHINT_NONE) != oldval);
+   return oldval + delta;
+#endif
+}
+
 /**
  * Atomically set pointer
  */
@@ -296,6 +332,23 @@ inline VolatileCounter64 InterlockedDecrement64(VolatileCounter64 *v)
 #endif
 }
 
+/**
+ * Atomically add value to 64-bit value
+ */
+inline VolatileCounter64 InterlockedAdd64(VolatileCounter64 *v, INT64 delta)
+{
+#if !HAVE_DECL___SYNC_ADD_AND_FETCH
+   VolatileCounter64 oldval;
+   do
+   {
+      oldval = __ldarx(v);
+   } while(__stdcx(v, oldval + delta) == 0);
+   return oldval + delta;
+#else
+   return __sync_add_and_fetch(v, delta);
+#endif
+}
+
 /**
  * Atomically set pointer
  */
@@ -406,6 +459,20 @@ inline VolatileCounter64 InterlockedDecrement64(VolatileCounter64 *v)
 #endif
 }
 
+/**
+ * Atomically add value to 64-bit value
+ */
+inline VolatileCounter64 InterlockedAdd64(VolatileCounter64 *v, INT64 delta)
+{
+#if defined(__GNUC__) && ((__GNUC__ < 4) || (__GNUC_MINOR__ < 1)) && (defined(__i386__) || defined(__x86_64__))
+   VolatileCounter64 temp = delta;
+   __asm__ __volatile__("lock; xaddq %0,%1" : "+r" (temp), "+m" (*v) : : "memory");
+   return temp + delta;
+#else
+   return __sync_add_and_fetch(v, delta);
+#endif
+}
+
 /**
  * Atomically set pointer
  */
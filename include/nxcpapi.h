@@ -51,12 +51,38 @@ typedef struct
 #ifdef __cplusplus
 
 struct MessageField;
+class NXCPMessageBlocks;
 
 /**
  * Default size hint
  */
 #define NXCP_DEFAULT_SIZE_HINT   (4096)
 
+/**
+ * Default minimal size of message payload to be compressed
+ */
+#define NXCP_DEFAULT_COMPRESSION_THRESHOLD   (128)
+
+/**
+ * Minimal size of binary field value to be sent directly from message without copying
+ */
+#define NXCP_DIRECT_SEND_THRESHOLD   (4096)
+
+/**
+ * Size of internal buffer in NXCPMessageBlocks (messages with smaller encoded part are serialized without heap allocation)
+ */
+#define NXCP_BLOCKS_LOCAL_BUFFER_SIZE   (2048)
+
+/**
+ * NXCP stream and message compression methods
+ */
+enum NXCPStreamCompressionMethod
+{
+   NXCP_STREAM_COMPRESSION_NONE = 0,
+   NXCP_STREAM_COMPRESSION_LZ4 = 1,
+   NXCP_STREAM_COMPRESSION_DEFLATE = 2
+};
+
 /**
  * Parsed NXCP message
  */
@@ -67,6 +93,7 @@ class LIBNETXMS_EXPORTABLE NXCPMessage
    UINT16 m_flags;
    UINT32 m_id;
    MessageField *m_fields; // Message fields
+   size_t m_encodedSize;   // Encoded size of all fields including alignment
    int m_version;          // Protocol version
    BYTE *m_data;           // binary data
    size_t m_dataSize;      // binary data size
@@ -89,6 +116,11 @@ class LIBNETXMS_EXPORTABLE NXCPMessage
 
    static NXCPMessage *deserialize(const NXCP_MESSAGE *rawMsg, int version = NXCP_VERSION);
    NXCP_MESSAGE *serialize(bool allowCompression = false) const;
+   NXCP_MESSAGE *serialize(NXCPStreamCompressionMethod compressionMethod) const;
+   size_t serializeTo(NXCP_MESSAGE *buffer, size_t bufferSize) const;
+   void serializeToBlocks(NXCPMessageBlocks *blocks) const;
+   size_t getSerializedSize() const;
+   bool isCompressible(NXCPStreamCompressionMethod compressionMethod) const;
 
    UINT16 getCode() const { return m_code; }
    void setCode(UINT16 code) { m_code = code; }
@@ -172,6 +204,37 @@ class LIBNETXMS_EXPORTABLE NXCPMessage
    static StringBuffer dump(const NXCP_MESSAGE *msg, int version);
 };
 
+/**
+ * Serialized NXCP message as list of data blocks for scatter-gather send. Values of large
+ * binary fields are referenced directly from source message, so message should not be
+ * modified or destroyed until blocks are sent.
+ */
+class LIBNETXMS_EXPORTABLE NXCPMessageBlocks
+{
+   friend class NXCPMessage;
+
+private:
+   BYTE *m_buffer;
+   size_t m_bufferSize;
+   SGBuffer *m_blocks;
+   int m_count;
+   int m_allocated;
+   size_t m_size;
+   SGBuffer m_localBlocks[8];
+   BYTE m_localBuffer[NXCP_BLOCKS_LOCAL_BUFFER_SIZE];
+
+   BYTE *allocateBuffer(size_t size);
+   void addBlock(const void *data, size_t size);
+
+public:
+   NXCPMessageBlocks();
+   ~NXCPMessageBlocks();
+
+   const SGBuffer *getBlocks() const { return m_blocks; }
+   int getCount() const { return m_count; }
+   size_t getSize() const { return m_size; }
+};
+
 /**
  * Message waiting queue element structure
  */
@@ -269,6 +332,11 @@ class LIBNETXMS_EXPORTABLE MsgWaitQueue
    static StringBuffer getDiagInfo();
 };
 
+/**
+ * Number of cached encryptors for AEAD ciphers (allows parallel encryption without locking)
+ */
+#define NXCP_AEAD_ENCRYPTOR_CACHE_SIZE 4
+
 /**
  * NXCP encryption context
  */
@@ -283,20 +351,35 @@ class LIBNETXMS_EXPORTABLE NXCPEncryptionContext : public RefCountObject
    MUTEX m_encryptorLock;
    EVP_CIPHER_CTX *m_encryptor;
    EVP_CIPHER_CTX *m_decryptor;
+   EVP_CIPHER_CTX * volatile m_aeadEncryptors[NXCP_AEAD_ENCRYPTOR_CACHE_SIZE];
+   VolatileCounter64 m_nonceCounter;
+   const UINT64 m_directionBit;  // Direction bit for messages sent via this context
+   UINT64 m_replayWindowTop;     // Highest counter of received messages (without direction bit)
+   UINT64 m_replayWindowMask;    // Bit N is set if message with counter (top - N) was received
 #endif
 
-	NXCPEncryptionContext();
+	NXCPEncryptionContext(bool responder = false);
    bool initCipher(int cipher);
 
+#ifdef _WITH_ENCRYPTION
+   EVP_CIPHER_CTX *acquireAEADEncryptor();
+   void releaseAEADEncryptor(EVP_CIPHER_CTX *encryptor);
+   NXCP_ENCRYPTED_MESSAGE *encryptMessageAEAD(const NXCP_MESSAGE *msg, BYTE *buffer, size_t bufferSize);
+   bool decryptMessageAEAD(NXCP_ENCRYPTED_MESSAGE *msg, BYTE *decryptionBuffer);
+#endif
+
 public:
 	static NXCPEncryptionContext *create(NXCPMessage *msg, RSA *privateKey);
 	static NXCPEncryptionContext *create(UINT32 ciphers);
 
 	virtual ~NXCPEncryptionContext();
 
-   NXCP_ENCRYPTED_MESSAGE *encryptMessage(NXCP_MESSAGE *msg);
+   NXCP_ENCRYPTED_MESSAGE *encryptMessage(NXCP_MESSAGE *msg) { return encryptMessage(msg, NULL, 0); }
+   NXCP_ENCRYPTED_MESSAGE *encryptMessage(const NXCP_MESSAGE *msg, BYTE *buffer, size_t bufferSize);
    bool decryptMessage(NXCP_ENCRYPTED_MESSAGE *msg, BYTE *decryptionBuffer);
 
+   bool isAEAD() const { return m_cipher == NXCP_CIPHER_AES_256_GCM; }
+
 	int getCipher() { return m_cipher; }
 	BYTE *getSessionKey() { return m_sessionKey; }
 	int getKeyLength() { return m_keyLength; }
@@ -331,7 +414,9 @@ class LIBNETXMS_EXPORTABLE AbstractMessageReceiver
    size_t m_dataSize;
    size_t m_bytesToSkip;
 
-   NXCPMessage *getMessageFromBuffer(bool *protocolError);
+   void *decodeMessage(bool raw, bool *protocolError);
+   void *getMessageFromBuffer(bool raw, bool *protocolError);
+   void *readMessage(UINT32 timeout, MessageReceiverResult *result, bool raw);
 
 protected:
    virtual int readBytes(BYTE *buffer, size_t size, UINT32 timeout) = 0;
@@ -345,6 +430,7 @@ class LIBNETXMS_EXPORTABLE AbstractMessageReceiver
    void setEncryptionContext(NXCPEncryptionContext *ctx) { m_encryptionContext = ctx; }
 
    NXCPMessage *readMessage(UINT32 timeout, MessageReceiverResult *result);
+   NXCP_MESSAGE *readRawMessage(UINT32 timeout, MessageReceiverResult *result);
    NXCP_MESSAGE *getRawMessageBuffer() { return (NXCP_MESSAGE *)m_buffer; }
 
    static const TCHAR *resultToText(MessageReceiverResult result);
@@ -440,16 +526,6 @@ class LIBNETXMS_EXPORTABLE PipeMessageReceiver : public AbstractMessageReceiver
    virtual void cancel() override;
 };
 
-/**
- * NXCP stresam compression methods
- */
-enum NXCPStreamCompressionMethod
-{
-   NXCP_STREAM_COMPRESSION_NONE = 0,
-   NXCP_STREAM_COMPRESSION_LZ4 = 1,
-   NXCP_STREAM_COMPRESSION_DEFLATE = 2
-};
-
 /**
  * Abstract stream compressor
  */
@@ -529,39 +605,47 @@ class LIBNETXMS_EXPORTABLE DeflateStreamCompressor : public StreamCompressor
    virtual size_t compressBufferSize(size_t dataSize);
 };
 
-#if 0
 /**
- * NXCP message consumer interface
+ * NXCP message consumer interface. Consumer registered with socket receiver
+ * will get exactly one call to onReceiverShutdown after all received messages
+ * were processed.
  */
 class LIBNETXMS_EXPORTABLE MessageConsumer
 {
 public:
+   virtual ~MessageConsumer();
+
    virtual SOCKET getSocket() = 0;
-   virtual void processMessage(NXCPMessage *msg) = 0;
+   virtual AbstractMessageReceiver *getMessageReceiver() = 0;
+   virtual UINT32 getReceiveTimeout();
+   virtual bool isRawMessageConsumer();
+
+   virtual void processMessage(NXCPMessage *msg);
+   virtual void processRawMessage(NXCP_MESSAGE *msg);
+   virtual bool onReceiveTimeout();
+   virtual void onReceiverShutdown(MessageReceiverResult reason) = 0;
+
+   virtual void incConsumerRefCount() = 0;
+   virtual void decConsumerRefCount() = 0;
 };
 
 /**
  * Socket receiver - manages receiving NXCP messages from multiple sockets
+ * using small fixed set of event loop threads. Received messages are passed
+ * to consumers via thread pool, preserving order of messages for each consumer.
  */
 class LIBNETXMS_EXPORTABLE SocketReceiver
 {
-private:
-   THREAD m_thread;
-   HashMap<SOCKET, MessageConsumer> *m_consumers;
-
-   static int m_maxSocketsPerThread;
-   static ObjectArray<SocketReceiver> *m_receivers;
-
 public:
-   static void start();
+   static bool start(int numThreads);
    static void shutdown();
+   static bool isRunning();
 
-   static void addConsumer(MessageConsumer *mc);
+   static bool addConsumer(MessageConsumer *mc, ThreadPool *pool);
    static void removeConsumer(MessageConsumer *mc);
 
-   static String getDiagInfo();
+   static int getConsumerCount();
 };
-#endif
 
 #else    /* __cplusplus */
 
@@ -613,6 +697,10 @@ bool LIBNETXMS_EXPORTABLE SendFileOverNXCP(AbstractCommChannel *channel, UINT32
                                            VolatileCounter *cancellationFlag = NULL);
 bool LIBNETXMS_EXPORTABLE NXCPGetPeerProtocolVersion(SOCKET s, int *pnVersion, MUTEX mutex);
 bool LIBNETXMS_EXPORTABLE NXCPGetPeerProtocolVersion(AbstractCommChannel *channel, int *pnVersion, MUTEX mutex);
+void LIBNETXMS_EXPORTABLE NXCPSetCompressionThreshold(size_t threshold);
+void LIBNETXMS_EXPORTABLE NXCPSetCompressedFileDetection(bool enabled);
+UINT16 LIBNETXMS_EXPORTABLE NXCPGetSupportedCompressionMethods();
+NXCPStreamCompressionMethod LIBNETXMS_EXPORTABLE NXCPSelectCompressionMethod(UINT16 methods);
 
 TCHAR LIBNETXMS_EXPORTABLE *NXCPMessageCodeName(UINT16 wCode, TCHAR *buffer);
 void LIBNETXMS_EXPORTABLE NXCPRegisterMessageNameResolver(NXCPMessageNameResolver r);
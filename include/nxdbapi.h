@@ -81,6 +81,9 @@ typedef db_result_t * DB_RESULT;
 struct db_unbuffered_result_t;
 typedef db_unbuffered_result_t * DB_UNBUFFERED_RESULT;
 
+struct db_bulk_insert_t;
+typedef db_bulk_insert_t * DB_BULK_INSERT;
+
 /**
  * Pool connection information
  */
@@ -106,6 +109,8 @@ struct LIBNXDB_PERF_COUNTERS
    UINT64 totalQueries;
    UINT64 longRunningQueries;
    UINT64 failedQueries;
+   UINT64 bulkInserts;
+   UINT64 bulkInsertRows;
 };
 
 /**
@@ -201,6 +206,11 @@ UINT32 LIBNXDB_EXPORTABLE DBGetFieldIPAddr(DB_UNBUFFERED_RESULT hResult, int iCo
 InetAddress LIBNXDB_EXPORTABLE DBGetFieldInetAddr(DB_UNBUFFERED_RESULT hResult, int iColumn);
 uuid LIBNXDB_EXPORTABLE DBGetFieldGUID(DB_UNBUFFERED_RESULT hResult, int iColumn);
 
+DB_BULK_INSERT LIBNXDB_EXPORTABLE DBBulkInsertBegin(DB_HANDLE hConn, const TCHAR *table, const TCHAR *columns, int columnCount, const int *sqlTypes, bool ignoreDuplicates = false);
+bool LIBNXDB_EXPORTABLE DBBulkInsertAddRow(DB_BULK_INSERT hBulk, const TCHAR **values);
+bool LIBNXDB_EXPORTABLE DBBulkInsertEnd(DB_BULK_INSERT hBulk);
+int LIBNXDB_EXPORTABLE DBBulkInsertGetRowCount(DB_BULK_INSERT hBulk);
+
 bool LIBNXDB_EXPORTABLE DBBegin(DB_HANDLE hConn);
 bool LIBNXDB_EXPORTABLE DBCommit(DB_HANDLE hConn);
 bool LIBNXDB_EXPORTABLE DBRollback(DB_HANDLE hConn);
@@ -35,11 +35,18 @@
 #include <nms_threads.h>
 #include <nxqueue.h>
 
+class NXMBDispatcher;
+
 /**
  * Message class
  */
 class LIBNXMB_EXPORTABLE NXMBMessage
 {
+   friend class NXMBDispatcher;
+
+private:
+   VolatileCounter m_refCount;   // Number of dispatcher workers still processing this message
+
 protected:
 	TCHAR *m_type;
 	TCHAR *m_senderId;
@@ -76,27 +83,40 @@ class LIBNXMB_EXPORTABLE NXMBSubscriber
  */
 class LIBNXMB_EXPORTABLE NXMBFilter
 {
+   friend class NXMBDispatcher;
+
+private:
+   NXMBDispatcher *m_dispatcher;   // Dispatcher this filter is registered with
+
+protected:
+   void notifyDispatcher();
+
 public:
 	NXMBFilter();
 	virtual ~NXMBFilter();
 
 	virtual bool isAllowed(NXMBMessage &msg);
 	virtual bool isOwnedByDispatcher();
+	virtual bool getAcceptedTypes(StringList *types);
 };
 
 /**
- * Message filter which accept messages of specific type(s)
+ * Message filter which accept messages of specific type(s). Messages are routed to subscribers
+ * with this filter by dispatcher's type index, so isAllowed() cannot be overridden (derive from
+ * NXMBFilter for custom filtering). Index is rebuilt when accepted types are changed.
  */
 class LIBNXMB_EXPORTABLE NXMBTypeFilter : public NXMBFilter
 {
 protected:
 	StringMap m_types;
+   Mutex m_lock;
 
 public:
 	NXMBTypeFilter();
 	virtual ~NXMBTypeFilter();
 
-	virtual bool isAllowed(NXMBMessage &msg);
+	virtual bool isAllowed(NXMBMessage &msg) override final;
+	virtual bool getAcceptedTypes(StringList *types) override final;
 
 	void addMessageType(const TCHAR *type);
 	void removeMessageType(const TCHAR *type);
@@ -120,24 +140,77 @@ class CallHandlerMap : public StringMapBase
 };
 
 /**
- * Message dispatcher class
+ * Subscriber statistics
+ */
+struct NXMBSubscriberStatistics
+{
+   TCHAR id[128];
+   UINT64 messages;           // Number of messages passed to subscriber
+   UINT64 totalHandlerTime;   // Total time spent in message handler (microseconds)
+   UINT64 maxHandlerTime;     // Maximum time spent in message handler (microseconds)
+   int worker;                // Worker thread serving this subscriber
+};
+
+/**
+ * Dispatcher statistics
+ */
+struct NXMBDispatcherStatistics
+{
+   UINT64 postedMessages;
+   UINT64 processedMessages;
+   UINT64 batches;
+   size_t queueSize;
+   int workers;
+};
+
+struct NXMBSubscriberEntry;
+struct NXMBSubscriberSnapshot;
+struct NXMBWorker;
+
+/**
+ * Message dispatcher class. Subscriber list is published to workers as immutable snapshot
+ * (taken from snapshot pool on change), so message processing does not take any locks.
+ * In multi-worker mode each subscriber is bound to one worker, which preserves order of messages
+ * for each subscriber while different subscribers are served in parallel. Subscribers can be
+ * added or removed from within message handler; such changes take effect from next batch.
  */
 class LIBNXMB_EXPORTABLE NXMBDispatcher
 {
+   friend class NXMBFilter;
+
 private:
-	Queue *m_queue;
-	int m_numSubscribers;
-	NXMBSubscriber **m_subscribers;
-	NXMBFilter **m_filters;
+   ObjectArray<NXMBSubscriberEntry> *m_subscribers;   // Authoritative subscriber list (protected by m_subscriberListAccess)
+   NXMBSubscriberSnapshot * volatile m_primary;
+   ObjectArray<NXMBSubscriberSnapshot> *m_snapshots;  // All allocated snapshots (protected by m_subscriberListAccess)
+   ObjectArray<NXMBSubscriberEntry> *m_retiredEntries; // Entries which could still be used by workers (protected by m_subscriberListAccess)
+   VolatileCounter m_retiredEntryCount;
 	MUTEX m_subscriberListAccess;
-	THREAD m_workerThreadHandle;
+   int m_numWorkers;
+   int m_nextWorker;
+   NXMBWorker *m_workers;
+   VolatileCounter m_activeWorkers;
+   VolatileCounter64 m_postedMessages;
+   VolatileCounter64 m_processedMessages;
+   VolatileCounter64 m_batches;
    CallHandlerMap *m_callHandlers;
    MUTEX m_callHandlerAccess;
    CONDITION m_startCondition;
    CONDITION m_stopCondition;
 
-	void workerThread();
+   void start(int numWorkers);
+	void workerThread(NXMBWorker *worker);
 	static THREAD_RESULT THREAD_CALL workerThreadStarter(void *);
+   void processMessage(NXMBMessage *msg, NXMBSubscriberSnapshot *snapshot, int worker);
+   void releaseMessage(NXMBMessage *msg);
+
+   NXMBSubscriberSnapshot *acquireSnapshot();
+   void releaseSnapshot(NXMBSubscriberSnapshot *snapshot);
+   void publishSubscriberList();
+   void retireEntry(NXMBSubscriberEntry *entry, bool deleteSubscriber, bool deleteFilter);
+   bool destroyRetiredEntries();
+   void waitForRetiredEntries();
+   bool isWorkerThread();
+   void onFilterChange(NXMBFilter *filter);
 
 public:
 	NXMBDispatcher();
@@ -152,7 +225,11 @@ class LIBNXMB_EXPORTABLE NXMBDispatcher
    void addCallHandler(const TCHAR *callName, NXMBCallHandler handler);
    void removeCallHandler(const TCHAR *callName);
 
+   void getStatistics(NXMBDispatcherStatistics *stats);
+   ObjectArray<NXMBSubscriberStatistics> *getSubscriberStatistics();
+
    static NXMBDispatcher *getInstance();
+   static void setWorkerCount(int count);
 };
 
 #endif   /* _nxmbapi_h_ */
@@ -84,6 +84,7 @@ class LIBNETXMS_EXPORTABLE Queue
    virtual ~Queue();
 
    void put(void *object);
+   void putAll(void **objects, size_t count);
 	void insert(void *object);
 	void setShutdownMode();
 	void setOwner(bool owner) { m_owner = owner; }
@@ -136,6 +136,7 @@ extern "C" {
 NXSL_Program LIBNXSL_EXPORTABLE *NXSLCompile(const TCHAR *source, TCHAR *errorMessage, size_t errorMessageLen, int *errorLineNumber);
 NXSL_VM LIBNXSL_EXPORTABLE *NXSLCompileAndCreateVM(const TCHAR *source, TCHAR *errorMessage, size_t errorMessageLen, NXSL_Environment *env);
 TCHAR LIBNXSL_EXPORTABLE *NXSLLoadFile(const TCHAR *fileName, UINT32 *fileSize);
+void LIBNXSL_EXPORTABLE NXSLEnableOptimizer(bool enable);
 
 #ifdef __cplusplus
 }
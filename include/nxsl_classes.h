@@ -625,7 +625,7 @@ class NXSL_Function
    UINT32 m_dwAddr;
 
    NXSL_Function() : m_name() { m_dwAddr = INVALID_ADDRESS; }
-   NXSL_Function(NXSL_Function *src) { m_name = src->m_name; m_dwAddr = src->m_dwAddr; }
+   NXSL_Function(const NXSL_Function *src) { m_name = src->m_name; m_dwAddr = src->m_dwAddr; }
    NXSL_Function(const char *name, UINT32 addr) : m_name(name) { m_dwAddr = addr; }
 };
 
@@ -798,11 +798,10 @@ class LIBNXSL_EXPORTABLE NXSL_Instruction
    NXSL_Instruction(NXSL_ValueManager *vm, int line, INT16 opCode, const NXSL_Identifier& identifier, INT16 stackItems, UINT32 addr2 = INVALID_ADDRESS);
    NXSL_Instruction(NXSL_ValueManager *vm, int line, INT16 opCode, UINT32 addr);
    NXSL_Instruction(NXSL_ValueManager *vm, int line, INT16 opCode, INT16 stackItems);
-   NXSL_Instruction(NXSL_ValueManager *vm, NXSL_Instruction *src);
+   NXSL_Instruction(NXSL_ValueManager *vm, const NXSL_Instruction *src);
    ~NXSL_Instruction();
 
-   OperandType getOperandType();
-   void restoreVariableReference(NXSL_Identifier *identifier);
+   OperandType getOperandType() const;
 };
 
 /**
@@ -811,12 +810,18 @@ class LIBNXSL_EXPORTABLE NXSL_Instruction
 struct NXSL_VariablePtr;
 
 /**
- * Variable pointer restore point
+ * Instruction reference resolved by VM at run time. VM keeps one entry per
+ * instruction instead of rewriting shared program code in place.
  */
-struct VREF_RESTORE_POINT
+struct NXSL_ResolvedReference
 {
-   UINT32 addr;
-   NXSL_Identifier *identifier;
+   INT16 opCode;     // replacement opcode or OPCODE_NOP if instruction is not resolved
+   union
+   {
+      NXSL_Variable *variable;
+      const NXSL_ExtFunction *function;
+      UINT32 addr;
+   } operand;
 };
 
 /**
@@ -833,7 +838,13 @@ class LIBNXSL_EXPORTABLE NXSL_VariableSystem : public NXSL_RuntimeObject
    NXSL_VariablePtr *m_variables;
    bool m_isConstant;
    int m_restorePointCount;
-   VREF_RESTORE_POINT m_restorePoints[MAX_VREF_RESTORE_POINTS];
+   UINT32 m_restorePoints[MAX_VREF_RESTORE_POINTS];
+   UINT32 m_version;
+   NXSL_Variable **m_slots;
+   int m_slotCount;
+   UINT32 m_slotVersion;
+
+   void resetSlots(UINT32 version);
 
 public:
    NXSL_VariableSystem(NXSL_VM *vm, bool constant = false);
@@ -847,8 +858,28 @@ class LIBNXSL_EXPORTABLE NXSL_VariableSystem : public NXSL_RuntimeObject
    void clear();
    bool isConstant() { return m_isConstant; }
 
-   bool createVariableReferenceRestorePoint(UINT32 addr, NXSL_Identifier *identifier);
-   void restoreVariableReferences(ObjectArray<NXSL_Instruction> *instructions);
+   bool createVariableReferenceRestorePoint(UINT32 addr);
+   void restoreVariableReferences(NXSL_ResolvedReference *references);
+
+   /**
+    * Version is changed every time new variable is created or variable system is cleared
+    */
+   UINT32 getVersion() const { return m_version; }
+
+   /**
+    * Get variable bound to given frame slot. All slots are reset if given version
+    * (version of global variable system) differs from version used when slots were bound.
+    */
+   NXSL_Variable *getSlot(int slot, UINT32 version)
+   {
+      if (version != m_slotVersion)
+      {
+         resetSlots(version);
+         return NULL;
+      }
+      return (slot < m_slotCount) ? m_slots[slot] : NULL;
+   }
+   void setSlot(int slot, NXSL_Variable *var);
 
    void dump(FILE *fp);
 };
@@ -880,6 +911,24 @@ struct NXSL_IdentifierLocation
    }
 };
 
+/**
+ * Immutable program image (code, constant pool, and function table) shared by all VMs running the program
+ */
+class LIBNXSL_EXPORTABLE NXSL_ProgramImage : public NXSL_ValueManager, public RefCountObject
+{
+   friend class NXSL_Program;
+   friend class NXSL_VM;
+
+protected:
+   ObjectArray<NXSL_Instruction> *m_instructions;
+   ObjectArray<NXSL_Function> *m_functions;
+
+   virtual ~NXSL_ProgramImage();
+
+public:
+   NXSL_ProgramImage(const ObjectArray<NXSL_Instruction> *instructions, const ObjectArray<NXSL_Function> *functions);
+};
+
 /**
  * Compiled NXSL program
  */
@@ -893,9 +942,14 @@ class LIBNXSL_EXPORTABLE NXSL_Program : public NXSL_ValueManager
    NXSL_ValueHashMap<NXSL_Identifier> *m_constants;
    ObjectArray<NXSL_Function> *m_functions;
    ObjectArray<NXSL_IdentifierLocation> *m_expressionVariables;
+   NXSL_ProgramImage *m_image;
 
 	UINT32 getFinalJumpDestination(UINT32 dwAddr, int srcJump);
    UINT32 getExpressionVariableCodeBlock(const NXSL_Identifier& identifier);
+   bool *createJumpTargetMap() const;
+   void foldConstants();
+   void removeUnreachableCode();
+   void createSuperInstructions();
 
 public:
    NXSL_Program();
@@ -908,9 +962,11 @@ class LIBNXSL_EXPORTABLE NXSL_Program : public NXSL_ValueManager
    void resolveLastJump(int opcode, int offset = 0);
 	void createJumpAt(UINT32 dwOpAddr, UINT32 dwJumpAddr);
    void addRequiredModule(const char *name, int lineNumber);
-	void optimize();
+	void optimize(bool extended = true);
 	void removeInstructions(UINT32 start, int count);
    bool addConstant(const NXSL_Identifier& name, NXSL_Value *value);
+   void resolveLocalVariables();
+   void finalize();
    void enableExpressionVariables();
    void disableExpressionVariables(int line);
    void registerExpressionVariable(const NXSL_Identifier& identifier);
@@ -967,6 +1023,7 @@ class LIBNXSL_EXPORTABLE NXSL_Library
 private:
    ObjectArray<NXSL_LibraryScript> *m_scriptList;
    MUTEX m_mutex;
+   VolatileCounter m_changeCounter;
 
    void deleteInternal(int nIndex);
 
@@ -984,6 +1041,8 @@ class LIBNXSL_EXPORTABLE NXSL_Library
    NXSL_LibraryScript *findScript(UINT32 id);
    NXSL_LibraryScript *findScript(const TCHAR *name);
    NXSL_VM *createVM(const TCHAR *name, NXSL_Environment *env);
+
+   UINT32 getChangeCounter() const { return m_changeCounter; }
    NXSL_VM *createVM(const TCHAR *name, NXSL_Environment *(*environmentCreator)(void*), bool (*scriptValidator)(NXSL_LibraryScript*, void*), void *context);
 
    void fillMessage(NXCPMessage *msg);
@@ -1049,7 +1108,10 @@ class LIBNXSL_EXPORTABLE NXSL_VM : public NXSL_ValueManager
    NXSL_Environment *m_env;
 	void *m_userData;
 
+   NXSL_ProgramImage *m_image;
    ObjectArray<NXSL_Instruction> *m_instructionSet;
+   ObjectArray<NXSL_Instruction> *m_moduleCode;
+   NXSL_ResolvedReference *m_resolvedReferences;
    UINT32 m_cp;
 
    UINT32 m_dwSubLevel;
@@ -1087,6 +1149,7 @@ class LIBNXSL_EXPORTABLE NXSL_VM : public NXSL_ValueManager
    void doBinaryOperation(int nOpCode);
    void getOrUpdateArrayElement(int opcode, NXSL_Value *array, NXSL_Value *index);
    bool setArrayElement(NXSL_Value *array, NXSL_Value *index, NXSL_Value *value);
+   void getAttribute(NXSL_Value *value, const char *attribute, bool safe);
    void getArrayAttribute(NXSL_Array *a, const char *attribute, bool safe);
    void getOrUpdateHashMapElement(int opcode, NXSL_Value *hashMap, NXSL_Value *key);
    bool setHashMapElement(NXSL_Value *hashMap, NXSL_Value *key, NXSL_Value *value);
@@ -1096,8 +1159,15 @@ class LIBNXSL_EXPORTABLE NXSL_VM : public NXSL_ValueManager
 
    NXSL_Variable *findVariable(const NXSL_Identifier& name, NXSL_VariableSystem **vs = NULL);
    NXSL_Variable *findOrCreateVariable(const NXSL_Identifier& name, NXSL_VariableSystem **vs = NULL);
+   NXSL_Variable *bindSlotVariable(const NXSL_Instruction *instr);
+   NXSL_Variable *findOrCreateSlotVariable(const NXSL_Instruction *instr)
+   {
+      NXSL_Variable *var = m_localVariables->getSlot(instr->m_stackItems, m_globalVariables->getVersion());
+      return (var != NULL) ? var : bindSlotVariable(instr);
+   }
 	NXSL_Variable *createVariable(const NXSL_Identifier& name);
 
+   void releaseCode();
    void relocateCode(UINT32 dwStartOffset, UINT32 dwLen, UINT32 dwShift);
    UINT32 getFunctionAddress(const NXSL_Identifier& name);
 
@@ -1109,6 +1179,7 @@ class LIBNXSL_EXPORTABLE NXSL_VM : public NXSL_ValueManager
 
 	void setGlobalVariable(const NXSL_Identifier& name, NXSL_Value *pValue);
 	NXSL_Variable *findGlobalVariable(const NXSL_Identifier& name) { return m_globalVariables->find(name); }
+	void clearGlobalVariables() { m_globalVariables->clear(); }
 
 	bool addConstant(const NXSL_Identifier& name, NXSL_Value *value);
 
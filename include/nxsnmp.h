@@ -586,6 +586,12 @@ class LIBNXSNMP_EXPORTABLE SNMP_PDU
    SNMP_Variable *getVariable(int index) { return m_variables->get(index); }
    UINT32 getVersion() { return m_version; }
    UINT32 getErrorCode() { return m_dwErrorCode; }
+   void setErrorCode(UINT32 errorCode) { m_dwErrorCode = errorCode; }
+
+   // GETBULK request parameters are encoded in place of error status and error index
+   void setBulkParameters(UINT32 nonRepeaters, UINT32 maxRepetitions) { m_dwErrorCode = nonRepeaters; m_dwErrorIndex = maxRepetitions; }
+   UINT32 getNonRepeaters() { return m_dwErrorCode; }
+   UINT32 getMaxRepetitions() { return m_dwErrorIndex; }
 
 	void setMessageId(UINT32 msgId) { m_msgId = msgId; }
 	UINT32 getMessageId() { return m_msgId; }
@@ -625,6 +631,7 @@ class LIBNXSNMP_EXPORTABLE SNMP_Transport
 	bool m_enableEngineIdAutoupdate;
 	bool m_updatePeerOnRecv;
 	bool m_reliable;
+	bool m_getBulkSupported;
 	SNMP_Version m_snmpVersion;
 
 public:
@@ -654,6 +661,10 @@ class LIBNXSNMP_EXPORTABLE SNMP_Transport
 
 	void setSnmpVersion(SNMP_Version version) { m_snmpVersion = version; }
 	SNMP_Version getSnmpVersion() const { return m_snmpVersion; }
+
+	// Cleared by SnmpWalk when agent rejects or ignores GETBULK requests
+	void setGetBulkSupported(bool supported) { m_getBulkSupported = supported; }
+	bool isGetBulkSupported() const { return m_getBulkSupported; }
 };
 
 /**
@@ -693,6 +704,89 @@ class LIBNXSNMP_EXPORTABLE SNMP_UDPTransport : public SNMP_Transport
 	bool isConnected() { return m_connected; }
 };
 
+/**
+ * Callback for asynchronous SNMP request completion. Response PDU is NULL
+ * if request failed and will be destroyed after callback returns.
+ */
+typedef void (*SNMP_AsyncRequestCallback)(UINT32 rc, SNMP_PDU *response, void *context);
+
+/**
+ * Callback for asynchronous raw SNMP request completion. Response data is NULL
+ * if request failed and is valid only until callback returns.
+ */
+typedef void (*SNMP_AsyncRawRequestCallback)(UINT32 rc, const BYTE *response, size_t size, void *context);
+
+/**
+ * Key for asynchronous SNMP request lookup (request ID or message ID and peer address)
+ */
+struct SNMP_AsyncRequestKey
+{
+   UINT32 id;
+   BYTE address[16];
+};
+
+struct SNMP_AsyncRequest;
+
+/**
+ * Number of slots in asynchronous SNMP client timer wheel
+ */
+#define SNMP_ASYNC_TIMER_WHEEL_SIZE    1024
+
+/**
+ * Asynchronous SNMP client. Requests to all peers are sent via shared UDP
+ * sockets (one per address family) and responses are matched to requests
+ * by request ID (SNMPv1/v2c) or message ID (SNMPv3) and peer address.
+ * Timeouts and retransmissions are handled by single I/O thread.
+ */
+class LIBNXSNMP_EXPORTABLE SNMP_AsyncClient
+{
+   DISABLE_COPY_CTOR(SNMP_AsyncClient)
+
+private:
+   SOCKET m_socketV4;
+   SOCKET m_socketV6;
+   THREAD m_ioThread;
+   MUTEX m_mutex;
+   bool m_shutdown;
+   bool m_accepting;    // Protected by m_mutex; cleared by I/O thread before aborting outstanding requests
+   ThreadPool *m_callbackPool;
+   HashMap<SNMP_AsyncRequestKey, SNMP_AsyncRequest> m_requests;
+   SNMP_AsyncRequest *m_timerWheel[SNMP_ASYNC_TIMER_WHEEL_SIZE];
+   INT64 m_lastTimerTick;
+   VolatileCounter m_pendingRequests;
+   VolatileCounter64 m_requestCount;
+   VolatileCounter64 m_retransmitCount;
+   VolatileCounter64 m_timeoutCount;
+
+   static THREAD_RESULT THREAD_CALL ioThreadStarter(void *arg);
+   void ioThread();
+
+   UINT32 submit(SNMP_AsyncRequest *request, const InetAddress& addr, UINT16 port);
+   UINT32 registerRequest(SNMP_AsyncRequest *request);
+   void scheduleTimeout(SNMP_AsyncRequest *request);
+   void cancelTimeout(SNMP_AsyncRequest *request);
+   void processResponse(const BYTE *data, size_t size, struct sockaddr *sender);
+   void processTimeouts();
+   void complete(SNMP_AsyncRequest *request);
+
+public:
+   SNMP_AsyncClient(ThreadPool *callbackPool = NULL);
+   ~SNMP_AsyncClient();
+
+   bool start();
+   void stop();
+
+   UINT32 sendRequest(const InetAddress& addr, UINT16 port, SNMP_PDU *request, SNMP_SecurityContext *securityContext,
+            UINT32 timeout, int numRetries, SNMP_AsyncRequestCallback callback, void *context);
+   UINT32 sendRawRequest(const InetAddress& addr, UINT16 port, const BYTE *pdu, size_t size,
+            UINT32 timeout, int numRetries, SNMP_AsyncRawRequestCallback callback, void *context);
+
+   int getPendingRequestCount() const { return m_pendingRequests; }
+   UINT64 getRequestCount() const { return m_requestCount; }
+   UINT64 getRetransmitCount() const { return m_retransmitCount; }
+   UINT64 getTimeoutCount() const { return m_timeoutCount; }
+};
+
 struct SNMP_SnapshotIndexEntry;
 
 /**
@@ -762,6 +856,10 @@ TCHAR LIBNXSNMP_EXPORTABLE *SNMPDataTypeName(UINT32 type, TCHAR *buffer, size_t
 UINT32 LIBNXSNMP_EXPORTABLE SnmpNewRequestId();
 void LIBNXSNMP_EXPORTABLE SnmpSetDefaultTimeout(UINT32 timeout);
 UINT32 LIBNXSNMP_EXPORTABLE SnmpGetDefaultTimeout();
+void LIBNXSNMP_EXPORTABLE SnmpSetBulkWalkMaxRepetitions(int maxRepetitions);
+int LIBNXSNMP_EXPORTABLE SnmpGetBulkWalkMaxRepetitions();
+void LIBNXSNMP_EXPORTABLE SnmpSetKeyCacheSize(int size);
+void LIBNXSNMP_EXPORTABLE SnmpGetKeyCacheStatistics(UINT64 *hits, UINT64 *misses, int *size);
 UINT32 LIBNXSNMP_EXPORTABLE SnmpGet(SNMP_Version version, SNMP_Transport *transport,
                                     const TCHAR *szOidStr, const UINT32 *oidBinary, size_t oidLen, void *pValue,
                                     size_t bufferSize, UINT32 dwFlags);
@@ -139,6 +139,8 @@ static LONG H_SupportedCiphers(const TCHAR *pszCmd, const TCHAR *pArg, TCHAR *pV
    else
    {
       *pValue = 0;
+      if (dwCiphers & NXCP_SUPPORT_AES_256_GCM)
+         _tcscat(pValue, _T("AES-256-GCM "));
       if (dwCiphers & NXCP_SUPPORT_AES_256)
          _tcscat(pValue, _T("AES-256 "));
       if (dwCiphers & NXCP_SUPPORT_AES_128)
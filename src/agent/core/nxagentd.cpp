@@ -76,6 +76,9 @@ THREAD_RESULT THREAD_CALL TunnelManager(void *);
 void ShutdownEventSender();
 void ShutdownSNMPTrapSender();
 
+void InitSNMPProxy();
+void ShutdownSNMPProxy();
+
 void ShutdownSyslogSender();
 
 void StartLocalDataCollector();
@@ -159,9 +162,9 @@ bool LoadConfig();
  */
 uuid g_agentId;
 #ifdef _WIN32
-UINT32 g_dwFlags = AF_ENABLE_ACTIONS | AF_ENABLE_AUTOLOAD | AF_WRITE_FULL_DUMP | AF_ENABLE_PUSH_CONNECTOR | AF_ENABLE_CONTROL_CONNECTOR | AF_REQUIRE_ENCRYPTION;
+UINT32 g_dwFlags = AF_ENABLE_ACTIONS | AF_ENABLE_AUTOLOAD | AF_WRITE_FULL_DUMP | AF_ENABLE_PUSH_CONNECTOR | AF_ENABLE_CONTROL_CONNECTOR | AF_REQUIRE_ENCRYPTION | AF_DETECT_COMPRESSED_FILES;
 #else
-UINT32 g_dwFlags = AF_ENABLE_ACTIONS | AF_ENABLE_AUTOLOAD | AF_ENABLE_PUSH_CONNECTOR | AF_REQUIRE_ENCRYPTION;
+UINT32 g_dwFlags = AF_ENABLE_ACTIONS | AF_ENABLE_AUTOLOAD | AF_ENABLE_PUSH_CONNECTOR | AF_REQUIRE_ENCRYPTION | AF_DETECT_COMPRESSED_FILES;
 #endif
 UINT32 g_failFlags = 0;
 TCHAR g_szLogFile[MAX_PATH] = AGENT_DEFAULT_LOG;
@@ -231,6 +234,7 @@ static TCHAR *s_externalSubAgentsList = NULL;
 static TCHAR *s_appAgentsList = NULL;
 static TCHAR *s_serverConnectionList = NULL;
 static UINT32 s_enabledCiphers = 0xFFFF;
+static UINT32 s_compressionThreshold = NXCP_DEFAULT_COMPRESSION_THRESHOLD;
 static THREAD s_sessionWatchdogThread = INVALID_THREAD_HANDLE;
 static THREAD s_listenerThread = INVALID_THREAD_HANDLE;
 static THREAD s_eventSenderThread = INVALID_THREAD_HANDLE;
@@ -267,6 +271,7 @@ static NX_CFG_TEMPLATE m_cfgTemplate[] =
    { _T("ActionShellExec"), CT_STRING_LIST, '\n', 0, 0, 0, &m_pszShellActionList, NULL },
    { _T("AppAgent"), CT_STRING_LIST, '\n', 0, 0, 0, &s_appAgentsList, NULL },
    { _T("BackgroundLogWriter"), CT_BOOLEAN, 0, 0, AF_BACKGROUND_LOG_WRITER, 0, &g_dwFlags, NULL },
+   { _T("CompressionThreshold"), CT_LONG, 0, 0, 0, 0, &s_compressionThreshold, NULL },
    { _T("ControlServers"), CT_STRING_LIST, ',', 0, 0, 0, &m_pszControlServerList, NULL },
    { _T("CreateCrashDumps"), CT_BOOLEAN, 0, 0, AF_CATCH_EXCEPTIONS, 0, &g_dwFlags, NULL },
    { _T("DataCollectionThreadPoolSize"), CT_LONG, 0, 0, 0, 0, &g_dcMaxCollectorPoolSize, NULL },
@@ -277,6 +282,7 @@ static NX_CFG_TEMPLATE m_cfgTemplate[] =
    { _T("DailyLogFileSuffix"), CT_STRING, 0, 0, 64, 0, s_dailyLogFileSuffix, NULL },
    { _T("DebugLevel"), CT_LONG, 0, 0, 0, 0, &s_debugLevel, &s_debugLevel },
    { _T("DebugTags"), CT_STRING_LIST, ',', 0, 0, 0, &s_debugTags, NULL },
+   { _T("DetectCompressedFiles"), CT_BOOLEAN, 0, 0, AF_DETECT_COMPRESSED_FILES, 0, &g_dwFlags, NULL },
    { _T("DisableIPv4"), CT_BOOLEAN, 0, 0, AF_DISABLE_IPV4, 0, &g_dwFlags, NULL },
    { _T("DisableIPv6"), CT_BOOLEAN, 0, 0, AF_DISABLE_IPV6, 0, &g_dwFlags, NULL },
    { _T("DumpDirectory"), CT_STRING, 0, 0, MAX_PATH, 0, s_dumpDir, NULL },
@@ -967,6 +973,9 @@ BOOL Initialize()
       return FALSE;
    }
 
+   NXCPSetCompressionThreshold(s_compressionThreshold);
+   NXCPSetCompressedFileDetection((g_dwFlags & AF_DETECT_COMPRESSED_FILES) != 0);
+
    // Initialize libssl - it is not used by core agent
    // but may be needed by some subagents. Allowing first load of libssl by
    // subagent via dlopen() may lead to undesired side effects
@@ -1020,7 +1029,7 @@ BOOL Initialize()
 	   g_commThreadPool = ThreadPoolCreate(_T("COMM"), 1, 32);
 	   if (g_dwFlags & AF_ENABLE_SNMP_PROXY)
 	   {
-	      g_snmpProxyThreadPool = ThreadPoolCreate(_T("SNMPPROXY"), 1, 128);
+	      InitSNMPProxy();
 	   }
 	   InitSessionList();
 
@@ -1403,7 +1412,7 @@ void Shutdown()
    {
       if (g_dwFlags & AF_ENABLE_SNMP_PROXY)
       {
-         ThreadPoolDestroy(g_snmpProxyThreadPool);
+         ShutdownSNMPProxy();
       }
       ThreadPoolDestroy(g_commThreadPool);
    }
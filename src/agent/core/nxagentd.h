@@ -104,6 +104,7 @@
 #define AF_SYSTEMD_DAEMON           0x08000000
 #define AF_JSON_LOG                 0x10000000
 #define AF_LOG_TO_STDOUT            0x20000000
+#define AF_DETECT_COMPRESSED_FILES  0x40000000
 
 // Flags for component failures
 #define FAIL_OPEN_LOG               0x00000001
@@ -313,7 +314,7 @@ class CommSession : public AbstractCommSession
    bool m_ipv6Aware;
    bool m_bulkReconciliationSupported;
    HashMap<UINT32, DownloadFileInfo> m_downloadFileMap;
-   bool m_allowCompression;   // allow compression for structured messages
+   NXCPStreamCompressionMethod m_compressionMethod;   // compression method for structured messages (NONE if compression is not allowed)
 	NXCPEncryptionContext *m_pCtx;
    time_t m_ts;               // Last activity timestamp
    SOCKET m_hProxySocket;     // Socket for proxy connection
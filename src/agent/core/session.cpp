@@ -146,7 +146,7 @@ CommSession::CommSession(AbstractCommChannel *channel, const InetAddress &server
    m_ipv6Aware = false;
    m_bulkReconciliationSupported = false;
    m_disconnected = false;
-   m_allowCompression = false;
+   m_compressionMethod = NXCP_STREAM_COMPRESSION_NONE;
    m_pCtx = NULL;
    m_ts = time(NULL);
    m_socketWriteMutex = MutexCreate();
@@ -458,14 +458,16 @@ bool CommSession::sendRawMessage(NXCP_MESSAGE *msg, NXCPEncryptionContext *ctx)
 
    if ((ctx != NULL) && (ctx != PROXY_ENCRYPTION_CTX))
    {
-      NXCP_ENCRYPTED_MESSAGE *enMsg = ctx->encryptMessage(msg);
+      BYTE localBuffer[8192];
+      NXCP_ENCRYPTED_MESSAGE *enMsg = ctx->encryptMessage(msg, localBuffer, sizeof(localBuffer));
       if (enMsg != NULL)
       {
          if (m_channel->send(enMsg, ntohl(enMsg->size), m_socketWriteMutex) <= 0)
          {
             success = false;
          }
-         free(enMsg);
+         if (reinterpret_cast<BYTE*>(enMsg) != localBuffer)
+            MemFree(enMsg);
       }
    }
    else
@@ -494,7 +496,30 @@ bool CommSession::sendMessage(const NXCPMessage *msg)
    if (m_disconnected)
       return false;
 
-   return sendRawMessage(msg->serialize(m_allowCompression), m_pCtx);
+   // Send messages that will be neither encrypted nor compressed as list of blocks to avoid copying large binary fields.
+   // Full message dump on debug level 8 requires serialized message, so regular path is used in that case.
+   NXCPEncryptionContext *ctx = m_pCtx;
+   if (((ctx == NULL) || (ctx == PROXY_ENCRYPTION_CTX)) && !msg->isCompressible(m_compressionMethod) && (nxlog_get_debug_level() < 8))
+   {
+      NXCPMessageBlocks blocks;
+      msg->serializeToBlocks(&blocks);
+      if (nxlog_get_debug_level() >= 6)
+      {
+         TCHAR buffer[128];
+         debugPrintf(6, _T("Sending message %s (ID %d; size %d; uncompressed)"), NXCPMessageCodeName(msg->getCode(), buffer),
+                  msg->getId(), static_cast<int>(blocks.getSize()));
+      }
+      if (m_channel->sendv(blocks.getBlocks(), blocks.getCount(), m_socketWriteMutex) <= 0)
+      {
+         TCHAR buffer[128];
+         debugPrintf(6, _T("CommSession::sendMessage() for %s (size %d) failed (error %d: %s)"),
+                  NXCPMessageCodeName(msg->getCode(), buffer), static_cast<int>(blocks.getSize()), WSAGetLastError(), _tcserror(WSAGetLastError()));
+         return false;
+      }
+      return true;
+   }
+
+   return sendRawMessage(msg->serialize(m_compressionMethod), ctx);
 }
 
 /**
@@ -513,7 +538,7 @@ void CommSession::postMessage(const NXCPMessage *msg)
    if (m_disconnected)
       return;
    incRefCount();
-   ThreadPoolExecuteSerialized(g_commThreadPool, m_key, this, &CommSession::sendMessageInBackground, msg->serialize(m_allowCompression));
+   ThreadPoolExecuteSerialized(g_commThreadPool, m_key, this, &CommSession::sendMessageInBackground, msg->serialize(m_compressionMethod));
 }
 
 /**
@@ -686,13 +711,24 @@ void CommSession::processingThread()
                // Servers before 2.0 use VID_ENABLED
                m_ipv6Aware = request->isFieldExist(VID_IPV6_SUPPORT) ? request->getFieldAsBoolean(VID_IPV6_SUPPORT) : request->getFieldAsBoolean(VID_ENABLED);
                m_bulkReconciliationSupported = request->getFieldAsBoolean(VID_BULK_RECONCILIATION);
-               m_allowCompression = request->getFieldAsBoolean(VID_ENABLE_COMPRESSION);
+               if (request->getFieldAsBoolean(VID_ENABLE_COMPRESSION))
+               {
+                  // Servers without support for compression methods negotiation can only use deflate
+                  m_compressionMethod = request->isFieldExist(VID_COMPRESSION_METHODS) ?
+                           NXCPSelectCompressionMethod(request->getFieldAsUInt16(VID_COMPRESSION_METHODS) & NXCPGetSupportedCompressionMethods()) :
+                           NXCP_STREAM_COMPRESSION_DEFLATE;
+               }
+               else
+               {
+                  m_compressionMethod = NXCP_STREAM_COMPRESSION_NONE;
+               }
                response.setField(VID_RCC, ERR_SUCCESS);
                response.setField(VID_FLAGS, static_cast<UINT16>((m_controlServer ? 0x01 : 0x00) | (m_masterServer ? 0x02 : 0x00)));
+               response.setField(VID_COMPRESSION_METHODS, NXCPGetSupportedCompressionMethods());
                debugPrintf(1, _T("Server capabilities: IPv6: %s; bulk reconciliation: %s; compression: %s"),
                            m_ipv6Aware ? _T("yes") : _T("no"),
                            m_bulkReconciliationSupported ? _T("yes") : _T("no"),
-                           m_allowCompression ? _T("yes") : _T("no"));
+                           (m_compressionMethod == NXCP_STREAM_COMPRESSION_LZ4) ? _T("LZ4") : ((m_compressionMethod == NXCP_STREAM_COMPRESSION_DEFLATE) ? _T("deflate") : _T("no")));
                break;
             case CMD_SET_SERVER_ID:
                m_serverId = request->getFieldAsUInt64(VID_SERVER_ID);
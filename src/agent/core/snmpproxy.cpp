@@ -35,6 +35,37 @@ static VolatileCounter64 s_snmpRequests = 0;
 static VolatileCounter64 s_snmpResponses = 0;
 extern UINT64 g_snmpTraps;
 
+/**
+ * Asynchronous SNMP client used for proxying requests
+ */
+static SNMP_AsyncClient *s_asyncClient = NULL;
+
+/**
+ * Initialize SNMP proxy
+ */
+void InitSNMPProxy()
+{
+   g_snmpProxyThreadPool = ThreadPoolCreate(_T("SNMPPROXY"), 1, 128);
+   s_asyncClient = new SNMP_AsyncClient(g_snmpProxyThreadPool);
+   if (!s_asyncClient->start())
+   {
+      nxlog_debug(1, _T("Cannot start asynchronous SNMP client, SNMP proxy will use synchronous requests"));
+      delete_and_null(s_asyncClient);
+   }
+}
+
+/**
+ * Shutdown SNMP proxy
+ */
+void ShutdownSNMPProxy()
+{
+   // Outstanding requests are completed as aborted via thread pool, so client can be destroyed only after pool shutdown
+   if (s_asyncClient != NULL)
+      s_asyncClient->stop();
+   ThreadPoolDestroy(g_snmpProxyThreadPool);
+   delete_and_null(s_asyncClient);
+}
+
 /**
  * Handler for SNMP proxy information parameters
  */
@@ -79,6 +110,41 @@ static bool ReadPDU(SOCKET hSocket, BYTE *pdu, UINT32 *pdwSize, UINT32 timeout)
 	return false;
 }
 
+/**
+ * Context for asynchronous proxy request
+ */
+struct SNMPProxyRequestContext
+{
+   CommSession *session;
+   UINT32 requestId;
+   int protocolVersion;
+};
+
+/**
+ * Completion callback for asynchronous proxy request
+ */
+static void SNMPProxyRequestCallback(UINT32 rc, const BYTE *pdu, size_t size, void *arg)
+{
+   SNMPProxyRequestContext *context = static_cast<SNMPProxyRequestContext*>(arg);
+
+   NXCPMessage response(CMD_REQUEST_COMPLETED, context->requestId, context->protocolVersion);
+   if (rc == SNMP_ERR_SUCCESS)
+   {
+      InterlockedIncrement64(&s_snmpResponses);
+      response.setField(VID_PDU_SIZE, static_cast<UINT32>(size));
+      response.setField(VID_PDU, pdu, size);
+      response.setField(VID_RCC, ERR_SUCCESS);
+   }
+   else
+   {
+      response.setField(VID_RCC, (rc == SNMP_ERR_TIMEOUT) ? ERR_REQUEST_TIMEOUT : ERR_SOCKET_ERROR);
+   }
+   context->session->debugPrintf(7, _T("proxySnmpRequest(%d): %s"), context->requestId, (rc == SNMP_ERR_SUCCESS) ? _T("success") : _T("failure"));
+   context->session->sendMessage(&response);
+   context->session->decRefCount();
+   delete context;
+}
+
 /**
  * Send SNMP request to target, receive response, and send it to server
  */
@@ -93,6 +159,27 @@ void CommSession::proxySnmpRequest(NXCPMessage *request)
    if ((pduIn != NULL) && (sizeIn > 0))
    {
       InetAddress addr = request->getFieldAsInetAddress(VID_IP_ADDRESS);
+      if (s_asyncClient != NULL)
+      {
+         UINT32 serverTimeout = request->getFieldAsUInt32(VID_TIMEOUT);
+         UINT32 timeout = (g_snmpTimeout != 0) ? g_snmpTimeout : ((serverTimeout != 0) ? serverTimeout : 1000);   // 1 second if not set
+
+         SNMPProxyRequestContext *context = new SNMPProxyRequestContext;
+         context->session = this;
+         context->requestId = requestId;
+         context->protocolVersion = m_protocolVersion;
+         UINT32 rc = s_asyncClient->sendRawRequest(addr, request->getFieldAsUInt16(VID_PORT), pduIn, sizeIn, timeout, 3, SNMPProxyRequestCallback, context);
+         if (rc == SNMP_ERR_SUCCESS)
+         {
+            // Session reference will be released by completion callback
+            InterlockedIncrement64(&s_snmpRequests);
+            delete request;
+            return;
+         }
+         delete context;
+         debugPrintf(7, _T("proxySnmpRequest(%d): asynchronous request failed (%d), falling back to synchronous request"), requestId, rc);
+      }
+
       SOCKET hSocket = CreateSocket(addr.getFamily(), SOCK_DGRAM, 0);
       if (hSocket != INVALID_SOCKET)
       {
@@ -27,6 +27,11 @@
 
 #define REQUEST_TIMEOUT	10000
 
+/**
+ * Size of buffer used to coalesce small blocks into single TLS record (maximum TLS record size)
+ */
+#define TLS_WRITE_BUFFER_SIZE 16384
+
 #ifdef _WITH_ENCRYPTION
 
 /**
@@ -72,6 +77,7 @@ class TunnelCommChannel : public AbstractCommChannel
    TunnelCommChannel(Tunnel *tunnel);
 
    virtual int send(const void *data, size_t size, MUTEX mutex = INVALID_MUTEX_HANDLE);
+   virtual int sendv(const SGBuffer *buffers, int count, MUTEX mutex = INVALID_MUTEX_HANDLE);
    virtual int recv(void *buffer, size_t size, UINT32 timeout = INFINITE);
    virtual int poll(UINT32 timeout, bool write = false);
    virtual int shutdown();
@@ -111,7 +117,9 @@ class Tunnel
    Tunnel(const TCHAR *hostname, UINT16 port);
 
    bool connectToServer();
+   int sslWriteInternal(const void *data, size_t size);
    int sslWrite(const void *data, size_t size);
+   int sslWritev(const SGBuffer *blocks, int count);
    bool sendMessage(const NXCPMessage *msg);
    NXCPMessage *waitForMessage(UINT16 code, UINT32 id) { return (m_queue != NULL) ? m_queue->waitForMessage(code, id, REQUEST_TIMEOUT) : NULL; }
 
@@ -135,6 +143,7 @@ class Tunnel
    TunnelCommChannel *createChannel();
    void closeChannel(TunnelCommChannel *channel);
    int sendChannelData(UINT32 id, const void *data, size_t len);
+   int sendChannelData(UINT32 id, const SGBuffer *data, int count);
 
    const TCHAR *getHostname() const { return m_hostname; }
 
@@ -316,16 +325,12 @@ void Tunnel::recvThread()
 }
 
 /**
- * Write to SSL
+ * Write to SSL (caller should hold write lock)
  */
-int Tunnel::sslWrite(const void *data, size_t size)
+int Tunnel::sslWriteInternal(const void *data, size_t size)
 {
-   if (!m_connected || m_reset)
-      return -1;
-
    bool canRetry;
    int bytes;
-   MutexLock(m_writeLock);
    do
    {
       canRetry = false;
@@ -353,10 +358,84 @@ int Tunnel::sslWrite(const void *data, size_t size)
       MutexUnlock(m_sslLock);
    }
    while(canRetry);
+   return bytes;
+}
+
+/**
+ * Write to SSL
+ */
+int Tunnel::sslWrite(const void *data, size_t size)
+{
+   if (!m_connected || m_reset)
+      return -1;
+
+   MutexLock(m_writeLock);
+   int bytes = sslWriteInternal(data, size);
    MutexUnlock(m_writeLock);
    return bytes;
 }
 
+/**
+ * Write multiple data blocks to SSL without interleaving with other writers. Small blocks
+ * are coalesced to avoid creating separate TLS record for each, large blocks are written directly.
+ * Returns total number of bytes written or result of failed SSL_write call.
+ */
+int Tunnel::sslWritev(const SGBuffer *blocks, int count)
+{
+   if (!m_connected || m_reset)
+      return -1;
+
+   BYTE buffer[TLS_WRITE_BUFFER_SIZE];
+   size_t pending = 0;
+   int total = 0;
+   MutexLock(m_writeLock);
+   for(int i = 0; i < count; i++)
+   {
+      if (pending + blocks[i].size <= TLS_WRITE_BUFFER_SIZE)
+      {
+         memcpy(&buffer[pending], blocks[i].data, blocks[i].size);
+         pending += blocks[i].size;
+         continue;
+      }
+
+      if (pending > 0)
+      {
+         int bytes = sslWriteInternal(buffer, pending);
+         if (bytes <= 0)
+         {
+            total = bytes;
+            break;
+         }
+         total += bytes;
+         pending = 0;
+      }
+
+      if (blocks[i].size <= TLS_WRITE_BUFFER_SIZE)
+      {
+         memcpy(buffer, blocks[i].data, blocks[i].size);
+         pending = blocks[i].size;
+      }
+      else
+      {
+         int bytes = sslWriteInternal(blocks[i].data, blocks[i].size);
+         if (bytes <= 0)
+         {
+            total = bytes;
+            pending = 0;
+            break;
+         }
+         total += bytes;
+      }
+   }
+   if (pending > 0)
+   {
+      int bytes = sslWriteInternal(buffer, pending);
+      total = (bytes > 0) ? total + bytes : bytes;
+   }
+   MutexUnlock(m_writeLock);
+   return total;
+}
+
 /**
  * Send message
  */
@@ -370,10 +449,9 @@ bool Tunnel::sendMessage(const NXCPMessage *msg)
       TCHAR buffer[64];
       debugPrintf(6, _T("Sending message %s"), NXCPMessageCodeName(msg->getCode(), buffer));
    }
-   NXCP_MESSAGE *data = msg->serialize(false);
-   bool success = (sslWrite(data, ntohl(data->size)) == ntohl(data->size));
-   free(data);
-   return success;
+   NXCPMessageBlocks blocks;
+   msg->serializeToBlocks(&blocks);
+   return sslWritev(blocks.getBlocks(), blocks.getCount()) == static_cast<int>(blocks.getSize());
 }
 
 /**
@@ -1076,11 +1154,47 @@ void Tunnel::closeChannel(TunnelCommChannel *channel)
  */
 int Tunnel::sendChannelData(UINT32 id, const void *data, size_t len)
 {
-   NXCP_MESSAGE *msg = CreateRawNXCPMessage(CMD_CHANNEL_DATA, id, 0, data, len, NULL, false);
-   int rc = sslWrite(msg, ntohl(msg->size));
-   if (rc == ntohl(msg->size))
-      rc = (int)len;  // adjust number of bytes to exclude tunnel overhead
-   free(msg);
+   SGBuffer block;
+   block.data = data;
+   block.size = len;
+   return sendChannelData(id, &block, 1);
+}
+
+/**
+ * Send channel data from multiple blocks as single channel data message
+ */
+int Tunnel::sendChannelData(UINT32 id, const SGBuffer *data, int count)
+{
+   size_t len = 0;
+   for(int i = 0; i < count; i++)
+      len += data[i].size;
+
+   // Message should be aligned to 8 bytes boundary
+   static const BYTE padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+   size_t paddingSize = (8 - ((len + NXCP_HEADER_SIZE) % 8)) & 7;
+   size_t msgSize = len + NXCP_HEADER_SIZE + paddingSize;
+
+   NXCP_MESSAGE header;
+   header.code = htons(CMD_CHANNEL_DATA);
+   header.flags = htons(MF_BINARY);
+   header.size = htonl(static_cast<UINT32>(msgSize));
+   header.id = htonl(id);
+   header.numFields = htonl(static_cast<UINT32>(len));   // numFields contains actual data size for binary message
+
+   SGBuffer localBlocks[16];
+   SGBuffer *blocks = (count + 2 <= 16) ? localBlocks : MemAllocArrayNoInit<SGBuffer>(count + 2);
+   blocks[0].data = &header;
+   blocks[0].size = NXCP_HEADER_SIZE;
+   memcpy(&blocks[1], data, sizeof(SGBuffer) * count);
+   blocks[count + 1].data = padding;
+   blocks[count + 1].size = paddingSize;
+
+   int rc = sslWritev(blocks, count + 2);
+   if (rc == static_cast<int>(msgSize))
+      rc = static_cast<int>(len);  // adjust number of bytes to exclude tunnel overhead
+
+   if (blocks != localBlocks)
+      MemFree(blocks);
    return rc;
 }
 
@@ -1144,6 +1258,14 @@ int TunnelCommChannel::send(const void *data, size_t size, MUTEX mutex)
    return m_active ? m_tunnel->sendChannelData(m_id, data, size) : -1;
 }
 
+/**
+ * Send data from multiple buffers as single channel data message
+ */
+int TunnelCommChannel::sendv(const SGBuffer *buffers, int count, MUTEX mutex)
+{
+   return m_active ? m_tunnel->sendChannelData(m_id, buffers, count) : -1;
+}
+
 /**
  * Receive data
  */
@@ -40,6 +40,62 @@ HashMap<uuid, LoraDeviceData> g_deviceMap(true);
  */
 MUTEX g_deviceMapMutex = INVALID_MUTEX_HANDLE;
 
+/**
+ * Handler for message bus parameters
+ */
+static LONG H_MessageBus(const TCHAR *param, const TCHAR *arg, TCHAR *value, AbstractCommSession *session)
+{
+   NXMBDispatcherStatistics stats;
+   NXMBDispatcher::getInstance()->getStatistics(&stats);
+   switch(*arg)
+   {
+      case 'B':
+         ret_uint64(value, stats.batches);
+         break;
+      case 'P':
+         ret_uint64(value, stats.postedMessages);
+         break;
+      case 'Q':
+         ret_uint(value, static_cast<UINT32>(stats.queueSize));
+         break;
+      case 'R':
+         ret_uint64(value, stats.processedMessages);
+         break;
+      case 'W':
+         ret_int(value, stats.workers);
+         break;
+      default:
+         return SYSINFO_RC_UNSUPPORTED;
+   }
+   return SYSINFO_RC_SUCCESS;
+}
+
+/**
+ * Handler for message bus subscribers table
+ */
+static LONG H_MessageBusSubscribers(const TCHAR *param, const TCHAR *arg, Table *value, AbstractCommSession *session)
+{
+   value->addColumn(_T("ID"), DCI_DT_STRING, _T("ID"), true);
+   value->addColumn(_T("WORKER"), DCI_DT_INT, _T("Worker"));
+   value->addColumn(_T("MESSAGES"), DCI_DT_UINT64, _T("Messages"));
+   value->addColumn(_T("TOTAL_TIME"), DCI_DT_UINT64, _T("Total handler time (us)"));
+   value->addColumn(_T("MAX_TIME"), DCI_DT_UINT64, _T("Max handler time (us)"));
+
+   ObjectArray<NXMBSubscriberStatistics> *subscribers = NXMBDispatcher::getInstance()->getSubscriberStatistics();
+   for(int i = 0; i < subscribers->size(); i++)
+   {
+      NXMBSubscriberStatistics *s = subscribers->get(i);
+      value->addRow();
+      value->set(0, s->id);
+      value->set(1, s->worker);
+      value->set(2, s->messages);
+      value->set(3, s->totalHandlerTime);
+      value->set(4, s->maxHandlerTime);
+   }
+   delete subscribers;
+   return SYSINFO_RC_SUCCESS;
+}
+
 /**
  * Parameters
  */
@@ -51,7 +107,20 @@ static NETXMS_SUBAGENT_PARAM m_parameters[] =
    { _T("LoraWAN.MessageCount(*)"), H_Communication, _T("M"), DCI_DT_UINT, _T("Message count") },
    { _T("LoraWAN.DataRate(*)"), H_Communication, _T("D"), DCI_DT_STRING, _T("Data rate") },
    { _T("LoraWAN.LastContact(*)"), H_Communication, _T("C"), DCI_DT_STRING, _T("Last contact") },
-   { _T("LoraWAN.DevAddr(*)"), H_Communication, _T("A"), DCI_DT_STRING, _T("DevAddr") }
+   { _T("LoraWAN.DevAddr(*)"), H_Communication, _T("A"), DCI_DT_STRING, _T("DevAddr") },
+   { _T("LoraWAN.MessageBus.Batches"), H_MessageBus, _T("B"), DCI_DT_UINT64, _T("LoraWAN message bus: processed message batches") },
+   { _T("LoraWAN.MessageBus.PostedMessages"), H_MessageBus, _T("P"), DCI_DT_UINT64, _T("LoraWAN message bus: posted messages") },
+   { _T("LoraWAN.MessageBus.ProcessedMessages"), H_MessageBus, _T("R"), DCI_DT_UINT64, _T("LoraWAN message bus: processed messages") },
+   { _T("LoraWAN.MessageBus.QueueSize"), H_MessageBus, _T("Q"), DCI_DT_UINT, _T("LoraWAN message bus: queue size") },
+   { _T("LoraWAN.MessageBus.Workers"), H_MessageBus, _T("W"), DCI_DT_INT, _T("LoraWAN message bus: worker threads") }
+};
+
+/**
+ * Tables
+ */
+static NETXMS_SUBAGENT_TABLE m_tables[] =
+{
+   { _T("LoraWAN.MessageBus.Subscribers"), H_MessageBusSubscribers, NULL, _T("ID"), _T("LoraWAN message bus: subscribers") }
 };
 
 /**
@@ -151,6 +220,9 @@ static bool ProcessCommands(UINT32 command, NXCPMessage *request, NXCPMessage *r
  */
 static bool SubagentInit(Config *config)
 {
+   // Should be set before first access to message bus
+   NXMBDispatcher::setWorkerCount(config->getValueAsInt(_T("/LORAWAN/MessageBusWorkers"), 1));
+
    g_deviceMapMutex = MutexCreate();
 
    LoadDevices();
@@ -190,7 +262,7 @@ static NETXMS_SUBAGENT_INFO m_info =
 	sizeof(m_parameters) / sizeof(NETXMS_SUBAGENT_PARAM),
 	m_parameters,
 	0, NULL,		// lists
-	0, NULL,		// tables
+	sizeof(m_tables) / sizeof(NETXMS_SUBAGENT_TABLE), m_tables,
    0, NULL,    // actions
 	0, NULL		// push parameters
 };
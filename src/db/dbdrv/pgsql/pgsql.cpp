@@ -1271,6 +1271,218 @@ extern "C" void __EXPORT DrvFreeUnbufferedResult(PG_UNBUFFERED_RESULT *result)
    MemFree(result);
 }
 
+/**
+ * Set error text from connection's last error message
+ */
+static void SetConnectionErrorText(PG_CONN *pConn, WCHAR *errorText)
+{
+   if (errorText == NULL)
+      return;
+   MultiByteToWideChar(CP_UTF8, 0, PQerrorMessage(pConn->handle), -1, errorText, DBDRV_MAX_ERROR_TEXT);
+   errorText[DBDRV_MAX_ERROR_TEXT - 1] = 0;
+   RemoveTrailingCRLFW(errorText);
+}
+
+/**
+ * Send buffered COPY data to server
+ */
+static bool FlushBulkInsertBuffer(PG_BULK_INSERT *bulk)
+{
+   if (bulk->size == 0)
+      return true;
+   bool success = (PQputCopyData(bulk->connection->handle, bulk->buffer, static_cast<int>(bulk->size)) == 1);
+   bulk->size = 0;
+   return success;
+}
+
+/**
+ * Start bulk insert using COPY FROM STDIN. If duplicate rows should be ignored, data is
+ * copied into temporary staging table and moved into target table with INSERT ... ON CONFLICT DO NOTHING
+ * when bulk insert completes. Connection remains locked until DrvBulkInsertEnd is called.
+ */
+extern "C" DBDRV_BULK_INSERT __EXPORT DrvBulkInsertBegin(PG_CONN *pConn, const WCHAR *table, const WCHAR *columns, int columnCount, bool ignoreDuplicates, DWORD *pdwError, WCHAR *errorText)
+{
+   char *utf8table = UTF8StringFromWideString(table);
+   char *utf8columns = UTF8StringFromWideString(columns);
+   char *stagingTable = NULL;
+
+   MutexLock(pConn->mutexQueryLock);
+
+   if (ignoreDuplicates)
+   {
+      size_t len = strlen(utf8table) + 16;
+      stagingTable = MemAllocStringA(len);
+      snprintf(stagingTable, len, "nx_bulk_%s", utf8table);
+
+      char query[512];
+      snprintf(query, 512, "CREATE TEMPORARY TABLE IF NOT EXISTS %s (LIKE %s INCLUDING DEFAULTS)", stagingTable, utf8table);
+      if (!UnsafeDrvQuery(pConn, query, errorText))
+      {
+         *pdwError = (PQstatus(pConn->handle) == CONNECTION_BAD) ? DBERR_CONNECTION_LOST : DBERR_OTHER_ERROR;
+         MutexUnlock(pConn->mutexQueryLock);
+         MemFree(utf8table);
+         MemFree(utf8columns);
+         MemFree(stagingTable);
+         return NULL;
+      }
+   }
+
+   size_t len = strlen(utf8columns) + strlen((stagingTable != NULL) ? stagingTable : utf8table) + 32;
+   char *query = MemAllocStringA(len);
+   snprintf(query, len, "COPY %s (%s) FROM STDIN", (stagingTable != NULL) ? stagingTable : utf8table, utf8columns);
+   PGresult *pResult = PQexec(pConn->handle, query);
+   MemFree(query);
+
+   if ((pResult == NULL) || (PQresultStatus(pResult) != PGRES_COPY_IN))
+   {
+      SetConnectionErrorText(pConn, errorText);
+      *pdwError = (PQstatus(pConn->handle) == CONNECTION_BAD) ? DBERR_CONNECTION_LOST : DBERR_OTHER_ERROR;
+      if (pResult != NULL)
+         PQclear(pResult);
+      MutexUnlock(pConn->mutexQueryLock);
+      MemFree(utf8table);
+      MemFree(utf8columns);
+      MemFree(stagingTable);
+      return NULL;
+   }
+   PQclear(pResult);
+
+   PG_BULK_INSERT *bulk = MemAllocStruct<PG_BULK_INSERT>();
+   bulk->connection = pConn;
+   bulk->table = utf8table;
+   bulk->columns = utf8columns;
+   bulk->stagingTable = stagingTable;
+   bulk->columnCount = columnCount;
+   bulk->allocated = 65536;
+   bulk->buffer = MemAllocStringA(bulk->allocated);
+   *pdwError = DBERR_SUCCESS;
+   return bulk;
+}
+
+/**
+ * Add row to bulk insert (values are encoded in COPY text format)
+ */
+extern "C" DWORD __EXPORT DrvBulkInsertAddRow(PG_BULK_INSERT *bulk, const WCHAR **values, WCHAR *errorText)
+{
+   char localBuffer[1024];
+   for(int i = 0; i < bulk->columnCount; i++)
+   {
+      char *value;
+      if (values[i] != NULL)
+      {
+         value = WideStringToUTF8(values[i], localBuffer, 1024);
+      }
+      else
+      {
+         localBuffer[0] = 0;  // NULL value is sent as empty string
+         value = localBuffer;
+      }
+
+      // Each character can be escaped, plus one byte for field separator
+      size_t required = strlen(value) * 2 + 1;
+      if (bulk->size + required > bulk->allocated)
+      {
+         bulk->allocated += std::max(required, static_cast<size_t>(65536));
+         bulk->buffer = MemRealloc(bulk->buffer, bulk->allocated);
+      }
+
+      char *out = &bulk->buffer[bulk->size];
+      for(const char *p = value; *p != 0; p++)
+      {
+         switch(*p)
+         {
+            case '\\':
+               *out++ = '\\';
+               *out++ = '\\';
+               break;
+            case '\t':
+               *out++ = '\\';
+               *out++ = 't';
+               break;
+            case '\n':
+               *out++ = '\\';
+               *out++ = 'n';
+               break;
+            case '\r':
+               *out++ = '\\';
+               *out++ = 'r';
+               break;
+            default:
+               *out++ = *p;
+               break;
+         }
+      }
+      *out++ = (i < bulk->columnCount - 1) ? '\t' : '\n';
+      bulk->size = out - bulk->buffer;
+      FreeConvertedString(value, localBuffer);
+   }
+
+   if ((bulk->size >= 60000) && !FlushBulkInsertBuffer(bulk))
+   {
+      SetConnectionErrorText(bulk->connection, errorText);
+      return (PQstatus(bulk->connection->handle) == CONNECTION_BAD) ? DBERR_CONNECTION_LOST : DBERR_OTHER_ERROR;
+   }
+   return DBERR_SUCCESS;
+}
+
+/**
+ * Complete bulk insert and destroy context
+ */
+extern "C" DWORD __EXPORT DrvBulkInsertEnd(PG_BULK_INSERT *bulk, WCHAR *errorText)
+{
+   PG_CONN *pConn = bulk->connection;
+   DWORD rc = DBERR_SUCCESS;
+
+   if (!FlushBulkInsertBuffer(bulk))
+   {
+      SetConnectionErrorText(pConn, errorText);
+      rc = DBERR_OTHER_ERROR;
+   }
+
+   if (PQputCopyEnd(pConn->handle, (rc == DBERR_SUCCESS) ? NULL : "bulk insert aborted") == 1)
+   {
+      PGresult *pResult;
+      while((pResult = PQgetResult(pConn->handle)) != NULL)
+      {
+         if ((rc == DBERR_SUCCESS) && (PQresultStatus(pResult) != PGRES_COMMAND_OK))
+         {
+            SetConnectionErrorText(pConn, errorText);
+            rc = DBERR_OTHER_ERROR;
+         }
+         PQclear(pResult);
+      }
+   }
+   else if (rc == DBERR_SUCCESS)
+   {
+      SetConnectionErrorText(pConn, errorText);
+      rc = DBERR_OTHER_ERROR;
+   }
+
+   if ((rc == DBERR_SUCCESS) && (bulk->stagingTable != NULL))
+   {
+      size_t len = strlen(bulk->table) + strlen(bulk->stagingTable) + strlen(bulk->columns) * 2 + 64;
+      char *query = MemAllocStringA(len);
+      snprintf(query, len, "INSERT INTO %s (%s) SELECT %s FROM %s ON CONFLICT DO NOTHING", bulk->table, bulk->columns, bulk->columns, bulk->stagingTable);
+      if (!UnsafeDrvQuery(pConn, query, errorText))
+         rc = DBERR_OTHER_ERROR;
+      snprintf(query, len, "TRUNCATE %s", bulk->stagingTable);
+      UnsafeDrvQuery(pConn, query, NULL);
+      MemFree(query);
+   }
+
+   if ((rc != DBERR_SUCCESS) && (PQstatus(pConn->handle) == CONNECTION_BAD))
+      rc = DBERR_CONNECTION_LOST;
+
+   MutexUnlock(pConn->mutexQueryLock);
+
+   MemFree(bulk->table);
+   MemFree(bulk->columns);
+   MemFree(bulk->stagingTable);
+   MemFree(bulk->buffer);
+   MemFree(bulk);
+   return rc;
+}
+
 /**
  * Begin transaction
  */
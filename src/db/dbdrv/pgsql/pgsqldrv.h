@@ -79,4 +79,19 @@ typedef struct
    int currRow;
 } PG_UNBUFFERED_RESULT;
 
+/**
+ * Bulk insert (COPY FROM STDIN) context
+ */
+typedef struct
+{
+   PG_CONN *connection;
+   char *table;
+   char *columns;
+   char *stagingTable;  // Temporary table used for duplicate elimination (NULL if COPY goes directly to target table)
+   int columnCount;
+   size_t size;         // Size of buffered data
+   size_t allocated;    // Allocated buffer size
+   char *buffer;
+} PG_BULK_INSERT;
+
 #endif   /* _pgsqldrv_h_ */
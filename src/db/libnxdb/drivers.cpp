@@ -196,6 +196,9 @@ DB_DRIVER LIBNXDB_EXPORTABLE DBLoadDriver(const TCHAR *module, const TCHAR *init
    driver->m_fpDrvPrepareStringA = (char* (*)(const char *))DLGetSymbolAddrEx(driver->m_handle, "DrvPrepareStringA");
    driver->m_fpDrvPrepareStringW = (WCHAR* (*)(const WCHAR *))DLGetSymbolAddrEx(driver->m_handle, "DrvPrepareStringW");
    driver->m_fpDrvIsTableExist = (int (*)(DBDRV_CONNECTION, const WCHAR *))DLGetSymbolAddrEx(driver->m_handle, "DrvIsTableExist");
+   driver->m_fpDrvBulkInsertBegin = (DBDRV_BULK_INSERT (*)(DBDRV_CONNECTION, const WCHAR *, const WCHAR *, int, bool, DWORD *, WCHAR *))DLGetSymbolAddrEx(driver->m_handle, "DrvBulkInsertBegin", false); // optional entry point
+   driver->m_fpDrvBulkInsertAddRow = (DWORD (*)(DBDRV_BULK_INSERT, const WCHAR **, WCHAR *))DLGetSymbolAddrEx(driver->m_handle, "DrvBulkInsertAddRow", false); // optional entry point
+   driver->m_fpDrvBulkInsertEnd = (DWORD (*)(DBDRV_BULK_INSERT, WCHAR *))DLGetSymbolAddrEx(driver->m_handle, "DrvBulkInsertEnd", false); // optional entry point
    if ((fpDrvInit == NULL) || (driver->m_fpDrvConnect == NULL) || (driver->m_fpDrvDisconnect == NULL) ||
 	    (driver->m_fpDrvPrepare == NULL) || (driver->m_fpDrvBind == NULL) || (driver->m_fpDrvFreeStatement == NULL) ||
        (driver->m_fpDrvQuery == NULL) || (driver->m_fpDrvSelect == NULL) || (driver->m_fpDrvGetField == NULL) ||
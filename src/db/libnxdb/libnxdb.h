@@ -86,6 +86,9 @@ struct db_driver_t
 	WCHAR* (* m_fpDrvPrepareStringW)(const WCHAR *);
 	char* (* m_fpDrvPrepareStringA)(const char *);
 	int (* m_fpDrvIsTableExist)(DBDRV_CONNECTION, const WCHAR *);
+	DBDRV_BULK_INSERT (* m_fpDrvBulkInsertBegin)(DBDRV_CONNECTION, const WCHAR *, const WCHAR *, int, bool, DWORD *, WCHAR *);
+	DWORD (* m_fpDrvBulkInsertAddRow)(DBDRV_BULK_INSERT, const WCHAR **, WCHAR *);
+	DWORD (* m_fpDrvBulkInsertEnd)(DBDRV_BULK_INSERT, WCHAR *);
 };
 
 /**
@@ -139,6 +142,24 @@ struct db_unbuffered_result_t
 	DBDRV_UNBUFFERED_RESULT m_data;
 };
 
+/**
+ * Bulk insert handle
+ */
+struct db_bulk_insert_t
+{
+   DB_DRIVER m_driver;
+   DB_HANDLE m_connection;
+   DBDRV_BULK_INSERT m_data;     // Driver bulk insert handle (NULL if generic implementation is used)
+   DB_STATEMENT m_statement;     // Prepared INSERT statement for generic implementation
+   bool m_batchMode;
+   bool m_ignoreDuplicates;
+   bool m_failed;
+   int m_columnCount;
+   int *m_sqlTypes;
+   int m_rowCount;
+   TCHAR *m_table;
+};
+
 /**
  * Global variables
  */
@@ -36,6 +36,8 @@ static UINT64 s_perfNonSelectQueries = 0;
 static UINT64 s_perfTotalQueries = 0;
 static UINT64 s_perfLongRunningQueries = 0;
 static UINT64 s_perfFailedQueries = 0;
+static UINT64 s_perfBulkInserts = 0;
+static UINT64 s_perfBulkInsertRows = 0;
 
 /**
  * Session init callback
@@ -1809,6 +1811,211 @@ bool LIBNXDB_EXPORTABLE DBRollback(DB_HANDLE hConn)
    return bRet;
 }
 
+/**
+ * Report failed bulk insert operation
+ */
+static void ReportBulkInsertFailure(DB_BULK_INSERT hBulk, const WCHAR *errorText, DWORD errorCode)
+{
+   DB_HANDLE hConn = hBulk->m_connection;
+#ifdef UNICODE
+   nxlog_write_tag(NXLOG_ERROR, DEBUG_TAG_DRIVER, _T("Bulk insert into table %s failed: %s"), hBulk->m_table, errorText);
+#else
+   nxlog_write_tag(NXLOG_ERROR, DEBUG_TAG_DRIVER, _T("Bulk insert into table %s failed: %ls"), hBulk->m_table, errorText);
+#endif
+   if (hConn->m_driver->m_fpEventHandler != NULL)
+      hConn->m_driver->m_fpEventHandler(DBEVENT_QUERY_FAILED, L"BULK INSERT", errorText, errorCode == DBERR_CONNECTION_LOST, hConn->m_driver->m_userArg);
+   s_perfFailedQueries++;
+}
+
+/**
+ * Start bulk insert into given table. Columns should be given as comma separated list.
+ * Driver's native bulk load interface is used if available, otherwise rows are inserted
+ * using single prepared statement (in batch mode if supported by driver).
+ * Connection is locked for exclusive use by calling thread until DBBulkInsertEnd is called.
+ */
+DB_BULK_INSERT LIBNXDB_EXPORTABLE DBBulkInsertBegin(DB_HANDLE hConn, const TCHAR *table, const TCHAR *columns, int columnCount, const int *sqlTypes, bool ignoreDuplicates)
+{
+   if ((columnCount <= 0) || (columns == NULL))
+      return NULL;
+
+   MutexLock(hConn->m_mutexTransLock);
+
+   DB_BULK_INSERT hBulk = MemAllocStruct<db_bulk_insert_t>();
+   hBulk->m_driver = hConn->m_driver;
+   hBulk->m_connection = hConn;
+   hBulk->m_ignoreDuplicates = ignoreDuplicates;
+   hBulk->m_columnCount = columnCount;
+   hBulk->m_sqlTypes = MemCopyArray(sqlTypes, columnCount);
+   hBulk->m_table = MemCopyString(table);
+
+   if ((hConn->m_driver->m_fpDrvBulkInsertBegin != NULL) && (hConn->m_driver->m_fpDrvBulkInsertAddRow != NULL) && (hConn->m_driver->m_fpDrvBulkInsertEnd != NULL))
+   {
+#ifdef UNICODE
+#define wcTable table
+#define wcColumns columns
+#else
+      WCHAR *wcTable = WideStringFromMBString(table);
+      WCHAR *wcColumns = WideStringFromMBString(columns);
+#endif
+      WCHAR errorText[DBDRV_MAX_ERROR_TEXT] = L"";
+      DWORD errorCode;
+      hBulk->m_data = hConn->m_driver->m_fpDrvBulkInsertBegin(hConn->m_connection, wcTable, wcColumns, columnCount, ignoreDuplicates, &errorCode, errorText);
+      if ((hBulk->m_data == NULL) && (errorCode == DBERR_CONNECTION_LOST) && hConn->m_reconnectEnabled)
+      {
+         DBReconnect(hConn);
+         hBulk->m_data = hConn->m_driver->m_fpDrvBulkInsertBegin(hConn->m_connection, wcTable, wcColumns, columnCount, ignoreDuplicates, &errorCode, errorText);
+      }
+#ifndef UNICODE
+      MemFree(wcTable);
+      MemFree(wcColumns);
+#endif
+#undef wcTable
+#undef wcColumns
+      if (hBulk->m_data == NULL)
+      {
+         ReportBulkInsertFailure(hBulk, errorText, errorCode);
+         s_perfTotalQueries++;
+         MemFree(hBulk->m_sqlTypes);
+         MemFree(hBulk->m_table);
+         MemFree(hBulk);
+         MutexUnlock(hConn->m_mutexTransLock);
+         return NULL;
+      }
+      nxlog_debug_tag(DEBUG_TAG_QUERY, 9, _T("{%p} Native bulk insert into table %s started"), hBulk, table);
+   }
+   else
+   {
+      StringBuffer query(_T("INSERT INTO "));
+      query.append(table);
+      query.append(_T(" ("));
+      query.append(columns);
+      query.append(_T(") VALUES (?"));
+      for(int i = 1; i < columnCount; i++)
+         query.append(_T(",?"));
+      query.append(_T(")"));
+      hBulk->m_statement = DBPrepare(hConn, query, true);
+      if (hBulk->m_statement == NULL)
+      {
+         MemFree(hBulk->m_sqlTypes);
+         MemFree(hBulk->m_table);
+         MemFree(hBulk);
+         MutexUnlock(hConn->m_mutexTransLock);
+         return NULL;
+      }
+      // Batch mode cannot skip individual duplicate rows
+      hBulk->m_batchMode = !ignoreDuplicates && DBOpenBatch(hBulk->m_statement);
+      nxlog_debug_tag(DEBUG_TAG_QUERY, 9, _T("{%p} Generic bulk insert into table %s started (batch mode %s)"), hBulk, table, hBulk->m_batchMode ? _T("ON") : _T("OFF"));
+   }
+   return hBulk;
+}
+
+/**
+ * Add row to bulk insert. Values array should contain exactly one element for each column.
+ * NULL elements are inserted as empty strings (same as with DBBind). Returns false on failure, after which
+ * all subsequent rows will be rejected until DBBulkInsertEnd is called.
+ */
+bool LIBNXDB_EXPORTABLE DBBulkInsertAddRow(DB_BULK_INSERT hBulk, const TCHAR **values)
+{
+   if ((hBulk == NULL) || hBulk->m_failed)
+      return false;
+
+   if (hBulk->m_data != NULL)
+   {
+      WCHAR errorText[DBDRV_MAX_ERROR_TEXT] = L"";
+#ifdef UNICODE
+      DWORD rc = hBulk->m_driver->m_fpDrvBulkInsertAddRow(hBulk->m_data, values, errorText);
+#else
+      WCHAR **wcValues = MemAllocArray<WCHAR*>(hBulk->m_columnCount);
+      for(int i = 0; i < hBulk->m_columnCount; i++)
+         wcValues[i] = (values[i] != NULL) ? WideStringFromMBString(values[i]) : NULL;
+      DWORD rc = hBulk->m_driver->m_fpDrvBulkInsertAddRow(hBulk->m_data, const_cast<const WCHAR**>(wcValues), errorText);
+      for(int i = 0; i < hBulk->m_columnCount; i++)
+         MemFree(wcValues[i]);
+      MemFree(wcValues);
+#endif
+      if (rc != DBERR_SUCCESS)
+      {
+         ReportBulkInsertFailure(hBulk, errorText, rc);
+         hBulk->m_failed = true;
+         return false;
+      }
+   }
+   else
+   {
+      if (hBulk->m_batchMode)
+         DBNextBatchRow(hBulk->m_statement);
+      for(int i = 0; i < hBulk->m_columnCount; i++)
+         DBBind(hBulk->m_statement, i + 1, hBulk->m_sqlTypes[i], values[i], hBulk->m_batchMode ? DB_BIND_TRANSIENT : DB_BIND_STATIC);
+      if (!hBulk->m_batchMode && !DBExecute(hBulk->m_statement) && !hBulk->m_ignoreDuplicates)
+      {
+         hBulk->m_failed = true;
+         return false;
+      }
+   }
+
+   hBulk->m_rowCount++;
+   return true;
+}
+
+/**
+ * Complete bulk insert and destroy handle. Returns true if all rows were inserted successfully.
+ */
+bool LIBNXDB_EXPORTABLE DBBulkInsertEnd(DB_BULK_INSERT hBulk)
+{
+   if (hBulk == NULL)
+      return false;
+
+   DB_HANDLE hConn = hBulk->m_connection;
+   bool success = !hBulk->m_failed;
+   INT64 ms = GetCurrentTimeMs();
+   if (hBulk->m_data != NULL)
+   {
+      WCHAR errorText[DBDRV_MAX_ERROR_TEXT] = L"";
+      DWORD rc = hBulk->m_driver->m_fpDrvBulkInsertEnd(hBulk->m_data, errorText);
+      if (rc != DBERR_SUCCESS)
+      {
+         if (success)
+            ReportBulkInsertFailure(hBulk, errorText, rc);
+         success = false;
+      }
+      s_perfNonSelectQueries++;
+      s_perfTotalQueries++;
+   }
+   else
+   {
+      if (hBulk->m_batchMode && success && (hBulk->m_rowCount > 0))
+         success = DBExecute(hBulk->m_statement);
+      DBFreeStatement(hBulk->m_statement);
+   }
+   ms = GetCurrentTimeMs() - ms;
+
+   if (success)
+   {
+      s_perfBulkInserts++;
+      s_perfBulkInsertRows += hBulk->m_rowCount;
+   }
+   if (hConn->m_driver->m_dumpSql)
+   {
+      nxlog_debug_tag(DEBUG_TAG_QUERY, 9, _T("{%p} %s bulk insert into table %s: %d rows [%d ms]"), hBulk,
+               success ? _T("Successful") : _T("Failed"), hBulk->m_table, hBulk->m_rowCount, static_cast<int>(ms));
+   }
+
+   MutexUnlock(hConn->m_mutexTransLock);
+
+   MemFree(hBulk->m_sqlTypes);
+   MemFree(hBulk->m_table);
+   MemFree(hBulk);
+   return success;
+}
+
+/**
+ * Get number of rows added to bulk insert so far
+ */
+int LIBNXDB_EXPORTABLE DBBulkInsertGetRowCount(DB_BULK_INSERT hBulk)
+{
+   return (hBulk != NULL) ? hBulk->m_rowCount : 0;
+}
+
 /**
  * Prepare string for using in SQL statement
  */
@@ -1917,4 +2124,6 @@ void LIBNXDB_EXPORTABLE DBGetPerfCounters(LIBNXDB_PERF_COUNTERS *counters)
    counters->nonSelectQueries = s_perfNonSelectQueries;
    counters->selectQueries = s_perfSelectQueries;
    counters->totalQueries = s_perfTotalQueries;
+   counters->bulkInserts = s_perfBulkInserts;
+   counters->bulkInsertRows = s_perfBulkInsertRows;
 }
@@ -1099,6 +1099,7 @@
    public static final long VID_REQUEST_TYPE = 677;
    public static final long VID_VERIFY_CERT = 678;
    public static final long VID_SYNC_NODE_COMPONENTS = 679;
+   public static final long VID_COMPRESSION_METHODS = 680;
 
 	public static final long VID_ACL_USER_BASE = 0x00001000L;
 	public static final long VID_ACL_USER_LAST = 0x00001FFFL;
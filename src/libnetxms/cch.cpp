@@ -37,6 +37,43 @@ AbstractCommChannel::~AbstractCommChannel()
 {
 }
 
+/**
+ * Send data from multiple buffers. Default implementation sends each buffer
+ * separately while holding write mutex.
+ */
+int AbstractCommChannel::sendv(const SGBuffer *buffers, int count, MUTEX mutex)
+{
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexLock(mutex);
+
+   int total = 0;
+   for(int i = 0; i < count; i++)
+   {
+      if (buffers[i].size == 0)
+         continue;
+      int rc = send(buffers[i].data, buffers[i].size);
+      if (rc <= 0)
+      {
+         total = rc;
+         break;
+      }
+      total += rc;
+   }
+
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexUnlock(mutex);
+   return total;
+}
+
+/**
+ * Get underlying socket. Default implementation returns INVALID_SOCKET
+ * (for channels not backed by socket).
+ */
+SOCKET AbstractCommChannel::getSocket() const
+{
+   return INVALID_SOCKET;
+}
+
 /**
  * Socket communication channel constructor
  */
@@ -76,6 +113,14 @@ int SocketCommChannel::send(const void *data, size_t size, MUTEX mutex)
    return SendEx(m_socket, data, size, 0, mutex);
 }
 
+/**
+ * Send data from multiple buffers
+ */
+int SocketCommChannel::sendv(const SGBuffer *buffers, int count, MUTEX mutex)
+{
+   return SendVectorEx(m_socket, buffers, count, mutex);
+}
+
 /**
  * Receive data
  */
@@ -125,3 +170,11 @@ void SocketCommChannel::close()
       m_socket = INVALID_SOCKET;
    }
 }
+
+/**
+ * Get underlying socket
+ */
+SOCKET SocketCommChannel::getSocket() const
+{
+   return m_socket;
+}
@@ -30,6 +30,12 @@
  */
 #define KEY_BUFFER_SIZE       4096
 
+/**
+ * Bit in AEAD message counter indicating direction (set for messages sent by responder).
+ * Both sides use same key and IV, so nonces must not overlap between directions.
+ */
+#define NONCE_DIRECTION_BIT   _ULL(0x8000000000000000)
+
 /**
  * Supported ciphers. By default, we support all ciphers compiled
  * into OpenSSL library.
@@ -39,6 +45,9 @@ static UINT32 s_supportedCiphers =
 #ifndef OPENSSL_NO_AES
    NXCP_SUPPORT_AES_256 |
    NXCP_SUPPORT_AES_128 |
+#if OPENSSL_VERSION_NUMBER >= 0x10001000L
+   NXCP_SUPPORT_AES_256_GCM |
+#endif
 #endif
 #ifndef OPENSSL_NO_BF
    NXCP_SUPPORT_BLOWFISH_256 |
@@ -57,7 +66,7 @@ static UINT32 s_supportedCiphers =
  * Static data
  */
 static WORD s_noEncryptionFlag = 0;
-static const TCHAR *s_cipherNames[NETXMS_MAX_CIPHERS] = { _T("AES-256"), _T("Blowfish-256"), _T("IDEA"), _T("3DES"), _T("AES-128"), _T("Blowfish-128") };
+static const TCHAR *s_cipherNames[NETXMS_MAX_CIPHERS] = { _T("AES-256"), _T("Blowfish-256"), _T("IDEA"), _T("3DES"), _T("AES-128"), _T("Blowfish-128"), _T("AES-256-GCM") };
 
 #ifdef _WITH_ENCRYPTION
 
@@ -90,7 +99,12 @@ static CIPHER_FUNC s_ciphers[NETXMS_MAX_CIPHERS] =
    NULL,
 #endif
 #ifndef OPENSSL_NO_BF
-   EVP_bf_cbc
+   EVP_bf_cbc,
+#else
+   NULL,
+#endif
+#if !defined(OPENSSL_NO_AES) && (OPENSSL_VERSION_NUMBER >= 0x10001000L)
+   EVP_aes_256_gcm
 #else
    NULL
 #endif
@@ -562,10 +576,42 @@ void LIBNETXMS_EXPORTABLE ICEDecryptData(const BYTE *in, int inLen, BYTE *out, c
 	ice_key_destroy(ice);
 }
 
+#ifdef _WITH_ENCRYPTION
+
 /**
- * Encryption context constructor
+ * Destroy cipher context (NULL safe)
  */
-NXCPEncryptionContext::NXCPEncryptionContext()
+static void FreeCipherContext(EVP_CIPHER_CTX *ctx)
+{
+   if (ctx == NULL)
+      return;
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+   EVP_CIPHER_CTX_free(ctx);
+#else
+   EVP_CIPHER_CTX_cleanup(ctx);
+   free(ctx);
+#endif
+}
+
+/**
+ * Build nonce for AEAD cipher from session IV and message counter
+ */
+static inline void BuildNonce(const BYTE *iv, UINT64 counter, BYTE *nonce)
+{
+   memcpy(nonce, iv, NXCP_AEAD_NONCE_SIZE);
+   for(int i = 0; i < 8; i++)
+      nonce[NXCP_AEAD_NONCE_SIZE - 1 - i] ^= static_cast<BYTE>(counter >> (i * 8));
+}
+
+#endif   /* _WITH_ENCRYPTION */
+
+/**
+ * Encryption context constructor. Responder is the side that generates session key.
+ */
+NXCPEncryptionContext::NXCPEncryptionContext(bool responder)
+#ifdef _WITH_ENCRYPTION
+   : m_directionBit(responder ? NONCE_DIRECTION_BIT : 0)
+#endif
 {
    m_sessionKey = NULL;
    m_keyLength = 0;
@@ -581,6 +627,11 @@ NXCPEncryptionContext::NXCPEncryptionContext()
    EVP_CIPHER_CTX_init(m_decryptor);
 #endif
    m_encryptorLock = MutexCreate();
+   for(int i = 0; i < NXCP_AEAD_ENCRYPTOR_CACHE_SIZE; i++)
+      m_aeadEncryptors[i] = NULL;
+   m_nonceCounter = m_directionBit;
+   m_replayWindowTop = 0;
+   m_replayWindowMask = 0;
 #endif
 }
 
@@ -600,6 +651,8 @@ NXCPEncryptionContext::~NXCPEncryptionContext()
    free(m_encryptor);
    free(m_decryptor);
 #endif
+   for(int i = 0; i < NXCP_AEAD_ENCRYPTOR_CACHE_SIZE; i++)
+      FreeCipherContext(m_aeadEncryptors[i]);
    MutexDestroy(m_encryptorLock);
 #endif
 }
@@ -685,6 +738,7 @@ bool NXCPEncryptionContext::initCipher(int cipher)
    switch(cipher)
    {
       case NXCP_CIPHER_AES_256:
+      case NXCP_CIPHER_AES_256_GCM:
          m_keyLength = 32;
          break;
       case NXCP_CIPHER_AES_128:
@@ -726,13 +780,18 @@ bool NXCPEncryptionContext::initCipher(int cipher)
  */
 NXCPEncryptionContext *NXCPEncryptionContext::create(UINT32 ciphers)
 {
-	NXCPEncryptionContext *ctx = new NXCPEncryptionContext;
+	NXCPEncryptionContext *ctx = new NXCPEncryptionContext(true);
 
 #ifdef _WITH_ENCRYPTION
    // Select cipher
    bool selected = false;
 
-   if (ciphers & NXCP_SUPPORT_AES_256)
+   if (ciphers & NXCP_SUPPORT_AES_256_GCM)
+   {
+      selected = ctx->initCipher(NXCP_CIPHER_AES_256_GCM);
+   }
+
+   if (!selected && (ciphers & NXCP_SUPPORT_AES_256))
    {
       selected = ctx->initCipher(NXCP_CIPHER_AES_256);
    }
@@ -777,26 +836,183 @@ NXCPEncryptionContext *NXCPEncryptionContext::create(UINT32 ciphers)
 	return ctx;
 }
 
+#ifdef _WITH_ENCRYPTION
+
 /**
- * Encrypt message
+ * Get encryptor for AEAD cipher from cache or create new one. Encryptors are taken from
+ * cache with atomic exchange, so each thread gets exclusive access to its encryptor
+ * without locking.
  */
-NXCP_ENCRYPTED_MESSAGE *NXCPEncryptionContext::encryptMessage(NXCP_MESSAGE *msg)
+EVP_CIPHER_CTX *NXCPEncryptionContext::acquireAEADEncryptor()
 {
-   if (msg->flags & s_noEncryptionFlag)
-      return (NXCP_ENCRYPTED_MESSAGE *)MemCopyBlock(msg, ntohl(msg->size));
+   for(int i = 0; i < NXCP_AEAD_ENCRYPTOR_CACHE_SIZE; i++)
+   {
+      EVP_CIPHER_CTX *encryptor = InterlockedExchangeObjectPointer(&m_aeadEncryptors[i], static_cast<EVP_CIPHER_CTX*>(NULL));
+      if (encryptor != NULL)
+         return encryptor;
+   }
 
-#ifdef _WITH_ENCRYPTION
-   MutexLock(m_encryptorLock);
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+   EVP_CIPHER_CTX *encryptor = EVP_CIPHER_CTX_new();
+#else
+   EVP_CIPHER_CTX *encryptor = (EVP_CIPHER_CTX *)malloc(sizeof(EVP_CIPHER_CTX));
+   EVP_CIPHER_CTX_init(encryptor);
+#endif
+   if (!EVP_EncryptInit_ex(encryptor, s_ciphers[m_cipher](), NULL, NULL, NULL) ||
+       !EVP_CIPHER_CTX_ctrl(encryptor, EVP_CTRL_GCM_SET_IVLEN, NXCP_AEAD_NONCE_SIZE, NULL) ||
+       !EVP_EncryptInit_ex(encryptor, NULL, NULL, m_sessionKey, NULL))
+   {
+      FreeCipherContext(encryptor);
+      return NULL;
+   }
+   return encryptor;
+}
 
-   if (!EVP_EncryptInit_ex(m_encryptor, NULL, NULL, m_sessionKey, m_iv))
+/**
+ * Return encryptor for AEAD cipher to cache. If all cache slots are occupied encryptor is destroyed.
+ */
+void NXCPEncryptionContext::releaseAEADEncryptor(EVP_CIPHER_CTX *encryptor)
+{
+   for(int i = 0; (i < NXCP_AEAD_ENCRYPTOR_CACHE_SIZE) && (encryptor != NULL); i++)
+      encryptor = InterlockedExchangeObjectPointer(&m_aeadEncryptors[i], encryptor);
+   FreeCipherContext(encryptor);
+}
+
+/**
+ * Encrypt message with AEAD cipher. Encrypted message contains message counter (used to build
+ * nonce) in place of checksum, followed by encrypted message and authentication tag.
+ */
+NXCP_ENCRYPTED_MESSAGE *NXCPEncryptionContext::encryptMessageAEAD(const NXCP_MESSAGE *msg, BYTE *buffer, size_t bufferSize)
+{
+   EVP_CIPHER_CTX *encryptor = acquireAEADEncryptor();
+   if (encryptor == NULL)
+      return NULL;
+
+   UINT64 counter = InterlockedIncrement64(&m_nonceCounter);
+   BYTE nonce[NXCP_AEAD_NONCE_SIZE];
+   BuildNonce(m_iv, counter, nonce);
+   if (!EVP_EncryptInit_ex(encryptor, NULL, NULL, NULL, nonce))
    {
-      MutexUnlock(m_encryptorLock);
+      releaseAEADEncryptor(encryptor);
+      return NULL;
+   }
+
+   UINT32 msgSize = ntohl(msg->size);
+   size_t size = msgSize + NXCP_ENCRYPTION_HEADER_SIZE + NXCP_AEAD_TAG_SIZE;
+   BYTE padding = static_cast<BYTE>((8 - (size % 8)) & 7);
+   size += padding;
+
+   NXCP_ENCRYPTED_MESSAGE *emsg = reinterpret_cast<NXCP_ENCRYPTED_MESSAGE*>((size <= bufferSize) ? buffer : MemAlloc(size));
+   emsg->code = htons(CMD_ENCRYPTED_MESSAGE);
+   emsg->padding = padding;
+   emsg->reserved = 0;
+   emsg->size = htonl(static_cast<UINT32>(size));
+   UINT64 networkCounter = htonq(counter);
+   memcpy(emsg->data, &networkCounter, NXCP_EH_ENCRYPTED_BYTES);
+
+   BYTE *out = emsg->data + NXCP_EH_ENCRYPTED_BYTES;
+   int dataSize, finalSize;
+   bool success = EVP_EncryptUpdate(encryptor, out, &dataSize, reinterpret_cast<const BYTE*>(msg), msgSize) &&
+                  EVP_EncryptFinal_ex(encryptor, out + dataSize, &finalSize) &&
+                  EVP_CIPHER_CTX_ctrl(encryptor, EVP_CTRL_GCM_GET_TAG, NXCP_AEAD_TAG_SIZE, out + msgSize);
+   releaseAEADEncryptor(encryptor);
+
+   if (!success)
+   {
+      if (reinterpret_cast<BYTE*>(emsg) != buffer)
+         MemFree(emsg);
       return NULL;
    }
+   memset(out + msgSize + NXCP_AEAD_TAG_SIZE, 0, padding);
+   return emsg;
+}
+
+/**
+ * Decrypt message encrypted with AEAD cipher. Messages encrypted for opposite direction
+ * and replayed messages are rejected. Should be called only by connection's receiver.
+ */
+bool NXCPEncryptionContext::decryptMessageAEAD(NXCP_ENCRYPTED_MESSAGE *msg, BYTE *decryptionBuffer)
+{
+   if (msg->size < static_cast<UINT32>(NXCP_ENCRYPTION_HEADER_SIZE + NXCP_AEAD_TAG_SIZE + msg->padding))
+      return false;
+   UINT32 dataSize = msg->size - NXCP_ENCRYPTION_HEADER_SIZE - NXCP_AEAD_TAG_SIZE - msg->padding;
+
+   UINT64 counter;
+   memcpy(&counter, msg->data, NXCP_EH_ENCRYPTED_BYTES);
+   counter = ntohq(counter);
+   if ((counter & NONCE_DIRECTION_BIT) == m_directionBit)
+      return false;  // Message was encrypted for opposite direction (possibly reflected)
+
+   // Senders may encrypt messages in parallel, so messages can arrive slightly out of order.
+   // Accept each counter only once and only within window of last 64 counters.
+   UINT64 sequence = counter & ~NONCE_DIRECTION_BIT;
+   if (sequence == 0)
+      return false;
+   if (sequence <= m_replayWindowTop)
+   {
+      UINT64 offset = m_replayWindowTop - sequence;
+      if ((offset >= 64) || (m_replayWindowMask & (_ULL(1) << offset)))
+         return false;  // Too old or replayed message
+   }
+
+   BYTE nonce[NXCP_AEAD_NONCE_SIZE];
+   BuildNonce(m_iv, counter, nonce);
+
+   // Decryptor is used only by receiver and does not need locking
+   if (!EVP_DecryptInit_ex(m_decryptor, NULL, NULL, m_sessionKey, nonce))
+      return false;
+
+   BYTE *in = msg->data + NXCP_EH_ENCRYPTED_BYTES;
+   int outSize;
+   if (!EVP_DecryptUpdate(m_decryptor, decryptionBuffer, &outSize, in, dataSize) ||
+       !EVP_CIPHER_CTX_ctrl(m_decryptor, EVP_CTRL_GCM_SET_TAG, NXCP_AEAD_TAG_SIZE, in + dataSize) ||
+       (EVP_DecryptFinal_ex(m_decryptor, decryptionBuffer + outSize, &outSize) <= 0))
+      return false;  // Authentication failed
+
+   UINT32 msgSize = ntohl(reinterpret_cast<NXCP_MESSAGE*>(decryptionBuffer)->size);
+   if (msgSize != dataSize)
+      return false;
+
+   // Update replay window only for authenticated messages
+   if (sequence > m_replayWindowTop)
+   {
+      UINT64 shift = sequence - m_replayWindowTop;
+      m_replayWindowMask = ((shift < 64) ? (m_replayWindowMask << shift) : 0) | 1;
+      m_replayWindowTop = sequence;
+   }
+   else
+   {
+      m_replayWindowMask |= _ULL(1) << (m_replayWindowTop - sequence);
+   }
+
+   memcpy(msg, decryptionBuffer, msgSize);
+   return true;
+}
+
+#endif   /* _WITH_ENCRYPTION */
+
+/**
+ * Encrypt message. If provided buffer is large enough, encrypted message is placed into it,
+ * otherwise new buffer is allocated (caller should check returned pointer and free it if needed).
+ */
+NXCP_ENCRYPTED_MESSAGE *NXCPEncryptionContext::encryptMessage(const NXCP_MESSAGE *msg, BYTE *buffer, size_t bufferSize)
+{
+   if (msg->flags & s_noEncryptionFlag)
+   {
+      UINT32 size = ntohl(msg->size);
+      if (size > bufferSize)
+         return (NXCP_ENCRYPTED_MESSAGE *)MemCopyBlock(msg, size);
+      memcpy(buffer, msg, size);
+      return reinterpret_cast<NXCP_ENCRYPTED_MESSAGE*>(buffer);
+   }
+
+#ifdef _WITH_ENCRYPTION
+   if (isAEAD())
+      return encryptMessageAEAD(msg, buffer, bufferSize);
 
    UINT32 msgSize = ntohl(msg->size);
-   NXCP_ENCRYPTED_MESSAGE *emsg = 
-      (NXCP_ENCRYPTED_MESSAGE *)malloc(msgSize + NXCP_ENCRYPTION_HEADER_SIZE + EVP_CIPHER_block_size(EVP_CIPHER_CTX_cipher(m_encryptor)) + 8);
+   size_t maxSize = msgSize + NXCP_ENCRYPTION_HEADER_SIZE + EVP_MAX_BLOCK_LENGTH + 8;
+   NXCP_ENCRYPTED_MESSAGE *emsg = reinterpret_cast<NXCP_ENCRYPTED_MESSAGE*>((maxSize <= bufferSize) ? buffer : MemAlloc(maxSize));
    emsg->code = htons(CMD_ENCRYPTED_MESSAGE);
    emsg->reserved = 0;
 
@@ -804,10 +1020,20 @@ NXCP_ENCRYPTED_MESSAGE *NXCPEncryptionContext::encryptMessage(NXCP_MESSAGE *msg)
    header.dwChecksum = htonl(CalculateCRC32((BYTE *)msg, msgSize, 0));
    header.dwReserved = 0;
 
+   MutexLock(m_encryptorLock);
+
+   if (!EVP_EncryptInit_ex(m_encryptor, NULL, NULL, m_sessionKey, m_iv))
+   {
+      MutexUnlock(m_encryptorLock);
+      if (reinterpret_cast<BYTE*>(emsg) != buffer)
+         MemFree(emsg);
+      return NULL;
+   }
+
    int dataSize;
    EVP_EncryptUpdate(m_encryptor, emsg->data, &dataSize, (BYTE *)&header, NXCP_EH_ENCRYPTED_BYTES);
    msgSize = dataSize;
-   EVP_EncryptUpdate(m_encryptor, emsg->data + msgSize, &dataSize, (BYTE *)msg, ntohl(msg->size));
+   EVP_EncryptUpdate(m_encryptor, emsg->data + msgSize, &dataSize, (const BYTE *)msg, ntohl(msg->size));
    msgSize += dataSize;
    EVP_EncryptFinal_ex(m_encryptor, emsg->data + msgSize, &dataSize);
    msgSize += dataSize + NXCP_EH_UNENCRYPTED_BYTES;
@@ -837,10 +1063,13 @@ NXCP_ENCRYPTED_MESSAGE *NXCPEncryptionContext::encryptMessage(NXCP_MESSAGE *msg)
 bool NXCPEncryptionContext::decryptMessage(NXCP_ENCRYPTED_MESSAGE *msg, BYTE *decryptionBuffer)
 {
 #ifdef _WITH_ENCRYPTION
+   msg->size = ntohl(msg->size);
+   if (isAEAD())
+      return decryptMessageAEAD(msg, decryptionBuffer);
+
    if (!EVP_DecryptInit_ex(m_decryptor, NULL, NULL, m_sessionKey, m_iv))
       return false;
 
-   msg->size = ntohl(msg->size);
    int dataSize;
    EVP_DecryptUpdate(m_decryptor, decryptionBuffer, &dataSize, msg->data,
                      msg->size - NXCP_EH_UNENCRYPTED_BYTES - msg->padding);
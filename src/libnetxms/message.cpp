@@ -23,6 +23,7 @@
 #include "libnetxms.h"
 #include <nxcpapi.h>
 #include <zlib.h>
+#include "lz4.h"
 
 #undef uthash_malloc
 #define uthash_malloc(sz) m_pool.allocate(sz)
@@ -68,6 +69,65 @@ static size_t CalculateFieldSize(const NXCP_MESSAGE_FIELD *field, bool networkBy
    return nSize;
 }
 
+/**
+ * Calculate field size including padding to 8 bytes boundary (host byte order)
+ */
+static inline size_t CalculateAlignedFieldSize(const NXCP_MESSAGE_FIELD *field)
+{
+   size_t size = CalculateFieldSize(field, false);
+   return size + ((8 - (size % 8)) & 7);
+}
+
+/**
+ * Encode field into output buffer in network byte order. Value of binary and UTF-8 string
+ * fields is not copied if copyValue is false. Returns number of bytes in encoded field
+ * (without padding).
+ */
+static inline size_t EncodeField(const NXCP_MESSAGE_FIELD *field, BYTE *out, bool copyValue)
+{
+   NXCP_MESSAGE_FIELD *f = reinterpret_cast<NXCP_MESSAGE_FIELD*>(out);
+   f->fieldId = htonl(field->fieldId);
+   f->type = field->type;
+   f->flags = field->flags;
+   f->df_int16 = (field->type == NXCP_DT_INT16) ? htons(field->df_int16) : field->df_int16;
+   switch(field->type)
+   {
+      case NXCP_DT_INT32:
+         f->df_int32 = htonl(field->df_int32);
+         return 12;
+      case NXCP_DT_INT64:
+         f->df_int64 = htonq(field->df_int64);
+         return 16;
+      case NXCP_DT_INT16:
+         return 8;
+      case NXCP_DT_FLOAT:
+         f->df_real = htond(field->df_real);
+         return 16;
+      case NXCP_DT_STRING:
+         f->df_string.length = htonl(field->df_string.length);
+#if WORDS_BIGENDIAN
+         memcpy(f->df_string.value, field->df_string.value, field->df_string.length);
+#else
+         for(UINT32 i = 0; i < field->df_string.length / 2; i++)
+            f->df_string.value[i] = bswap_16(field->df_string.value[i]);
+#endif
+         return field->df_string.length + 12;
+      case NXCP_DT_BINARY:
+      case NXCP_DT_UTF8_STRING:
+         f->df_binary.length = htonl(field->df_binary.length);
+         if (copyValue)
+            memcpy(f->df_binary.value, field->df_binary.value, field->df_binary.length);
+         return field->df_binary.length + 12;
+      case NXCP_DT_INETADDR:
+         memcpy(&f->df_inetaddr, &field->df_inetaddr, 24);
+         if (field->df_inetaddr.family == NXCP_AF_INET)
+            f->df_inetaddr.addr.v4 = htonl(field->df_inetaddr.addr.v4);
+         return 32;
+      default:
+         return 8;
+   }
+}
+
 /**
  * Field hash map entry
  */
@@ -91,6 +151,144 @@ inline MessageField *CreateMessageField(MemoryPool& pool, size_t fieldSize)
    return entry;
 }
 
+/**
+ * Minimal size of message to be compressed
+ */
+static size_t s_compressionThreshold = NXCP_DEFAULT_COMPRESSION_THRESHOLD;
+
+/**
+ * Set minimal size of message to be compressed
+ */
+void LIBNETXMS_EXPORTABLE NXCPSetCompressionThreshold(size_t threshold)
+{
+   s_compressionThreshold = threshold;
+}
+
+/**
+ * Get message compression methods supported by this library (as NXCP_COMPRESSION_METHOD_xxx bit mask)
+ */
+UINT16 LIBNETXMS_EXPORTABLE NXCPGetSupportedCompressionMethods()
+{
+   return NXCP_COMPRESSION_METHOD_DEFLATE | NXCP_COMPRESSION_METHOD_LZ4;
+}
+
+/**
+ * Select message compression method from methods supported by peer. Peers
+ * which do not report supported methods can only handle deflate.
+ */
+NXCPStreamCompressionMethod LIBNETXMS_EXPORTABLE NXCPSelectCompressionMethod(UINT16 methods)
+{
+   return (methods & NXCP_COMPRESSION_METHOD_LZ4) ? NXCP_STREAM_COMPRESSION_LZ4 : NXCP_STREAM_COMPRESSION_DEFLATE;
+}
+
+/**
+ * Decompress message payload. Compressed payload starts with 4 bytes of uncompressed message size.
+ * For LZ4 it is followed by 4 bytes of compressed data size, because compressed data is padded
+ * to 8 bytes boundary and LZ4 decoder requires exact input size.
+ */
+static bool DecompressPayload(const NXCP_MESSAGE *msg, UINT16 flags, BYTE *out, size_t outSize)
+{
+   size_t msgSize = static_cast<size_t>(ntohl(msg->size));
+   if (msgSize <= NXCP_HEADER_SIZE + 8)
+      return false;
+
+   const BYTE *in = reinterpret_cast<const BYTE*>(msg) + NXCP_HEADER_SIZE + 4;
+   size_t inSize = msgSize - NXCP_HEADER_SIZE - 4;
+
+   if (flags & MF_COMPRESSED_LZ4)
+   {
+      size_t compSize = static_cast<size_t>(ntohl(*reinterpret_cast<const UINT32*>(in)));
+      if (compSize > inSize - 4)
+         return false;
+      return LZ4_decompress_safe(reinterpret_cast<const char*>(in + 4), reinterpret_cast<char*>(out),
+               static_cast<int>(compSize), static_cast<int>(outSize)) == static_cast<int>(outSize);
+   }
+
+   z_stream stream;
+   stream.zalloc = Z_NULL;
+   stream.zfree = Z_NULL;
+   stream.opaque = Z_NULL;
+   stream.avail_in = static_cast<UINT32>(inSize);
+   stream.next_in = const_cast<BYTE*>(in);
+   if (inflateInit(&stream) != Z_OK)
+   {
+      nxlog_debug(6, _T("NXCPMessage: inflateInit() failed"));
+      return false;
+   }
+
+   stream.next_out = out;
+   stream.avail_out = static_cast<UINT32>(outSize);
+   bool success = (inflate(&stream, Z_FINISH) == Z_STREAM_END);
+   inflateEnd(&stream);
+   return success;
+}
+
+/**
+ * Compress serialized message payload. Returns new message or NULL if compression
+ * failed or does not reduce message size.
+ */
+static NXCP_MESSAGE *CompressPayload(const NXCP_MESSAGE *msg, size_t size, NXCPStreamCompressionMethod method)
+{
+   size_t dataSize = size - NXCP_HEADER_SIZE;
+   size_t compMsgSize;
+   BYTE *compressedMsg;
+   if (method == NXCP_STREAM_COMPRESSION_LZ4)
+   {
+      int compBufferSize = LZ4_compressBound(static_cast<int>(dataSize));
+      compressedMsg = static_cast<BYTE*>(MemAlloc(compBufferSize + NXCP_HEADER_SIZE + 16));
+      int bytes = LZ4_compress_default(reinterpret_cast<const char*>(msg->fields), reinterpret_cast<char*>(compressedMsg + NXCP_HEADER_SIZE + 8),
+               static_cast<int>(dataSize), compBufferSize);
+      if (bytes <= 0)
+      {
+         MemFree(compressedMsg);
+         return NULL;
+      }
+      *reinterpret_cast<UINT32*>(compressedMsg + NXCP_HEADER_SIZE + 4) = htonl(static_cast<UINT32>(bytes));
+      compMsgSize = bytes + NXCP_HEADER_SIZE + 8;
+   }
+   else
+   {
+      z_stream stream;
+      stream.zalloc = Z_NULL;
+      stream.zfree = Z_NULL;
+      stream.opaque = Z_NULL;
+      stream.avail_in = 0;
+      stream.next_in = Z_NULL;
+      if (deflateInit(&stream, 9) != Z_OK)
+         return NULL;
+
+      size_t compBufferSize = deflateBound(&stream, static_cast<unsigned long>(dataSize));
+      compressedMsg = static_cast<BYTE*>(MemAlloc(compBufferSize + NXCP_HEADER_SIZE + 4));
+      stream.next_in = const_cast<BYTE*>(reinterpret_cast<const BYTE*>(msg->fields));
+      stream.avail_in = static_cast<UINT32>(dataSize);
+      stream.next_out = compressedMsg + NXCP_HEADER_SIZE + 4;
+      stream.avail_out = static_cast<UINT32>(compBufferSize);
+      bool success = (deflate(&stream, Z_FINISH) == Z_STREAM_END);
+      deflateEnd(&stream);
+      if (!success)
+      {
+         MemFree(compressedMsg);
+         return NULL;
+      }
+      compMsgSize = compBufferSize - stream.avail_out + NXCP_HEADER_SIZE + 4;
+   }
+
+   // Message should be aligned to 8 bytes boundary
+   compMsgSize += (8 - (compMsgSize % 8)) & 7;
+   if (compMsgSize >= size - 4)
+   {
+      MemFree(compressedMsg);
+      return NULL;
+   }
+
+   memcpy(compressedMsg, msg, NXCP_HEADER_SIZE);
+   NXCP_MESSAGE *compMsg = reinterpret_cast<NXCP_MESSAGE*>(compressedMsg);
+   compMsg->flags |= htons((method == NXCP_STREAM_COMPRESSION_LZ4) ? (MF_COMPRESSED | MF_COMPRESSED_LZ4) : MF_COMPRESSED);
+   memcpy(compressedMsg + NXCP_HEADER_SIZE, &msg->size, 4); // Save size of uncompressed message
+   compMsg->size = htonl(static_cast<UINT32>(compMsgSize));
+   return compMsg;
+}
+
 /**
  * Default constructor for NXCPMessage class
  */
@@ -99,6 +297,7 @@ NXCPMessage::NXCPMessage(int version) : m_pool(NXCP_DEFAULT_SIZE_HINT)
    m_code = 0;
    m_id = 0;
    m_fields = NULL;
+   m_encodedSize = 0;
    m_flags = 0;
    m_version = version;
    m_data = NULL;
@@ -113,6 +312,7 @@ NXCPMessage::NXCPMessage(UINT16 code, UINT32 id, int version) : m_pool(NXCP_DEFA
    m_code = code;
    m_id = id;
    m_fields = NULL;
+   m_encodedSize = 0;
    m_flags = 0;
    m_version = version;
    m_data = NULL;
@@ -129,6 +329,7 @@ NXCPMessage::NXCPMessage(NXCPMessage *msg) : m_pool(msg->m_pool.regionSize())
    m_flags = msg->m_flags;
    m_version = msg->m_version;
    m_fields = NULL;
+   m_encodedSize = msg->m_encodedSize;
 
    if (m_flags & MF_BINARY)
    {
@@ -181,6 +382,7 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
    m_code = ntohs(msg->code);
    m_id = ntohl(msg->id);
    m_fields = NULL;
+   m_encodedSize = 0;
 
    int v = getEncodedProtocolVersion();
    m_version = (v != 0) ? v : version; // Use encoded version if present
@@ -191,34 +393,17 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
       m_dataSize = (size_t)ntohl(msg->numFields);
       if ((m_flags & MF_COMPRESSED) && !(m_flags & MF_STREAM) && (m_version >= 4))
       {
-         m_flags &= ~MF_COMPRESSED; // clear "compressed" flag so it will not be mistakenly re-sent
-
-         z_stream stream;
-         stream.zalloc = Z_NULL;
-         stream.zfree = Z_NULL;
-         stream.opaque = Z_NULL;
-         stream.avail_in = (UINT32)ntohl(msg->size) - NXCP_HEADER_SIZE - 4;
-         stream.next_in = (BYTE *)msg + NXCP_HEADER_SIZE + 4;
-         if (inflateInit(&stream) != Z_OK)
-         {
-            nxlog_debug(6, _T("NXCPMessage: inflateInit() failed"));
-            m_version = -1;   // error indicator
-            return;
-         }
+         UINT16 flags = m_flags;
+         m_flags &= ~(MF_COMPRESSED | MF_COMPRESSED_LZ4); // clear "compressed" flags so it will not be mistakenly re-sent
 
          m_data = m_pool.allocateArray<BYTE>(m_dataSize);
-         stream.next_out = m_data;
-         stream.avail_out = (UINT32)m_dataSize;
-
-         if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
+         if (!DecompressPayload(msg, flags, m_data, m_dataSize))
          {
-            inflateEnd(&stream);
             TCHAR buffer[256];
             nxlog_debug(6, _T("NXCPMessage: failed to decompress binary message %s with ID %d"), NXCPMessageCodeName(m_code, buffer), m_id);
             m_version = -1;   // error indicator
             return;
          }
-         inflateEnd(&stream);
       }
       else
       {
@@ -234,35 +419,18 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
       size_t msgDataSize;
       if ((m_flags & MF_COMPRESSED) && (m_version >= 4))
       {
-         m_flags &= ~MF_COMPRESSED; // clear "compressed" flag so it will not be mistakenly re-sent
+         UINT16 flags = m_flags;
+         m_flags &= ~(MF_COMPRESSED | MF_COMPRESSED_LZ4); // clear "compressed" flags so it will not be mistakenly re-sent
          msgDataSize = (size_t)ntohl(*((UINT32 *)((BYTE *)msg + NXCP_HEADER_SIZE))) - NXCP_HEADER_SIZE;
 
-         z_stream stream;
-         stream.zalloc = Z_NULL;
-         stream.zfree = Z_NULL;
-         stream.opaque = Z_NULL;
-         stream.avail_in = (UINT32)ntohl(msg->size) - NXCP_HEADER_SIZE - 4;
-         stream.next_in = (BYTE *)msg + NXCP_HEADER_SIZE + 4;
-         if (inflateInit(&stream) != Z_OK)
-         {
-            nxlog_debug(6, _T("NXCPMessage: inflateInit() failed"));
-            m_version = -1;   // error indicator
-            return;
-         }
-
          msgData = m_pool.allocateArray<BYTE>(msgDataSize);
-         stream.next_out = msgData;
-         stream.avail_out = (UINT32)msgDataSize;
-
-         if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
+         if (!DecompressPayload(msg, flags, msgData, msgDataSize))
          {
-            inflateEnd(&stream);
             TCHAR buffer[256];
             nxlog_debug(6, _T("NXCPMessage: failed to decompress message %s with ID %d"), NXCPMessageCodeName(m_code, buffer), m_id);
             m_version = -1;   // error indicator
             return;
          }
-         inflateEnd(&stream);
       }
       else
       {
@@ -339,6 +507,7 @@ NXCPMessage::NXCPMessage(const NXCP_MESSAGE *msg, int version) : m_pool(SizeHint
          }
 
          HASH_ADD_INT(m_fields, id, entry);
+         m_encodedSize += CalculateAlignedFieldSize(&entry->data);
 
          // Starting from version 2, all variables should be 8-byte aligned
          if (m_version >= 2)
@@ -515,8 +684,10 @@ void *NXCPMessage::set(UINT32 fieldId, BYTE type, const void *value, bool isSign
    if (curr != NULL)
    {
       HASH_DEL(m_fields, curr);
+      m_encodedSize -= CalculateAlignedFieldSize(&curr->data);
    }
    HASH_ADD_INT(m_fields, id, entry);
+   m_encodedSize += CalculateAlignedFieldSize(&entry->data);
 
    return (type == NXCP_DT_INT16) ? ((void *)((BYTE *)&entry->data + 6)) : ((void *)((BYTE *)&entry->data + 8));
 #undef __buffer
@@ -1090,149 +1261,266 @@ uuid NXCPMessage::getFieldAsGUID(UINT32 fieldId) const
 }
 
 /**
- * Build protocol message ready to be send over the wire
+ * Build protocol message ready to be send over the wire. Deflate is used if compression is allowed.
  */
 NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
 {
-   // Calculate message size
+   return serialize(allowCompression ? NXCP_STREAM_COMPRESSION_DEFLATE : NXCP_STREAM_COMPRESSION_NONE);
+}
+
+/**
+ * Get size of serialized message without compression
+ */
+size_t NXCPMessage::getSerializedSize() const
+{
+   if (m_flags & MF_BINARY)
+   {
+      size_t size = NXCP_HEADER_SIZE + m_dataSize;
+      return size + ((8 - (size % 8)) & 7);
+   }
+
+   if (m_version >= 2)
+      return NXCP_HEADER_SIZE + m_encodedSize;
+
+   // Before version 2 fields are not aligned, only message itself is aligned to 8 bytes boundary
    size_t size = NXCP_HEADER_SIZE;
-   UINT32 fieldCount = 0;
+   MessageField *entry, *tmp;
+   HASH_ITER(hh, m_fields, entry, tmp)
+   {
+      size += CalculateFieldSize(&entry->data, false);
+   }
+   return size + ((8 - (size % 8)) & 7);
+}
+
+/**
+ * Serialize message without compression into provided buffer in single pass.
+ * Returns size of serialized message or 0 if buffer is too small.
+ */
+size_t NXCPMessage::serializeTo(NXCP_MESSAGE *buffer, size_t bufferSize) const
+{
+   size_t size = getSerializedSize();
+   if (size > bufferSize)
+      return 0;
+
+   buffer->code = htons(m_code);
+   buffer->flags = htons(m_flags | MF_NXCP_VERSION(m_version));
+   buffer->size = htonl(static_cast<UINT32>(size));
+   buffer->id = htonl(m_id);
+
+   BYTE *out = reinterpret_cast<BYTE*>(buffer) + NXCP_HEADER_SIZE;
    if (m_flags & MF_BINARY)
    {
-      size += m_dataSize;
-      fieldCount = (UINT32)m_dataSize;
-      size += (8 - (size % 8)) & 7;
+      buffer->numFields = htonl(static_cast<UINT32>(m_dataSize));
+      memcpy(out, m_data, m_dataSize);
+      out += m_dataSize;
    }
    else
    {
+      buffer->numFields = htonl(HASH_COUNT(m_fields));
       MessageField *entry, *tmp;
       HASH_ITER(hh, m_fields, entry, tmp)
       {
-         size_t fieldSize = CalculateFieldSize(&entry->data, false);
+         size_t fieldSize = EncodeField(&entry->data, out, true);
+         out += fieldSize;
          if (m_version >= 2)
-            size += fieldSize + ((8 - (fieldSize % 8)) & 7);
-         else
-            size += fieldSize;
-         fieldCount++;
+         {
+            size_t padding = (8 - (fieldSize % 8)) & 7;
+            memset(out, 0, padding);
+            out += padding;
+         }
       }
-
-      // Message should be aligned to 8 bytes boundary
-      // This is always the case starting from version 2 because
-      // all fields are padded to 8 bytes boundary
-      if (m_version < 2)
-         size += (8 - (size % 8)) & 7;
    }
 
-   // Create message
+   // Message should be aligned to 8 bytes boundary
+   memset(out, 0, size - (out - reinterpret_cast<BYTE*>(buffer)));
+   return size;
+}
+
+/**
+ * Build protocol message ready to be send over the wire using given compression method.
+ * Caller should ensure that peer supports selected compression method.
+ */
+NXCP_MESSAGE *NXCPMessage::serialize(NXCPStreamCompressionMethod compressionMethod) const
+{
+   size_t size = getSerializedSize();
    NXCP_MESSAGE *msg = static_cast<NXCP_MESSAGE*>(MemAlloc(size));
-   memset(msg, 0, size);
-   msg->code = htons(m_code);
-   msg->flags = htons(m_flags | MF_NXCP_VERSION(m_version));
-   msg->size = htonl(static_cast<UINT32>(size));
-   msg->id = htonl(m_id);
-   msg->numFields = htonl(fieldCount);
-
-   // Fill data fields
+   serializeTo(msg, size);
+
+   if (isCompressible(compressionMethod))
+   {
+      NXCP_MESSAGE *compMsg = CompressPayload(msg, size, compressionMethod);
+      if (compMsg != NULL)
+      {
+         MemFree(msg);
+         msg = compMsg;
+      }
+   }
+   return msg;
+}
+
+/**
+ * Check if message payload will be compressed when serialized with given compression method.
+ * Compression supported starting with NXCP version 4; stream messages, messages marked with
+ * MF_DONT_COMPRESS and messages below compression threshold are never compressed.
+ */
+bool NXCPMessage::isCompressible(NXCPStreamCompressionMethod compressionMethod) const
+{
+   return (m_version >= 4) && (compressionMethod != NXCP_STREAM_COMPRESSION_NONE) &&
+          !(m_flags & (MF_STREAM | MF_DONT_COMPRESS)) && (getSerializedSize() > s_compressionThreshold);
+}
+
+/**
+ * Serialize message without compression as list of data blocks. Values of binary and UTF-8 string
+ * fields larger than NXCP_DIRECT_SEND_THRESHOLD are referenced directly and not copied.
+ */
+void NXCPMessage::serializeToBlocks(NXCPMessageBlocks *blocks) const
+{
+   size_t size = getSerializedSize();
+   blocks->m_count = 0;
+   blocks->m_size = size;
+
+   if (m_version < 2)
+   {
+      // Fields are not aligned in old protocol versions, use plain serialization
+      NXCP_MESSAGE *msg = reinterpret_cast<NXCP_MESSAGE*>(blocks->allocateBuffer(size));
+      serializeTo(msg, size);
+      blocks->addBlock(msg, size);
+      return;
+   }
+
+   // Calculate size of data that will be referenced directly
+   size_t directSize = 0;
    if (m_flags & MF_BINARY)
    {
-      memcpy(msg->fields, m_data, m_dataSize);
+      if (m_dataSize >= NXCP_DIRECT_SEND_THRESHOLD)
+         directSize = m_dataSize;
    }
-   else
+   else if (m_encodedSize >= NXCP_DIRECT_SEND_THRESHOLD)
    {
-      NXCP_MESSAGE_FIELD *field = (NXCP_MESSAGE_FIELD *)((char *)msg + NXCP_HEADER_SIZE);
       MessageField *entry, *tmp;
       HASH_ITER(hh, m_fields, entry, tmp)
       {
-         size_t fieldSize = CalculateFieldSize(&entry->data, false);
-         memcpy(field, &entry->data, fieldSize);
+         if (((entry->data.type == NXCP_DT_BINARY) || (entry->data.type == NXCP_DT_UTF8_STRING)) && (entry->data.df_binary.length >= NXCP_DIRECT_SEND_THRESHOLD))
+            directSize += entry->data.df_binary.length;
+      }
+   }
 
-         // Convert numeric values to network format
-         field->fieldId = htonl(field->fieldId);
-         switch(field->type)
-         {
-            case NXCP_DT_INT32:
-               field->df_int32 = htonl(field->df_int32);
-               break;
-            case NXCP_DT_INT64:
-               field->df_int64 = htonq(field->df_int64);
-               break;
-            case NXCP_DT_INT16:
-               field->df_int16 = htons(field->df_int16);
-               break;
-            case NXCP_DT_FLOAT:
-               field->df_real = htond(field->df_real);
-               break;
-            case NXCP_DT_STRING:
-#if !(WORDS_BIGENDIAN)
-               {
-                  bswap_array_16(field->df_string.value, field->df_string.length / 2);
-                  field->df_string.length = htonl(field->df_string.length);
-               }
-#endif
-               break;
-            case NXCP_DT_BINARY:
-            case NXCP_DT_UTF8_STRING:
-               field->df_string.length = htonl(field->df_string.length);
-               break;
-            case NXCP_DT_INETADDR:
-               if (field->df_inetaddr.family == NXCP_AF_INET)
-               {
-                  field->df_inetaddr.addr.v4 = htonl(field->df_inetaddr.addr.v4);
-               }
-               break;
-         }
+   BYTE *buffer = blocks->allocateBuffer(size - directSize);
+   NXCP_MESSAGE *header = reinterpret_cast<NXCP_MESSAGE*>(buffer);
+   header->code = htons(m_code);
+   header->flags = htons(m_flags | MF_NXCP_VERSION(m_version));
+   header->size = htonl(static_cast<UINT32>(size));
+   header->id = htonl(m_id);
 
-         if (m_version >= 2)
-            field = (NXCP_MESSAGE_FIELD *)((char *)field + fieldSize + ((8 - (fieldSize % 8)) & 7));
-         else
-            field = (NXCP_MESSAGE_FIELD *)((char *)field + fieldSize);
+   BYTE *out = buffer + NXCP_HEADER_SIZE;
+   BYTE *blockStart = buffer;
+   if (m_flags & MF_BINARY)
+   {
+      header->numFields = htonl(static_cast<UINT32>(m_dataSize));
+      if (directSize > 0)
+      {
+         blocks->addBlock(blockStart, out - blockStart);
+         blocks->addBlock(m_data, m_dataSize);
+         blockStart = out;
       }
+      else
+      {
+         memcpy(out, m_data, m_dataSize);
+         out += m_dataSize;
+      }
+      size_t padding = (8 - ((NXCP_HEADER_SIZE + m_dataSize) % 8)) & 7;
+      memset(out, 0, padding);
+      out += padding;
    }
-
-   // Compress message payload if requested. Compression supported starting with NXCP version 4.
-   if ((m_version >= 4) && allowCompression && (size > 128) && !(m_flags & (MF_STREAM | MF_DONT_COMPRESS)))
+   else
    {
-      z_stream stream;
-      stream.zalloc = Z_NULL;
-      stream.zfree = Z_NULL;
-      stream.opaque = Z_NULL;
-      stream.avail_in = 0;
-      stream.next_in = Z_NULL;
-      if (deflateInit(&stream, 9) == Z_OK)
+      header->numFields = htonl(HASH_COUNT(m_fields));
+      MessageField *entry, *tmp;
+      HASH_ITER(hh, m_fields, entry, tmp)
       {
-         size_t compBufferSize = deflateBound(&stream, (unsigned long)(size - NXCP_HEADER_SIZE));
-         BYTE *compressedMsg = (BYTE *)MemAlloc(compBufferSize + NXCP_HEADER_SIZE + 4);
-         stream.next_in = (BYTE *)msg->fields;
-         stream.avail_in = (UINT32)(size - NXCP_HEADER_SIZE);
-         stream.next_out = compressedMsg + NXCP_HEADER_SIZE + 4;
-         stream.avail_out = (UINT32)compBufferSize;
-         if (deflate(&stream, Z_FINISH) == Z_STREAM_END)
+         bool direct = ((entry->data.type == NXCP_DT_BINARY) || (entry->data.type == NXCP_DT_UTF8_STRING)) && (entry->data.df_binary.length >= NXCP_DIRECT_SEND_THRESHOLD);
+         size_t fieldSize = EncodeField(&entry->data, out, !direct);
+         if (direct)
          {
-            size_t compMsgSize = compBufferSize - stream.avail_out + NXCP_HEADER_SIZE + 4;
-            // Message should be aligned to 8 bytes boundary
-            compMsgSize += (8 - (compMsgSize % 8)) & 7;
-            if (compMsgSize < size - 4)
-            {
-               memcpy(compressedMsg, msg, NXCP_HEADER_SIZE);
-               MemFree(msg);
-               msg = (NXCP_MESSAGE *)compressedMsg;
-               msg->flags |= htons(MF_COMPRESSED);
-               memcpy((BYTE *)msg + NXCP_HEADER_SIZE, &msg->size, 4); // Save size of uncompressed message
-               msg->size = htonl((UINT32)compMsgSize);
-            }
-            else
-            {
-               MemFree(compressedMsg);
-            }
+            out += 12;
+            blocks->addBlock(blockStart, out - blockStart);
+            blocks->addBlock(entry->data.df_binary.value, entry->data.df_binary.length);
+            blockStart = out;
          }
          else
          {
-            MemFree(compressedMsg);
+            out += fieldSize;
          }
-         deflateEnd(&stream);
+         size_t padding = (8 - (fieldSize % 8)) & 7;
+         memset(out, 0, padding);
+         out += padding;
       }
    }
-   return msg;
+   if (out > blockStart)
+      blocks->addBlock(blockStart, out - blockStart);
+}
+
+/**
+ * Message blocks constructor
+ */
+NXCPMessageBlocks::NXCPMessageBlocks()
+{
+   m_buffer = m_localBuffer;
+   m_bufferSize = NXCP_BLOCKS_LOCAL_BUFFER_SIZE;
+   m_blocks = m_localBlocks;
+   m_count = 0;
+   m_allocated = sizeof(m_localBlocks) / sizeof(SGBuffer);
+   m_size = 0;
+}
+
+/**
+ * Message blocks destructor
+ */
+NXCPMessageBlocks::~NXCPMessageBlocks()
+{
+   if (m_buffer != m_localBuffer)
+      MemFree(m_buffer);
+   if (m_blocks != m_localBlocks)
+      MemFree(m_blocks);
+}
+
+/**
+ * Allocate buffer for encoded message data. Internal buffer is used if large enough,
+ * otherwise buffer is allocated on heap.
+ */
+BYTE *NXCPMessageBlocks::allocateBuffer(size_t size)
+{
+   if (size > m_bufferSize)
+   {
+      if (m_buffer != m_localBuffer)
+         MemFree(m_buffer);
+      m_buffer = static_cast<BYTE*>(MemAlloc(size));
+      m_bufferSize = size;
+   }
+   return m_buffer;
+}
+
+/**
+ * Add data block
+ */
+void NXCPMessageBlocks::addBlock(const void *data, size_t size)
+{
+   if (m_count == m_allocated)
+   {
+      m_allocated += 16;
+      if (m_blocks == m_localBlocks)
+      {
+         m_blocks = MemAllocArrayNoInit<SGBuffer>(m_allocated);
+         memcpy(m_blocks, m_localBlocks, sizeof(m_localBlocks));
+      }
+      else
+      {
+         m_blocks = MemReallocArray(m_blocks, m_allocated);
+      }
+   }
+   m_blocks[m_count].data = data;
+   m_blocks[m_count].size = size;
+   m_count++;
 }
 
 /**
@@ -1241,6 +1529,7 @@ NXCP_MESSAGE *NXCPMessage::serialize(bool allowCompression) const
 void NXCPMessage::deleteAllFields()
 {
    m_fields = NULL;
+   m_encodedSize = 0;
    m_data = NULL;
    m_dataSize = 0;
    m_pool.clear();
@@ -1464,31 +1753,13 @@ StringBuffer NXCPMessage::dump(const NXCP_MESSAGE *msg, int version)
    if ((flags & MF_COMPRESSED) && (version >= 4))
    {
       msgDataSize = (size_t)ntohl(*((UINT32 *)((BYTE *)msg + NXCP_HEADER_SIZE))) - NXCP_HEADER_SIZE;
-
-      z_stream stream;
-      stream.zalloc = Z_NULL;
-      stream.zfree = Z_NULL;
-      stream.opaque = Z_NULL;
-      stream.avail_in = size - NXCP_HEADER_SIZE - 4;
-      stream.next_in = (BYTE *)msg + NXCP_HEADER_SIZE + 4;
-      if (inflateInit(&stream) != Z_OK)
-      {
-         out.append(_T("Cannot decompress message"));
-         return out;
-      }
-
       msgData = allocatedMsgData = static_cast<BYTE*>(MemAlloc(msgDataSize));
-      stream.next_out = allocatedMsgData;
-      stream.avail_out = (UINT32)msgDataSize;
-
-      if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
+      if (!DecompressPayload(msg, flags, allocatedMsgData, msgDataSize))
       {
-         inflateEnd(&stream);
          MemFree(allocatedMsgData);
          out.append(_T("Cannot decompress message"));
          return out;
       }
-      inflateEnd(&stream);
    }
    else
    {
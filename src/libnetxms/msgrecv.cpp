@@ -48,12 +48,26 @@ AbstractMessageReceiver::~AbstractMessageReceiver()
    MemFree(m_decryptionBuffer);
 }
 
+/**
+ * Decode message at the beginning of the buffer. Will return either copy of raw message or message object.
+ */
+void *AbstractMessageReceiver::decodeMessage(bool raw, bool *protocolError)
+{
+   if (raw)
+      return MemCopyBlock(m_buffer, ntohl(((NXCP_MESSAGE *)m_buffer)->size));
+
+   NXCPMessage *msg = NXCPMessage::deserialize(reinterpret_cast<NXCP_MESSAGE*>(m_buffer));
+   if (msg == NULL)
+      *protocolError = true;  // message deserialization error
+   return msg;
+}
+
 /**
  * Get message from buffer
  */
-NXCPMessage *AbstractMessageReceiver::getMessageFromBuffer(bool *protocolError)
+void *AbstractMessageReceiver::getMessageFromBuffer(bool raw, bool *protocolError)
 {
-   NXCPMessage *msg = NULL;
+   void *msg = NULL;
 
    if (m_dataSize >= NXCP_HEADER_SIZE)
    {
@@ -72,18 +86,12 @@ NXCPMessage *AbstractMessageReceiver::getMessageFromBuffer(bool *protocolError)
                if (m_decryptionBuffer == NULL)
                   m_decryptionBuffer = (BYTE *)MemAlloc(m_size);
                if (m_encryptionContext->decryptMessage((NXCP_ENCRYPTED_MESSAGE *)m_buffer, m_decryptionBuffer))
-               {
-                  msg = NXCPMessage::deserialize(reinterpret_cast<NXCP_MESSAGE*>(m_buffer));
-                  if (msg == NULL)
-                     *protocolError = true;  // message deserialization error
-               }
+                  msg = decodeMessage(raw, protocolError);
             }
          }
          else
          {
-            msg = NXCPMessage::deserialize(reinterpret_cast<NXCP_MESSAGE*>(m_buffer));
-            if (msg == NULL)
-               *protocolError = true;  // message deserialization error
+            msg = decodeMessage(raw, protocolError);
          }
          m_dataSize -= msgSize;
          if (m_dataSize > 0)
@@ -118,13 +126,13 @@ NXCPMessage *AbstractMessageReceiver::getMessageFromBuffer(bool *protocolError)
 /**
  * Read message from communication channel
  */
-NXCPMessage *AbstractMessageReceiver::readMessage(UINT32 timeout, MessageReceiverResult *result)
+void *AbstractMessageReceiver::readMessage(UINT32 timeout, MessageReceiverResult *result, bool raw)
 {
-   NXCPMessage *msg;
+   void *msg;
    bool protocolError = false;
    while(true)
    {
-      msg = getMessageFromBuffer(&protocolError);
+      msg = getMessageFromBuffer(raw, &protocolError);
       if (msg != NULL)
       {
          *result = MSGRECV_SUCCESS;
@@ -162,6 +170,23 @@ NXCPMessage *AbstractMessageReceiver::readMessage(UINT32 timeout, MessageReceive
    return msg;
 }
 
+/**
+ * Read message from communication channel
+ */
+NXCPMessage *AbstractMessageReceiver::readMessage(UINT32 timeout, MessageReceiverResult *result)
+{
+   return static_cast<NXCPMessage*>(readMessage(timeout, result, false));
+}
+
+/**
+ * Read raw message from communication channel. Returned message should be destroyed by caller with MemFree.
+ * Encrypted messages are returned already decrypted.
+ */
+NXCP_MESSAGE *AbstractMessageReceiver::readRawMessage(UINT32 timeout, MessageReceiverResult *result)
+{
+   return static_cast<NXCP_MESSAGE*>(readMessage(timeout, result, true));
+}
+
 /**
  * Convert result to text
  */
@@ -757,6 +757,59 @@ NXCP_MESSAGE LIBNETXMS_EXPORTABLE *CreateRawNXCPMessage(UINT16 code, UINT32 id,
    return msg;
 }
 
+/**
+ * Detect already compressed files when sending file over NXCP
+ */
+static bool s_detectCompressedFiles = true;
+
+/**
+ * Enable or disable detection of already compressed files in SendFileOverNXCP. If enabled,
+ * files in common compressed formats will be sent without stream compression.
+ */
+void LIBNETXMS_EXPORTABLE NXCPSetCompressedFileDetection(bool enabled)
+{
+   s_detectCompressedFiles = enabled;
+}
+
+/**
+ * Signatures of compressed file formats
+ */
+static struct
+{
+   size_t length;
+   BYTE signature[6];
+} s_compressedFileSignatures[] =
+{
+   { 2, { 0x1F, 0x8B } },                          // gzip
+   { 3, { 0x42, 0x5A, 0x68 } },                    // bzip2
+   { 4, { 0x50, 0x4B, 0x03, 0x04 } },              // zip (also jar, docx, etc.)
+   { 6, { 0xFD, 0x37, 0x7A, 0x58, 0x5A, 0x00 } },  // xz
+   { 4, { 0x28, 0xB5, 0x2F, 0xFD } },              // zstd
+   { 4, { 0x04, 0x22, 0x4D, 0x18 } },              // lz4 frame
+   { 6, { 0x37, 0x7A, 0xBC, 0xAF, 0x27, 0x1C } },  // 7-zip
+   { 6, { 0x52, 0x61, 0x72, 0x21, 0x1A, 0x07 } },  // rar
+   { 4, { 0x89, 0x50, 0x4E, 0x47 } },              // png
+   { 3, { 0xFF, 0xD8, 0xFF } },                    // jpeg
+   { 0, { 0 } }
+};
+
+/**
+ * Check if file content is already compressed. File position is reset to file start.
+ */
+static bool IsCompressedFile(int hFile)
+{
+   BYTE header[6];
+   int bytes = _read(hFile, header, sizeof(header));
+   _lseek(hFile, 0, SEEK_SET);
+   for(int i = 0; s_compressedFileSignatures[i].length > 0; i++)
+   {
+      if ((bytes >= static_cast<int>(s_compressedFileSignatures[i].length)) &&
+          !memcmp(header, s_compressedFileSignatures[i].signature, s_compressedFileSignatures[i].length))
+         return true;
+   }
+   return false;
+}
+
 /**
  * Send file over NXCP
  */
@@ -794,6 +847,12 @@ bool LIBNETXMS_EXPORTABLE SendFileOverNXCP(AbstractCommChannel *channel, UINT32
       size_t bytesToRead = (offset < 0) ? (0 - offset) : (fileSize - offset);
       INT64 bytesTransferred = 0;
 
+      if ((compressionMethod != NXCP_STREAM_COMPRESSION_NONE) && s_detectCompressedFiles && IsCompressedFile(hFile))
+      {
+         nxlog_debug(6, _T("SendFileOverNXCP: file %s is already compressed, stream compression disabled"), pszFile);
+         compressionMethod = NXCP_STREAM_COMPRESSION_NONE;
+      }
+
 		if (_lseek(hFile, offset, (offset < 0) ? SEEK_END : SEEK_SET) != -1)
 		{
          StreamCompressor *compressor = (compressionMethod != NXCP_STREAM_COMPRESSION_NONE) ? StreamCompressor::create(compressionMethod, true, FILE_BUFFER_SIZE) : NULL;
@@ -149,6 +149,44 @@ void Queue::put(void *element)
    unlock();
 }
 
+/**
+ * Put multiple elements into queue at once
+ */
+void Queue::putAll(void **elements, size_t count)
+{
+   lock();
+   for(size_t i = 0; i < count; i++)
+   {
+      if (m_tail->count == m_blockSize)
+      {
+         // Allocate new buffer
+         m_tail->next = static_cast<QueueBuffer*>(MemAllocZeroed(sizeof(QueueBuffer) + (m_blockSize - 1) * sizeof(void*)));
+         m_tail = m_tail->next;
+         m_blockCount++;
+      }
+      m_tail->elements[m_tail->tail++] = elements[i];
+      if (m_tail->tail == m_blockSize)
+         m_tail->tail = 0;
+      m_tail->count++;
+   }
+   m_size += count;
+   if (m_readers > 0)
+   {
+#ifdef _WIN32
+      if (count > 1)
+         WakeAllConditionVariable(&m_wakeupCondition);
+      else
+         WakeConditionVariable(&m_wakeupCondition);
+#else
+      if (count > 1)
+         pthread_cond_broadcast(&m_wakeupCondition);
+      else
+         pthread_cond_signal(&m_wakeupCondition);
+#endif
+   }
+   unlock();
+}
+
 /**
  * Insert new element into the beginning of a queue
  */
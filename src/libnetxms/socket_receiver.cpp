@@ -0,0 +1,681 @@
+/*
+** NetXMS - Network Management System
+** NetXMS Foundation Library
+** Copyright (C) 2003-2019 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published
+** by the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: socket_receiver.cpp
+**
+**/
+
+#include "libnetxms.h"
+#include <nxcpapi.h>
+
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#define DEBUG_TAG _T("comm.receiver")
+
+/**
+ * Message consumer destructor
+ */
+MessageConsumer::~MessageConsumer()
+{
+}
+
+/**
+ * Get receive timeout (in milliseconds). Default implementation returns INFINITE.
+ */
+UINT32 MessageConsumer::getReceiveTimeout()
+{
+   return INFINITE;
+}
+
+/**
+ * Check if consumer expects raw messages instead of message objects. Default implementation returns false.
+ */
+bool MessageConsumer::isRawMessageConsumer()
+{
+   return false;
+}
+
+/**
+ * Process received message. Default implementation just destroys message.
+ */
+void MessageConsumer::processMessage(NXCPMessage *msg)
+{
+   delete msg;
+}
+
+/**
+ * Process received raw message. Default implementation just destroys message.
+ */
+void MessageConsumer::processRawMessage(NXCP_MESSAGE *msg)
+{
+   MemFree(msg);
+}
+
+/**
+ * Called by receiver when no data was received within receive timeout. Should return
+ * true to continue waiting or false to shutdown receiver. Called on receiver thread.
+ * Default implementation returns false.
+ */
+bool MessageConsumer::onReceiveTimeout()
+{
+   return false;
+}
+
+#if HAVE_SYS_EPOLL_H
+
+/**
+ * Max number of events retrieved by single epoll_wait call
+ */
+#define MAX_EVENTS   256
+
+/**
+ * Registered consumer
+ */
+struct ConsumerRegistration
+{
+   MessageConsumer *consumer;
+   ThreadPool *pool;
+   SOCKET socket;
+   UINT32 timeout;
+   INT64 lastActivity;
+   bool raw;
+   bool removeRequested;
+   TCHAR key[48];
+};
+
+/**
+ * Task for message consumer
+ */
+struct ConsumerTask
+{
+   MessageConsumer *consumer;
+   void *message;
+   bool raw;
+   MessageReceiverResult reason;
+};
+
+/**
+ * Execute consumer task. Message consumer reference is released after task execution.
+ */
+static void ExecuteConsumerTask(ConsumerTask *task)
+{
+   if (task->message != NULL)
+   {
+      if (task->raw)
+         task->consumer->processRawMessage(static_cast<NXCP_MESSAGE*>(task->message));
+      else
+         task->consumer->processMessage(static_cast<NXCPMessage*>(task->message));
+   }
+   else
+   {
+      task->consumer->onReceiverShutdown(task->reason);
+   }
+   task->consumer->decConsumerRefCount();
+   delete task;
+}
+
+/**
+ * Pass task to consumer
+ */
+static void PostConsumerTask(ConsumerRegistration *r, void *message, MessageReceiverResult reason)
+{
+   ConsumerTask *task = new ConsumerTask;
+   task->consumer = r->consumer;
+   task->message = message;
+   task->raw = r->raw;
+   task->reason = reason;
+   if (r->pool != NULL)
+      ThreadPoolExecuteSerialized(r->pool, r->key, ExecuteConsumerTask, task);
+   else
+      ExecuteConsumerTask(task);
+}
+
+/**
+ * Receiver loop - single thread serving set of sockets
+ */
+class ReceiverLoop
+{
+private:
+   int m_id;
+   THREAD m_thread;
+   int m_epollFd;
+   int m_controlPipe[2];
+   MUTEX m_mutex;
+   HashMap<SOCKET, ConsumerRegistration> m_consumers;
+   bool m_removalRequested;
+   bool m_stop;
+
+   void mainLoop();
+   void readMessages(ConsumerRegistration *r, INT64 now);
+   void unregisterConsumer(ConsumerRegistration *r, MessageReceiverResult reason);
+   void processRemovalRequests();
+   void checkTimeouts(INT64 now);
+   void wakeup();
+
+   static THREAD_RESULT THREAD_CALL threadStarter(void *arg);
+
+public:
+   ReceiverLoop(int id);
+   ~ReceiverLoop();
+
+   bool start();
+   void stop();
+
+   bool addConsumer(ConsumerRegistration *r);
+   void removeConsumer(SOCKET s);
+   int getConsumerCount();
+};
+
+/**
+ * Receiver loop constructor
+ */
+ReceiverLoop::ReceiverLoop(int id) : m_consumers(false)
+{
+   m_id = id;
+   m_thread = INVALID_THREAD_HANDLE;
+   m_epollFd = -1;
+   m_controlPipe[0] = -1;
+   m_controlPipe[1] = -1;
+   m_mutex = MutexCreate();
+   m_removalRequested = false;
+   m_stop = false;
+}
+
+/**
+ * Receiver loop destructor
+ */
+ReceiverLoop::~ReceiverLoop()
+{
+   if (m_epollFd != -1)
+      _close(m_epollFd);
+   if (m_controlPipe[0] != -1)
+      _close(m_controlPipe[0]);
+   if (m_controlPipe[1] != -1)
+      _close(m_controlPipe[1]);
+   MutexDestroy(m_mutex);
+}
+
+/**
+ * Start receiver loop
+ */
+bool ReceiverLoop::start()
+{
+   m_epollFd = epoll_create(1024);
+   if (m_epollFd == -1)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: epoll_create() call failed (%s)"), _tcserror(errno));
+      return false;
+   }
+
+   if (pipe(m_controlPipe) != 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: pipe() call failed (%s)"), _tcserror(errno));
+      m_controlPipe[0] = -1;
+      m_controlPipe[1] = -1;
+      return false;
+   }
+
+   struct epoll_event ev;
+   memset(&ev, 0, sizeof(ev));
+   ev.events = EPOLLIN;
+   ev.data.ptr = NULL;  // NULL indicates control pipe
+   if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_controlPipe[0], &ev) != 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: cannot add control pipe to epoll set (%s)"), _tcserror(errno));
+      return false;
+   }
+
+   m_thread = ThreadCreateEx(ReceiverLoop::threadStarter, 0, this);
+   return m_thread != INVALID_THREAD_HANDLE;
+}
+
+/**
+ * Stop receiver loop. All remaining consumers will be unregistered.
+ */
+void ReceiverLoop::stop()
+{
+   m_stop = true;
+   wakeup();
+   ThreadJoin(m_thread);
+   m_thread = INVALID_THREAD_HANDLE;
+
+   MutexLock(m_mutex);
+   Iterator<ConsumerRegistration> *it = m_consumers.iterator();
+   ObjectArray<ConsumerRegistration> consumers(64, 64, false);
+   while(it->hasNext())
+      consumers.add(it->next());
+   delete it;
+   MutexUnlock(m_mutex);
+
+   for(int i = 0; i < consumers.size(); i++)
+      unregisterConsumer(consumers.get(i), MSGRECV_CLOSED);
+}
+
+/**
+ * Wake up receiver thread
+ */
+void ReceiverLoop::wakeup()
+{
+   if (m_controlPipe[1] != -1)
+      _write(m_controlPipe[1], "W", 1);
+}
+
+/**
+ * Thread starter
+ */
+THREAD_RESULT THREAD_CALL ReceiverLoop::threadStarter(void *arg)
+{
+   ThreadSetName("SocketReceiver");
+   static_cast<ReceiverLoop*>(arg)->mainLoop();
+   return THREAD_OK;
+}
+
+/**
+ * Add consumer to this loop
+ */
+bool ReceiverLoop::addConsumer(ConsumerRegistration *r)
+{
+   MutexLock(m_mutex);
+   if (m_consumers.contains(r->socket))
+   {
+      MutexUnlock(m_mutex);
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("SocketReceiver: socket %d already registered"), (int)r->socket);
+      return false;
+   }
+   m_consumers.set(r->socket, r);
+   MutexUnlock(m_mutex);
+
+   struct epoll_event ev;
+   memset(&ev, 0, sizeof(ev));
+   ev.events = EPOLLIN | EPOLLRDHUP;
+   ev.data.ptr = r;
+   if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, r->socket, &ev) != 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("SocketReceiver: cannot add socket %d to epoll set (%s)"), (int)r->socket, _tcserror(errno));
+      MutexLock(m_mutex);
+      m_consumers.unlink(r->socket);
+      MutexUnlock(m_mutex);
+      return false;
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 7, _T("SocketReceiver: socket %d registered with receiver loop %d"), (int)r->socket, m_id);
+   return true;
+}
+
+/**
+ * Request consumer removal. Consumer will be removed asynchronously by receiver thread.
+ */
+void ReceiverLoop::removeConsumer(SOCKET s)
+{
+   MutexLock(m_mutex);
+   ConsumerRegistration *r = m_consumers.get(s);
+   if (r != NULL)
+   {
+      r->removeRequested = true;
+      m_removalRequested = true;
+   }
+   MutexUnlock(m_mutex);
+   if (r != NULL)
+      wakeup();
+}
+
+/**
+ * Get number of consumers registered with this loop
+ */
+int ReceiverLoop::getConsumerCount()
+{
+   MutexLock(m_mutex);
+   int count = m_consumers.size();
+   MutexUnlock(m_mutex);
+   return count;
+}
+
+/**
+ * Unregister consumer and notify it about receiver shutdown. Registration object is destroyed.
+ */
+void ReceiverLoop::unregisterConsumer(ConsumerRegistration *r, MessageReceiverResult reason)
+{
+   epoll_ctl(m_epollFd, EPOLL_CTL_DEL, r->socket, NULL);
+
+   MutexLock(m_mutex);
+   m_consumers.unlink(r->socket);
+   MutexUnlock(m_mutex);
+
+   nxlog_debug_tag(DEBUG_TAG, 7, _T("SocketReceiver: socket %d unregistered from receiver loop %d (%s)"),
+            (int)r->socket, m_id, AbstractMessageReceiver::resultToText(reason));
+
+   // Registration reference to consumer will be released by shutdown task
+   PostConsumerTask(r, NULL, reason);
+   delete r;
+}
+
+/**
+ * Read all available messages from consumer's socket
+ */
+void ReceiverLoop::readMessages(ConsumerRegistration *r, INT64 now)
+{
+   r->lastActivity = now;
+   AbstractMessageReceiver *receiver = r->consumer->getMessageReceiver();
+   while(true)
+   {
+      MessageReceiverResult result;
+      void *msg = r->raw ?
+               static_cast<void*>(receiver->readRawMessage(0, &result)) :
+               static_cast<void*>(receiver->readMessage(0, &result));
+      if (result == MSGRECV_SUCCESS)
+      {
+         r->consumer->incConsumerRefCount();
+         PostConsumerTask(r, msg, MSGRECV_SUCCESS);
+      }
+      else
+      {
+         // Timeout means that all available data was consumed
+         if (result != MSGRECV_TIMEOUT)
+            unregisterConsumer(r, result);
+         break;
+      }
+   }
+}
+
+/**
+ * Process pending removal requests
+ */
+void ReceiverLoop::processRemovalRequests()
+{
+   ObjectArray<ConsumerRegistration> consumers(16, 16, false);
+   MutexLock(m_mutex);
+   if (m_removalRequested)
+   {
+      Iterator<ConsumerRegistration> *it = m_consumers.iterator();
+      while(it->hasNext())
+      {
+         ConsumerRegistration *r = it->next();
+         if (r->removeRequested)
+            consumers.add(r);
+      }
+      delete it;
+      m_removalRequested = false;
+   }
+   MutexUnlock(m_mutex);
+
+   for(int i = 0; i < consumers.size(); i++)
+      unregisterConsumer(consumers.get(i), MSGRECV_CLOSED);
+}
+
+/**
+ * Check receive timeouts
+ */
+void ReceiverLoop::checkTimeouts(INT64 now)
+{
+   ObjectArray<ConsumerRegistration> expired(16, 16, false);
+   MutexLock(m_mutex);
+   Iterator<ConsumerRegistration> *it = m_consumers.iterator();
+   while(it->hasNext())
+   {
+      ConsumerRegistration *r = it->next();
+      if ((r->timeout != INFINITE) && (now - r->lastActivity > static_cast<INT64>(r->timeout)))
+         expired.add(r);
+   }
+   delete it;
+   MutexUnlock(m_mutex);
+
+   for(int i = 0; i < expired.size(); i++)
+   {
+      ConsumerRegistration *r = expired.get(i);
+      if (r->consumer->onReceiveTimeout())
+         r->lastActivity = now;
+      else
+         unregisterConsumer(r, MSGRECV_TIMEOUT);
+   }
+}
+
+/**
+ * Receiver loop
+ */
+void ReceiverLoop::mainLoop()
+{
+   nxlog_debug_tag(DEBUG_TAG, 2, _T("SocketReceiver: receiver loop %d started"), m_id);
+
+   struct epoll_event events[MAX_EVENTS];
+   INT64 lastTimeoutCheck = GetCurrentTimeMs();
+   while(!m_stop)
+   {
+      int count = epoll_wait(m_epollFd, events, MAX_EVENTS, 1000);
+      if ((count == -1) && (errno != EINTR))
+      {
+         nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: epoll_wait() call failed (%s)"), _tcserror(errno));
+         ThreadSleepMs(100);
+         continue;
+      }
+
+      INT64 now = GetCurrentTimeMs();
+      bool controlEvent = false;
+      for(int i = 0; i < count; i++)
+      {
+         if (events[i].data.ptr == NULL)
+         {
+            char buffer[64];
+            _read(m_controlPipe[0], buffer, sizeof(buffer));
+            controlEvent = true;
+         }
+         else
+         {
+            readMessages(static_cast<ConsumerRegistration*>(events[i].data.ptr), now);
+         }
+      }
+
+      if (controlEvent)
+         processRemovalRequests();
+
+      if (now - lastTimeoutCheck >= 1000)
+      {
+         checkTimeouts(now);
+         lastTimeoutCheck = now;
+      }
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 2, _T("SocketReceiver: receiver loop %d stopped"), m_id);
+}
+
+/**
+ * Receiver loops
+ */
+static ReceiverLoop **s_loops = NULL;
+static int s_loopCount = 0;
+
+/**
+ * Start socket receiver with given number of threads
+ */
+bool SocketReceiver::start(int numThreads)
+{
+   if ((s_loopCount > 0) || (numThreads < 1))
+      return false;
+
+   ReceiverLoop **loops = MemAllocArray<ReceiverLoop*>(numThreads);
+   for(int i = 0; i < numThreads; i++)
+   {
+      loops[i] = new ReceiverLoop(i);
+      if (!loops[i]->start())
+      {
+         for(int j = 0; j < i; j++)
+         {
+            loops[j]->stop();
+            delete loops[j];
+         }
+         delete loops[i];
+         MemFree(loops);
+         nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: initialization failed"));
+         return false;
+      }
+   }
+
+   s_loops = loops;
+   s_loopCount = numThreads;
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: started with %d threads"), numThreads);
+   return true;
+}
+
+/**
+ * Shutdown socket receiver. Remaining consumers will be notified about receiver shutdown.
+ */
+void SocketReceiver::shutdown()
+{
+   if (s_loopCount == 0)
+      return;
+
+   int count = s_loopCount;
+   s_loopCount = 0;
+   for(int i = 0; i < count; i++)
+   {
+      s_loops[i]->stop();
+      delete s_loops[i];
+   }
+   MemFreeAndNull(s_loops);
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: stopped"));
+}
+
+/**
+ * Check if socket receiver is running
+ */
+bool SocketReceiver::isRunning()
+{
+   return s_loopCount > 0;
+}
+
+/**
+ * Add message consumer. Received messages will be passed to consumer via given thread pool
+ * (or directly from receiver thread if pool is NULL). Returns false if consumer cannot be
+ * registered (for example, if receiver is not running) - in that case consumer should
+ * read messages by itself.
+ *
+ * Messages for each consumer are delivered by serialized pool tasks, so message waiting
+ * for delivery occupies no thread but needs a free one to be processed. If other tasks on
+ * the same pool block until some message is received (for example, wait for response to
+ * a request), they can occupy all pool threads and prevent delivery of that message until
+ * wait times out. Pool passed here therefore should be used only for message delivery,
+ * and consumers should not block in message processing callbacks.
+ */
+bool SocketReceiver::addConsumer(MessageConsumer *mc, ThreadPool *pool)
+{
+   int loopCount = s_loopCount;
+   if (loopCount == 0)
+      return false;
+
+   SOCKET s = mc->getSocket();
+   if (s == INVALID_SOCKET)
+      return false;
+
+   ConsumerRegistration *r = new ConsumerRegistration;
+   r->consumer = mc;
+   r->pool = pool;
+   r->socket = s;
+   r->timeout = mc->getReceiveTimeout();
+   r->lastActivity = GetCurrentTimeMs();
+   r->raw = mc->isRawMessageConsumer();
+   r->removeRequested = false;
+   _sntprintf(r->key, 48, _T("MessageConsumer_%p"), mc);
+
+   mc->incConsumerRefCount();
+   if (!s_loops[s % loopCount]->addConsumer(r))
+   {
+      mc->decConsumerRefCount();
+      delete r;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Remove message consumer. Consumer is removed asynchronously and will be notified
+ * about shutdown as usual.
+ */
+void SocketReceiver::removeConsumer(MessageConsumer *mc)
+{
+   int loopCount = s_loopCount;
+   if (loopCount == 0)
+      return;
+
+   SOCKET s = mc->getSocket();
+   if (s != INVALID_SOCKET)
+      s_loops[s % loopCount]->removeConsumer(s);
+}
+
+/**
+ * Get total number of registered consumers
+ */
+int SocketReceiver::getConsumerCount()
+{
+   int count = 0;
+   for(int i = 0; i < s_loopCount; i++)
+      count += s_loops[i]->getConsumerCount();
+   return count;
+}
+
+#else /* HAVE_SYS_EPOLL_H */
+
+/**
+ * Start socket receiver (not supported on this platform)
+ */
+bool SocketReceiver::start(int numThreads)
+{
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("SocketReceiver: not supported on this platform"));
+   return false;
+}
+
+/**
+ * Shutdown socket receiver
+ */
+void SocketReceiver::shutdown()
+{
+}
+
+/**
+ * Check if socket receiver is running
+ */
+bool SocketReceiver::isRunning()
+{
+   return false;
+}
+
+/**
+ * Add message consumer
+ */
+bool SocketReceiver::addConsumer(MessageConsumer *mc, ThreadPool *pool)
+{
+   return false;
+}
+
+/**
+ * Remove message consumer
+ */
+void SocketReceiver::removeConsumer(MessageConsumer *mc)
+{
+}
+
+/**
+ * Get total number of registered consumers
+ */
+int SocketReceiver::getConsumerCount()
+{
+   return 0;
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
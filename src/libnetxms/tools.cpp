@@ -1286,6 +1286,124 @@ int LIBNETXMS_EXPORTABLE SendEx(SOCKET hSocket, const void *data, size_t len, in
 	return nLeft == 0 ? (int)len : nRet;
 }
 
+/**
+ * Send data from multiple buffers with single system call where possible (scatter-gather send).
+ * Returns total number of bytes sent or value less or equal to 0 on error.
+ */
+int LIBNETXMS_EXPORTABLE SendVectorEx(SOCKET hSocket, const SGBuffer *buffers, int count, MUTEX mutex)
+{
+#ifdef _WIN32
+   WSABUF localVector[16];
+   WSABUF *vector = (count <= 16) ? localVector : MemAllocArrayNoInit<WSABUF>(count);
+#else
+   struct iovec localVector[16];
+   struct iovec *vector = (count <= 16) ? localVector : MemAllocArrayNoInit<struct iovec>(count);
+#endif
+   size_t total = 0;
+   for(int i = 0; i < count; i++)
+   {
+#ifdef _WIN32
+      vector[i].buf = static_cast<char*>(const_cast<void*>(buffers[i].data));
+      vector[i].len = static_cast<ULONG>(buffers[i].size);
+#else
+      vector[i].iov_base = const_cast<void*>(buffers[i].data);
+      vector[i].iov_len = buffers[i].size;
+#endif
+      total += buffers[i].size;
+   }
+
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexLock(mutex);
+
+   int rc = 0;
+   size_t bytesLeft = total;
+   int index = 0;
+   while(bytesLeft > 0)
+   {
+#ifdef _WIN32
+      DWORD bytes;
+      if (WSASend(hSocket, &vector[index], count - index, &bytes, 0, NULL, NULL) == SOCKET_ERROR)
+         rc = -1;
+      else
+         rc = static_cast<int>(bytes);
+#else
+      struct msghdr mh;
+      memset(&mh, 0, sizeof(mh));
+      mh.msg_iov = &vector[index];
+      mh.msg_iovlen = count - index;
+#ifdef IOV_MAX
+      if (mh.msg_iovlen > IOV_MAX)
+         mh.msg_iovlen = IOV_MAX;
+#endif
+#ifdef MSG_NOSIGNAL
+      rc = static_cast<int>(sendmsg(hSocket, &mh, MSG_NOSIGNAL));
+#else
+      rc = static_cast<int>(sendmsg(hSocket, &mh, 0));
+#endif
+#endif
+      if (rc <= 0)
+      {
+#ifndef _WIN32
+         if ((rc == -1) && (errno == EINTR))
+            continue;
+#endif
+         if ((WSAGetLastError() == WSAEWOULDBLOCK)
+#ifndef _WIN32
+             || (errno == EAGAIN)
+#endif
+            )
+         {
+            // Wait until socket becomes available for writing
+            SocketPoller p(true);
+            p.add(hSocket);
+            rc = p.poll(60000);
+#ifdef _WIN32
+            if (rc > 0)
+#else
+            if ((rc > 0) || ((rc == -1) && (errno == EINTR)))
+#endif
+               continue;
+         }
+         break;
+      }
+
+      // Skip fully sent buffers and adjust partially sent one
+      bytesLeft -= rc;
+      size_t sent = static_cast<size_t>(rc);
+#ifdef _WIN32
+      while((index < count) && (sent >= vector[index].len))
+      {
+         sent -= vector[index].len;
+         index++;
+      }
+      if (sent > 0)
+      {
+         vector[index].buf += sent;
+         vector[index].len -= static_cast<ULONG>(sent);
+      }
+#else
+      while((index < count) && (sent >= vector[index].iov_len))
+      {
+         sent -= vector[index].iov_len;
+         index++;
+      }
+      if (sent > 0)
+      {
+         vector[index].iov_base = static_cast<char*>(vector[index].iov_base) + sent;
+         vector[index].iov_len -= sent;
+      }
+#endif
+   }
+
+   if (mutex != INVALID_MUTEX_HANDLE)
+      MutexUnlock(mutex);
+
+   if (vector != localVector)
+      MemFree(vector);
+
+   return (bytesLeft == 0) ? static_cast<int>(total) : rc;
+}
+
 /**
  * Extended recv() - receive data with timeout
  *
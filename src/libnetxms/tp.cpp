@@ -43,6 +43,23 @@ static int s_maintThreadResponsiveness = 12;
 #define MIN_WORKER_IDLE_TIMEOUT  10000
 #define MAX_WORKER_IDLE_TIMEOUT  600000
 
+/**
+ * Maximum number of execution queues in work stealing mode
+ */
+#define MAX_WORK_STEALING_QUEUES 32
+
+/**
+ * Interval (milliseconds) for idle worker to re-check other workers' queues in work stealing mode.
+ * Idle workers are normally woken up by request submitter (see WakeIdleWorker), so this is only a safety net.
+ */
+#define WORK_STEALING_SCAN_INTERVAL 1000
+
+/**
+ * Maximum wait time (milliseconds) accounted in wait time moving average. Average is kept
+ * as 32 bit fixed point value to allow lock-free updates, so wait time has to be capped.
+ */
+#define MAX_ACCOUNTED_WAIT_TIME  1000000
+
 /**
  * Worker thread data
  */
@@ -50,6 +67,8 @@ struct WorkerThreadInfo
 {
    ThreadPool *pool;
    THREAD handle;
+   int queueIndex;         // own execution queue (work stealing mode only)
+   VolatileCounter averageWaitTime;  // task wait time moving average (work stealing mode only)
 };
 
 /**
@@ -61,6 +80,7 @@ struct WorkRequest
    void *arg;
    INT64 queueTime;
    INT64 runTime;
+   UINT64 sequence;  // for scheduled requests: keeps FIFO order for same run time
 };
 
 /**
@@ -84,6 +104,7 @@ class SerializationQueue: public Queue
  */
 struct ThreadPool
 {
+   UINT32 flags;
    int minThreads;
    int maxThreads;
    int stackSize;
@@ -93,26 +114,299 @@ struct ThreadPool
    THREAD maintThread;
    CONDITION maintThreadWakeup;
    HashMap<UINT64, WorkerThreadInfo> *threads;
-   Queue *queue;
+   Queue **queues;      // execution queues (only one unless in work stealing mode)
+   int queueCount;
+   int *queueWorkers;   // number of workers assigned to each execution queue
+   VolatileCounter *queueIdleWorkers;  // number of idle workers waiting on each execution queue (work stealing mode only)
+   VolatileCounter idleWorkers;        // total number of idle workers (work stealing mode only)
+   VolatileCounter nextQueue;
    StringObjectMap<SerializationQueue> *serializationQueues;
    MUTEX serializationLock;
-   ObjectArray<WorkRequest> *schedulerQueue;
+   WorkRequest **schedulerHeap;  // 4-ary min-heap ordered by run time
+   int schedulerHeapSize;
+   int schedulerHeapAllocated;
+   UINT64 schedulerSequence;
+   UINT64 schedulerLateness[THREAD_POOL_LATENESS_BUCKETS];
    MUTEX schedulerLock;
    TCHAR *name;
    bool shutdownMode;
    INT64 loadAverage[3];
-   INT64 averageWaitTime;
+   VolatileCounter averageWaitTime;
    UINT64 threadStartCount;
    UINT64 threadStopCount;
    VolatileCounter64 taskExecutionCount;
 };
 
+/**
+ * Callback for calculating average wait time in work stealing mode
+ */
+static EnumerationCallbackResult SumWaitTimeCallback(const void *key, const void *object, void *arg)
+{
+   *static_cast<INT64*>(arg) += static_cast<const WorkerThreadInfo*>(object)->averageWaitTime;
+   return _CONTINUE;
+}
+
+/**
+ * Get average request wait time in milliseconds (pool mutex must be held)
+ */
+static INT64 GetAverageWaitTime(ThreadPool *p)
+{
+   if (!(p->flags & THREAD_POOL_WORK_STEALING))
+      return p->averageWaitTime / EMA_FP_1;
+
+   int count = p->threads->size();
+   if (count == 0)
+      return 0;
+   INT64 sum = 0;
+   p->threads->forEach(SumWaitTimeCallback, &sum);
+   return sum / count / EMA_FP_1;
+}
+
+/**
+ * Update request wait time moving average. Can be called by multiple threads concurrently.
+ */
+static inline void UpdateWaitTimeAverage(VolatileCounter *average, INT64 waitTime)
+{
+   INT64 n = std::min(waitTime, static_cast<INT64>(MAX_ACCOUNTED_WAIT_TIME)) << EMA_FP_SHIFT;
+   VolatileCounter curr, next;
+   do
+   {
+      curr = *average;
+      INT64 value = curr;
+      UpdateExpMovingAverage(value, EMA_EXP_180, n);
+      next = static_cast<VolatileCounter>(value);
+   } while(InterlockedCompareExchange(average, next, curr) != curr);
+}
+
+/**
+ * Wake up idle worker in work stealing mode if request was put into queue without idle workers.
+ * One request is moved from that queue to queue with idle worker, so idle worker starts
+ * processing immediately instead of finding request on next periodic scan.
+ */
+static void WakeIdleWorker(ThreadPool *p, int busyQueue)
+{
+   if ((p->idleWorkers == 0) || (p->queueIdleWorkers[busyQueue] > 0))
+      return;
+
+   for(int i = 1; i < p->queueCount; i++)
+   {
+      int index = (busyQueue + i) % p->queueCount;
+      if (p->queueIdleWorkers[index] > 0)
+      {
+         void *rq = p->queues[busyQueue]->get();
+         if (rq != NULL)
+            p->queues[index]->put(rq);
+         return;
+      }
+   }
+}
+
+/**
+ * Put request into execution queue. In work stealing mode less loaded of two adjacent queues is used.
+ */
+static inline void EnqueueRequest(ThreadPool *p, WorkRequest *rq)
+{
+   if (p->queueCount == 1)
+   {
+      p->queues[0]->put(rq);
+      return;
+   }
+
+   UINT32 n = static_cast<UINT32>(InterlockedIncrement(&p->nextQueue));
+   int index = n % p->queueCount;
+   if (p->queues[(n + 1) % p->queueCount]->size() < p->queues[index]->size())
+      index = (n + 1) % p->queueCount;
+   p->queues[index]->put(rq);
+   WakeIdleWorker(p, index);
+}
+
+/**
+ * Get next request in work stealing mode - from own queue, then from other queues, then
+ * wait on own queue. Returns NULL if no request was available within given timeout.
+ */
+static WorkRequest *GetRequestWorkStealing(ThreadPool *p, WorkerThreadInfo *wt, UINT32 timeout)
+{
+   Queue *ownQueue = p->queues[wt->queueIndex];
+   UINT32 waitTime = 0;
+   while(true)
+   {
+      WorkRequest *rq = static_cast<WorkRequest*>(ownQueue->get());
+      if (rq != NULL)
+         return rq;
+
+      // Worker is registered as idle before scanning other queues, so request put into
+      // other queue after the scan will be moved to this worker's queue by WakeIdleWorker
+      InterlockedIncrement(&p->queueIdleWorkers[wt->queueIndex]);
+      InterlockedIncrement(&p->idleWorkers);
+
+      for(int i = 1; (i < p->queueCount) && (rq == NULL); i++)
+         rq = static_cast<WorkRequest*>(p->queues[(wt->queueIndex + i) % p->queueCount]->get());
+
+      // Wake up periodically to check other queues as a safety net
+      if ((rq == NULL) && (waitTime < timeout))
+      {
+         UINT32 interval = std::min(static_cast<UINT32>(WORK_STEALING_SCAN_INTERVAL), timeout - waitTime);
+         rq = static_cast<WorkRequest*>(ownQueue->getOrBlock(interval));
+         waitTime += interval;
+      }
+
+      InterlockedDecrement(&p->idleWorkers);
+      InterlockedDecrement(&p->queueIdleWorkers[wt->queueIndex]);
+
+      if (rq != NULL)
+      {
+         // More requests could be put into own queue while this worker was still registered as idle
+         if (ownQueue->size() > 0)
+            WakeIdleWorker(p, wt->queueIndex);
+         return rq;
+      }
+      if (waitTime >= timeout)
+         return NULL;
+   }
+}
+
+/**
+ * Scheduler heap arity
+ */
+#define SCHEDULER_HEAP_ARITY  4
+
+/**
+ * Maximum number of scheduled requests moved to execution queue at once
+ */
+#define SCHEDULER_DISPATCH_BATCH_SIZE  256
+
+/**
+ * Check if scheduled request r1 should run before r2
+ */
+static inline bool ScheduledBefore(const WorkRequest *r1, const WorkRequest *r2)
+{
+   return (r1->runTime < r2->runTime) || ((r1->runTime == r2->runTime) && (r1->sequence < r2->sequence));
+}
+
+/**
+ * Add request to scheduler heap (scheduler lock must be held). Returns true if new request is now the first one.
+ */
+static bool SchedulerHeapPush(ThreadPool *p, WorkRequest *rq)
+{
+   if (p->schedulerHeapSize == p->schedulerHeapAllocated)
+   {
+      p->schedulerHeapAllocated += std::max(p->schedulerHeapAllocated, 64);
+      p->schedulerHeap = MemReallocArray(p->schedulerHeap, p->schedulerHeapAllocated);
+   }
+
+   WorkRequest **heap = p->schedulerHeap;
+   int index = p->schedulerHeapSize++;
+   while(index > 0)
+   {
+      int parent = (index - 1) / SCHEDULER_HEAP_ARITY;
+      if (!ScheduledBefore(rq, heap[parent]))
+         break;
+      heap[index] = heap[parent];
+      index = parent;
+   }
+   heap[index] = rq;
+   return index == 0;
+}
+
+/**
+ * Remove first request from scheduler heap (scheduler lock must be held)
+ */
+static WorkRequest *SchedulerHeapPop(ThreadPool *p)
+{
+   WorkRequest **heap = p->schedulerHeap;
+   WorkRequest *top = heap[0];
+   WorkRequest *last = heap[--p->schedulerHeapSize];
+   int size = p->schedulerHeapSize;
+   int index = 0;
+   while(true)
+   {
+      int child = index * SCHEDULER_HEAP_ARITY + 1;
+      if (child >= size)
+         break;
+      int end = std::min(child + SCHEDULER_HEAP_ARITY, size);
+      int minChild = child;
+      for(int i = child + 1; i < end; i++)
+         if (ScheduledBefore(heap[i], heap[minChild]))
+            minChild = i;
+      if (!ScheduledBefore(heap[minChild], last))
+         break;
+      heap[index] = heap[minChild];
+      index = minChild;
+   }
+   if (size > 0)
+      heap[index] = last;
+   return top;
+}
+
+/**
+ * Get lateness histogram bucket for given dispatch delay (in milliseconds)
+ */
+static inline int LatenessBucket(INT64 delay)
+{
+   if (delay <= 1)
+      return 0;
+   if (delay <= 10)
+      return 1;
+   if (delay <= 100)
+      return 2;
+   if (delay <= 1000)
+      return 3;
+   return 4;
+}
+
+/**
+ * Move due scheduled requests to execution queue. Returns time in milliseconds until next scheduled request
+ * or given default value if there are no scheduled requests.
+ */
+static UINT32 DispatchScheduledRequests(ThreadPool *p, UINT32 defaultWaitTime)
+{
+   WorkRequest *batch[SCHEDULER_DISPATCH_BATCH_SIZE];
+   while(true)
+   {
+      int count = 0;
+      UINT32 waitTime = defaultWaitTime;
+      INT64 now = GetCurrentTimeMs();
+
+      MutexLock(p->schedulerLock);
+      while((p->schedulerHeapSize > 0) && (count < SCHEDULER_DISPATCH_BATCH_SIZE))
+      {
+         WorkRequest *rq = p->schedulerHeap[0];
+         if (rq->runTime > now)
+         {
+            UINT32 delay = static_cast<UINT32>(rq->runTime - now);
+            if (delay < waitTime)
+               waitTime = delay;
+            break;
+         }
+         SchedulerHeapPop(p);
+         p->schedulerLateness[LatenessBucket(now - rq->runTime)]++;
+         batch[count++] = rq;
+      }
+      MutexUnlock(p->schedulerLock);
+
+      for(int i = 0; i < count; i++)
+      {
+         InterlockedIncrement(&p->activeRequests);
+         batch[i]->queueTime = now;
+         EnqueueRequest(p, batch[i]);
+      }
+
+      if (count < SCHEDULER_DISPATCH_BATCH_SIZE)
+         return waitTime;
+   }
+}
+
 /**
  * Thread pool registry
  */
 static StringObjectMap<ThreadPool> s_registry(false);
 static Mutex s_registryLock;
 
+/**
+ * Create new worker thread (pool mutex must be held)
+ */
+static WorkerThreadInfo *CreateWorkerThread(ThreadPool *p);
+
 /**
  * Worker function to join stopped thread
  */
@@ -127,8 +421,9 @@ static void JoinWorkerThread(void *arg)
  */
 static THREAD_RESULT THREAD_CALL WorkerThread(void *arg)
 {
-   ThreadPool *p = static_cast<WorkerThreadInfo*>(arg)->pool;
-   Queue *q = p->queue;
+   WorkerThreadInfo *wt = static_cast<WorkerThreadInfo*>(arg);
+   ThreadPool *p = wt->pool;
+   bool workStealing = (p->flags & THREAD_POOL_WORK_STEALING) != 0;
 
    char threadName[16];
    threadName[0] = '$';
@@ -142,7 +437,9 @@ static THREAD_RESULT THREAD_CALL WorkerThread(void *arg)
 
    while(true)
    {
-      WorkRequest *rq = static_cast<WorkRequest*>(q->getOrBlock(p->workerIdleTimeout));
+      WorkRequest *rq = workStealing ?
+               GetRequestWorkStealing(p, wt, p->workerIdleTimeout) :
+               static_cast<WorkRequest*>(p->queues[0]->getOrBlock(p->workerIdleTimeout));
 
       if (rq == NULL)
       {
@@ -154,12 +451,14 @@ static THREAD_RESULT THREAD_CALL WorkerThread(void *arg)
          }
 
          MutexLock(p->mutex);
-         if ((p->threads->size() <= p->minThreads) || (p->averageWaitTime / EMA_FP_1 > s_waitTimeLowWatermark))
+         if ((p->threads->size() <= p->minThreads) || (GetAverageWaitTime(p) > s_waitTimeLowWatermark) ||
+             (workStealing && (p->queueWorkers[wt->queueIndex] <= 1)))
          {
             MutexUnlock(p->mutex);
             continue;
          }
          p->threads->remove(CAST_FROM_POINTER(arg, UINT64));
+         p->queueWorkers[wt->queueIndex]--;
          p->threadStopCount++;
          MutexUnlock(p->mutex);
 
@@ -171,17 +470,15 @@ static THREAD_RESULT THREAD_CALL WorkerThread(void *arg)
          rq->arg = arg;
          rq->queueTime = GetCurrentTimeMs();
          InterlockedIncrement(&p->activeRequests);
-         p->queue->put(rq);
+         EnqueueRequest(p, rq);
          break;
       }
       
       if (rq->func == NULL) // stop indicator
          break;
       
-      INT64 waitTime = (GetCurrentTimeMs() - rq->queueTime) << EMA_FP_SHIFT;
-      MutexLock(p->mutex);
-      UpdateExpMovingAverage(p->averageWaitTime, EMA_EXP_180, waitTime);
-      MutexUnlock(p->mutex);
+      // In work stealing mode each worker maintains own average, pool average is calculated on request
+      UpdateWaitTimeAverage(workStealing ? &wt->averageWaitTime : &p->averageWaitTime, GetCurrentTimeMs() - rq->queueTime);
 
       rq->func(rq->arg);
       MemFree(rq);
@@ -237,25 +534,20 @@ static THREAD_RESULT THREAD_CALL MaintenanceThread(void *arg)
 
             MutexLock(p->mutex);
             int threadCount = p->threads->size();
-            INT64 averageWaitTime = p->averageWaitTime / EMA_FP_1;
+            INT64 averageWaitTime = GetAverageWaitTime(p);
             if (((averageWaitTime > s_waitTimeHighWatermark) && (threadCount < p->maxThreads)) ||
                 ((threadCount == 0) && (p->activeRequests > 0)))
             {
                int delta = std::min(p->maxThreads - threadCount, std::max((static_cast<int>(p->activeRequests) - threadCount) / 2, 1));
                for(int i = 0; i < delta; i++)
                {
-                  WorkerThreadInfo *wt = new WorkerThreadInfo;
-                  wt->pool = p;
-                  wt->handle = ThreadCreateEx(WorkerThread, p->stackSize, wt);
-                  if (wt->handle != INVALID_THREAD_HANDLE)
+                  if (CreateWorkerThread(p) != NULL)
                   {
-                     p->threads->set(CAST_FROM_POINTER(wt, UINT64), wt);
                      p->threadStartCount++;
                      started++;
                   }
                   else
                   {
-                     delete wt;
                      failure = true;
                      break;
                   }
@@ -284,55 +576,72 @@ static THREAD_RESULT THREAD_CALL MaintenanceThread(void *arg)
                nxlog_debug_tag(DEBUG_TAG, 4, _T("%s"), debugMessage);
          }
       }
-      sleepTime = 5000 - cycleTime;
 
       // Check scheduler queue
-      MutexLock(p->schedulerLock);
-      if (p->schedulerQueue->size() > 0)
-      {
-         INT64 now = GetCurrentTimeMs();
-         WorkRequest *rq;
-         while(p->schedulerQueue->size() > 0)
-         {
-            rq = p->schedulerQueue->get(0);
-            if (rq->runTime > now)
-            {
-               UINT32 delay = static_cast<UINT32>(rq->runTime - now);
-               if (delay < sleepTime)
-                  sleepTime = delay;
-               break;
-            }
-            p->schedulerQueue->remove(0);
-            InterlockedIncrement(&p->activeRequests);
-            rq->queueTime = now;
-            p->queue->put(rq);
-         }
-      }
-      MutexUnlock(p->schedulerLock);
+      sleepTime = DispatchScheduledRequests(p, 5000 - cycleTime);
    }
    nxlog_debug_tag(DEBUG_TAG, 3, _T("Maintenance thread for thread pool %s stopped"), p->name);
    return THREAD_OK;
 }
 
+/**
+ * Create new worker thread (pool mutex must be held)
+ */
+static WorkerThreadInfo *CreateWorkerThread(ThreadPool *p)
+{
+   WorkerThreadInfo *wt = new WorkerThreadInfo;
+   wt->pool = p;
+   wt->averageWaitTime = 0;
+
+   // Assign worker to execution queue with least workers
+   wt->queueIndex = 0;
+   for(int i = 1; i < p->queueCount; i++)
+      if (p->queueWorkers[i] < p->queueWorkers[wt->queueIndex])
+         wt->queueIndex = i;
+
+   wt->handle = ThreadCreateEx(WorkerThread, p->stackSize, wt);
+   if (wt->handle == INVALID_THREAD_HANDLE)
+   {
+      delete wt;
+      return NULL;
+   }
+   p->threads->set(CAST_FROM_POINTER(wt, UINT64), wt);
+   p->queueWorkers[wt->queueIndex]++;
+   return wt;
+}
+
 /**
  * Create thread pool
  */
-ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThreads, int maxThreads, int stackSize)
+ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThreads, int maxThreads, int stackSize, UINT32 flags)
 {
    ThreadPool *p = MemAllocStruct<ThreadPool>();
+   p->flags = flags;
    p->minThreads = minThreads;
    p->maxThreads = maxThreads;
    p->stackSize = stackSize;
    p->workerIdleTimeout = MIN_WORKER_IDLE_TIMEOUT;
    p->activeRequests = 0;
    p->threads = new HashMap<UINT64, WorkerThreadInfo>();
-   p->queue = new Queue(64, false);
+   // Work stealing mode requires at least one worker per queue, so number of queues is limited by minimal pool size
+   p->queueCount = (flags & THREAD_POOL_WORK_STEALING) ? std::min(minThreads, MAX_WORK_STEALING_QUEUES) : 1;
+   if (p->queueCount < 2)
+   {
+      p->queueCount = 1;
+      p->flags &= ~THREAD_POOL_WORK_STEALING;
+   }
+   p->queues = MemAllocArrayNoInit<Queue*>(p->queueCount);
+   for(int i = 0; i < p->queueCount; i++)
+      p->queues[i] = new Queue(64, false);
+   p->queueWorkers = MemAllocArray<int>(p->queueCount);
+   p->queueIdleWorkers = MemAllocArray<VolatileCounter>(p->queueCount);
    p->mutex = MutexCreate();
    p->maintThreadWakeup = ConditionCreate(false);
    p->serializationQueues = new StringObjectMap<SerializationQueue>(true);
    p->serializationQueues->setIgnoreCase(false);
    p->serializationLock = MutexCreate();
-   p->schedulerQueue = new ObjectArray<WorkRequest>(16, 16, false);
+   p->schedulerHeapAllocated = 64;
+   p->schedulerHeap = MemAllocArrayNoInit<WorkRequest*>(p->schedulerHeapAllocated);
    p->schedulerLock = MutexCreate();
    p->name = (name != NULL) ? MemCopyString(name) : MemCopyString(_T("NONAME"));
    p->shutdownMode = false;
@@ -342,18 +651,8 @@ ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThre
    MutexLock(p->mutex);
    for(int i = 0; i < p->minThreads; i++)
    {
-      WorkerThreadInfo *wt = new WorkerThreadInfo;
-      wt->pool = p;
-      wt->handle = ThreadCreateEx(WorkerThread, stackSize, wt);
-      if (wt->handle != INVALID_THREAD_HANDLE)
-      {
-         p->threads->set(CAST_FROM_POINTER(wt, UINT64), wt);
-      }
-      else
-      {
+      if (CreateWorkerThread(p) == NULL)
          nxlog_debug_tag(DEBUG_TAG, 1, _T("Cannot create worker thread in pool %s"), p->name);
-         delete wt;
-      }
    }
    MutexUnlock(p->mutex);
 
@@ -361,7 +660,7 @@ ThreadPool LIBNETXMS_EXPORTABLE *ThreadPoolCreate(const TCHAR *name, int minThre
    s_registry.set(p->name, p);
    s_registryLock.unlock();
 
-   nxlog_debug_tag(DEBUG_TAG, 1, _T("Thread pool %s initialized (min=%d, max=%d)"), p->name, p->minThreads, p->maxThreads);
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("Thread pool %s initialized (min=%d, max=%d, queues=%d)"), p->name, p->minThreads, p->maxThreads, p->queueCount);
    return p;
 }
 
@@ -397,7 +696,7 @@ void LIBNETXMS_EXPORTABLE ThreadPoolDestroy(ThreadPool *p)
    MutexLock(p->mutex);
    int count = p->threads->size();
    for(int i = 0; i < count; i++)
-      p->queue->put(&rq);
+      p->queues[i % p->queueCount]->put(&rq);
    MutexUnlock(p->mutex);
 
    p->threads->forEach(ThreadPoolDestroyCallback, NULL);
@@ -405,12 +704,16 @@ void LIBNETXMS_EXPORTABLE ThreadPoolDestroy(ThreadPool *p)
    nxlog_debug_tag(DEBUG_TAG, 1, _T("Thread pool %s destroyed"), p->name);
    p->threads->setOwner(true);
    delete p->threads;
-   delete p->queue;
+   for(int i = 0; i < p->queueCount; i++)
+      delete p->queues[i];
+   MemFree(p->queues);
+   MemFree(p->queueWorkers);
+   MemFree((void *)p->queueIdleWorkers);
    delete p->serializationQueues;
    MutexDestroy(p->serializationLock);
-   for(int i = 0; i < p->schedulerQueue->size(); i++)
-      MemFree(p->schedulerQueue->get(i));
-   delete p->schedulerQueue;
+   for(int i = 0; i < p->schedulerHeapSize; i++)
+      MemFree(p->schedulerHeap[i]);
+   MemFree(p->schedulerHeap);
    MutexDestroy(p->schedulerLock);
    MutexDestroy(p->mutex);
    MemFree(p->name);
@@ -431,7 +734,47 @@ void LIBNETXMS_EXPORTABLE ThreadPoolExecute(ThreadPool *p, ThreadPoolWorkerFunct
    rq->func = f;
    rq->arg = arg;
    rq->queueTime = GetCurrentTimeMs();
-   p->queue->put(rq);
+   EnqueueRequest(p, rq);
+}
+
+/**
+ * Execute same task for multiple arguments as soon as possible
+ */
+void LIBNETXMS_EXPORTABLE ThreadPoolExecuteBatch(ThreadPool *p, ThreadPoolWorkerFunction f, void **args, int count)
+{
+   if (p->shutdownMode || (count <= 0))
+      return;
+
+   INT64 now = GetCurrentTimeMs();
+   WorkRequest **requests = MemAllocArrayNoInit<WorkRequest*>(count);
+   for(int i = 0; i < count; i++)
+   {
+      WorkRequest *rq = MemAllocStruct<WorkRequest>();
+      rq->func = f;
+      rq->arg = args[i];
+      rq->queueTime = now;
+      requests[i] = rq;
+      InterlockedIncrement(&p->activeRequests);
+      InterlockedIncrement64(&p->taskExecutionCount);
+   }
+
+   if (p->queueCount == 1)
+   {
+      p->queues[0]->putAll(reinterpret_cast<void**>(requests), count);
+   }
+   else
+   {
+      // Spread requests evenly between execution queues
+      int chunkSize = std::max(count / p->queueCount, 1);
+      for(int i = 0; i < count; i += chunkSize)
+      {
+         UINT32 n = static_cast<UINT32>(InterlockedIncrement(&p->nextQueue));
+         int index = n % p->queueCount;
+         p->queues[index]->putAll(reinterpret_cast<void**>(&requests[i]), std::min(chunkSize, count - i));
+         WakeIdleWorker(p, index);
+      }
+   }
+   MemFree(requests);
 }
 
 /**
@@ -502,16 +845,6 @@ void LIBNETXMS_EXPORTABLE ThreadPoolExecuteSerialized(ThreadPool *p, const TCHAR
    MutexUnlock(p->serializationLock);
 }
 
-/**
- * Scheduled requests comparator (used for task sorting)
- */
-static int ScheduledRequestsComparator(const WorkRequest **e1, const WorkRequest **e2)
-{
-   time_t t1 = (*e1)->runTime;
-   time_t t2 = (*e2)->runTime;
-   return (t1 < t2) ? -1 : ((t1 > t2) ? 1 : 0);
-}
-
 /**
  * Schedule task for execution using absolute time (in milliseconds)
  */
@@ -527,10 +860,13 @@ void LIBNETXMS_EXPORTABLE ThreadPoolScheduleAbsoluteMs(ThreadPool *p, INT64 runT
    rq->queueTime = GetCurrentTimeMs();
 
    MutexLock(p->schedulerLock);
-   p->schedulerQueue->add(rq);
-   p->schedulerQueue->sort(ScheduledRequestsComparator);
+   rq->sequence = p->schedulerSequence++;
+   bool first = SchedulerHeapPush(p, rq);
    MutexUnlock(p->schedulerLock);
-   ConditionSet(p->maintThreadWakeup);
+
+   // Maintenance thread only needs to recalculate wait time if new request should run before all others
+   if (first)
+      ConditionSet(p->maintThreadWakeup);
 }
 
 /**
@@ -571,11 +907,12 @@ void LIBNETXMS_EXPORTABLE ThreadPoolGetInfo(ThreadPool *p, ThreadPoolInfo *info)
    info->loadAvg[0] = GetExpMovingAverageValue(p->loadAverage[0]);
    info->loadAvg[1] = GetExpMovingAverageValue(p->loadAverage[1]);
    info->loadAvg[2] = GetExpMovingAverageValue(p->loadAverage[2]);
-   info->averageWaitTime = static_cast<UINT32>(p->averageWaitTime / EMA_FP_1);
+   info->averageWaitTime = static_cast<UINT32>(GetAverageWaitTime(p));
    MutexUnlock(p->mutex);
 
    MutexLock(p->schedulerLock);
-   info->scheduledRequests = p->schedulerQueue->size();
+   info->scheduledRequests = p->schedulerHeapSize;
+   memcpy(info->schedulerLateness, p->schedulerLateness, sizeof(info->schedulerLateness));
    MutexUnlock(p->schedulerLock);
 
    info->serializedRequests = 0;
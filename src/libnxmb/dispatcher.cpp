@@ -23,13 +23,130 @@
 
 #include "libnxmb.h"
 
+/**
+ * Maximum number of messages processed by worker in one batch
+ */
+#define MAX_BATCH_SIZE     64
+
+/**
+ * Maximum number of worker threads
+ */
+#define MAX_WORKERS        32
+
+/**
+ * Number of worker threads for global dispatcher instance
+ */
+static int s_workerCount = 1;
+
+/**
+ * Read 64-bit counter atomically
+ */
+static inline UINT64 ReadCounter(VolatileCounter64 *counter)
+{
+   return static_cast<UINT64>(InterlockedAdd64(counter, 0));
+}
+
+/**
+ * Registered subscriber. Statistic counters are updated atomically by owning worker
+ * and can be read by other threads at any time.
+ */
+struct NXMBSubscriberEntry
+{
+   NXMBSubscriber *subscriber;
+   NXMBFilter *filter;
+   int worker;
+   VolatileCounter64 messages;
+   VolatileCounter64 totalHandlerTime;
+   VolatileCounter64 maxHandlerTime;   // Only owning worker changes it, so update by difference is safe
+   volatile bool removed;              // Set when entry is retired, workers skip it for the rest of the batch
+   bool deleteSubscriber;              // Destroy subscriber together with retired entry
+   bool deleteFilter;                  // Destroy filter together with retired entry
+
+   NXMBSubscriberEntry(NXMBSubscriber *_subscriber, NXMBFilter *_filter)
+   {
+      subscriber = _subscriber;
+      filter = _filter;
+      worker = 0;
+      messages = 0;
+      totalHandlerTime = 0;
+      maxHandlerTime = 0;
+      removed = false;
+      deleteSubscriber = false;
+      deleteFilter = false;
+   }
+};
+
+/**
+ * Destroy retired subscriber entry
+ */
+static void DestroyEntry(NXMBSubscriberEntry *e)
+{
+   if (e->deleteSubscriber)
+      delete e->subscriber;
+   if (e->deleteFilter)
+      delete e->filter;
+   delete e;
+}
+
+/**
+ * Immutable snapshot of subscriber list used by workers. Entries in type index and
+ * generic entry list are positions in entries array, sorted in ascending order.
+ * Snapshots are reused but never destroyed while dispatcher exists, so reader holding
+ * pointer to outdated snapshot can always safely check its counters.
+ */
+struct NXMBSubscriberSnapshot
+{
+   VolatileCounter readers;
+   VolatileCounter writers;
+   ObjectArray<NXMBSubscriberEntry> entries;
+   StringObjectMap<IntegerArray<int>> typeIndex;   // Subscribers with type filters by message type
+   IntegerArray<int> genericEntries;               // Subscribers with filters which should be called for each message
+
+   NXMBSubscriberSnapshot() : entries(0, 16, false), typeIndex(true), genericEntries(0, 16)
+   {
+      readers = 0;
+      writers = 0;
+   }
+};
+
+/**
+ * Worker thread data
+ */
+struct NXMBWorker
+{
+   NXMBDispatcher *dispatcher;
+   int index;
+   Queue *queue;
+   THREAD thread;
+   UINT32 threadId;
+};
+
+/**
+ * Get current time in microseconds (used for handler time measurement)
+ */
+static inline UINT64 GetCurrentTimeUs()
+{
+#ifdef _WIN32
+   FILETIME ft;
+   GetSystemTimeAsFileTime(&ft);
+   return ((static_cast<UINT64>(ft.dwHighDateTime) << 32) | static_cast<UINT64>(ft.dwLowDateTime)) / 10;
+#else
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return static_cast<UINT64>(tv.tv_sec) * _ULL(1000000) + static_cast<UINT64>(tv.tv_usec);
+#endif
+}
+
 /**
  * Worker thread starter
  */
 THREAD_RESULT THREAD_CALL NXMBDispatcher::workerThreadStarter(void *arg)
 {
-	((NXMBDispatcher *)arg)->workerThread();
-   ConditionSet(((NXMBDispatcher *)arg)->m_stopCondition);
+   NXMBWorker *worker = static_cast<NXMBWorker*>(arg);
+   NXMBDispatcher *dispatcher = worker->dispatcher;
+	dispatcher->workerThread(worker);
+   if (InterlockedDecrement(&dispatcher->m_activeWorkers) == 0)
+      ConditionSet(dispatcher->m_stopCondition);
 	return THREAD_OK;
 }
 
@@ -38,12 +155,25 @@ THREAD_RESULT THREAD_CALL NXMBDispatcher::workerThreadStarter(void *arg)
  */
 NXMBDispatcher::NXMBDispatcher()
 {
-	m_queue = new Queue;
-	m_numSubscribers = 0;
-	m_subscribers = NULL;
-	m_filters = NULL;
+   m_subscribers = new ObjectArray<NXMBSubscriberEntry>(16, 16, false);
+   m_primary = new NXMBSubscriberSnapshot();
+   m_snapshots = new ObjectArray<NXMBSubscriberSnapshot>(4, 4, true);
+   m_snapshots->add(m_primary);
+   m_retiredEntries = new ObjectArray<NXMBSubscriberEntry>(0, 16, false);
+   m_retiredEntryCount = 0;
 	m_subscriberListAccess = MutexCreate();
-	m_workerThreadHandle = INVALID_THREAD_HANDLE;
+   m_numWorkers = 1;
+   m_nextWorker = 0;
+   m_workers = new NXMBWorker[1];
+   m_workers[0].dispatcher = this;
+   m_workers[0].index = 0;
+   m_workers[0].queue = new Queue();
+   m_workers[0].thread = INVALID_THREAD_HANDLE;
+   m_workers[0].threadId = 0;
+   m_activeWorkers = 0;
+   m_postedMessages = 0;
+   m_processedMessages = 0;
+   m_batches = 0;
    m_callHandlers = new CallHandlerMap();
    m_callHandlerAccess = MutexCreate();
    m_startCondition = ConditionCreate(TRUE);
@@ -55,32 +185,53 @@ NXMBDispatcher::NXMBDispatcher()
  */
 NXMBDispatcher::~NXMBDispatcher()
 {
-	NXMBMessage *msg;
-	while((msg = (NXMBMessage *)m_queue->get()) != NULL)
-		delete msg;
+   for(int i = 0; i < m_numWorkers; i++)
+   {
+      void *msg;
+      while((msg = m_workers[i].queue->get()) != NULL)
+      {
+         if ((msg != INVALID_POINTER_VALUE) && (InterlockedDecrement(&static_cast<NXMBMessage*>(msg)->m_refCount) == 0))
+            delete static_cast<NXMBMessage*>(msg);
+      }
+   }
 
-   if (m_workerThreadHandle != INVALID_THREAD_HANDLE)
+   if (m_workers[0].thread != INVALID_THREAD_HANDLE)
    {
       // ThreadJoin cannot be used here because at least on
       // Windows waiting on thread from DLL unload handler
       // will cause deadlock
-	   ThreadDetach(m_workerThreadHandle);
-	   m_queue->put(INVALID_POINTER_VALUE);
+      for(int i = 0; i < m_numWorkers; i++)
+      {
+	      ThreadDetach(m_workers[i].thread);
+	      m_workers[i].queue->put(INVALID_POINTER_VALUE);
+      }
       ConditionWait(m_stopCondition, 30000);
    }
-	delete m_queue;
+   for(int i = 0; i < m_numWorkers; i++)
+      delete m_workers[i].queue;
+   delete[] m_workers;
 
 	MutexDestroy(m_subscriberListAccess);
 
-	for(int i = 0; i < m_numSubscribers; i++)
+	for(int i = 0; i < m_subscribers->size(); i++)
 	{
-		if ((m_subscribers[i] != NULL) && m_subscribers[i]->isOwnedByDispatcher())
-			delete m_subscribers[i];
-		if ((m_filters[i] != NULL) && m_filters[i]->isOwnedByDispatcher())
-			delete m_filters[i];
+      NXMBSubscriberEntry *e = m_subscribers->get(i);
+		if (e->subscriber->isOwnedByDispatcher())
+			delete e->subscriber;
+		if (e->filter != NULL)
+      {
+         if (e->filter->isOwnedByDispatcher())
+			   delete e->filter;
+         else
+            e->filter->m_dispatcher = NULL;
+      }
+      delete e;
 	}
-	free(m_subscribers);
-	free(m_filters);
+   delete m_subscribers;
+   for(int i = 0; i < m_retiredEntries->size(); i++)
+      DestroyEntry(m_retiredEntries->get(i));
+   delete m_retiredEntries;
+   delete m_snapshots;
 
    MutexDestroy(m_callHandlerAccess);
    delete m_callHandlers;
@@ -90,112 +241,468 @@ NXMBDispatcher::~NXMBDispatcher()
 }
 
 /**
- * Worker thread
+ * Start worker threads
  */
-void NXMBDispatcher::workerThread()
+void NXMBDispatcher::start(int numWorkers)
 {
-   nxlog_debug(3, _T("NXMB: dispatcher thread started"));
-   ConditionSet(m_startCondition);
-	while(true)
+   if (numWorkers != m_numWorkers)
+   {
+      // Called before instance is available to other threads, so queues can be safely replaced
+      for(int i = 0; i < m_numWorkers; i++)
+         delete m_workers[i].queue;
+      delete[] m_workers;
+
+      m_numWorkers = numWorkers;
+      m_workers = new NXMBWorker[numWorkers];
+      for(int i = 0; i < numWorkers; i++)
+      {
+         m_workers[i].dispatcher = this;
+         m_workers[i].index = i;
+         m_workers[i].queue = new Queue();
+         m_workers[i].thread = INVALID_THREAD_HANDLE;
+         m_workers[i].threadId = 0;
+      }
+
+      MutexLock(m_subscriberListAccess);
+      for(int i = 0; i < m_subscribers->size(); i++)
+         m_subscribers->get(i)->worker = i % numWorkers;
+      m_nextWorker = m_subscribers->size() % numWorkers;
+      publishSubscriberList();
+      MutexUnlock(m_subscriberListAccess);
+   }
+
+   for(int i = 0; i < m_numWorkers; i++)
+      m_workers[i].thread = ThreadCreateEx(NXMBDispatcher::workerThreadStarter, 0, &m_workers[i]);
+   ConditionWait(m_startCondition, INFINITE);
+}
+
+/**
+ * Acquire current subscriber list snapshot
+ */
+NXMBSubscriberSnapshot *NXMBDispatcher::acquireSnapshot()
+{
+   NXMBSubscriberSnapshot *snapshot;
+   while(true)
+   {
+      snapshot = m_primary;
+      InterlockedIncrement(&snapshot->readers);
+      if (snapshot->writers == 0)
+         break;
+      InterlockedDecrement(&snapshot->readers);
+   }
+   return snapshot;
+}
+
+/**
+ * Release subscriber list snapshot
+ */
+void NXMBDispatcher::releaseSnapshot(NXMBSubscriberSnapshot *snapshot)
+{
+   InterlockedDecrement(&snapshot->readers);
+}
+
+/**
+ * Rebuild subscriber list snapshot and make it current. Snapshot not used by any reader
+ * is taken from pool (or new one is created), so this method never waits for workers and
+ * can be called from within message handler. Entries removed from subscriber list should
+ * be passed to retireEntry(). Must be called with subscriber list lock held.
+ */
+void NXMBDispatcher::publishSubscriberList()
+{
+   NXMBSubscriberSnapshot *snapshot = NULL;
+   for(int i = 0; i < m_snapshots->size(); i++)
+   {
+      NXMBSubscriberSnapshot *s = m_snapshots->get(i);
+      if ((s != m_primary) && (s->readers == 0))
+      {
+         snapshot = s;
+         break;
+      }
+   }
+   if (snapshot == NULL)
+   {
+      snapshot = new NXMBSubscriberSnapshot();
+      snapshot->writers = 1;
+      m_snapshots->add(snapshot);
+   }
+
+   snapshot->entries.clear();
+   snapshot->typeIndex.clear();
+   snapshot->genericEntries.clear();
+
+   StringList types;
+   for(int i = 0; i < m_subscribers->size(); i++)
+   {
+      NXMBSubscriberEntry *e = m_subscribers->get(i);
+      snapshot->entries.add(e);
+
+      types.clear();
+      if ((e->filter != NULL) && e->filter->getAcceptedTypes(&types))
+      {
+         for(int j = 0; j < types.size(); j++)
+         {
+            IntegerArray<int> *list = snapshot->typeIndex.get(types.get(j));
+            if (list == NULL)
+            {
+               list = new IntegerArray<int>(4, 4);
+               snapshot->typeIndex.set(types.get(j), list);
+            }
+            list->add(i);
+         }
+      }
+      else
+      {
+         snapshot->genericEntries.add(i);
+      }
+   }
+
+   InterlockedDecrement(&snapshot->writers);
+   NXMBSubscriberSnapshot *prev = InterlockedExchangeObjectPointer(&m_primary, snapshot);
+   InterlockedIncrement(&prev->writers);
+}
+
+/**
+ * Retire entry removed from subscriber list. Entry is destroyed (together with subscriber
+ * and filter if requested) when no worker can use it anymore. Must be called with subscriber
+ * list lock held and after new subscriber list is published.
+ */
+void NXMBDispatcher::retireEntry(NXMBSubscriberEntry *entry, bool deleteSubscriber, bool deleteFilter)
+{
+   entry->removed = true;
+   entry->deleteSubscriber = deleteSubscriber;
+   entry->deleteFilter = deleteFilter;
+   m_retiredEntries->add(entry);
+   InterlockedIncrement(&m_retiredEntryCount);
+}
+
+/**
+ * Destroy retired entries if outdated snapshots are not used by any reader.
+ * Must be called with subscriber list lock held. Returns true if retired entry list is empty.
+ */
+bool NXMBDispatcher::destroyRetiredEntries()
+{
+   if (m_retiredEntries->isEmpty())
+      return true;
+
+   for(int i = 0; i < m_snapshots->size(); i++)
+   {
+      NXMBSubscriberSnapshot *s = m_snapshots->get(i);
+      if ((s != m_primary) && (s->readers > 0))
+         return false;
+   }
+
+   for(int i = 0; i < m_retiredEntries->size(); i++)
+      DestroyEntry(m_retiredEntries->get(i));
+   m_retiredEntries->clear();
+   m_retiredEntryCount = 0;
+   return true;
+}
+
+/**
+ * Wait until all retired entries are destroyed. Subscriber list lock is not held while
+ * waiting, so workers blocked on it from within message handlers can finish their batches.
+ * Must not be called by worker thread.
+ */
+void NXMBDispatcher::waitForRetiredEntries()
+{
+   while(true)
+   {
+      MutexLock(m_subscriberListAccess);
+      bool done = destroyRetiredEntries();
+      MutexUnlock(m_subscriberListAccess);
+      if (done)
+         break;
+      ThreadSleepMs(10);
+   }
+}
+
+/**
+ * Check if current thread is one of dispatcher's workers
+ */
+bool NXMBDispatcher::isWorkerThread()
+{
+   UINT32 id = GetCurrentThreadId();
+   for(int i = 0; i < m_numWorkers; i++)
+      if (m_workers[i].threadId == id)
+         return true;
+   return false;
+}
+
+/**
+ * Pass message to subscribers served by given worker. Subscribers with type filters are
+ * taken from type index, other subscribers are checked by calling filter. Both lists are
+ * merged so that subscribers are called in registration order.
+ */
+void NXMBDispatcher::processMessage(NXMBMessage *msg, NXMBSubscriberSnapshot *snapshot, int worker)
+{
+   IntegerArray<int> *typed = snapshot->typeIndex.get(msg->getType());
+   int typedCount = (typed != NULL) ? typed->size() : 0;
+   int genericCount = snapshot->genericEntries.size();
+   int t = 0, g = 0;
+   while((t < typedCount) || (g < genericCount))
+   {
+      int index;
+      bool checkFilter;
+      if ((g >= genericCount) || ((t < typedCount) && (typed->get(t) < snapshot->genericEntries.get(g))))
+      {
+         index = typed->get(t++);
+         checkFilter = false;
+      }
+      else
+      {
+         index = snapshot->genericEntries.get(g++);
+         checkFilter = true;
+      }
+
+      NXMBSubscriberEntry *e = snapshot->entries.get(index);
+      if ((e->worker != worker) || e->removed)
+         continue;
+      if (checkFilter && (e->filter != NULL) && !e->filter->isAllowed(*msg))
+         continue;
+
+      UINT64 startTime = GetCurrentTimeUs();
+      e->subscriber->messageHandler(*msg);
+      INT64 elapsed = static_cast<INT64>(GetCurrentTimeUs() - startTime);
+      InterlockedIncrement64(&e->messages);
+      InterlockedAdd64(&e->totalHandlerTime, elapsed);
+      if (elapsed > e->maxHandlerTime)
+         InterlockedAdd64(&e->maxHandlerTime, elapsed - e->maxHandlerTime);
+   }
+}
+
+/**
+ * Release message after processing by worker
+ */
+void NXMBDispatcher::releaseMessage(NXMBMessage *msg)
+{
+   if (InterlockedDecrement(&msg->m_refCount) == 0)
+   {
+      InterlockedIncrement64(&m_processedMessages);
+      delete msg;
+   }
+}
+
+/**
+ * Worker thread. Messages are taken from queue in batches and whole batch is processed
+ * using single subscriber list snapshot.
+ */
+void NXMBDispatcher::workerThread(NXMBWorker *worker)
+{
+   worker->threadId = GetCurrentThreadId();
+   nxlog_debug(3, _T("NXMB: dispatcher thread #%d started"), worker->index);
+   if (InterlockedIncrement(&m_activeWorkers) == m_numWorkers)
+      ConditionSet(m_startCondition);
+
+   NXMBMessage *batch[MAX_BATCH_SIZE];
+   bool running = true;
+	while(running)
 	{
-		NXMBMessage *msg = (NXMBMessage *)m_queue->getOrBlock();
+		void *msg = worker->queue->getOrBlock();
 		if (msg == INVALID_POINTER_VALUE)
 			break;
 
-      nxlog_debug(7, _T("NXMB: processing message %s from %s"), msg->getType(), msg->getSenderId());
+      batch[0] = static_cast<NXMBMessage*>(msg);
+      int count = 1;
+      while(count < MAX_BATCH_SIZE)
+      {
+         msg = worker->queue->get();
+         if (msg == NULL)
+            break;
+         if (msg == INVALID_POINTER_VALUE)
+         {
+            running = false;
+            break;
+         }
+         batch[count++] = static_cast<NXMBMessage*>(msg);
+      }
+      InterlockedIncrement64(&m_batches);
 
-		MutexLock(m_subscriberListAccess);
-		for(int i = 0; i < m_numSubscribers; i++)
-		{
-			if (m_filters[i]->isAllowed(*msg))
-			{
-				m_subscribers[i]->messageHandler(*msg);
-			}
-		}
-		MutexUnlock(m_subscriberListAccess);
-		delete msg;
+      NXMBSubscriberSnapshot *snapshot = acquireSnapshot();
+      for(int i = 0; i < count; i++)
+      {
+         nxlog_debug(7, _T("NXMB: processing message %s from %s"), batch[i]->getType(), batch[i]->getSenderId());
+         processMessage(batch[i], snapshot, worker->index);
+      }
+      releaseSnapshot(snapshot);
+
+      // Destroy entries retired while batch was processed (possibly by message handler)
+      if (m_retiredEntryCount > 0)
+      {
+         MutexLock(m_subscriberListAccess);
+         destroyRetiredEntries();
+         MutexUnlock(m_subscriberListAccess);
+      }
+
+      for(int i = 0; i < count; i++)
+         releaseMessage(batch[i]);
 	}
-   nxlog_debug(3, _T("NXMB: dispatcher thread stopped"));
+   nxlog_debug(3, _T("NXMB: dispatcher thread #%d stopped"), worker->index);
 }
 
 /**
- * Post message
+ * Post message. In multi-worker mode message is passed to all workers and
+ * destroyed by the last one.
  */
 void NXMBDispatcher::postMessage(NXMBMessage *msg)
 {
-	m_queue->put(msg);
+   InterlockedIncrement64(&m_postedMessages);
+   msg->m_refCount = m_numWorkers;
+   for(int i = 0; i < m_numWorkers; i++)
+      m_workers[i].queue->put(msg);
 }
 
 /**
- * Add subscriber
+ * Add subscriber. Message types accepted by filter are indexed at this point and
+ * index is rebuilt if filter notifies dispatcher about change. Can be called from
+ * message handler; in that case new subscriber will get messages starting from next batch.
  */
 void NXMBDispatcher::addSubscriber(NXMBSubscriber *subscriber, NXMBFilter *filter)
 {
-	int i;
+   NXMBSubscriberEntry *entry = new NXMBSubscriberEntry(subscriber, filter);
+   NXMBSubscriberEntry *oldEntry = NULL;
 
 	MutexLock(m_subscriberListAccess);
+   if (filter != NULL)
+      filter->m_dispatcher = this;
 
-	for(i = 0; i < m_numSubscribers; i++)
+	for(int i = 0; i < m_subscribers->size(); i++)
 	{
-		if ((m_subscribers[i] != NULL) && (!_tcscmp(m_subscribers[i]->getId(), subscriber->getId())))
+      NXMBSubscriberEntry *e = m_subscribers->get(i);
+		if (!_tcscmp(e->subscriber->getId(), subscriber->getId()))
 		{
-			// Subscriber already registered, replace it
-			if (m_subscribers[i] != subscriber)
-			{
-				// Different object with same ID
-				if (m_subscribers[i]->isOwnedByDispatcher())
-					delete m_subscribers[i];
-				m_subscribers[i] = subscriber;
-			}
-
-			// Replace filter
-			if (m_filters[i] != filter)
-			{
-				if (m_filters[i]->isOwnedByDispatcher())
-					delete m_filters[i];
-				m_filters[i] = filter;
-			}
+			// Subscriber already registered, replace it but keep worker binding and statistics
+         // (messages processed by old entry until new list is published are not counted)
+         entry->worker = e->worker;
+         entry->messages = ReadCounter(&e->messages);
+         entry->totalHandlerTime = ReadCounter(&e->totalHandlerTime);
+         entry->maxHandlerTime = ReadCounter(&e->maxHandlerTime);
+         m_subscribers->replace(i, entry);
+         oldEntry = e;
 			break;
 		}
 	}
 
-	if (i == m_numSubscribers)		// New subscriber
+	if (oldEntry == NULL)		// New subscriber
 	{
-		m_numSubscribers++;
-		m_subscribers = (NXMBSubscriber **)realloc(m_subscribers, sizeof(NXMBSubscriber *) * m_numSubscribers);
-		m_filters = (NXMBFilter **)realloc(m_filters, sizeof(NXMBFilter *) * m_numSubscribers);
-		m_subscribers[i] = subscriber;
-		m_filters[i] = filter;
+      entry->worker = m_nextWorker;
+      m_nextWorker = (m_nextWorker + 1) % m_numWorkers;
+      m_subscribers->add(entry);
 	}
 
+   publishSubscriberList();
+
+   if (oldEntry != NULL)
+   {
+      // Old subscriber and filter are destroyed only if replaced by different object with same ID
+      bool deleteFilter = false;
+      if ((oldEntry->filter != filter) && (oldEntry->filter != NULL))
+      {
+         if (oldEntry->filter->isOwnedByDispatcher())
+            deleteFilter = true;
+         else
+            oldEntry->filter->m_dispatcher = NULL;
+      }
+      retireEntry(oldEntry, (oldEntry->subscriber != subscriber) && oldEntry->subscriber->isOwnedByDispatcher(), deleteFilter);
+   }
+
 	MutexUnlock(m_subscriberListAccess);
+
+   if ((oldEntry != NULL) && !isWorkerThread())
+      waitForRetiredEntries();
 }
 
 /**
- * Remove subscriber
+ * Remove subscriber. When called outside of worker threads, subscriber is not called after
+ * this method returns. When called from message handler, other workers may still finish
+ * current batch with removed subscriber, so subscriber not owned by dispatcher should not be
+ * destroyed immediately in that case.
  */
 void NXMBDispatcher::removeSubscriber(const TCHAR *id)
 {
-	int i;
+   bool removed = false;
 
 	MutexLock(m_subscriberListAccess);
 
-	for(i = 0; i < m_numSubscribers; i++)
+	for(int i = 0; i < m_subscribers->size(); i++)
 	{
-		if ((m_subscribers[i] != NULL) && (!_tcscmp(m_subscribers[i]->getId(), id)))
+      NXMBSubscriberEntry *e = m_subscribers->get(i);
+		if (!_tcscmp(e->subscriber->getId(), id))
 		{
-			if (m_subscribers[i]->isOwnedByDispatcher())
-				delete m_subscribers[i];
-			if ((m_filters[i] != NULL) && m_filters[i]->isOwnedByDispatcher())
-				delete m_filters[i];
-			m_numSubscribers--;
-			memmove(&m_subscribers[i], &m_subscribers[i + 1], sizeof(NXMBSubscriber *) * (m_numSubscribers - i));
-			memmove(&m_filters[i], &m_filters[i + 1], sizeof(NXMBFilter *) * (m_numSubscribers - i));
+         m_subscribers->remove(i);
+         publishSubscriberList();
+
+         bool deleteFilter = false;
+			if (e->filter != NULL)
+         {
+            if (e->filter->isOwnedByDispatcher())
+				   deleteFilter = true;
+            else
+               e->filter->m_dispatcher = NULL;
+         }
+         retireEntry(e, e->subscriber->isOwnedByDispatcher(), deleteFilter);
+         removed = true;
 			break;
 		}
 	}
 
 	MutexUnlock(m_subscriberListAccess);
+
+   if (removed && !isWorkerThread())
+      waitForRetiredEntries();
+}
+
+/**
+ * Called by filter when set of accepted message types is changed. Type index is rebuilt.
+ * Can be called from message handler; new index is used starting from next batch.
+ */
+void NXMBDispatcher::onFilterChange(NXMBFilter *filter)
+{
+	MutexLock(m_subscriberListAccess);
+	for(int i = 0; i < m_subscribers->size(); i++)
+	{
+      if (m_subscribers->get(i)->filter == filter)
+      {
+         publishSubscriberList();
+         break;
+      }
+	}
+	MutexUnlock(m_subscriberListAccess);
+}
+
+/**
+ * Get dispatcher statistics
+ */
+void NXMBDispatcher::getStatistics(NXMBDispatcherStatistics *stats)
+{
+   stats->postedMessages = ReadCounter(&m_postedMessages);
+   stats->processedMessages = ReadCounter(&m_processedMessages);
+   stats->batches = ReadCounter(&m_batches);
+   stats->queueSize = 0;
+   for(int i = 0; i < m_numWorkers; i++)
+      stats->queueSize += m_workers[i].queue->size();
+   stats->workers = m_numWorkers;
+}
+
+/**
+ * Get statistics for all registered subscribers. Returned array should be destroyed by caller.
+ */
+ObjectArray<NXMBSubscriberStatistics> *NXMBDispatcher::getSubscriberStatistics()
+{
+	MutexLock(m_subscriberListAccess);
+   ObjectArray<NXMBSubscriberStatistics> *list = new ObjectArray<NXMBSubscriberStatistics>(m_subscribers->size(), 16, true);
+   for(int i = 0; i < m_subscribers->size(); i++)
+   {
+      NXMBSubscriberEntry *e = m_subscribers->get(i);
+      NXMBSubscriberStatistics *s = new NXMBSubscriberStatistics;
+      _tcslcpy(s->id, e->subscriber->getId(), 128);
+      s->messages = ReadCounter(&e->messages);
+      s->totalHandlerTime = ReadCounter(&e->totalHandlerTime);
+      s->maxHandlerTime = ReadCounter(&e->maxHandlerTime);
+      s->worker = e->worker;
+      list->add(s);
+   }
+	MutexUnlock(m_subscriberListAccess);
+   return list;
 }
 
 /**
@@ -252,11 +759,18 @@ static Mutex s_instanceLock;
 NXMBDispatcher *NXMBDispatcher::getInstance()
 {
    s_instanceLock.lock();
-   if (s_instance.m_workerThreadHandle == INVALID_THREAD_HANDLE)
-   {
-      s_instance.m_workerThreadHandle = ThreadCreateEx(NXMBDispatcher::workerThreadStarter, 0, &s_instance);
-      ConditionWait(s_instance.m_startCondition, INFINITE);
-   }
+   if (s_instance.m_workers[0].thread == INVALID_THREAD_HANDLE)
+      s_instance.start(s_workerCount);
    s_instanceLock.unlock();
 	return &s_instance;
 }
+
+/**
+ * Set number of worker threads for global dispatcher instance. Has effect only if called
+ * before first call to getInstance(). Each subscriber is always served by same worker,
+ * so order of messages is preserved for each subscriber.
+ */
+void NXMBDispatcher::setWorkerCount(int count)
+{
+   s_workerCount = std::min(std::max(count, 1), MAX_WORKERS);
+}
@@ -30,6 +30,7 @@
 
 NXMBFilter::NXMBFilter()
 {
+   m_dispatcher = NULL;
 }
 
 NXMBFilter::~NXMBFilter()
@@ -46,6 +47,26 @@ bool NXMBFilter::isOwnedByDispatcher()
 	return true;
 }
 
+/**
+ * Notify dispatcher that set of accepted message types was changed
+ */
+void NXMBFilter::notifyDispatcher()
+{
+   NXMBDispatcher *dispatcher = m_dispatcher;
+   if (dispatcher != NULL)
+      dispatcher->onFilterChange(this);
+}
+
+/**
+ * Get list of message types accepted by filter. Should return false if filter
+ * cannot be expressed as fixed set of message types and isAllowed() should be
+ * called for every message.
+ */
+bool NXMBFilter::getAcceptedTypes(StringList *types)
+{
+   return false;
+}
+
 /**
  * Filter by message type implementation
  */
@@ -60,15 +81,40 @@ NXMBTypeFilter::~NXMBTypeFilter()
 
 bool NXMBTypeFilter::isAllowed(NXMBMessage &msg)
 { 
-	return m_types.get(msg.getType()) != NULL;
+   m_lock.lock();
+	bool allowed = (m_types.get(msg.getType()) != NULL);
+   m_lock.unlock();
+   return allowed;
+}
+
+bool NXMBTypeFilter::getAcceptedTypes(StringList *types)
+{
+   m_lock.lock();
+   StringList *keys = m_types.keys();
+   m_lock.unlock();
+   types->addAll(keys);
+   delete keys;
+   return true;
 }
 
+/**
+ * Add accepted message type. Dispatcher's type index is updated if filter is already registered.
+ */
 void NXMBTypeFilter::addMessageType(const TCHAR *type)
 { 
+   m_lock.lock();
 	m_types.set(type, _T("*"));
+   m_lock.unlock();
+   notifyDispatcher();
 }
 
+/**
+ * Remove accepted message type. Dispatcher's type index is updated if filter is already registered.
+ */
 void NXMBTypeFilter::removeMessageType(const TCHAR *type)
 { 
+   m_lock.lock();
 	m_types.remove(type);
+   m_lock.unlock();
+   notifyDispatcher();
 }
@@ -28,6 +28,7 @@
  */
 NXMBMessage::NXMBMessage()
 {
+   m_refCount = 0;
 	m_type = _tcsdup(_T("NONE"));
 	m_senderId = _tcsdup(_T("UNKNOWN"));
 }
@@ -37,6 +38,7 @@ NXMBMessage::NXMBMessage()
  */
 NXMBMessage::NXMBMessage(const TCHAR *type, const TCHAR *senderId)
 {
+   m_refCount = 0;
 	m_type = _tcsdup(CHECK_NULL(type));
 	m_senderId = _tcsdup(CHECK_NULL(senderId));
 }
@@ -99,7 +99,9 @@ NXSL_Program *NXSL_Compiler::compile(const TCHAR *pszSourceCode)
    if (yyparse(scanner, m_lexer, this, pResult) == 0)
    {
       pResult->resolveFunctions();
-		pResult->optimize();
+      pResult->resolveLocalVariables();
+		pResult->optimize(g_nxslOptimizerEnabled);
+      pResult->finalize();
    }
    else
    {
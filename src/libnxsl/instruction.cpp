@@ -102,7 +102,7 @@ NXSL_Instruction::NXSL_Instruction(NXSL_ValueManager *vm, int line, INT16 opCode
 /**
  * Copy constructor
  */
-NXSL_Instruction::NXSL_Instruction(NXSL_ValueManager *vm, NXSL_Instruction *src)
+NXSL_Instruction::NXSL_Instruction(NXSL_ValueManager *vm, const NXSL_Instruction *src)
 {
    m_vm = vm;
    m_opCode = src->m_opCode;
@@ -144,7 +144,7 @@ NXSL_Instruction::~NXSL_Instruction()
 /**
  * Get operand type for instruction
  */
-OperandType NXSL_Instruction::getOperandType()
+OperandType NXSL_Instruction::getOperandType() const
 {
    switch(m_opCode)
    {
@@ -154,24 +154,35 @@ OperandType NXSL_Instruction::getOperandType()
       case OPCODE_CALL_METHOD:
       case OPCODE_CASE_CONST:
       case OPCODE_DEC:
+      case OPCODE_DEC_LOCAL:
+      case OPCODE_DEC_LOCAL_POP:
       case OPCODE_DECP:
+      case OPCODE_DECP_LOCAL:
       case OPCODE_GET_ATTRIBUTE:
+      case OPCODE_GET_OBJECT_ATTR:
       case OPCODE_GLOBAL:
       case OPCODE_GLOBAL_ARRAY:
       case OPCODE_INC:
+      case OPCODE_INC_LOCAL:
+      case OPCODE_INC_LOCAL_POP:
       case OPCODE_INCP:
+      case OPCODE_INCP_LOCAL:
 		case OPCODE_NAME:
       case OPCODE_PUSH_CONSTREF:
       case OPCODE_PUSH_EXPRVAR:
+      case OPCODE_PUSH_LOCAL:
       case OPCODE_PUSH_VARIABLE:
       case OPCODE_SAFE_GET_ATTR:
       case OPCODE_SELECT:
       case OPCODE_SET:
       case OPCODE_SET_ATTRIBUTE:
+      case OPCODE_SET_LOCAL:
+      case OPCODE_SET_LOCAL_POP:
       case OPCODE_SET_EXPRVAR:
       case OPCODE_UPDATE_EXPRVAR:
          return OP_TYPE_IDENTIFIER;
 		case OPCODE_CASE:
+      case OPCODE_JZ_CMP_CONST:
       case OPCODE_PUSH_CONSTANT:
          return OP_TYPE_CONST;
       case OPCODE_PUSH_VARPTR:
@@ -195,34 +206,3 @@ OperandType NXSL_Instruction::getOperandType()
          return OP_TYPE_NONE;
    }
 }
-
-/**
- * Restore variable reference
- */
-void NXSL_Instruction::restoreVariableReference(NXSL_Identifier *identifier)
-{
-   switch(m_opCode)
-   {
-      case OPCODE_PUSH_VARPTR:
-         m_opCode = (m_addr2 == INVALID_ADDRESS) ? OPCODE_PUSH_VARIABLE : OPCODE_PUSH_EXPRVAR;
-         break;
-      case OPCODE_SET_VARPTR:
-         m_opCode = OPCODE_SET;
-         break;
-      case OPCODE_INC_VARPTR:
-         m_opCode = OPCODE_INC;
-         break;
-      case OPCODE_DEC_VARPTR:
-         m_opCode = OPCODE_DEC;
-         break;
-      case OPCODE_INCP_VARPTR:
-         m_opCode = OPCODE_INCP;
-         break;
-      case OPCODE_DECP_VARPTR:
-         m_opCode = OPCODE_DECP;
-         break;
-      default:
-         break;
-   }
-   m_operand.m_identifier = identifier;
-}
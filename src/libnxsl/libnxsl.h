@@ -138,6 +138,17 @@ typedef void *yyscan_t;
 #define OPCODE_UPDATE_EXPRVAR 93
 #define OPCODE_CLEAR_EXPRVARS 94
 #define OPCODE_GET_RANGE      95
+#define OPCODE_PUSH_LOCAL     96
+#define OPCODE_SET_LOCAL      97
+#define OPCODE_INC_LOCAL      98
+#define OPCODE_DEC_LOCAL      99
+#define OPCODE_INCP_LOCAL     100
+#define OPCODE_DECP_LOCAL     101
+#define OPCODE_JZ_CMP_CONST   102
+#define OPCODE_SET_LOCAL_POP  103
+#define OPCODE_INC_LOCAL_POP  104
+#define OPCODE_DEC_LOCAL_POP  105
+#define OPCODE_GET_OBJECT_ATTR 106
 
 class NXSL_Compiler;
 
@@ -222,6 +233,13 @@ class NXSL_Compiler
 //
 
 extern const TCHAR *g_szTypeNames[];
+extern bool g_nxslOptimizerEnabled;
+
+//
+// Functions
+//
+
+int SelectResultType(int type1, int type2, int op);
 
 
 #endif
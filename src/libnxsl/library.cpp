@@ -30,6 +30,7 @@ NXSL_Library::NXSL_Library()
 {
    m_scriptList = new ObjectArray<NXSL_LibraryScript>(16, 16, true);
    m_mutex = MutexCreate();
+   m_changeCounter = 0;
 }
 
 /**
@@ -47,6 +48,7 @@ NXSL_Library::~NXSL_Library()
 bool NXSL_Library::addScript(NXSL_LibraryScript *script)
 {
    m_scriptList->add(script);
+   InterlockedIncrement(&m_changeCounter);
    return true;
 }
 
@@ -59,6 +61,7 @@ void NXSL_Library::deleteScript(const TCHAR *pszName)
       if (!_tcsicmp(m_scriptList->get(i)->getName(), pszName))
       {
          m_scriptList->remove(i);
+         InterlockedIncrement(&m_changeCounter);
          break;
       }
 }
@@ -72,6 +75,7 @@ void NXSL_Library::deleteScript(UINT32 dwId)
       if (m_scriptList->get(i)->getId() == dwId)
       {
          m_scriptList->remove(i);
+         InterlockedIncrement(&m_changeCounter);
          break;
       }
 }
@@ -23,6 +23,19 @@
 
 #include "libnxsl.h"
 
+/**
+ * Optimizer flag (constant folding, dead code elimination, and superinstructions)
+ */
+bool g_nxslOptimizerEnabled = true;
+
+/**
+ * Enable or disable optimizer for subsequently compiled scripts
+ */
+void LIBNXSL_EXPORTABLE NXSLEnableOptimizer(bool enable)
+{
+   g_nxslOptimizerEnabled = enable;
+}
+
 /**
  * Interface to compiler
  */
@@ -55,7 +55,9 @@ static const char *s_nxslCommandMnemonic[] =
    "SINC", "SINCP", "SDEC", "SDECP", "EPEEK",
    "PUSH", "SET", "CALL", "INC", "DEC",
    "INCP", "DECP", "IN", "PUSH", "SET",
-   "UPDATE", "CLREXPR", "RANGE"
+   "UPDATE", "CLREXPR", "RANGE", "PUSHL",
+   "SETL", "INCL", "DECL", "INCPL", "DECPL",
+   "CMPJZ", "SETLP", "INCLP", "DECLP", "OAGET"
 };
 
 /**
@@ -68,6 +70,7 @@ NXSL_Program::NXSL_Program() : NXSL_ValueManager()
    m_functions = new ObjectArray<NXSL_Function>(16, 16, true);
    m_requiredModules = new ObjectArray<NXSL_ModuleImport>(4, 4, true);
    m_expressionVariables = NULL;
+   m_image = NULL;
 }
 
 /**
@@ -75,13 +78,60 @@ NXSL_Program::NXSL_Program() : NXSL_ValueManager()
  */
 NXSL_Program::~NXSL_Program()
 {
-   delete m_instructionSet;
+   if (m_image != NULL)
+   {
+      // Code and function table are owned by image and can still be in use by running VMs
+      m_image->decRefCount();
+   }
+   else
+   {
+      delete m_instructionSet;
+      delete m_functions;
+   }
    delete m_constants;
-   delete m_functions;
    delete m_requiredModules;
    delete m_expressionVariables;
 }
 
+/**
+ * Finalize program: move code and function table into immutable image shared
+ * by all VMs created from this program. Program should not be modified after this call.
+ */
+void NXSL_Program::finalize()
+{
+   if (m_image != NULL)
+      return;
+
+   m_image = new NXSL_ProgramImage(m_instructionSet, m_functions);
+   delete m_instructionSet;
+   delete m_functions;
+   m_instructionSet = m_image->m_instructions;
+   m_functions = m_image->m_functions;
+}
+
+/**
+ * Create program image from given code and function table
+ */
+NXSL_ProgramImage::NXSL_ProgramImage(const ObjectArray<NXSL_Instruction> *instructions, const ObjectArray<NXSL_Function> *functions) : NXSL_ValueManager(), RefCountObject()
+{
+   m_instructions = new ObjectArray<NXSL_Instruction>(instructions->size(), 32, true);
+   for(int i = 0; i < instructions->size(); i++)
+      m_instructions->add(new NXSL_Instruction(this, instructions->get(i)));
+
+   m_functions = new ObjectArray<NXSL_Function>(functions->size(), 8, true);
+   for(int i = 0; i < functions->size(); i++)
+      m_functions->add(new NXSL_Function(functions->get(i)));
+}
+
+/**
+ * Program image destructor
+ */
+NXSL_ProgramImage::~NXSL_ProgramImage()
+{
+   delete m_instructions;
+   delete m_functions;
+}
+
 /**
  * Add new constant. Name expected to be dynamically allocated and
  * will be destroyed by NXSL_Program when no longer needed.
@@ -273,8 +323,24 @@ void NXSL_Program::dump(FILE *fp, const ObjectArray<NXSL_Instruction> *instructi
          case OPCODE_CALL_EXTERNAL:
          case OPCODE_GLOBAL:
          case OPCODE_SELECT:
+         case OPCODE_PUSH_LOCAL:
+         case OPCODE_SET_LOCAL:
+         case OPCODE_INC_LOCAL:
+         case OPCODE_DEC_LOCAL:
+         case OPCODE_INCP_LOCAL:
+         case OPCODE_DECP_LOCAL:
+         case OPCODE_SET_LOCAL_POP:
+         case OPCODE_INC_LOCAL_POP:
+         case OPCODE_DEC_LOCAL_POP:
             _ftprintf(fp, _T("%hs, %d\n"), instr->m_operand.m_identifier->value, instr->m_stackItems);
             break;
+         case OPCODE_JZ_CMP_CONST:
+            if (instr->m_operand.m_constant->isNull())
+               _ftprintf(fp, _T("%hs <null>, %04X\n"), s_nxslCommandMnemonic[instr->m_stackItems], instr->m_addr2);
+            else
+               _ftprintf(fp, _T("%hs \"%s\", %04X\n"), s_nxslCommandMnemonic[instr->m_stackItems],
+                        instr->m_operand.m_constant->getValueAsCString(), instr->m_addr2);
+            break;
          case OPCODE_CALL:
             _ftprintf(fp, _T("%04X, %d\n"), instr->m_operand.m_addr, instr->m_stackItems);
             break;
@@ -305,6 +371,7 @@ void NXSL_Program::dump(FILE *fp, const ObjectArray<NXSL_Instruction> *instructi
 			case OPCODE_SAFE_GET_ATTR:
          case OPCODE_GET_ATTRIBUTE:
          case OPCODE_SET_ATTRIBUTE:
+         case OPCODE_GET_OBJECT_ATTR:
 			case OPCODE_NAME:
          case OPCODE_CASE_CONST:
             _ftprintf(fp, _T("%hs\n"), instr->m_operand.m_identifier->value);
@@ -348,6 +415,105 @@ void NXSL_Program::dump(FILE *fp, const ObjectArray<NXSL_Instruction> *instructi
    }
 }
 
+/**
+ * Find identifier in list
+ */
+static int FindIdentifier(const ObjectArray<NXSL_Identifier>& list, const NXSL_Identifier& name)
+{
+   for(int i = 0; i < list.size(); i++)
+      if (list.get(i)->equals(name))
+         return i;
+   return -1;
+}
+
+/**
+ * Resolve local variables to function frame slots. Must be called before optimize()
+ * because function boundaries are detected by jumps over function bodies.
+ * Name based access is kept for constants, variables declared as global anywhere
+ * in the program, and variables with names starting with $ (function arguments,
+ * regular expression captures, and variables provided by host application).
+ */
+void NXSL_Program::resolveLocalVariables()
+{
+   int codeSize = m_instructionSet->size();
+   if (codeSize == 0)
+      return;
+
+   // Find scope (function index + 1, 0 for main code) for each instruction
+   int *scopes = static_cast<int*>(MemAllocZeroed(codeSize * sizeof(int)));
+   for(int i = 0; i < m_functions->size(); i++)
+   {
+      UINT32 start = m_functions->get(i)->m_dwAddr;
+      if ((start == 0) || (start >= static_cast<UINT32>(codeSize)))
+         continue;   // implicit main
+
+      const NXSL_Instruction *jump = m_instructionSet->get(start - 1);
+      UINT32 end = ((jump->m_opCode == OPCODE_JMP) && (jump->m_operand.m_addr > start)) ?
+               std::min(jump->m_operand.m_addr, static_cast<UINT32>(codeSize)) : static_cast<UINT32>(codeSize);
+      for(UINT32 addr = start; addr < end; addr++)
+         scopes[addr] = i + 1;
+   }
+
+   ObjectArray<NXSL_Identifier> globals(16, 16, false);
+   for(int i = 0; i < codeSize; i++)
+   {
+      const NXSL_Instruction *instr = m_instructionSet->get(i);
+      if ((instr->m_opCode == OPCODE_GLOBAL) || (instr->m_opCode == OPCODE_GLOBAL_ARRAY))
+         globals.add(instr->m_operand.m_identifier);
+   }
+
+   // Assign slots in order of first appearance within scope
+   ObjectArray<ObjectArray<NXSL_Identifier>> slots(m_functions->size() + 1, 16, true);
+   for(int i = 0; i <= m_functions->size(); i++)
+      slots.add(new ObjectArray<NXSL_Identifier>(16, 16, false));
+   for(int i = 0; i < codeSize; i++)
+   {
+      NXSL_Instruction *instr = m_instructionSet->get(i);
+      INT16 opcode;
+      switch(instr->m_opCode)
+      {
+         case OPCODE_PUSH_VARIABLE:
+            opcode = OPCODE_PUSH_LOCAL;
+            break;
+         case OPCODE_SET:
+            opcode = OPCODE_SET_LOCAL;
+            break;
+         case OPCODE_INC:
+            opcode = OPCODE_INC_LOCAL;
+            break;
+         case OPCODE_DEC:
+            opcode = OPCODE_DEC_LOCAL;
+            break;
+         case OPCODE_INCP:
+            opcode = OPCODE_INCP_LOCAL;
+            break;
+         case OPCODE_DECP:
+            opcode = OPCODE_DECP_LOCAL;
+            break;
+         default:
+            continue;
+      }
+
+      const NXSL_Identifier *name = instr->m_operand.m_identifier;
+      if ((name->value[0] == '$') || m_constants->contains(*name) || (FindIdentifier(globals, *name) != -1))
+         continue;
+
+      ObjectArray<NXSL_Identifier> *scope = slots.get(scopes[i]);
+      int slot = FindIdentifier(*scope, *name);
+      if (slot == -1)
+      {
+         if (scope->size() >= 0x7FFF)
+            continue;   // slot index should fit into stack item counter
+         slot = scope->size();
+         scope->add(instr->m_operand.m_identifier);
+      }
+      instr->m_opCode = opcode;
+      instr->m_stackItems = static_cast<INT16>(slot);
+   }
+
+   MemFree(scopes);
+}
+
 /**
  * Get final jump destination from a jump chain
  */
@@ -360,9 +526,414 @@ UINT32 NXSL_Program::getFinalJumpDestination(UINT32 dwAddr, int srcJump)
 }
 
 /**
- * Optimize compiled program
+ * Create map of instructions which can be reached not only by falling through
+ * from previous instruction (jump and call destinations, function entry points,
+ * select branches, and instructions reachable by skipping next instruction).
+ * Returned array should be freed by caller with MemFree.
+ */
+bool *NXSL_Program::createJumpTargetMap() const
+{
+   int codeSize = m_instructionSet->size();
+   bool *targets = MemAllocArray<bool>(codeSize + 1);
+   for(int i = 0; i < m_functions->size(); i++)
+   {
+      UINT32 addr = m_functions->get(i)->m_dwAddr;
+      if (addr < static_cast<UINT32>(codeSize))
+         targets[addr] = true;
+   }
+
+   for(int i = 0; i < codeSize; i++)
+   {
+      const NXSL_Instruction *instr = m_instructionSet->get(i);
+      UINT32 addr = INVALID_ADDRESS;
+      switch(instr->m_opCode)
+      {
+         case OPCODE_CALL:
+         case OPCODE_CATCH:
+         case OPCODE_JMP:
+         case OPCODE_JNZ:
+         case OPCODE_JNZ_PEEK:
+         case OPCODE_JZ:
+         case OPCODE_JZ_PEEK:
+            addr = instr->m_operand.m_addr;
+            break;
+         case OPCODE_PUSHCP:
+            addr = i + instr->m_stackItems;
+            break;
+         case OPCODE_PUSH_EXPRVAR:
+         case OPCODE_UPDATE_EXPRVAR:
+            addr = i + 2;
+            break;
+      }
+      if (addr < static_cast<UINT32>(codeSize))
+         targets[addr] = true;
+      if (instr->m_addr2 < static_cast<UINT32>(codeSize))
+         targets[instr->m_addr2] = true;
+   }
+   return targets;
+}
+
+/**
+ * Remove instructions from jump target map. Jumps to first removed instruction
+ * will land on instruction following removed block.
  */
-void NXSL_Program::optimize()
+static inline void RemoveFromJumpTargetMap(bool *targets, int codeSize, int start, int count)
+{
+   targets[start + count] |= targets[start];
+   memmove(&targets[start], &targets[start + count], (codeSize - start - count + 1) * sizeof(bool));
+}
+
+/**
+ * Evaluate binary operation on two constants at compile time. Follows rules used
+ * by NXSL_VM::doBinaryOperation. Returns NULL if result cannot be calculated at
+ * compile time or operation will cause run time error.
+ */
+static NXSL_Value *EvaluateConstantExpression(NXSL_ValueManager *vm, int opCode, NXSL_Value *value1, NXSL_Value *value2)
+{
+   switch(opCode)
+   {
+      case OPCODE_ADD:
+      case OPCODE_SUB:
+      case OPCODE_MUL:
+      case OPCODE_DIV:
+      case OPCODE_REM:
+      case OPCODE_EQ:
+      case OPCODE_NE:
+      case OPCODE_LT:
+      case OPCODE_LE:
+      case OPCODE_GT:
+      case OPCODE_GE:
+      case OPCODE_BIT_AND:
+      case OPCODE_BIT_OR:
+      case OPCODE_BIT_XOR:
+      case OPCODE_LSHIFT:
+      case OPCODE_RSHIFT:
+      case OPCODE_CONCAT:
+         break;
+      default:
+         return NULL;
+   }
+
+   if (value1->isNull() || value2->isNull())
+   {
+      if ((opCode != OPCODE_EQ) && (opCode != OPCODE_NE))
+         return NULL;
+      bool equals = value1->isNull() && value2->isNull();
+      return vm->createValue(static_cast<INT32>(((opCode == OPCODE_EQ) ? equals : !equals) ? 1 : 0));
+   }
+
+   if (!value1->isString() || !value2->isString())
+      return NULL;
+
+   if (value1->isNumeric() && value2->isNumeric() && (opCode != OPCODE_CONCAT))
+   {
+      int type = SelectResultType(value1->getDataType(), value2->getDataType(), opCode);
+      if (type == NXSL_DT_NULL)
+         return NULL;
+      if (((opCode == OPCODE_DIV) || (opCode == OPCODE_REM)) && value2->isFalse())
+         return NULL;   // leave division by zero to run time
+
+      NXSL_Value *result = NULL;
+      NXSL_Value *v1 = vm->createValue(value1);
+      NXSL_Value *v2 = vm->createValue(value2);
+      if (v1->convert(type) && v2->convert(type))
+      {
+         switch(opCode)
+         {
+            case OPCODE_ADD:
+               v1->add(v2);
+               break;
+            case OPCODE_SUB:
+               v1->sub(v2);
+               break;
+            case OPCODE_MUL:
+               v1->mul(v2);
+               break;
+            case OPCODE_DIV:
+               v1->div(v2);
+               break;
+            case OPCODE_REM:
+               v1->rem(v2);
+               break;
+            case OPCODE_EQ:
+               result = vm->createValue(static_cast<INT32>(v1->EQ(v2) ? 1 : 0));
+               break;
+            case OPCODE_NE:
+               result = vm->createValue(static_cast<INT32>(v1->EQ(v2) ? 0 : 1));
+               break;
+            case OPCODE_LT:
+               result = vm->createValue(static_cast<INT32>(v1->LT(v2) ? 1 : 0));
+               break;
+            case OPCODE_LE:
+               result = vm->createValue(static_cast<INT32>(v1->LE(v2) ? 1 : 0));
+               break;
+            case OPCODE_GT:
+               result = vm->createValue(static_cast<INT32>(v1->GT(v2) ? 1 : 0));
+               break;
+            case OPCODE_GE:
+               result = vm->createValue(static_cast<INT32>(v1->GE(v2) ? 1 : 0));
+               break;
+            case OPCODE_BIT_AND:
+               v1->bitAnd(v2);
+               break;
+            case OPCODE_BIT_OR:
+               v1->bitOr(v2);
+               break;
+            case OPCODE_BIT_XOR:
+               v1->bitXor(v2);
+               break;
+            case OPCODE_LSHIFT:
+               v1->lshift(v2->getValueAsInt32());
+               break;
+            case OPCODE_RSHIFT:
+               v1->rshift(v2->getValueAsInt32());
+               break;
+         }
+         if (result == NULL)
+         {
+            result = v1;
+            v1 = NULL;
+         }
+      }
+      vm->destroyValue(v1);
+      vm->destroyValue(v2);
+      return result;
+   }
+
+   UINT32 len1, len2;
+   const TCHAR *text1, *text2;
+   switch(opCode)
+   {
+      case OPCODE_EQ:
+      case OPCODE_NE:
+         {
+            text1 = value1->getValueAsString(&len1);
+            text2 = value2->getValueAsString(&len2);
+            bool equals = (len1 == len2) && !memcmp(text1, text2, len1 * sizeof(TCHAR));
+            return vm->createValue(static_cast<INT32>(((opCode == OPCODE_EQ) ? equals : !equals) ? 1 : 0));
+         }
+      case OPCODE_CONCAT:
+         {
+            NXSL_Value *result = vm->createValue(value1);
+            text2 = value2->getValueAsString(&len2);
+            result->concatenate(text2, len2);
+            return result;
+         }
+   }
+   return NULL;
+}
+
+/**
+ * Fold constant expressions and conditional jumps on constant values
+ */
+void NXSL_Program::foldConstants()
+{
+   bool *targets = createJumpTargetMap();
+   for(int i = 0; i < m_instructionSet->size() - 2; i++)
+   {
+      NXSL_Instruction *instr = m_instructionSet->get(i);
+      if (instr->m_opCode != OPCODE_PUSH_CONSTANT)
+         continue;
+
+      NXSL_Instruction *next = m_instructionSet->get(i + 1);
+      if ((next->m_opCode == OPCODE_JZ) || (next->m_opCode == OPCODE_JNZ))
+      {
+         if (!instr->m_operand.m_constant->isBoolean() || targets[i + 1])
+            continue;
+
+         // Replace with unconditional jump or remove both instructions
+         bool jump = (next->m_opCode == OPCODE_JZ) ? instr->m_operand.m_constant->isFalse() : instr->m_operand.m_constant->isTrue();
+         int codeSize = m_instructionSet->size();
+         if (jump)
+         {
+            next->m_opCode = OPCODE_JMP;
+            removeInstructions(i, 1);
+            RemoveFromJumpTargetMap(targets, codeSize, i, 1);
+         }
+         else
+         {
+            removeInstructions(i, 2);
+            RemoveFromJumpTargetMap(targets, codeSize, i, 2);
+         }
+         i = std::max(i - 2, -1);
+         continue;
+      }
+
+      if ((next->m_opCode != OPCODE_PUSH_CONSTANT) || (i + 3 >= m_instructionSet->size()) || targets[i + 1] || targets[i + 2])
+         continue;
+
+      NXSL_Value *result = EvaluateConstantExpression(this, m_instructionSet->get(i + 2)->m_opCode,
+               instr->m_operand.m_constant, next->m_operand.m_constant);
+      if (result == NULL)
+         continue;
+
+      destroyValue(instr->m_operand.m_constant);
+      instr->m_operand.m_constant = result;
+      int codeSize = m_instructionSet->size();
+      removeInstructions(i + 1, 2);
+      RemoveFromJumpTargetMap(targets, codeSize, i + 1, 2);
+      i = std::max(i - 2, -1);   // result can be an operand of preceding instruction
+   }
+   MemFree(targets);
+}
+
+/**
+ * Mark instruction as reachable and add it to processing stack
+ */
+static inline void MarkReachable(UINT32 addr, bool *reachable, UINT32 *stack, int *stackSize, int codeSize)
+{
+   if ((addr < static_cast<UINT32>(codeSize)) && !reachable[addr])
+   {
+      reachable[addr] = true;
+      stack[(*stackSize)++] = addr;
+   }
+}
+
+/**
+ * Remove instructions that cannot be reached from main program or any function
+ */
+void NXSL_Program::removeUnreachableCode()
+{
+   int codeSize = m_instructionSet->size();
+   if (codeSize < 2)
+      return;
+
+   bool *reachable = MemAllocArray<bool>(codeSize);
+   UINT32 *stack = MemAllocArrayNoInit<UINT32>(codeSize);
+   int stackSize = 0;
+   MarkReachable(0, reachable, stack, &stackSize, codeSize);
+   for(int i = 0; i < m_functions->size(); i++)
+      MarkReachable(m_functions->get(i)->m_dwAddr, reachable, stack, &stackSize, codeSize);
+
+   while(stackSize > 0)
+   {
+      UINT32 addr = stack[--stackSize];
+      const NXSL_Instruction *instr = m_instructionSet->get(addr);
+      switch(instr->m_opCode)
+      {
+         case OPCODE_JMP:
+            MarkReachable(instr->m_operand.m_addr, reachable, stack, &stackSize, codeSize);
+            break;
+         case OPCODE_CALL:
+         case OPCODE_CATCH:
+         case OPCODE_JNZ:
+         case OPCODE_JNZ_PEEK:
+         case OPCODE_JZ:
+         case OPCODE_JZ_PEEK:
+            MarkReachable(instr->m_operand.m_addr, reachable, stack, &stackSize, codeSize);
+            MarkReachable(addr + 1, reachable, stack, &stackSize, codeSize);
+            break;
+         case OPCODE_ABORT:
+         case OPCODE_EXIT:
+         case OPCODE_RET_NULL:
+         case OPCODE_RETURN:
+            break;
+         case OPCODE_PUSHCP:
+            MarkReachable(addr + instr->m_stackItems, reachable, stack, &stackSize, codeSize);
+            MarkReachable(addr + 1, reachable, stack, &stackSize, codeSize);
+            break;
+         case OPCODE_PUSH_EXPRVAR:
+         case OPCODE_UPDATE_EXPRVAR:
+            MarkReachable(addr + 1, reachable, stack, &stackSize, codeSize);
+            MarkReachable(addr + 2, reachable, stack, &stackSize, codeSize);
+            break;
+         default:
+            MarkReachable(addr + 1, reachable, stack, &stackSize, codeSize);
+            break;
+      }
+      if (instr->m_addr2 != INVALID_ADDRESS)
+         MarkReachable(instr->m_addr2, reachable, stack, &stackSize, codeSize);
+   }
+   MemFree(stack);
+
+   // Remove unreachable blocks starting from the end so that block addresses remain valid;
+   // last instruction is never removed
+   for(int end = codeSize - 2; end >= 0; end--)
+   {
+      if (reachable[end])
+         continue;
+      int start = end;
+      while((start > 0) && !reachable[start - 1])
+         start--;
+      removeInstructions(start, end - start + 1);
+      end = start;
+   }
+   MemFree(reachable);
+}
+
+/**
+ * Replace common instruction sequences with single instructions
+ */
+void NXSL_Program::createSuperInstructions()
+{
+   bool *targets = createJumpTargetMap();
+   for(int i = 0; i < m_instructionSet->size() - 2; i++)
+   {
+      NXSL_Instruction *instr = m_instructionSet->get(i);
+      NXSL_Instruction *next = m_instructionSet->get(i + 1);
+      if (targets[i + 1])
+         continue;
+
+      int codeSize = m_instructionSet->size();
+      switch(instr->m_opCode)
+      {
+         case OPCODE_PUSH_CONSTANT:
+            // Compare with constant followed by conditional jump
+            if (((next->m_opCode == OPCODE_EQ) || (next->m_opCode == OPCODE_NE) ||
+                 (next->m_opCode == OPCODE_LT) || (next->m_opCode == OPCODE_LE) ||
+                 (next->m_opCode == OPCODE_GT) || (next->m_opCode == OPCODE_GE)) &&
+                (i + 3 < codeSize) && (m_instructionSet->get(i + 2)->m_opCode == OPCODE_JZ) && !targets[i + 2] &&
+                (instr->m_operand.m_constant->isNull() || instr->m_operand.m_constant->isString()))
+            {
+               instr->m_opCode = OPCODE_JZ_CMP_CONST;
+               instr->m_stackItems = next->m_opCode;
+               instr->m_addr2 = m_instructionSet->get(i + 2)->m_operand.m_addr;
+               removeInstructions(i + 1, 2);
+               RemoveFromJumpTargetMap(targets, codeSize, i + 1, 2);
+            }
+            break;
+         case OPCODE_SET_LOCAL:
+            if ((next->m_opCode == OPCODE_POP) && (next->m_stackItems == 1))
+            {
+               instr->m_opCode = OPCODE_SET_LOCAL_POP;
+               removeInstructions(i + 1, 1);
+               RemoveFromJumpTargetMap(targets, codeSize, i + 1, 1);
+            }
+            break;
+         case OPCODE_INC_LOCAL:
+         case OPCODE_INCP_LOCAL:
+         case OPCODE_DEC_LOCAL:
+         case OPCODE_DECP_LOCAL:
+            if ((next->m_opCode == OPCODE_POP) && (next->m_stackItems == 1))
+            {
+               instr->m_opCode = ((instr->m_opCode == OPCODE_INC_LOCAL) || (instr->m_opCode == OPCODE_INCP_LOCAL)) ? OPCODE_INC_LOCAL_POP : OPCODE_DEC_LOCAL_POP;
+               removeInstructions(i + 1, 1);
+               RemoveFromJumpTargetMap(targets, codeSize, i + 1, 1);
+            }
+            break;
+         case OPCODE_PUSH_VARIABLE:
+            if (((next->m_opCode == OPCODE_GET_ATTRIBUTE) || (next->m_opCode == OPCODE_SAFE_GET_ATTR)) &&
+                !strcmp(instr->m_operand.m_identifier->value, "$object"))
+            {
+               // Attribute name moves to new instruction, $object identifier will be destroyed with removed one
+               std::swap(instr->m_operand.m_identifier, next->m_operand.m_identifier);
+               instr->m_opCode = OPCODE_GET_OBJECT_ATTR;
+               instr->m_stackItems = (next->m_opCode == OPCODE_SAFE_GET_ATTR) ? 1 : 0;
+               removeInstructions(i + 1, 1);
+               RemoveFromJumpTargetMap(targets, codeSize, i + 1, 1);
+            }
+            break;
+      }
+   }
+   MemFree(targets);
+}
+
+/**
+ * Optimize compiled program. Extended optimizations include constant folding,
+ * dead code elimination, and replacement of common instruction sequences with
+ * superinstructions.
+ */
+void NXSL_Program::optimize(bool extended)
 {
 	int i;
 
@@ -380,6 +951,9 @@ void NXSL_Program::optimize()
 		}
 	}
 
+   if (extended)
+      foldConstants();
+
 	// Convert jumps to address beyond code end to NRETs
 	for(i = 0; i < m_instructionSet->size(); i++)
 	{
@@ -420,6 +994,9 @@ void NXSL_Program::optimize()
 		}
 	}
 
+   if (extended)
+      removeUnreachableCode();
+
 	// Remove jumps to next instruction
 	for(i = 0; i < m_instructionSet->size(); i++)
 	{
@@ -433,6 +1010,9 @@ void NXSL_Program::optimize()
 			i--;
 		}
 	}
+
+   if (extended)
+      createSuperInstructions();
 }
 
 /**
@@ -469,6 +1049,10 @@ void NXSL_Program::removeInstructions(UINT32 start, int count)
 		{
          instr->m_addr2 -= count;
 		}
+      if ((instr->m_opCode == OPCODE_PUSHCP) && (static_cast<UINT32>(i) < start) && (i + instr->m_stackItems > static_cast<int>(start)))
+      {
+         instr->m_stackItems -= count;
+      }
 	}
 
 	// Update function table
@@ -724,6 +1308,7 @@ NXSL_Program *NXSL_Program::load(ByteStream& s, TCHAR *errMsg, size_t errMsgSize
    for(int i = 0; i < constants.size(); i++)
       p->destroyValue(constants.get(i));
 
+   p->finalize();
    return p;
 
 failure:
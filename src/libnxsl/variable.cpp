@@ -84,6 +84,10 @@ NXSL_VariableSystem::NXSL_VariableSystem(NXSL_VM *vm, bool constant) : NXSL_Runt
    m_variables = NULL;
 	m_isConstant = constant;
 	m_restorePointCount = 0;
+   m_version = 0;
+   m_slots = NULL;
+   m_slotCount = 0;
+   m_slotVersion = 0;
 }
 
 /**
@@ -94,6 +98,10 @@ NXSL_VariableSystem::NXSL_VariableSystem(NXSL_VM *vm, NXSL_VariableSystem *src)
    m_variables = NULL;
    m_isConstant = src->m_isConstant;
    m_restorePointCount = 0;
+   m_version = 0;
+   m_slots = NULL;
+   m_slotCount = 0;
+   m_slotVersion = 0;
 
    NXSL_VariablePtr *var, *tmp;
    HASH_ITER(hh, src->m_variables, var, tmp)
@@ -108,8 +116,7 @@ NXSL_VariableSystem::NXSL_VariableSystem(NXSL_VM *vm, NXSL_VariableSystem *src)
 NXSL_VariableSystem::~NXSL_VariableSystem()
 {
    clear();
-   for(int i = 0; i < m_restorePointCount; i++)
-      delete m_restorePoints[i].identifier;
+   MemFree(m_slots);
 }
 
 /**
@@ -124,6 +131,7 @@ void NXSL_VariableSystem::clear()
       var->v.~NXSL_Variable();
       MemFree(var);
    }
+   m_version++;
 }
 
 /**
@@ -185,30 +193,54 @@ NXSL_Variable *NXSL_VariableSystem::create(const NXSL_Identifier& name, NXSL_Val
    NXSL_VariablePtr *var = MemAllocStruct<NXSL_VariablePtr>();
    NXSL_Variable *v = new (&var->v) NXSL_Variable(m_vm, name, (value != NULL) ? value : m_vm->createValue(), m_isConstant);
    HASH_ADD_KEYPTR(hh, m_variables, v->m_name.value, v->m_name.length, var);
+   m_version++;
    return v;
 }
 
+/**
+ * Bind variable to frame slot
+ */
+void NXSL_VariableSystem::setSlot(int slot, NXSL_Variable *var)
+{
+   if (slot >= m_slotCount)
+   {
+      int count = std::max(slot + 1, m_slotCount + 16);
+      m_slots = MemRealloc(m_slots, sizeof(NXSL_Variable*) * count);
+      memset(&m_slots[m_slotCount], 0, sizeof(NXSL_Variable*) * (count - m_slotCount));
+      m_slotCount = count;
+   }
+   m_slots[slot] = var;
+}
+
+/**
+ * Unbind all slots
+ */
+void NXSL_VariableSystem::resetSlots(UINT32 version)
+{
+   if (m_slotCount > 0)
+      memset(m_slots, 0, sizeof(NXSL_Variable*) * m_slotCount);
+   m_slotVersion = version;
+}
+
 /**
  * Create restore point for variable reference
  */
-bool NXSL_VariableSystem::createVariableReferenceRestorePoint(UINT32 addr, NXSL_Identifier *identifier)
+bool NXSL_VariableSystem::createVariableReferenceRestorePoint(UINT32 addr)
 {
    if (m_restorePointCount >= MAX_VREF_RESTORE_POINTS)
       return false;
 
-   m_restorePoints[m_restorePointCount].addr = addr;
-   m_restorePoints[m_restorePointCount].identifier = identifier;
-   m_restorePointCount++;
+   m_restorePoints[m_restorePointCount++] = addr;
    return true;
 }
 
 /**
  * Restore saved variable references
  */
-void NXSL_VariableSystem::restoreVariableReferences(ObjectArray<NXSL_Instruction> *instructions)
+void NXSL_VariableSystem::restoreVariableReferences(NXSL_ResolvedReference *references)
 {
    for(int i = 0; i < m_restorePointCount; i++)
-      instructions->get(m_restorePoints[i].addr)->restoreVariableReference(m_restorePoints[i].identifier);
+      references[m_restorePoints[i]].opCode = OPCODE_NOP;
    m_restorePointCount = 0;
 }
 
@@ -87,7 +87,7 @@ static const TCHAR *GetErrorMessage(int error)
 /**
  * Determine operation data type
  */
-static int SelectResultType(int nType1, int nType2, int nOp)
+int SelectResultType(int nType1, int nType2, int nOp)
 {
    int nType;
 
@@ -127,6 +127,34 @@ static int SelectResultType(int nType1, int nType2, int nOp)
    return nType;
 }
 
+/**
+ * Compare two values of same numeric type
+ */
+static inline bool CompareValues(const NXSL_Value *value1, const NXSL_Value *value2, int op)
+{
+   switch(op)
+   {
+      case OPCODE_EQ:
+         return value1->EQ(value2);
+      case OPCODE_NE:
+         return !value1->EQ(value2);
+      case OPCODE_LT:
+         return value1->LT(value2);
+      case OPCODE_LE:
+         return value1->LE(value2);
+      case OPCODE_GT:
+         return value1->GT(value2);
+      case OPCODE_GE:
+         return value1->GE(value2);
+   }
+   return false;
+}
+
+/**
+ * Name of variable holding current object
+ */
+static const NXSL_Identifier s_objectVariableName("$object");
+
 /**
  * Security context destructor
  */
@@ -147,7 +175,10 @@ bool NXSL_SecurityContext::validateAccess(int accessType, const void *object)
  */
 NXSL_VM::NXSL_VM(NXSL_Environment *env, NXSL_Storage *storage) : NXSL_ValueManager()
 {
+   m_image = NULL;
    m_instructionSet = NULL;
+   m_moduleCode = NULL;
+   m_resolvedReferences = NULL;
    m_cp = INVALID_ADDRESS;
    m_dataStack = NULL;
    m_codeStack = NULL;
@@ -186,7 +217,7 @@ NXSL_VM::NXSL_VM(NXSL_Environment *env, NXSL_Storage *storage) : NXSL_ValueManag
  */
 NXSL_VM::~NXSL_VM()
 {
-   delete m_instructionSet;
+   releaseCode();
 
    delete m_dataStack;
    delete m_codeStack;
@@ -204,7 +235,6 @@ NXSL_VM::~NXSL_VM()
    delete m_env;
    destroyValue(m_pRetValue);
 
-   delete m_functions;
    delete m_modules;
 
    MemFree(m_errorText);
@@ -220,6 +250,26 @@ EnumerationCallbackResult NXSL_VM::createConstantsCallback(const void *key, cons
    return _CONTINUE;
 }
 
+/**
+ * Release program code and function table
+ */
+void NXSL_VM::releaseCode()
+{
+   if (m_image != NULL)
+   {
+      if (m_instructionSet != m_image->m_instructions)
+         delete m_instructionSet;
+      if (m_functions != m_image->m_functions)
+         delete m_functions;
+      m_image->decRefCount();
+      m_image = NULL;
+   }
+   m_instructionSet = NULL;
+   m_functions = NULL;
+   delete_and_null(m_moduleCode);
+   MemFreeAndNull(m_resolvedReferences);
+}
+
 /**
  * Load program
  */
@@ -227,21 +277,23 @@ bool NXSL_VM::load(const NXSL_Program *program)
 {
    bool success = true;
 
-   delete m_instructionSet;
-   delete m_functions;
+   releaseCode();
    delete m_modules;
 
    int i;
 
-   // Copy instructions
-   m_instructionSet = new ObjectArray<NXSL_Instruction>(program->m_instructionSet->size(), 32, true);
-   for(i = 0; i < program->m_instructionSet->size(); i++)
-      m_instructionSet->add(new NXSL_Instruction(this, program->m_instructionSet->get(i)));
-
-   // Copy function information
-   m_functions = new ObjectArray<NXSL_Function>(program->m_functions->size(), 8, true);
-   for(i = 0; i < program->m_functions->size(); i++)
-      m_functions->add(new NXSL_Function(program->m_functions->get(i)));
+   // Use shared program image (create private image if program is not finalized)
+   if (program->m_image != NULL)
+   {
+      m_image = program->m_image;
+      m_image->incRefCount();
+   }
+   else
+   {
+      m_image = new NXSL_ProgramImage(program->m_instructionSet, program->m_functions);
+   }
+   m_instructionSet = m_image->m_instructions;
+   m_functions = m_image->m_functions;
 
    // Set constants
    m_constants->clear();
@@ -291,6 +343,10 @@ bool NXSL_VM::run(const ObjectRefArray<NXSL_Value>& args, NXSL_VariableSystem **
 	destroyValue(m_pRetValue);
 	m_pRetValue = NULL;
 
+   // Table for references resolved at run time
+   if (m_resolvedReferences == NULL)
+      m_resolvedReferences = static_cast<NXSL_ResolvedReference*>(MemAllocZeroed(sizeof(NXSL_ResolvedReference) * std::max(m_instructionSet->size(), 1)));
+
    // Create stacks
    m_dataStack = new NXSL_ObjectStack<NXSL_Value>();
    m_codeStack = new NXSL_Stack();
@@ -367,10 +423,10 @@ bool NXSL_VM::run(const ObjectRefArray<NXSL_Value>& args, NXSL_VariableSystem **
       error(NXSL_ERR_NO_MAIN);
    }
 
-   // Restore instructions replaced to direct variable pointers
-   m_localVariables->restoreVariableReferences(m_instructionSet);
-   m_globalVariables->restoreVariableReferences(m_instructionSet);
-   m_constants->restoreVariableReferences(m_instructionSet);
+   // Drop references to direct variable pointers
+   m_localVariables->restoreVariableReferences(m_resolvedReferences);
+   m_globalVariables->restoreVariableReferences(m_resolvedReferences);
+   m_constants->restoreVariableReferences(m_resolvedReferences);
 
    // Restore global variables
    if (globals == NULL)
@@ -427,12 +483,12 @@ bool NXSL_VM::unwind()
 
       if (m_expressionVariables != NULL)
       {
-         m_expressionVariables->restoreVariableReferences(m_instructionSet);
+         m_expressionVariables->restoreVariableReferences(m_resolvedReferences);
          delete m_expressionVariables;
       }
       m_expressionVariables = static_cast<NXSL_VariableSystem*>(m_codeStack->pop());
 
-      m_localVariables->restoreVariableReferences(m_instructionSet);
+      m_localVariables->restoreVariableReferences(m_resolvedReferences);
       delete m_localVariables;
       m_localVariables = static_cast<NXSL_VariableSystem*>(m_codeStack->pop());
 
@@ -544,6 +600,20 @@ NXSL_Variable *NXSL_VM::findOrCreateVariable(const NXSL_Identifier& name, NXSL_V
    return var;
 }
 
+/**
+ * Bind frame slot for slot-resolved instruction to variable. Slot is bound on first
+ * access within function frame using regular lookup rules, so globals and constants
+ * still take precedence over local variables with same name.
+ */
+NXSL_Variable *NXSL_VM::bindSlotVariable(const NXSL_Instruction *instr)
+{
+   NXSL_VariableSystem *vs;
+   NXSL_Variable *var = findOrCreateVariable(*instr->m_operand.m_identifier, &vs);
+   if (vs != m_expressionVariables)   // expression variables can be destroyed while frame is active
+      m_localVariables->setSlot(instr->m_stackItems, var);
+   return var;
+}
+
 /**
  * Create variable if it does not exist, otherwise return NULL
  */
@@ -580,7 +650,8 @@ void NXSL_VM::execute()
    NXSL_VariableSystem *vs;
 
    cp = m_instructionSet->get(m_cp);
-   switch(cp->m_opCode)
+   NXSL_ResolvedReference *ref = &m_resolvedReferences[m_cp];
+   switch((ref->opCode != OPCODE_NOP) ? ref->opCode : cp->m_opCode)
    {
       case OPCODE_PUSH_CONSTANT:
          m_dataStack->push(createValue(cp->m_operand.m_constant));
@@ -589,14 +660,14 @@ void NXSL_VM::execute()
          pVar = findOrCreateVariable(*cp->m_operand.m_identifier, &vs);
          m_dataStack->push(createValue(pVar->getValue()));
          // convert to direct variable access without name lookup
-         if (vs->createVariableReferenceRestorePoint(m_cp, cp->m_operand.m_identifier))
+         if (vs->createVariableReferenceRestorePoint(m_cp))
          {
-            cp->m_opCode = OPCODE_PUSH_VARPTR;
-            cp->m_operand.m_variable = pVar;
+            ref->opCode = OPCODE_PUSH_VARPTR;
+            ref->operand.variable = pVar;
          }
          break;
       case OPCODE_PUSH_VARPTR:
-         m_dataStack->push(createValue(cp->m_operand.m_variable->getValue()));
+         m_dataStack->push(createValue(ref->operand.variable->getValue()));
          break;
       case OPCODE_PUSH_EXPRVAR:
          if (m_expressionVariables == NULL)
@@ -607,10 +678,10 @@ void NXSL_VM::execute()
          {
             m_dataStack->push(createValue(pVar->getValue()));
             // convert to direct variable access without name lookup
-            if (m_expressionVariables->createVariableReferenceRestorePoint(m_cp, cp->m_operand.m_identifier))
+            if (m_expressionVariables->createVariableReferenceRestorePoint(m_cp))
             {
-               cp->m_opCode = OPCODE_PUSH_VARPTR;
-               cp->m_operand.m_variable = pVar;
+               ref->opCode = OPCODE_PUSH_VARPTR;
+               ref->operand.variable = pVar;
             }
             dwNext++;   // Skip next instruction
          }
@@ -622,7 +693,7 @@ void NXSL_VM::execute()
             m_codeStack->push(m_expressionVariables);
             if (m_expressionVariables != NULL)
             {
-               m_expressionVariables->restoreVariableReferences(m_instructionSet);
+               m_expressionVariables->restoreVariableReferences(m_resolvedReferences);
                m_expressionVariables = NULL;
             }
             dwNext = cp->m_addr2;
@@ -655,7 +726,7 @@ void NXSL_VM::execute()
             m_codeStack->push(m_expressionVariables);
             if (m_expressionVariables != NULL)
             {
-               m_expressionVariables->restoreVariableReferences(m_instructionSet);
+               m_expressionVariables->restoreVariableReferences(m_resolvedReferences);
                m_expressionVariables = NULL;
             }
             dwNext = cp->m_addr2;
@@ -671,10 +742,10 @@ void NXSL_VM::execute()
          {
             m_dataStack->push(createValue(pVar->getValue()));
             // convert to direct value access without name lookup
-            if (m_constants->createVariableReferenceRestorePoint(m_cp, cp->m_operand.m_identifier))
+            if (m_constants->createVariableReferenceRestorePoint(m_cp))
             {
-               cp->m_opCode = OPCODE_PUSH_VARPTR;
-               cp->m_operand.m_variable = pVar;
+               ref->opCode = OPCODE_PUSH_VARPTR;
+               ref->operand.variable = pVar;
             }
          }
          else
@@ -709,10 +780,10 @@ void NXSL_VM::execute()
 				{
 					pVar->setValue(createValue(pValue));
                // convert to direct variable access without name lookup
-		         if (vs->createVariableReferenceRestorePoint(m_cp, cp->m_operand.m_identifier))
+		         if (vs->createVariableReferenceRestorePoint(m_cp))
 		         {
-                  cp->m_opCode = OPCODE_SET_VARPTR;
-                  cp->m_operand.m_variable = pVar;
+                  ref->opCode = OPCODE_SET_VARPTR;
+                  ref->operand.variable = pVar;
 		         }
 				}
 				else
@@ -729,13 +800,54 @@ void NXSL_VM::execute()
          pValue = m_dataStack->peek();
          if (pValue != NULL)
          {
-            cp->m_operand.m_variable->setValue(createValue(pValue));
+            ref->operand.variable->setValue(createValue(pValue));
          }
          else
          {
             error(NXSL_ERR_DATA_STACK_UNDERFLOW);
          }
          break;
+      case OPCODE_PUSH_LOCAL:
+         m_dataStack->push(createValue(findOrCreateSlotVariable(cp)->getValue()));
+         break;
+      case OPCODE_SET_LOCAL:
+         pVar = findOrCreateSlotVariable(cp);
+         if (!pVar->isConstant())
+         {
+            pValue = m_dataStack->peek();
+            if (pValue != NULL)
+            {
+               pVar->setValue(createValue(pValue));
+            }
+            else
+            {
+               error(NXSL_ERR_DATA_STACK_UNDERFLOW);
+            }
+         }
+         else
+         {
+            error(NXSL_ERR_ASSIGNMENT_TO_CONSTANT);
+         }
+         break;
+      case OPCODE_SET_LOCAL_POP:   // Set local variable and remove value from stack
+         pVar = findOrCreateSlotVariable(cp);
+         if (!pVar->isConstant())
+         {
+            pValue = m_dataStack->pop();
+            if (pValue != NULL)
+            {
+               pVar->setValue(pValue);
+            }
+            else
+            {
+               error(NXSL_ERR_DATA_STACK_UNDERFLOW);
+            }
+         }
+         else
+         {
+            error(NXSL_ERR_ASSIGNMENT_TO_CONSTANT);
+         }
+         break;
       case OPCODE_SET_EXPRVAR:
          pValue = (cp->m_stackItems == 0) ? m_dataStack->peek() : m_dataStack->pop();
          if (pValue != NULL)
@@ -1152,6 +1264,37 @@ void NXSL_VM::execute()
             error(NXSL_ERR_DATA_STACK_UNDERFLOW);
          }
          break;
+      case OPCODE_JZ_CMP_CONST:  // Compare with constant and jump if result is false
+         pValue = m_dataStack->pop();
+         if (pValue != NULL)
+         {
+            const NXSL_Value *constant = cp->m_operand.m_constant;
+            if (pValue->isNumeric() && (pValue->getDataType() == constant->getDataType()))
+            {
+               // Operands of same numeric type can be compared without conversion
+               if (!CompareValues(pValue, constant, cp->m_stackItems))
+                  dwNext = cp->m_addr2;
+               destroyValue(pValue);
+            }
+            else
+            {
+               m_dataStack->push(pValue);
+               m_dataStack->push(createValue(constant));
+               doBinaryOperation(cp->m_stackItems);
+               if (m_cp != INVALID_ADDRESS)
+               {
+                  pValue = m_dataStack->pop();
+                  if (pValue->isFalse())
+                     dwNext = cp->m_addr2;
+                  destroyValue(pValue);
+               }
+            }
+         }
+         else
+         {
+            error(NXSL_ERR_DATA_STACK_UNDERFLOW);
+         }
+         break;
       case OPCODE_JZ_PEEK:
       case OPCODE_JNZ_PEEK:
 			pValue = m_dataStack->peek();
@@ -1183,7 +1326,7 @@ void NXSL_VM::execute()
          }
          break;
       case OPCODE_CALL:
-         dwNext = cp->m_operand.m_addr;
+         dwNext = (ref->opCode == OPCODE_CALL) ? ref->operand.addr : cp->m_operand.m_addr;
          callFunction(cp->m_stackItems);
          break;
       case OPCODE_CALL_EXTERNAL:
@@ -1191,9 +1334,8 @@ void NXSL_VM::execute()
          if (pFunc != NULL)
          {
             // convert to direct call using pointer
-            cp->m_opCode = OPCODE_CALL_EXTPTR;
-            delete cp->m_operand.m_identifier;
-            cp->m_operand.m_function = pFunc;
+            ref->opCode = OPCODE_CALL_EXTPTR;
+            ref->operand.function = pFunc;
 
             if (callExternalFunction(pFunc, cp->m_stackItems))
                dwNext = m_instructionSet->size();
@@ -1204,9 +1346,8 @@ void NXSL_VM::execute()
             if (addr != INVALID_ADDRESS)
             {
                // convert to CALL
-               cp->m_opCode = OPCODE_CALL;
-               delete cp->m_operand.m_identifier;
-               cp->m_operand.m_addr = addr;
+               ref->opCode = OPCODE_CALL;
+               ref->operand.addr = addr;
 
                dwNext = addr;
                callFunction(cp->m_stackItems);
@@ -1219,7 +1360,7 @@ void NXSL_VM::execute()
          }
          break;
       case OPCODE_CALL_EXTPTR:
-         if (callExternalFunction(cp->m_operand.m_function, cp->m_stackItems))
+         if (callExternalFunction(ref->operand.function, cp->m_stackItems))
             dwNext = m_instructionSet->size();
          break;
       case OPCODE_CALL_METHOD:
@@ -1297,7 +1438,7 @@ void NXSL_VM::execute()
             NXSL_VariableSystem *savedExpressionVariables = static_cast<NXSL_VariableSystem*>(m_codeStack->pop());
             if (m_expressionVariables != NULL)
             {
-               m_expressionVariables->restoreVariableReferences(m_instructionSet);
+               m_expressionVariables->restoreVariableReferences(m_resolvedReferences);
                delete m_expressionVariables;
             }
             m_expressionVariables = savedExpressionVariables;
@@ -1305,7 +1446,7 @@ void NXSL_VM::execute()
             NXSL_VariableSystem *savedLocals = static_cast<NXSL_VariableSystem*>(m_codeStack->pop());
             if (savedLocals != NULL)
             {
-               m_localVariables->restoreVariableReferences(m_instructionSet);
+               m_localVariables->restoreVariableReferences(m_resolvedReferences);
                delete m_localVariables;
                m_localVariables = savedLocals;
             }
@@ -1419,10 +1560,10 @@ void NXSL_VM::execute()
                pValue->decrement();
 
             // Convert to direct variable access
-            if (vs->createVariableReferenceRestorePoint(m_cp, cp->m_operand.m_identifier))
+            if (vs->createVariableReferenceRestorePoint(m_cp))
             {
-               cp->m_opCode = (cp->m_opCode == OPCODE_INC) ? OPCODE_INC_VARPTR : OPCODE_DEC_VARPTR;
-               cp->m_operand.m_variable = pVar;
+               ref->opCode = (cp->m_opCode == OPCODE_INC) ? OPCODE_INC_VARPTR : OPCODE_DEC_VARPTR;
+               ref->operand.variable = pVar;
             }
          }
          else
@@ -1432,11 +1573,11 @@ void NXSL_VM::execute()
          break;
       case OPCODE_INC_VARPTR:  // Post increment/decrement
       case OPCODE_DEC_VARPTR:
-         pValue = cp->m_operand.m_variable->getValue();
+         pValue = ref->operand.variable->getValue();
          if (pValue->isNumeric())
          {
             m_dataStack->push(createValue(pValue));
-            if (cp->m_opCode == OPCODE_INC_VARPTR)
+            if (ref->opCode == OPCODE_INC_VARPTR)
                pValue->increment();
             else
                pValue->decrement();
@@ -1459,10 +1600,10 @@ void NXSL_VM::execute()
             m_dataStack->push(createValue(pValue));
 
             // Convert to direct variable access
-            if (vs->createVariableReferenceRestorePoint(m_cp, cp->m_operand.m_identifier))
+            if (vs->createVariableReferenceRestorePoint(m_cp))
             {
-               cp->m_opCode = (cp->m_opCode == OPCODE_INCP) ? OPCODE_INCP_VARPTR : OPCODE_DECP_VARPTR;
-               cp->m_operand.m_variable = pVar;
+               ref->opCode = (cp->m_opCode == OPCODE_INCP) ? OPCODE_INCP_VARPTR : OPCODE_DECP_VARPTR;
+               ref->operand.variable = pVar;
             }
          }
          else
@@ -1472,10 +1613,10 @@ void NXSL_VM::execute()
          break;
       case OPCODE_INCP_VARPTR: // Pre increment/decrement
       case OPCODE_DECP_VARPTR:
-         pValue = cp->m_operand.m_variable->getValue();
+         pValue = ref->operand.variable->getValue();
          if (pValue->isNumeric())
          {
-            if (cp->m_opCode == OPCODE_INCP_VARPTR)
+            if (ref->opCode == OPCODE_INCP_VARPTR)
                pValue->increment();
             else
                pValue->decrement();
@@ -1486,53 +1627,59 @@ void NXSL_VM::execute()
             error(NXSL_ERR_NOT_NUMBER);
          }
          break;
+      case OPCODE_INC_LOCAL:  // Post increment/decrement
+      case OPCODE_DEC_LOCAL:
+         pValue = findOrCreateSlotVariable(cp)->getValue();
+         if (pValue->isNumeric())
+         {
+            m_dataStack->push(createValue(pValue));
+            if (cp->m_opCode == OPCODE_INC_LOCAL)
+               pValue->increment();
+            else
+               pValue->decrement();
+         }
+         else
+         {
+            error(NXSL_ERR_NOT_NUMBER);
+         }
+         break;
+      case OPCODE_INCP_LOCAL: // Pre increment/decrement
+      case OPCODE_DECP_LOCAL:
+         pValue = findOrCreateSlotVariable(cp)->getValue();
+         if (pValue->isNumeric())
+         {
+            if (cp->m_opCode == OPCODE_INCP_LOCAL)
+               pValue->increment();
+            else
+               pValue->decrement();
+            m_dataStack->push(createValue(pValue));
+         }
+         else
+         {
+            error(NXSL_ERR_NOT_NUMBER);
+         }
+         break;
+      case OPCODE_INC_LOCAL_POP: // Increment/decrement without pushing result to stack
+      case OPCODE_DEC_LOCAL_POP:
+         pValue = findOrCreateSlotVariable(cp)->getValue();
+         if (pValue->isNumeric())
+         {
+            if (cp->m_opCode == OPCODE_INC_LOCAL_POP)
+               pValue->increment();
+            else
+               pValue->decrement();
+         }
+         else
+         {
+            error(NXSL_ERR_NOT_NUMBER);
+         }
+         break;
       case OPCODE_GET_ATTRIBUTE:
 		case OPCODE_SAFE_GET_ATTR:
          pValue = m_dataStack->pop();
          if (pValue != NULL)
          {
-            if (pValue->getDataType() == NXSL_DT_OBJECT)
-            {
-               NXSL_Object *pObj;
-               NXSL_Value *pAttr;
-
-               pObj = pValue->getValueAsObject();
-               if (pObj != NULL)
-               {
-                  pAttr = pObj->getClass()->getAttr(pObj, cp->m_operand.m_identifier->value);
-                  if (pAttr != NULL)
-                  {
-                     m_dataStack->push(pAttr);
-                  }
-                  else
-                  {
-							if (cp->m_opCode == OPCODE_SAFE_GET_ATTR)
-							{
-	                     m_dataStack->push(createValue());
-							}
-							else
-							{
-								error(NXSL_ERR_NO_SUCH_ATTRIBUTE);
-							}
-                  }
-               }
-               else
-               {
-                  error(NXSL_ERR_INTERNAL);
-               }
-            }
-            else if (pValue->getDataType() == NXSL_DT_ARRAY)
-            {
-               getArrayAttribute(pValue->getValueAsArray(), cp->m_operand.m_identifier->value, cp->m_opCode == OPCODE_SAFE_GET_ATTR);
-            }
-            else if (pValue->getDataType() == NXSL_DT_HASHMAP)
-            {
-               getHashMapAttribute(pValue->getValueAsHashMap(), cp->m_operand.m_identifier->value, cp->m_opCode == OPCODE_SAFE_GET_ATTR);
-            }
-            else
-            {
-               error(NXSL_ERR_NOT_OBJECT);
-            }
+            getAttribute(pValue, cp->m_operand.m_identifier->value, cp->m_opCode == OPCODE_SAFE_GET_ATTR);
             destroyValue(pValue);
          }
          else
@@ -1540,6 +1687,22 @@ void NXSL_VM::execute()
             error(NXSL_ERR_DATA_STACK_UNDERFLOW);
          }
          break;
+      case OPCODE_GET_OBJECT_ATTR:  // Get attribute of $object without copying it to stack
+         if (ref->opCode == OPCODE_GET_OBJECT_ATTR)
+         {
+            pVar = ref->operand.variable;
+         }
+         else
+         {
+            pVar = findOrCreateVariable(s_objectVariableName, &vs);
+            if (vs->createVariableReferenceRestorePoint(m_cp))
+            {
+               ref->opCode = OPCODE_GET_OBJECT_ATTR;
+               ref->operand.variable = pVar;
+            }
+         }
+         getAttribute(pVar->getValue(), cp->m_operand.m_identifier->value, cp->m_stackItems != 0);
+         break;
       case OPCODE_SET_ATTRIBUTE:
          pValue = m_dataStack->pop();
          if (pValue != NULL)
@@ -1954,7 +2117,8 @@ void NXSL_VM::doBinaryOperation(int nOpCode)
    switch(nOpCode)
    {
       case OPCODE_CASE:
-		   pVal1 = m_instructionSet->get(m_cp)->m_operand.m_constant;
+         // Constant belongs to shared program image and may be converted during comparison
+		   pVal1 = createValue(m_instructionSet->get(m_cp)->m_operand.m_constant);
 		   pVal2 = m_dataStack->peek();
          break;
       case OPCODE_CASE_CONST:
@@ -2213,6 +2377,10 @@ void NXSL_VM::doBinaryOperation(int nOpCode)
       destroyValue(pVal1);
       destroyValue(pVal2);
    }
+   else if (nOpCode == OPCODE_CASE)
+   {
+      destroyValue(pVal1);
+   }
 
    if (pRes != NULL)
       m_dataStack->push(pRes);
@@ -2266,6 +2434,49 @@ void NXSL_VM::doUnaryOperation(int nOpCode)
    }
 }
 
+/**
+ * Get attribute of object, array, or hash map and push it to stack
+ */
+void NXSL_VM::getAttribute(NXSL_Value *value, const char *attribute, bool safe)
+{
+   if (value->getDataType() == NXSL_DT_OBJECT)
+   {
+      NXSL_Object *object = value->getValueAsObject();
+      if (object != NULL)
+      {
+         NXSL_Value *attrValue = object->getClass()->getAttr(object, attribute);
+         if (attrValue != NULL)
+         {
+            m_dataStack->push(attrValue);
+         }
+         else if (safe)
+         {
+            m_dataStack->push(createValue());
+         }
+         else
+         {
+            error(NXSL_ERR_NO_SUCH_ATTRIBUTE);
+         }
+      }
+      else
+      {
+         error(NXSL_ERR_INTERNAL);
+      }
+   }
+   else if (value->getDataType() == NXSL_DT_ARRAY)
+   {
+      getArrayAttribute(value->getValueAsArray(), attribute, safe);
+   }
+   else if (value->getDataType() == NXSL_DT_HASHMAP)
+   {
+      getHashMapAttribute(value->getValueAsHashMap(), attribute, safe);
+   }
+   else
+   {
+      error(NXSL_ERR_NOT_OBJECT);
+   }
+}
+
 /**
  * Relocate code block
  */
@@ -2283,6 +2494,10 @@ void NXSL_VM::relocateCode(UINT32 dwStart, UINT32 dwLen, UINT32 dwShift)
           (instr->m_opCode == OPCODE_CALL))
       {
          instr->m_operand.m_addr += dwShift;
+      }
+      if (instr->m_addr2 != INVALID_ADDRESS)
+      {
+         instr->m_addr2 += dwShift;
       }
 	}
 }
@@ -2299,11 +2514,31 @@ void NXSL_VM::loadModule(NXSL_Program *module, const NXSL_ModuleImport *importIn
       if (!_tcsicmp(importInfo->name, m_modules->get(i)->m_name))
          return;  // Already loaded
 
+   // Program code and function table are shared, switch to VM's own lists before adding module
+   if (m_instructionSet == m_image->m_instructions)
+   {
+      m_instructionSet = new ObjectArray<NXSL_Instruction>(m_image->m_instructions->size() + module->m_instructionSet->size(), 32, false);
+      for(i = 0; i < m_image->m_instructions->size(); i++)
+         m_instructionSet->add(m_image->m_instructions->get(i));
+      m_moduleCode = new ObjectArray<NXSL_Instruction>(module->m_instructionSet->size(), 32, true);
+   }
+   if (m_functions == m_image->m_functions)
+   {
+      m_functions = new ObjectArray<NXSL_Function>(m_image->m_functions->size() + module->m_functions->size(), 8, true);
+      for(i = 0; i < m_image->m_functions->size(); i++)
+         m_functions->add(new NXSL_Function(m_image->m_functions->get(i)));
+   }
+
    // Add code from module
    int start = m_instructionSet->size();
    for(i = 0; i < module->m_instructionSet->size(); i++)
-      m_instructionSet->add(new NXSL_Instruction(this, module->m_instructionSet->get(i)));
+   {
+      NXSL_Instruction *instr = new NXSL_Instruction(this, module->m_instructionSet->get(i));
+      m_moduleCode->add(instr);
+      m_instructionSet->add(instr);
+   }
    relocateCode(start, module->m_instructionSet->size(), start);
+   MemFreeAndNull(m_resolvedReferences);  // code size changed
    
    // Add function names from module
    for(i = 0; i < module->m_functions->size(); i++)
@@ -2386,12 +2621,12 @@ void NXSL_VM::callFunction(int nArgCount)
       m_dwSubLevel++;
       m_codeStack->push(CAST_TO_POINTER(m_cp + 1, void *));
       m_codeStack->push(m_localVariables);
-      m_localVariables->restoreVariableReferences(m_instructionSet);
+      m_localVariables->restoreVariableReferences(m_resolvedReferences);
       m_localVariables = new NXSL_VariableSystem(this);
       m_codeStack->push(m_expressionVariables);
       if (m_expressionVariables != NULL)
       {
-         m_expressionVariables->restoreVariableReferences(m_instructionSet);
+         m_expressionVariables->restoreVariableReferences(m_resolvedReferences);
          m_expressionVariables = NULL;
       }
       m_nBindPos = 1;
@@ -782,7 +782,7 @@ UINT32 AgentConnectionEx::processBulkCollectedData(NXCPMessage *request, NXCPMes
          NXCPMessage msg(CMD_REQUEST_COMPLETED, request->getId(), getProtocolVersion());
          msg.setField(VID_RCC, ERR_PROCESSING);
          msg.setField(VID_PROGRESS, i * 100 / count);
-         postRawMessage(msg.serialize(isCompressionAllowed()));
+         postRawMessage(msg.serialize(getCompressionMethod()));
          startTime = GetCurrentTimeMs();
       }
 
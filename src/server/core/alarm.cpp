@@ -49,6 +49,32 @@ AlarmComment::AlarmComment(UINT32 id, time_t changeTime, UINT32 userId, TCHAR *t
    m_text = text;
 }
 
+/**
+ * Alarms of single object with number of active (not resolved) alarms per severity
+ */
+struct ObjectAlarms
+{
+   ObjectArray<Alarm> alarms;
+   UINT32 activeCount[5];
+
+   ObjectAlarms() : alarms(4, 4, false)
+   {
+      memset(activeCount, 0, sizeof(activeCount));
+   }
+};
+
+/**
+ * Alarm index entry. Holds alarm attributes used for building object index,
+ * so index can be updated correctly after alarm change.
+ */
+struct AlarmIndexEntry
+{
+   Alarm *alarm;
+   UINT32 sourceObject;
+   int severity;
+   bool active;
+};
+
 /**
  * Alarm list
  */
@@ -58,9 +84,61 @@ class AlarmList
    Mutex m_lock;
    ObjectArray<Alarm> m_list;
    StringObjectMap<Alarm> m_keyIndex;
+   HashMap<UINT32, AlarmIndexEntry> m_idIndex;
+   HashMap<UINT32, ObjectAlarms> m_objectIndex;
+   UINT32 m_severityCount[5];
+
+   static bool isActive(Alarm *alarm) { return (alarm->getState() & ALARM_STATE_MASK) < ALARM_STATE_RESOLVED; }
+
+   void indexByObject(AlarmIndexEntry *entry)
+   {
+      ObjectAlarms *objectAlarms = m_objectIndex.get(entry->sourceObject);
+      if (objectAlarms == NULL)
+      {
+         objectAlarms = new ObjectAlarms();
+         m_objectIndex.set(entry->sourceObject, objectAlarms);
+      }
+      objectAlarms->alarms.add(entry->alarm);
+      if (entry->active)
+         objectAlarms->activeCount[entry->severity]++;
+   }
+
+   void unindexByObject(AlarmIndexEntry *entry)
+   {
+      ObjectAlarms *objectAlarms = m_objectIndex.get(entry->sourceObject);
+      if (objectAlarms == NULL)
+         return;
+      objectAlarms->alarms.remove(entry->alarm);
+      if (objectAlarms->alarms.isEmpty())
+         m_objectIndex.remove(entry->sourceObject);
+      else if (entry->active)
+         objectAlarms->activeCount[entry->severity]--;
+   }
+
+   void unindex(Alarm *alarm)
+   {
+      if (alarm->getParentAlarmId() != 0)
+      {
+         Alarm *parent = find(alarm->getParentAlarmId());
+         if (parent != NULL)
+            parent->removeSubordinateAlarm(alarm->getAlarmId());
+      }
+      if (*alarm->getKey() != 0)
+         m_keyIndex.remove(alarm->getKey());
+      AlarmIndexEntry *entry = m_idIndex.get(alarm->getAlarmId());
+      if (entry != NULL)
+      {
+         unindexByObject(entry);
+         m_severityCount[entry->severity]--;
+         m_idIndex.remove(alarm->getAlarmId());
+      }
+   }
 
 public:
-   AlarmList() : m_list(256, 256, true), m_keyIndex(false) { }
+   AlarmList() : m_list(256, 256, true), m_keyIndex(false), m_idIndex(true), m_objectIndex(true)
+   {
+      memset(m_severityCount, 0, sizeof(m_severityCount));
+   }
    ~AlarmList() { }
 
    void lock() { m_lock.lock(); }
@@ -74,6 +152,7 @@ class AlarmList
       lock();
       for(int i = 0; i < m_list.size(); i++)
          memUsage += m_list.get(i)->getMemoryUsage();
+      memUsage += m_list.size() * sizeof(AlarmIndexEntry) + m_objectIndex.size() * sizeof(ObjectAlarms);
       unlock();
       return memUsage;
    }
@@ -83,10 +162,40 @@ class AlarmList
    Alarm *find(const TCHAR *key) { return m_keyIndex.get(key); }
    Alarm *find(UINT32 id)
    {
-      for(int i = 0; i < m_list.size(); i++)
-         if (m_list.get(i)->getAlarmId() == id)
-            return m_list.get(i);
-      return NULL;
+      AlarmIndexEntry *entry = m_idIndex.get(id);
+      return (entry != NULL) ? entry->alarm : NULL;
+   }
+
+   /**
+    * Get alarms for given object (returned array should not be modified)
+    */
+   const ObjectArray<Alarm> *getObjectAlarms(UINT32 objectId)
+   {
+      ObjectAlarms *objectAlarms = m_objectIndex.get(objectId);
+      return (objectAlarms != NULL) ? &objectAlarms->alarms : NULL;
+   }
+
+   /**
+    * Get most critical severity among active alarms for given object or STATUS_UNKNOWN if there are no active alarms
+    */
+   int getMostCriticalSeverity(UINT32 objectId)
+   {
+      ObjectAlarms *objectAlarms = m_objectIndex.get(objectId);
+      if (objectAlarms != NULL)
+      {
+         for(int i = 4; i >= 0; i--)
+            if (objectAlarms->activeCount[i] > 0)
+               return i;
+      }
+      return STATUS_UNKNOWN;
+   }
+
+   /**
+    * Get number of alarms per severity
+    */
+   void getSeverityCounters(UINT32 *counters)
+   {
+      memcpy(counters, m_severityCount, sizeof(m_severityCount));
    }
 
    void add(Alarm *alarm)
@@ -94,32 +203,61 @@ class AlarmList
       m_list.add(alarm);
       if (*alarm->getKey() != 0)
          m_keyIndex.set(alarm->getKey(), alarm);
+
+      AlarmIndexEntry *entry = new AlarmIndexEntry;
+      entry->alarm = alarm;
+      entry->sourceObject = alarm->getSourceObject();
+      entry->severity = alarm->getCurrentSeverity();
+      entry->active = isActive(alarm);
+      m_idIndex.set(alarm->getAlarmId(), entry);
+      indexByObject(entry);
+      m_severityCount[entry->severity]++;
    }
 
-   void remove(int index)
+   /**
+    * Update indexes after change of alarm's source object, severity, or state
+    */
+   void update(Alarm *alarm)
    {
-      Alarm *alarm = m_list.get(index);
-      if (alarm->getParentAlarmId() != 0)
+      AlarmIndexEntry *entry = m_idIndex.get(alarm->getAlarmId());
+      if ((entry == NULL) || (entry->alarm != alarm))
+         return;  // Alarm is not in the list (or it is a copy)
+
+      bool active = isActive(alarm);
+      if ((entry->sourceObject == alarm->getSourceObject()) && (entry->severity == alarm->getCurrentSeverity()) && (entry->active == active))
+         return;
+
+      m_severityCount[entry->severity]--;
+      if (entry->sourceObject != alarm->getSourceObject())
       {
-         Alarm *parent = find(alarm->getParentAlarmId());
-         if (parent != NULL)
-            parent->removeSubordinateAlarm(alarm->getAlarmId());
+         unindexByObject(entry);
+         entry->sourceObject = alarm->getSourceObject();
+         entry->severity = alarm->getCurrentSeverity();
+         entry->active = active;
+         indexByObject(entry);
       }
-      if (*alarm->getKey() != 0)
-         m_keyIndex.remove(alarm->getKey());
+      else
+      {
+         ObjectAlarms *objectAlarms = m_objectIndex.get(entry->sourceObject);
+         if (entry->active)
+            objectAlarms->activeCount[entry->severity]--;
+         entry->severity = alarm->getCurrentSeverity();
+         entry->active = active;
+         if (entry->active)
+            objectAlarms->activeCount[entry->severity]++;
+      }
+      m_severityCount[entry->severity]++;
+   }
+
+   void remove(int index)
+   {
+      unindex(m_list.get(index));
       m_list.remove(index);
    }
 
    void remove(Alarm *alarm)
    {
-      if (alarm->getParentAlarmId() != 0)
-      {
-         Alarm *parent = find(alarm->getParentAlarmId());
-         if (parent != NULL)
-            parent->removeSubordinateAlarm(alarm->getAlarmId());
-      }
-      if (*alarm->getKey() != 0)
-         m_keyIndex.remove(alarm->getKey());
+      unindex(alarm);
       m_list.remove(alarm);
    }
 };
@@ -786,6 +924,7 @@ void Alarm::updateFromEvent(Event *event, UINT32 parentAlarmId, const TCHAR *rca
    m_impact = MemCopyString(impact);
    delete m_alarmCategoryList;
    m_alarmCategoryList = new IntegerArray<UINT32>(alarmCategoryList);
+   s_alarmList.update(this);
 
    NotifyClients(NX_NOTIFY_ALARM_CHANGED, this);
    updateInDatabase();
@@ -829,7 +968,10 @@ UINT32 NXCORE_EXPORTABLE CreateNewAlarm(const uuid& rule, const TCHAR *message,
    String expImpact = event->expandText(impact);
 
    // Check if we have a duplicate alarm
-   if (((state & ALARM_STATE_MASK) != ALARM_STATE_TERMINATED) && !expKey.isEmpty())
+   // Alarm list remains locked until new alarm is added, so events with same alarm key
+   // processed by different event processing threads cannot create duplicate alarms
+   bool keyed = ((state & ALARM_STATE_MASK) != ALARM_STATE_TERMINATED) && !expKey.isEmpty();
+   if (keyed)
    {
       s_alarmList.lock();
 
@@ -858,9 +1000,8 @@ UINT32 NXCORE_EXPORTABLE CreateNewAlarm(const uuid& rule, const TCHAR *message,
             alarm->openHelpdeskIssue(NULL);
 
          newAlarm = false;
+         s_alarmList.unlock();
       }
-
-      s_alarmList.unlock();
    }
 
    if (newAlarm)
@@ -869,19 +1010,20 @@ UINT32 NXCORE_EXPORTABLE CreateNewAlarm(const uuid& rule, const TCHAR *message,
       Alarm *alarm = new Alarm(event, parentAlarmId, rcaScriptName, rule, expMsg, expKey, expImpact, state, severity, timeout, timeoutEvent, ackTimeout, alarmCategoryList);
       alarmId = alarm->getAlarmId();
 
-      // Open helpdesk issue
-      if (openHelpdeskIssue)
-         alarm->openHelpdeskIssue(NULL);
-
       // Add new alarm to active alarm list if needed
 		if ((alarm->getState() & ALARM_STATE_MASK) != ALARM_STATE_TERMINATED)
       {
-         s_alarmList.lock();
+         if (!keyed)
+            s_alarmList.lock();
          nxlog_debug_tag(DEBUG_TAG, 7, _T("AlarmManager: adding new active alarm, current alarm count %d"), s_alarmList.size());
          s_alarmList.add(alarm);
          s_alarmList.unlock();
       }
 
+      // Open helpdesk issue
+      if (openHelpdeskIssue)
+         alarm->openHelpdeskIssue(NULL);
+
 		alarm->createInDatabase();
       updateRelatedEvent = true;
 
@@ -951,6 +1093,7 @@ UINT32 Alarm::acknowledge(ClientSession *session, bool sticky, UINT32 acknowledg
       m_state |= ALARM_STATE_STICKY;
    m_ackByUser = (session != NULL) ? session->getUserId() : 0;
    m_lastChangeTime = (UINT32)time(NULL);
+   s_alarmList.update(this);
    NotifyClients(NX_NOTIFY_ALARM_CHANGED, this);
    updateInDatabase();
 
@@ -968,15 +1111,11 @@ UINT32 NXCORE_EXPORTABLE AckAlarmById(UINT32 alarmId, ClientSession *session, bo
    UINT32 dwObject, dwRet = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
-      {
-         dwRet = alarm->acknowledge(session, sticky, acknowledgmentActionTime, includeSubordinates);
-         dwObject = alarm->getSourceObject();
-         break;
-      }
+      dwRet = alarm->acknowledge(session, sticky, acknowledgmentActionTime, includeSubordinates);
+      dwObject = alarm->getSourceObject();
    }
    s_alarmList.unlock();
 
@@ -1027,6 +1166,7 @@ void Alarm::resolve(UINT32 userId, Event *event, bool terminate, bool notify, bo
    m_ackTimeout = 0;
    if (m_helpDeskState != ALARM_HELPDESK_IGNORED)
       m_helpDeskState = ALARM_HELPDESK_CLOSED;
+   s_alarmList.update(this);
    if (notify)
       NotifyClients(terminate ? NX_NOTIFY_ALARM_TERMINATED : NX_NOTIFY_ALARM_CHANGED, this);
    updateInDatabase();
@@ -1355,17 +1495,13 @@ UINT32 OpenHelpdeskIssue(UINT32 alarmId, ClientSession *session, TCHAR *hdref)
    *hdref = 0;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
-      {
-         if (alarm->checkCategoryAccess(session))
-            rcc = alarm->openHelpdeskIssue(hdref);
-         else
-            rcc = RCC_ACCESS_DENIED;
-         break;
-      }
+      if (alarm->checkCategoryAccess(session))
+         rcc = alarm->openHelpdeskIssue(hdref);
+      else
+         rcc = RCC_ACCESS_DENIED;
    }
    s_alarmList.unlock();
    return rcc;
@@ -1379,26 +1515,23 @@ UINT32 GetHelpdeskIssueUrlFromAlarm(UINT32 alarmId, UINT32 userId, TCHAR *url, s
    UINT32 rcc = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      if (s_alarmList.get(i)->getAlarmId() == alarmId)
+      if (alarm->checkCategoryAccess(session))
       {
-         if (s_alarmList.get(i)->checkCategoryAccess(session))
+         if ((alarm->getHelpDeskState() != ALARM_HELPDESK_IGNORED) && (alarm->getHelpDeskRef()[0] != 0))
          {
-            if ((s_alarmList.get(i)->getHelpDeskState() != ALARM_HELPDESK_IGNORED) && (s_alarmList.get(i)->getHelpDeskRef()[0] != 0))
-            {
-               rcc = GetHelpdeskIssueUrl(s_alarmList.get(i)->getHelpDeskRef(), url, size);
-            }
-            else
-            {
-               rcc = RCC_OUT_OF_STATE_REQUEST;
-            }
+            rcc = GetHelpdeskIssueUrl(alarm->getHelpDeskRef(), url, size);
          }
          else
          {
-            rcc = RCC_ACCESS_DENIED;
+            rcc = RCC_OUT_OF_STATE_REQUEST;
          }
-         break;
+      }
+      else
+      {
+         rcc = RCC_ACCESS_DENIED;
       }
    }
    s_alarmList.unlock();
@@ -1413,24 +1546,20 @@ UINT32 UnlinkHelpdeskIssueById(UINT32 alarmId, ClientSession *session)
    UINT32 rcc = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
+      if (session != NULL)
       {
-         if (session != NULL)
-         {
-            WriteAuditLog(AUDIT_OBJECTS, TRUE, session->getUserId(), session->getWorkstation(), session->getId(),
-               alarm->getSourceObject(), _T("Helpdesk issue %s unlinked from alarm %d (%s) on object %s"),
-               alarm->getHelpDeskRef(), alarm->getAlarmId(), alarm->getMessage(),
-               GetObjectName(alarm->getSourceObject(), _T("")));
-         }
-         alarm->unlinkFromHelpdesk();
+         WriteAuditLog(AUDIT_OBJECTS, TRUE, session->getUserId(), session->getWorkstation(), session->getId(),
+            alarm->getSourceObject(), _T("Helpdesk issue %s unlinked from alarm %d (%s) on object %s"),
+            alarm->getHelpDeskRef(), alarm->getAlarmId(), alarm->getMessage(),
+            GetObjectName(alarm->getSourceObject(), _T("")));
+      }
+      alarm->unlinkFromHelpdesk();
 			NotifyClients(NX_NOTIFY_ALARM_CHANGED, alarm);
 			alarm->updateInDatabase();
-         rcc = RCC_SUCCESS;
-         break;
-      }
+      rcc = RCC_SUCCESS;
    }
    s_alarmList.unlock();
 
@@ -1480,17 +1609,13 @@ void NXCORE_EXPORTABLE DeleteAlarm(UINT32 alarmId, bool objectCleanup)
    // Delete alarm from in-memory list
    if (!objectCleanup)  // otherwise already locked
       s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
-      {
-         dwObject = alarm->getSourceObject();
-         NotifyClients(NX_NOTIFY_ALARM_DELETED, alarm);
-         s_alarmList.remove(i);
-         found = true;
-         break;
-      }
+      dwObject = alarm->getSourceObject();
+      NotifyClients(NX_NOTIFY_ALARM_DELETED, alarm);
+      s_alarmList.remove(alarm);
+      found = true;
    }
    if (!objectCleanup)
       s_alarmList.unlock();
@@ -1521,14 +1646,15 @@ bool DeleteObjectAlarms(UINT32 objectId, DB_HANDLE hdb)
 {
 	s_alarmList.lock();
 
-	// go through from end because s_alarmList.size() is decremented by DeleteAlarm()
-	for(int i = s_alarmList.size() - 1; i >= 0; i--)
-   {
-      Alarm *alarm = s_alarmList.get(i);
-		if (alarm->getSourceObject() == objectId)
-      {
-			DeleteAlarm(alarm->getAlarmId(), true);
-      }
+	// copy alarm IDs because object's alarm list is modified by DeleteAlarm()
+	const ObjectArray<Alarm> *alarms = s_alarmList.getObjectAlarms(objectId);
+	if (alarms != NULL)
+	{
+	   IntegerArray<UINT32> alarmIds(alarms->size());
+	   for(int i = 0; i < alarms->size(); i++)
+	      alarmIds.add(alarms->get(i)->getAlarmId());
+	   for(int i = 0; i < alarmIds.size(); i++)
+	      DeleteAlarm(alarmIds.get(i), true);
 	}
 
 	s_alarmList.unlock();
@@ -1610,21 +1736,17 @@ UINT32 NXCORE_EXPORTABLE GetAlarm(UINT32 alarmId, UINT32 userId, NXCPMessage *ms
    UINT32 rcc = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
+      if (alarm->checkCategoryAccess(session))
       {
-         if (alarm->checkCategoryAccess(session))
-         {
-            alarm->fillMessage(msg);
-            rcc = RCC_SUCCESS;
-         }
-         else
-         {
-            rcc = RCC_ACCESS_DENIED;
-         }
-         break;
+         alarm->fillMessage(msg);
+         rcc = RCC_SUCCESS;
+      }
+      else
+      {
+         rcc = RCC_ACCESS_DENIED;
       }
    }
    s_alarmList.unlock();
@@ -1641,19 +1763,16 @@ UINT32 NXCORE_EXPORTABLE GetAlarmEvents(UINT32 alarmId, UINT32 userId, NXCPMessa
    UINT32 dwRet = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      if (s_alarmList.get(i)->getAlarmId() == alarmId)
+      if (alarm->checkCategoryAccess(session))
       {
-         if (s_alarmList.get(i)->checkCategoryAccess(session))
-         {
-            dwRet = RCC_SUCCESS;
-         }
-         else
-         {
-            dwRet = RCC_ACCESS_DENIED;
-         }
-         break;
+         dwRet = RCC_SUCCESS;
+      }
+      else
+      {
+         dwRet = RCC_ACCESS_DENIED;
       }
    }
 
@@ -1676,14 +1795,10 @@ NetObj NXCORE_EXPORTABLE *GetAlarmSourceObject(UINT32 alarmId, bool alreadyLocke
 
    if (!alreadyLocked)
       s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
-      {
-         dwObjectId = alarm->getSourceObject();
-         break;
-      }
+      dwObjectId = alarm->getSourceObject();
    }
 
    if (!alreadyLocked)
@@ -1718,19 +1833,8 @@ NetObj NXCORE_EXPORTABLE *GetAlarmSourceObject(const TCHAR *hdref)
  */
 int GetMostCriticalStatusForObject(UINT32 dwObjectId)
 {
-   int status = STATUS_UNKNOWN;
-
    s_alarmList.lock();
-   for(int i = 0; (i < s_alarmList.size()) && (status != STATUS_CRITICAL); i++)
-   {
-      Alarm *alarm = s_alarmList.get(i);
-      if ((alarm->getSourceObject() == dwObjectId) &&
-			 ((alarm->getState() & ALARM_STATE_MASK) < ALARM_STATE_RESOLVED) &&
-          ((alarm->getCurrentSeverity() > status) || (status == STATUS_UNKNOWN)))
-      {
-         status = (int)alarm->getCurrentSeverity();
-      }
-   }
+   int status = s_alarmList.getMostCriticalSeverity(dwObjectId);
    s_alarmList.unlock();
    return status;
 }
@@ -1744,9 +1848,7 @@ void GetAlarmStats(NXCPMessage *pMsg)
 
    s_alarmList.lock();
    pMsg->setField(VID_NUM_ALARMS, s_alarmList.size());
-   memset(dwCount, 0, sizeof(UINT32) * 5);
-   for(int i = 0; i < s_alarmList.size(); i++)
-      dwCount[s_alarmList.get(i)->getCurrentSeverity()]++;
+   s_alarmList.getSeverityCounters(dwCount);
    s_alarmList.unlock();
    pMsg->setFieldFromInt32Array(VID_ALARMS_BY_SEVERITY, 5, dwCount);
 }
@@ -1815,6 +1917,7 @@ static THREAD_RESULT THREAD_CALL WatchdogThread(void *arg)
 				PostSystemEvent(alarm->getTimeoutEvent(), alarm->getSourceObject(), "dssd",
 				         alarm->getAlarmId(), alarm->getMessage(), alarm->getKey(), alarm->getSourceEventCode());
 				alarm->onAckTimeoutExpiration();
+				s_alarmList.update(alarm);
 				alarm->updateInDatabase();
 				NotifyClients(NX_NOTIFY_ALARM_CHANGED, alarm);
 			}
@@ -1963,14 +2066,10 @@ UINT32 UpdateAlarmComment(UINT32 alarmId, UINT32 *noteId, const TCHAR *text, UIN
    UINT32 rcc = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
-      {
-         rcc = alarm->updateAlarmComment(noteId, text, userId, syncWithHelpdesk);
-         break;
-      }
+      rcc = alarm->updateAlarmComment(noteId, text, userId, syncWithHelpdesk);
    }
    s_alarmList.unlock();
 
@@ -2019,14 +2118,10 @@ UINT32 DeleteAlarmCommentByID(UINT32 alarmId, UINT32 noteId)
    UINT32 rcc = RCC_INVALID_ALARM_ID;
 
    s_alarmList.lock();
-   for(int i = 0; i < s_alarmList.size(); i++)
+   Alarm *alarm = s_alarmList.find(alarmId);
+   if (alarm != NULL)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if (alarm->getAlarmId() == alarmId)
-      {
-         rcc = alarm->deleteComment(noteId);
-         break;
-      }
+      rcc = alarm->deleteComment(noteId);
    }
    s_alarmList.unlock();
 
@@ -2130,14 +2225,28 @@ UINT32 GetAlarmComments(UINT32 alarmId, NXCPMessage *msg)
 ObjectArray<Alarm> NXCORE_EXPORTABLE *GetAlarms(UINT32 objectId, bool recursive)
 {
    s_alarmList.lock();
-   ObjectArray<Alarm> *result = new ObjectArray<Alarm>(s_alarmList.size(), 16, true);
-   for(int i = 0; i < s_alarmList.size(); i++)
+   ObjectArray<Alarm> *result;
+   if ((objectId != 0) && !recursive)
    {
-      Alarm *alarm = s_alarmList.get(i);
-      if ((objectId == 0) || (alarm->getSourceObject() == objectId) ||
-          (recursive && IsParentObject(objectId, alarm->getSourceObject())))
+      const ObjectArray<Alarm> *alarms = s_alarmList.getObjectAlarms(objectId);
+      result = new ObjectArray<Alarm>((alarms != NULL) ? alarms->size() : 0, 16, true);
+      if (alarms != NULL)
       {
-         result->add(new Alarm(alarm, true));
+         for(int i = 0; i < alarms->size(); i++)
+            result->add(new Alarm(alarms->get(i), true));
+      }
+   }
+   else
+   {
+      result = new ObjectArray<Alarm>(s_alarmList.size(), 16, true);
+      for(int i = 0; i < s_alarmList.size(); i++)
+      {
+         Alarm *alarm = s_alarmList.get(i);
+         if ((objectId == 0) || (alarm->getSourceObject() == objectId) ||
+             (recursive && IsParentObject(objectId, alarm->getSourceObject())))
+         {
+            result->add(new Alarm(alarm, true));
+         }
       }
    }
    s_alarmList.unlock();
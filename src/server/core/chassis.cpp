@@ -322,6 +322,8 @@ void Chassis::linkObjects()
  */
 void Chassis::onDataCollectionChange()
 {
+   scheduleItemsForPolling(time(NULL));
+
    Node *controller = (Node *)FindObjectById(m_controllerId, OBJECT_NODE);
    if (controller == NULL)
    {
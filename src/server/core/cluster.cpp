@@ -905,6 +905,7 @@ void Cluster::unbindFromTemplate(UINT32 dwTemplateId, bool removeDCI)
 void Cluster::onDataCollectionChange()
 {
    queueUpdate();
+   scheduleItemsForPolling(time(NULL));
 }
 
 /**
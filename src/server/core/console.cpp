@@ -38,6 +38,7 @@ extern ThreadPool *g_discoveryThreadPool;
 
 void ShowPredictionEngines(CONSOLE_CTX console);
 void ShowAgentTunnels(CONSOLE_CTX console);
+void ShowEventProcessorStatistics(CONSOLE_CTX console);
 UINT32 BindAgentTunnel(UINT32 tunnelId, UINT32 nodeId, UINT32 userId);
 UINT32 UnbindAgentTunnel(UINT32 nodeId, UINT32 userId);
 INT64 GetEventLogWriterQueueSize();
@@ -73,6 +74,7 @@ static void ShowMemoryUsage(ServerConsole *console)
 {
    console->printf(_T("Alarms ...................: %.02f MB\n"), static_cast<double>(GetAlarmMemoryUsage()) / 1048576);
    console->printf(_T("Data collection cache ....: %.02f MB\n"), static_cast<double>(GetDCICacheMemoryUsage()) / 1048576);
+   console->printf(_T("DCI data write queues ....: %.02f MB\n"), static_cast<double>(GetIDataWriterMemoryUsage()) / 1048576);
    console->printf(_T("Raw DCI data write cache .: %.02f MB\n"), static_cast<double>(GetRawDataWriterMemoryUsage()) / 1048576);
    console->print(_T("\n"));
 }
@@ -778,6 +780,8 @@ int ProcessConsoleCommand(const TCHAR *pszCmdLine, CONSOLE_CTX pCtx)
          ConsolePrintf(pCtx, _T("   Non-SELECT ..... ") INT64_FMT _T("\n"), counters.nonSelectQueries);
          ConsolePrintf(pCtx, _T("   Long running ... ") INT64_FMT _T("\n"), counters.longRunningQueries);
          ConsolePrintf(pCtx, _T("   Failed ......... ") INT64_FMT _T("\n"), counters.failedQueries);
+         ConsolePrintf(pCtx, _T("   Bulk inserts ... ") INT64_FMT _T("\n"), counters.bulkInserts);
+         ConsolePrintf(pCtx, _T("   Bulk rows ...... ") INT64_FMT _T("\n"), counters.bulkInsertRows);
 
          ConsolePrintf(pCtx, _T("Background writer requests:\n"));
          ConsolePrintf(pCtx, _T("   DCI data ....... ") INT64_FMT _T("\n"), g_idataWriteRequests);
@@ -796,6 +800,14 @@ int ProcessConsoleCommand(const TCHAR *pszCmdLine, CONSOLE_CTX pCtx)
             ConsoleWrite(pCtx, _T("Invalid subcommand\n"));
          }
       }
+      else if (IsCommand(_T("EPP"), szBuffer, 3))
+      {
+         g_pEventPolicy->showStatistics(pCtx);
+      }
+      else if (IsCommand(_T("EVPROC"), szBuffer, 3))
+      {
+         ShowEventProcessorStatistics(pCtx);
+      }
       else if (IsCommand(_T("FDB"), szBuffer, 3))
       {
          // Get argument
@@ -1214,6 +1226,7 @@ int ProcessConsoleCommand(const TCHAR *pszCmdLine, CONSOLE_CTX pCtx)
          ShowThreadPool(pCtx, g_dataCollectorThreadPool);
          ShowThreadPool(pCtx, g_schedulerThreadPool);
          ShowThreadPool(pCtx, g_agentConnectionThreadPool);
+         ShowThreadPool(pCtx, g_agentReceiverThreadPool);
          ShowThreadPool(pCtx, g_clientThreadPool);
          ShowThreadPool(pCtx, g_npeThreadPool);
          ShowThreadPool(pCtx, g_syncerThreadPool);
@@ -1622,6 +1635,8 @@ int ProcessConsoleCommand(const TCHAR *pszCmdLine, CONSOLE_CTX pCtx)
             _T("   show dbcp                         - Show active sessions in database connection pool\n")
             _T("   show dbstats                      - Show DB library statistics\n")
             _T("   show discovery queue              - Show content of network discovery queue\n")
+            _T("   show epp                          - Show event processing policy rule statistics\n")
+            _T("   show evproc                       - Show event processing threads statistics\n")
             _T("   show fdb <node>                   - Show forwarding database for node\n")
             _T("   show flags                        - Show internal server flags\n")
             _T("   show heap details                 - Show detailed heap information\n")
@@ -205,6 +205,54 @@ static void *GetTableData(DataCollectionTarget *dcTarget, DCTable *table, UINT32
 	return result;
 }
 
+/**
+ * Process collected data or collection error
+ */
+static void ProcessCollectedData(const shared_ptr<DCObject>& dcObject, void *data, UINT32 error, time_t currTime)
+{
+   // Transform and store received value into database or handle error
+   switch(error)
+   {
+      case DCE_SUCCESS:
+         if (dcObject->getStatus() == ITEM_STATUS_NOT_SUPPORTED)
+            dcObject->setStatus(ITEM_STATUS_ACTIVE, true);
+         if (!static_cast<DataCollectionTarget*>(dcObject->getOwner())->processNewDCValue(dcObject, currTime, data))
+         {
+            // value processing failed, convert to data collection error
+            dcObject->processNewError(false);
+         }
+         break;
+      case DCE_COLLECTION_ERROR:
+         if (dcObject->getStatus() == ITEM_STATUS_NOT_SUPPORTED)
+            dcObject->setStatus(ITEM_STATUS_ACTIVE, true);
+         dcObject->processNewError(false);
+         break;
+      case DCE_NO_SUCH_INSTANCE:
+         if (dcObject->getStatus() == ITEM_STATUS_NOT_SUPPORTED)
+            dcObject->setStatus(ITEM_STATUS_ACTIVE, true);
+         dcObject->processNewError(true);
+         break;
+      case DCE_COMM_ERROR:
+         dcObject->processNewError(false);
+         break;
+      case DCE_NOT_SUPPORTED:
+         // Change item's status
+         dcObject->setStatus(ITEM_STATUS_NOT_SUPPORTED, true);
+         break;
+   }
+
+   // Send session notification when force poll is performed
+   if (dcObject->isForcePollRequested())
+   {
+      ClientSession *session = dcObject->processForcePoll();
+      if (session != NULL)
+      {
+         session->notify(NX_NOTIFY_FORCE_DCI_POLL, dcObject->getOwnerId());
+         session->decRefCount();
+      }
+   }
+}
+
 /**
  * Data collector
  */
@@ -293,47 +341,7 @@ void DataCollector(shared_ptr<DCObject> dcObject)
                break;
          }
 
-         // Transform and store received value into database or handle error
-         switch(error)
-         {
-            case DCE_SUCCESS:
-               if (dcObject->getStatus() == ITEM_STATUS_NOT_SUPPORTED)
-                  dcObject->setStatus(ITEM_STATUS_ACTIVE, true);
-               if (!static_cast<DataCollectionTarget*>(dcObject->getOwner())->processNewDCValue(dcObject, currTime, data))
-               {
-                  // value processing failed, convert to data collection error
-                  dcObject->processNewError(false);
-               }
-               break;
-            case DCE_COLLECTION_ERROR:
-               if (dcObject->getStatus() == ITEM_STATUS_NOT_SUPPORTED)
-                  dcObject->setStatus(ITEM_STATUS_ACTIVE, true);
-               dcObject->processNewError(false);
-               break;
-            case DCE_NO_SUCH_INSTANCE:
-               if (dcObject->getStatus() == ITEM_STATUS_NOT_SUPPORTED)
-                  dcObject->setStatus(ITEM_STATUS_ACTIVE, true);
-               dcObject->processNewError(true);
-               break;
-            case DCE_COMM_ERROR:
-               dcObject->processNewError(false);
-               break;
-            case DCE_NOT_SUPPORTED:
-               // Change item's status
-               dcObject->setStatus(ITEM_STATUS_NOT_SUPPORTED, true);
-               break;
-         }
-
-         // Send session notification when force poll is performed
-         if (dcObject->isForcePollRequested())
-         {
-            ClientSession *session = dcObject->processForcePoll();
-            if (session != NULL)
-            {
-               session->notify(NX_NOTIFY_FORCE_DCI_POLL, dcObject->getOwnerId());
-               session->decRefCount();
-            }
-         }
+         ProcessCollectedData(dcObject, data, error, currTime);
       }
 
       // Decrement node's usage counter
@@ -353,25 +361,464 @@ void DataCollector(shared_ptr<DCObject> dcObject)
    // Update item's last poll time and clear busy flag so item can be polled again
    dcObject->setLastPollTime(currTime);
    dcObject->clearBusyFlag();
+   ScheduleDataCollection(dcObject, currTime);
+}
+
+/**
+ * Maximum number of SNMP DCIs collected with single request
+ */
+static int s_snmpMaxBatchSize = 32;
+
+/**
+ * Asynchronous SNMP client for data collection (NULL if asynchronous requests are disabled)
+ */
+static SNMP_AsyncClient *s_snmpAsyncClient = NULL;
+
+/**
+ * SNMP data collection batch
+ */
+struct SNMPDataCollectionBatch
+{
+   Node *node;
+   UINT16 port;
+   SNMP_Version version;
+   SharedObjectArray<DCObject> items;
+   DCItem **dcItems;
+   int *index;
+   int count;
+   TCHAR *data;
+   TCHAR **buffers;
+   DataCollectionError *errors;
+
+   SNMPDataCollectionBatch(Node *_node, UINT16 _port, SNMP_Version _version) : items(64, 64)
+   {
+      node = _node;
+      port = _port;
+      version = _version;
+      dcItems = NULL;
+      index = NULL;
+      count = 0;
+      data = NULL;
+      buffers = NULL;
+      errors = NULL;
+   }
+
+   ~SNMPDataCollectionBatch()
+   {
+      MemFree(dcItems);
+      MemFree(index);
+      MemFree(data);
+      MemFree(buffers);
+      MemFree(errors);
+   }
+
+   void prepare();
+   void complete();
+};
+
+/**
+ * Prepare batch for collection. DCIs scheduled for deletion are passed to standard data collector.
+ */
+void SNMPDataCollectionBatch::prepare()
+{
+   if (dcItems != NULL)
+      return;  // Already prepared
+
+   dcItems = MemAllocArrayNoInit<DCItem*>(items.size());
+   index = MemAllocArrayNoInit<int>(items.size());
+   for(int i = 0; i < items.size(); i++)
+   {
+      DCObject *dcObject = items.get(i);
+      if (dcObject->isScheduledForDeletion() || IsShutdownInProgress())
+      {
+         // Let standard data collector do necessary cleanup
+         DataCollector(items.getShared(i));
+      }
+      else
+      {
+         index[count] = i;
+         dcItems[count++] = static_cast<DCItem*>(dcObject);
+      }
+   }
+
+   if (count > 0)
+   {
+      data = MemAllocArrayNoInit<TCHAR>(count * MAX_LINE_SIZE);
+      buffers = MemAllocArrayNoInit<TCHAR*>(count);
+      for(int i = 0; i < count; i++)
+         buffers[i] = &data[i * MAX_LINE_SIZE];
+      errors = MemAllocArrayNoInit<DataCollectionError>(count);
+   }
+}
+
+/**
+ * Process collected values
+ */
+void SNMPDataCollectionBatch::complete()
+{
+   time_t currTime = time(NULL);
+   for(int i = 0; i < count; i++)
+   {
+      const shared_ptr<DCObject>& dcObject = items.getShared(index[i]);
+      if (!IsShutdownInProgress())
+         ProcessCollectedData(dcObject, buffers[i], errors[i], currTime);
+      node->decRefCount();
+
+      dcObject->setLastPollTime(currTime);
+      dcObject->clearBusyFlag();
+      ScheduleDataCollection(dcObject, currTime);
+   }
+}
+
+/**
+ * Data collector for SNMP DCIs batch
+ */
+static void SNMPDataCollector(SNMPDataCollectionBatch *batch)
+{
+   batch->prepare();
+   if (batch->count > 0)
+   {
+      DbgPrintf(8, _T("SNMPDataCollector(): processing %d DC objects for node %s [%u]"), batch->count, batch->node->getName(), batch->node->getId());
+      batch->node->getItemsFromSNMP(batch->port, batch->version, batch->dcItems, batch->count, s_snmpMaxBatchSize, batch->buffers, batch->errors);
+      batch->complete();
+   }
+   delete batch;
+}
+
+/**
+ * Completion callback for asynchronous SNMP data collection (called on data collector thread pool)
+ */
+static void SNMPAsyncDataCollectionCallback(bool success, void *context)
+{
+   SNMPDataCollectionBatch *batch = static_cast<SNMPDataCollectionBatch*>(context);
+   if (success)
+   {
+      batch->complete();
+      delete batch;
+   }
+   else
+   {
+      DbgPrintf(7, _T("SNMPAsyncDataCollectionCallback(): batch request failed for node %s [%u], repeating with synchronous requests"), batch->node->getName(), batch->node->getId());
+      SNMPDataCollector(batch);
+   }
+}
+
+/**
+ * Queue SNMP DCIs for given node for polling. DCIs using same SNMP port and
+ * version are collected together. All DCIs should be already marked as busy
+ * and node's reference count incremented for each DCI.
+ */
+void QueueSNMPDataCollection(Node *node, SharedObjectArray<DCObject> *items)
+{
+   if (s_snmpMaxBatchSize < 2)
+   {
+      for(int i = 0; i < items->size(); i++)
+         ThreadPoolExecute(g_dataCollectorThreadPool, DataCollector, items->getShared(i));
+      return;
+   }
+
+   bool *queued = MemAllocArray<bool>(items->size());
+   for(int i = 0; i < items->size(); i++)
+   {
+      if (queued[i])
+         continue;
+
+      DCItem *dci = static_cast<DCItem*>(items->get(i));
+      SNMPDataCollectionBatch *batch = new SNMPDataCollectionBatch(node, dci->getSnmpPort(), dci->getSnmpVersion());
+      for(int j = i; (j < items->size()) && (batch->items.size() < s_snmpMaxBatchSize); j++)
+      {
+         DCItem *curr = static_cast<DCItem*>(items->get(j));
+         if (!queued[j] && (curr->getSnmpPort() == batch->port) && (curr->getSnmpVersion() == batch->version))
+         {
+            batch->items.add(items->getShared(j));
+            queued[j] = true;
+         }
+      }
+
+      if (s_snmpAsyncClient != NULL)
+      {
+         batch->prepare();
+         if (batch->count == 0)
+         {
+            delete batch;
+            continue;
+         }
+         if (node->getItemsFromSNMPAsync(s_snmpAsyncClient, batch->port, batch->version, batch->dcItems, batch->count,
+                  batch->buffers, batch->errors, SNMPAsyncDataCollectionCallback, batch))
+            continue;
+      }
+      ThreadPoolExecute(g_dataCollectorThreadPool, SNMPDataCollector, batch);
+   }
+   MemFree(queued);
+}
+
+/**
+ * Get number of pending asynchronous SNMP requests
+ */
+INT64 GetSNMPAsyncPendingRequestCount()
+{
+   return (s_snmpAsyncClient != NULL) ? s_snmpAsyncClient->getPendingRequestCount() : 0;
+}
+
+/**
+ * Size of data collection scheduler wheel (in seconds)
+ */
+#define SCHEDULER_WHEEL_SIZE     4096
+
+/**
+ * Interval between full scans of data collection targets (in seconds)
+ */
+#define FULL_SCAN_INTERVAL       60
+
+/**
+ * Data collection scheduler entry
+ */
+struct DCSchedulerEntry
+{
+   DCSchedulerEntry *next;
+   time_t dueTime;
+   UINT32 ownerId;
+   UINT32 dciId;
+};
+
+/**
+ * Data collection scheduler. Implemented as hashed timing wheel with
+ * one second resolution. Entry for DCI is considered valid only if its due
+ * time matches DCI's scheduled poll time, so rescheduling DCI to earlier time
+ * simply adds new entry and old one is dropped when reached. Entries refer to
+ * DCIs by owner and DCI ID, so deleted DCIs are not kept alive by scheduler and
+ * their entries are dropped when reached.
+ */
+static DCSchedulerEntry *s_schedulerWheel[SCHEDULER_WHEEL_SIZE];
+static ObjectMemoryPool<DCSchedulerEntry> s_schedulerEntryPool(1024);
+static Mutex s_schedulerLock;
+static time_t s_schedulerLastTick = 0;
+static UINT32 s_schedulerQueueSize = 0;
+
+/**
+ * Average DCI scheduling lag (in milliseconds)
+ */
+UINT32 g_averageDCISchedulingLag = 0;
+
+/**
+ * Schedule data collection object for polling at next poll time
+ * calculated from object's state. If object is already scheduled
+ * for earlier time this call has no effect.
+ */
+void ScheduleDataCollection(const shared_ptr<DCObject>& dcObject, time_t currTime)
+{
+   time_t dueTime = dcObject->getNextPollTime(currTime);
+   if (dueTime == 0)
+      return;
+
+   s_schedulerLock.lock();
+   time_t scheduledTime = dcObject->getScheduledPollTime();
+   if ((scheduledTime == 0) || (dueTime < scheduledTime))
+   {
+      DCSchedulerEntry *entry = new(s_schedulerEntryPool.allocate()) DCSchedulerEntry();
+      entry->dueTime = dueTime;
+      entry->ownerId = dcObject->getOwnerId();
+      entry->dciId = dcObject->getId();
+
+      // Entries already due are placed into the slot processed on next tick
+      time_t slotTime = std::max(dueTime, s_schedulerLastTick + 1);
+      DCSchedulerEntry **slot = &s_schedulerWheel[slotTime % SCHEDULER_WHEEL_SIZE];
+      entry->next = *slot;
+      *slot = entry;
+
+      dcObject->setScheduledPollTime(dueTime);
+      s_schedulerQueueSize++;
+   }
+   s_schedulerLock.unlock();
+}
+
+/**
+ * Get number of entries in data collection scheduler
+ */
+INT64 GetDataCollectionSchedulerQueueSize()
+{
+   return s_schedulerQueueSize;
+}
+
+/**
+ * Remove due entries from scheduler wheel. Returns number of entries placed
+ * into provided array (caller is responsible for array destruction).
+ */
+static int GetDueSchedulerEntries(time_t now, DCSchedulerEntry ***entries)
+{
+   int count = 0, allocated = 256;
+   *entries = MemAllocArrayNoInit<DCSchedulerEntry*>(allocated);
+
+   s_schedulerLock.lock();
+
+   // Check all slots if there is a gap since last run or clock was moved back
+   time_t first, last;
+   if ((s_schedulerLastTick == 0) || (now < s_schedulerLastTick) || (now - s_schedulerLastTick >= SCHEDULER_WHEEL_SIZE))
+   {
+      first = now - SCHEDULER_WHEEL_SIZE + 1;
+      last = now;
+   }
+   else
+   {
+      first = s_schedulerLastTick + 1;
+      last = now;
+   }
+   bool clockMovedBack = (s_schedulerLastTick != 0) && (now < s_schedulerLastTick);
+
+   for(time_t t = first; t <= last; t++)
+   {
+      DCSchedulerEntry **prev = &s_schedulerWheel[t % SCHEDULER_WHEEL_SIZE];
+      DCSchedulerEntry *entry = *prev;
+      while(entry != NULL)
+      {
+         DCSchedulerEntry *next = entry->next;
+         if ((entry->dueTime <= now) || clockMovedBack)
+         {
+            *prev = next;
+            s_schedulerQueueSize--;
+            if (count == allocated)
+            {
+               allocated += 256;
+               *entries = MemReallocArray(*entries, allocated);
+            }
+            (*entries)[count++] = entry;
+         }
+         else
+         {
+            prev = &entry->next;
+         }
+         entry = next;
+      }
+   }
+   s_schedulerLastTick = now;
+
+   s_schedulerLock.unlock();
+   return count;
 }
 
 /**
- * Callback for queueing DCIs
+ * Compare scheduler entries by owner ID and DCI ID
  */
-static void QueueItems(NetObj *object, UINT32 *watchdogId)
+static int CompareSchedulerEntries(const void *e1, const void *e2)
+{
+   const DCSchedulerEntry *entry1 = *static_cast<DCSchedulerEntry* const*>(e1);
+   const DCSchedulerEntry *entry2 = *static_cast<DCSchedulerEntry* const*>(e2);
+   if (entry1->ownerId != entry2->ownerId)
+      return (entry1->ownerId < entry2->ownerId) ? -1 : 1;
+   return (entry1->dciId < entry2->dciId) ? -1 : ((entry1->dciId > entry2->dciId) ? 1 : 0);
+}
+
+/**
+ * Check if list of scheduler entries (sorted by DCI ID) contains entry for given DCI with given due time.
+ * Entry matching DCI's scheduled poll time is the one DCI is currently scheduled by.
+ */
+static bool IsCurrentSchedulerEntryPresent(DCSchedulerEntry **entries, int count, UINT32 dciId, time_t dueTime)
+{
+   int l = 0, r = count;
+   while(l < r)
+   {
+      int m = (l + r) / 2;
+      if (entries[m]->dciId < dciId)
+         l = m + 1;
+      else
+         r = m;
+   }
+   for(; (l < count) && (entries[l]->dciId == dciId); l++)
+      if (entries[l]->dueTime == dueTime)
+         return true;
+   return false;
+}
+
+/**
+ * Queue due data collection objects for polling
+ */
+static void QueueScheduledItems(time_t now, GaugeData<UINT32> *schedulingLag)
+{
+   DCSchedulerEntry **entries;
+   int count = GetDueSchedulerEntries(now, &entries);
+   if (count == 0)
+   {
+      MemFree(entries);
+      return;
+   }
+
+   qsort(entries, count, sizeof(DCSchedulerEntry*), CompareSchedulerEntries);
+
+   INT64 currTimeMs = GetCurrentTimeMs();
+   INT64 totalLag = 0;
+   IntegerArray<UINT32> dciIds(256, 256);
+   SharedObjectArray<DCObject> candidates(256, 256);
+   SharedObjectArray<DCObject> items(256, 256);
+   for(int i = 0; i < count;)
+   {
+      UINT32 ownerId = entries[i]->ownerId;
+      int start = i;
+      for(; (i < count) && (entries[i]->ownerId == ownerId); i++)
+      {
+         if ((dciIds.size() == 0) || (dciIds.get(dciIds.size() - 1) != entries[i]->dciId))
+            dciIds.add(entries[i]->dciId);
+         totalLag += currTimeMs - static_cast<INT64>(entries[i]->dueTime) * 1000;
+      }
+
+      NetObj *object = FindObjectById(ownerId);
+      if ((object != NULL) && object->isDataCollectionTarget() && !IsShutdownInProgress())
+      {
+         object->incRefCount();
+         static_cast<DataCollectionTarget*>(object)->getDCObjectsById(dciIds, &candidates);
+
+         // Skip DCIs rescheduled since entries were added
+         s_schedulerLock.lock();
+         for(int j = 0; j < candidates.size(); j++)
+         {
+            DCObject *dci = candidates.get(j);
+            if (IsCurrentSchedulerEntryPresent(&entries[start], i - start, dci->getId(), dci->getScheduledPollTime()))
+            {
+               dci->setScheduledPollTime(0);
+               items.add(candidates.getShared(j));
+            }
+         }
+         s_schedulerLock.unlock();
+
+         if (items.size() > 0)
+         {
+            nxlog_debug(8, _T("ItemPoller: queueing %d items for object %s [%d]"), items.size(), object->getName(), object->getId());
+            static_cast<DataCollectionTarget*>(object)->queueItemsForPolling(&items, now);
+         }
+         object->decRefCount();
+      }
+      dciIds.clear();
+      candidates.clear();
+      items.clear();
+   }
+
+   schedulingLag->update(static_cast<UINT32>(totalLag / count));
+
+   s_schedulerLock.lock();
+   for(int i = 0; i < count; i++)
+      s_schedulerEntryPool.destroy(entries[i]);
+   s_schedulerLock.unlock();
+   MemFree(entries);
+}
+
+/**
+ * Callback for scheduling DCIs
+ */
+static void ScheduleItems(NetObj *object, UINT32 *watchdogId)
 {
    if (IsShutdownInProgress())
       return;
 
    WatchdogNotify(*watchdogId);
-	nxlog_debug(8, _T("ItemPoller: calling DataCollectionTarget::queueItemsForPolling for object %s [%d]"),
+	nxlog_debug(8, _T("ItemPoller: calling DataCollectionTarget::scheduleItemsForPolling for object %s [%d]"),
 				   object->getName(), object->getId());
-	static_cast<DataCollectionTarget*>(object)->queueItemsForPolling();
+	static_cast<DataCollectionTarget*>(object)->scheduleItemsForPolling(time(NULL));
 }
 
 /**
- * Item poller thread: check nodes' items and put into the
- * data collector queue when data polling required
+ * Item poller thread: put items due for polling into the data collector
+ * queue. Items are normally rescheduled by data collector, but all data
+ * collection targets are periodically scanned for items missing in scheduler
+ * (for example, after change of object's management status).
  */
 static THREAD_RESULT THREAD_CALL ItemPoller(void *pArg)
 {
@@ -379,6 +826,8 @@ static THREAD_RESULT THREAD_CALL ItemPoller(void *pArg)
 
    UINT32 watchdogId = WatchdogAddThread(_T("Item Poller"), 10);
    GaugeData<UINT32> queuingTime(ITEM_POLLING_INTERVAL, 300);
+   GaugeData<UINT32> schedulingLag(ITEM_POLLING_INTERVAL, 300);
+   time_t lastFullScan = 0;
 
    while(!IsShutdownInProgress())
    {
@@ -388,14 +837,22 @@ static THREAD_RESULT THREAD_CALL ItemPoller(void *pArg)
 		DbgPrintf(8, _T("ItemPoller: wakeup"));
 
       INT64 startTime = GetCurrentTimeMs();
-		g_idxNodeById.forEach(QueueItems, &watchdogId);
-		g_idxClusterById.forEach(QueueItems, &watchdogId);
-		g_idxMobileDeviceById.forEach(QueueItems, &watchdogId);
-      g_idxChassisById.forEach(QueueItems, &watchdogId);
-		g_idxSensorById.forEach(QueueItems, &watchdogId);
+      time_t now = static_cast<time_t>(startTime / 1000);
+      if ((now - lastFullScan >= FULL_SCAN_INTERVAL) || (now < lastFullScan))
+      {
+         g_idxNodeById.forEach(ScheduleItems, &watchdogId);
+         g_idxClusterById.forEach(ScheduleItems, &watchdogId);
+         g_idxMobileDeviceById.forEach(ScheduleItems, &watchdogId);
+         g_idxChassisById.forEach(ScheduleItems, &watchdogId);
+         g_idxSensorById.forEach(ScheduleItems, &watchdogId);
+         lastFullScan = now;
+      }
+
+      QueueScheduledItems(now, &schedulingLag);
 
 		queuingTime.update(static_cast<UINT32>(GetCurrentTimeMs() - startTime));
 		g_averageDCIQueuingTime = static_cast<UINT32>(queuingTime.getAverage());
+		g_averageDCISchedulingLag = static_cast<UINT32>(schedulingLag.getAverage());
    }
    DbgPrintf(1, _T("Item poller thread terminated"));
    return THREAD_OK;
@@ -424,6 +881,7 @@ THREAD_RESULT THREAD_CALL CacheLoader(void *arg)
             nxlog_debug_tag(_T("obj.dc.cache"), 6, _T("Loading cache for DCI %s [%d] on %s [%d]"),
                      ref->getName(), ref->getId(), object->getName(), object->getId());
             static_cast<DCItem*>(dci.get())->reloadCache(false);
+            ScheduleDataCollection(dci, time(NULL));
          }
          object->decRefCount();
       }
@@ -447,7 +905,18 @@ void InitDataCollector()
    g_dataCollectorThreadPool = ThreadPoolCreate(_T("DATACOLL"),
             ConfigReadInt(_T("ThreadPool.DataCollector.BaseSize"), 10),
             ConfigReadInt(_T("ThreadPool.DataCollector.MaxSize"), 250),
-            128 * 1024);
+            128 * 1024,
+            ConfigReadBoolean(_T("ThreadPool.DataCollector.WorkStealing"), false) ? THREAD_POOL_WORK_STEALING : 0);
+   s_snmpMaxBatchSize = ConfigReadInt(_T("DataCollection.SNMP.MaxBatchSize"), 32);
+   if (ConfigReadBoolean(_T("DataCollection.SNMP.AsyncRequests"), true))
+   {
+      s_snmpAsyncClient = new SNMP_AsyncClient(g_dataCollectorThreadPool);
+      if (!s_snmpAsyncClient->start())
+      {
+         nxlog_write(NXLOG_WARNING, _T("Cannot start asynchronous SNMP client, SNMP data collection will use synchronous requests"));
+         delete_and_null(s_snmpAsyncClient);
+      }
+   }
 
    s_itemPollerThread = ThreadCreateEx(ItemPoller, 0, NULL);
    s_cacheLoaderThread = ThreadCreateEx(CacheLoader, 0, NULL);
@@ -460,7 +929,10 @@ void StopDataCollection()
 {
    ThreadJoin(s_itemPollerThread);
    ThreadJoin(s_cacheLoaderThread);
+   if (s_snmpAsyncClient != NULL)
+      s_snmpAsyncClient->stop();  // Outstanding requests will be completed via data collector thread pool
    ThreadPoolDestroy(g_dataCollectorThreadPool);
+   delete_and_null(s_snmpAsyncClient);
 }
 
 /**
@@ -37,15 +37,47 @@ struct DELAYED_SQL_REQUEST
 };
 
 /**
- * Delayed request for idata_ INSERT
+ * Delayed request for idata_ INSERT. Records are packed into writer queue chunks:
+ * fixed header is followed by raw and transformed values as zero-terminated UTF-8 strings.
  */
 struct DELAYED_IDATA_INSERT
 {
    time_t timestamp;
    UINT32 nodeId;
    UINT32 dciId;
-   TCHAR rawValue[MAX_RESULT_LENGTH];
-   TCHAR transformedValue[MAX_RESULT_LENGTH];
+   UINT16 rawValueLength;         // in bytes, including terminator
+   UINT16 transformedValueLength; // in bytes, including terminator
+
+   const char *rawValue() const { return reinterpret_cast<const char*>(this) + sizeof(DELAYED_IDATA_INSERT); }
+   const char *transformedValue() const { return rawValue() + rawValueLength; }
+   size_t size() const { return RecordSize(rawValueLength + transformedValueLength); }
+
+   static size_t RecordSize(size_t valuesLength)
+   {
+      size_t size = sizeof(DELAYED_IDATA_INSERT) + valuesLength;
+      return (size + 7) & ~static_cast<size_t>(7);
+   }
+};
+
+/**
+ * Size of single IData writer queue chunk
+ */
+#define IDATA_QUEUE_CHUNK_SIZE   65536
+
+/**
+ * Maximum number of unused chunks kept by IData writer for reuse
+ */
+#define IDATA_QUEUE_MAX_FREE_CHUNKS   16
+
+/**
+ * IData writer queue chunk
+ */
+struct IDataQueueChunk
+{
+   IDataQueueChunk *next;
+   size_t used;
+   size_t count;
+   BYTE data[IDATA_QUEUE_CHUNK_SIZE];
 };
 
 /**
@@ -67,7 +99,17 @@ struct DELAYED_RAW_DATA_UPDATE
 struct IDataWriter
 {
    THREAD thread;
-   ObjectQueue<DELAYED_IDATA_INSERT> *queue;
+   MUTEX mutex;
+   CONDITION wakeup;
+   IDataQueueChunk *head;
+   IDataQueueChunk *tail;
+   IDataQueueChunk *freeChunks;
+   int freeChunkCount;
+   size_t queued;          // records in queue not yet taken by writer thread
+   size_t count;           // all records not yet written to database
+   UINT64 memoryUsage;
+   UINT64 memoryUsagePeak;
+   bool shutdown;
    const TCHAR *storageClass;
 };
 
@@ -81,6 +123,11 @@ struct IDataWriter
  */
 static int s_idataWriterCount = 1;
 
+/**
+ * Maximum number of records per transaction for IData writers
+ */
+static int s_idataMaxRecords = 1000;
+
 /**
  * IData writers
  */
@@ -174,30 +221,108 @@ void NXCORE_EXPORTABLE QueueSQLRequest(const TCHAR *query, int bindCount, int *s
    g_otherWriteRequests++;
 }
 
+/**
+ * Encode DCI value for IData writer queue. Buffer should be at least MAX_RESULT_LENGTH * 4 bytes.
+ * Returns number of bytes used including terminator.
+ */
+static inline size_t EncodeIDataValue(const TCHAR *value, char *buffer)
+{
+   int len = std::min(static_cast<int>(_tcslen(value)), MAX_RESULT_LENGTH - 1);
+#ifdef UNICODE
+   int bytes = WideCharToMultiByte(CP_UTF8, 0, value, len, buffer, MAX_RESULT_LENGTH * 4 - 1, NULL, NULL);
+#else
+   int bytes = static_cast<int>(mb_to_utf8(value, len, buffer, MAX_RESULT_LENGTH * 4 - 1));
+#endif
+   buffer[bytes] = 0;
+   return bytes + 1;
+}
+
+/**
+ * Decode DCI value from IData writer queue. Buffer should be at least MAX_RESULT_LENGTH characters.
+ */
+static inline void DecodeIDataValue(const char *value, TCHAR *buffer)
+{
+#ifdef UNICODE
+   MultiByteToWideChar(CP_UTF8, 0, value, -1, buffer, MAX_RESULT_LENGTH);
+#else
+   utf8_to_mb(value, -1, buffer, MAX_RESULT_LENGTH);
+#endif
+   buffer[MAX_RESULT_LENGTH - 1] = 0;
+}
+
 /**
  * Queue INSERT request for idata_xxx table
  */
 void QueueIDataInsert(time_t timestamp, UINT32 nodeId, UINT32 dciId, const TCHAR *rawValue, const TCHAR *transformedValue, DCObjectStorageClass storageClass)
 {
-	DELAYED_IDATA_INSERT *rq = MemAllocStruct<DELAYED_IDATA_INSERT>();
-	rq->timestamp = timestamp;
-	rq->nodeId = nodeId;
-	rq->dciId = dciId;
-   _tcslcpy(rq->rawValue, rawValue, MAX_RESULT_LENGTH);
-   _tcslcpy(rq->transformedValue, transformedValue, MAX_RESULT_LENGTH);
+   char rawValueUtf8[MAX_RESULT_LENGTH * 4], transformedValueUtf8[MAX_RESULT_LENGTH * 4];
+   size_t rawValueLength = EncodeIDataValue(rawValue, rawValueUtf8);
+   size_t transformedValueLength = EncodeIDataValue(transformedValue, transformedValueUtf8);
+   size_t size = DELAYED_IDATA_INSERT::RecordSize(rawValueLength + transformedValueLength);
+
+   IDataWriter *writer;
    if ((g_flags & AF_SINGLE_TABLE_PERF_DATA) && (g_dbSyntax == DB_SYNTAX_TSDB))
    {
-      s_idataWriters[static_cast<int>(storageClass)].queue->put(rq);
+      writer = &s_idataWriters[static_cast<int>(storageClass)];
    }
    else if (s_idataWriterCount > 1)
    {
-      int hash = nodeId % s_idataWriterCount;
-      s_idataWriters[hash].queue->put(rq);
+      writer = &s_idataWriters[nodeId % s_idataWriterCount];
    }
    else
    {
-      s_idataWriters[0].queue->put(rq);
+      writer = &s_idataWriters[0];
    }
+
+   MutexLock(writer->mutex);
+
+   IDataQueueChunk *chunk = writer->tail;
+   if ((chunk == NULL) || (chunk->used + size > IDATA_QUEUE_CHUNK_SIZE))
+   {
+      if (writer->freeChunks != NULL)
+      {
+         chunk = writer->freeChunks;
+         writer->freeChunks = chunk->next;
+         writer->freeChunkCount--;
+      }
+      else
+      {
+         chunk = static_cast<IDataQueueChunk*>(MemAlloc(sizeof(IDataQueueChunk)));
+         writer->memoryUsage += sizeof(IDataQueueChunk);
+         if (writer->memoryUsage > writer->memoryUsagePeak)
+            writer->memoryUsagePeak = writer->memoryUsage;
+      }
+      chunk->next = NULL;
+      chunk->used = 0;
+      chunk->count = 0;
+      if (writer->tail != NULL)
+         writer->tail->next = chunk;
+      else
+         writer->head = chunk;
+      writer->tail = chunk;
+   }
+
+   DELAYED_IDATA_INSERT *rq = reinterpret_cast<DELAYED_IDATA_INSERT*>(&chunk->data[chunk->used]);
+   rq->timestamp = timestamp;
+   rq->nodeId = nodeId;
+   rq->dciId = dciId;
+   rq->rawValueLength = static_cast<UINT16>(rawValueLength);
+   rq->transformedValueLength = static_cast<UINT16>(transformedValueLength);
+   memcpy(const_cast<char*>(rq->rawValue()), rawValueUtf8, rawValueLength);
+   memcpy(const_cast<char*>(rq->transformedValue()), transformedValueUtf8, transformedValueLength);
+   chunk->used += size;
+   chunk->count++;
+
+   writer->count++;
+   writer->queued++;
+   // Wake up writer on first record and then once more when full batch becomes available
+   // (queue counter grows by one and is reset when writer takes records, so it crosses threshold exactly once)
+   bool wakeup = (writer->queued == 1) || (writer->queued == static_cast<size_t>(s_idataMaxRecords));
+
+   MutexUnlock(writer->mutex);
+
+   if (wakeup)
+      ConditionSet(writer->wakeup);
 	g_idataWriteRequests++;
 }
 
@@ -282,271 +407,302 @@ static THREAD_RESULT THREAD_CALL DBWriteThread(void *arg)
 }
 
 /**
- * Database "lazy" write thread for idata_xxx INSERTs
+ * Column list for idata INSERTs
  */
-static THREAD_RESULT THREAD_CALL IDataWriteThread(void *arg)
-{
-   ThreadSetName("DBWriter/IData");
-   IDataWriter *writer = static_cast<IDataWriter*>(arg);
-   int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
-   while(true)
-   {
-		DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
+static const TCHAR *s_idataColumns = _T("item_id,idata_timestamp,idata_value,raw_value");
+static int s_idataColumnTypes[] = { DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER, DB_SQLTYPE_VARCHAR, DB_SQLTYPE_VARCHAR };
 
-      DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-		if (DBBegin(hdb))
-		{
-			int count = 0;
-			while(true)
-			{
-				bool success;
-
-				// For Oracle preparing statement even for one time execution is preferred
-				// For other databases it will actually slow down inserts
-				if (g_dbSyntax == DB_SYNTAX_ORACLE)
-				{
-	            TCHAR query[256];
-               _sntprintf(query, 256, _T("INSERT INTO idata_%d (item_id,idata_timestamp,idata_value,raw_value) VALUES (?,?,?,?)"), (int)rq->nodeId);
-               DB_STATEMENT hStmt = DBPrepare(hdb, query);
-               if (hStmt != NULL)
-               {
-                  DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, rq->dciId);
-                  DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, (INT64)rq->timestamp);
-                  DBBind(hStmt, 3, DB_SQLTYPE_VARCHAR, rq->transformedValue, DB_BIND_STATIC);
-                  DBBind(hStmt, 4, DB_SQLTYPE_VARCHAR, rq->rawValue, DB_BIND_STATIC);
-                  success = DBExecute(hStmt);
-                  DBFreeStatement(hStmt);
-               }
-               else
-               {
-                  success = false;
-               }
-				}
-				else
-				{
-               TCHAR query[1024];
-               _sntprintf(query, 1024, _T("INSERT INTO idata_%d (item_id,idata_timestamp,idata_value,raw_value) VALUES (%d,%d,%s,%s)"),
-                          (int)rq->nodeId, (int)rq->dciId, (int)rq->timestamp,
-                          (const TCHAR *)DBPrepareString(hdb, rq->transformedValue),
-                          (const TCHAR *)DBPrepareString(hdb, rq->rawValue));
-               success = DBQuery(hdb, query);
-				}
+/**
+ * Wait for idata INSERT requests in writer queue. Blocks until at least one
+ * request is available, then waits up to 500 milliseconds for full batch.
+ * Returns all queued chunks detached from writer queue.
+ */
+static IDataQueueChunk *WaitForIDataRecords(IDataWriter *writer, bool *shutdown)
+{
+   ConditionWait(writer->wakeup, INFINITE);
+
+   MutexLock(writer->mutex);
+   bool wait = !writer->shutdown && (writer->queued < static_cast<size_t>(s_idataMaxRecords));
+   MutexUnlock(writer->mutex);
+   if (wait)
+      ConditionWait(writer->wakeup, 500);
+
+   MutexLock(writer->mutex);
+   IDataQueueChunk *chain = writer->head;
+   writer->head = NULL;
+   writer->tail = NULL;
+   writer->queued = 0;
+   *shutdown = writer->shutdown;
+   MutexUnlock(writer->mutex);
+   return chain;
+}
 
-				MemFree(rq);
+/**
+ * Read next batch of idata INSERT requests from detached chunk chain. Whole chunks are
+ * added to batch until it contains at least maxRecords records, so batch array should have room for
+ * maxRecords + IDATA_QUEUE_CHUNK_SIZE / sizeof(DELAYED_IDATA_INSERT) elements.
+ * Returns first chunk not included into batch.
+ */
+static IDataQueueChunk *ReadIDataBatch(IDataQueueChunk *chain, DELAYED_IDATA_INSERT **batch, int maxRecords, int *count)
+{
+   *count = 0;
+   IDataQueueChunk *chunk = chain;
+   while((chunk != NULL) && (*count < maxRecords))
+   {
+      size_t offset = 0;
+      for(size_t i = 0; i < chunk->count; i++)
+      {
+         DELAYED_IDATA_INSERT *rq = reinterpret_cast<DELAYED_IDATA_INSERT*>(&chunk->data[offset]);
+         batch[(*count)++] = rq;
+         offset += rq->size();
+      }
+      chunk = chunk->next;
+   }
+   return chunk;
+}
 
-				count++;
-				if (!success || (count > maxRecords))
-					break;
+/**
+ * Return processed chunks to writer
+ */
+static void ReleaseIDataChunks(IDataWriter *writer, IDataQueueChunk *chain, IDataQueueChunk *end, int count)
+{
+   MutexLock(writer->mutex);
+   while(chain != end)
+   {
+      IDataQueueChunk *next = chain->next;
+      if (writer->freeChunkCount < IDATA_QUEUE_MAX_FREE_CHUNKS)
+      {
+         chain->next = writer->freeChunks;
+         writer->freeChunks = chain;
+         writer->freeChunkCount++;
+      }
+      else
+      {
+         MemFree(chain);
+         writer->memoryUsage -= sizeof(IDataQueueChunk);
+      }
+      chain = next;
+   }
+   writer->count -= count;
+   MutexUnlock(writer->mutex);
+}
 
-				rq = writer->queue->getOrBlock(500);
-				if ((rq == NULL) || (rq == INVALID_POINTER_VALUE))
-					break;
-			}
-			DBCommit(hdb);
-		}
-		else
-		{
-			MemFree(rq);
-		}
-		DBConnectionPoolReleaseConnection(hdb);
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
-	}
+/**
+ * Allocate batch array for IData writer
+ */
+static inline DELAYED_IDATA_INSERT **AllocateIDataBatch()
+{
+   return MemAllocArrayNoInit<DELAYED_IDATA_INSERT*>(s_idataMaxRecords + IDATA_QUEUE_CHUNK_SIZE / sizeof(DELAYED_IDATA_INSERT));
+}
 
-   return THREAD_OK;
+/**
+ * Add idata INSERT request to bulk insert
+ */
+static bool AddIDataRow(DB_BULK_INSERT hBulk, DELAYED_IDATA_INSERT *rq)
+{
+   TCHAR dciId[16], timestamp[32], rawValue[MAX_RESULT_LENGTH], transformedValue[MAX_RESULT_LENGTH];
+   _sntprintf(dciId, 16, _T("%u"), rq->dciId);
+   _sntprintf(timestamp, 32, INT64_FMT, static_cast<INT64>(rq->timestamp));
+   DecodeIDataValue(rq->rawValue(), rawValue);
+   DecodeIDataValue(rq->transformedValue(), transformedValue);
+   const TCHAR *values[4] = { dciId, timestamp, transformedValue, rawValue };
+   return DBBulkInsertAddRow(hBulk, values);
 }
 
 /**
- * Database "lazy" write thread for idata INSERTs - generic version
+ * Stream idata INSERT requests into given table using bulk insert
  */
-static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Generic(void *arg)
+static bool BulkInsertIDataRows(DB_HANDLE hdb, const TCHAR *table, DELAYED_IDATA_INSERT **rows, int count, bool ignoreDuplicates)
 {
-   ThreadSetName("DBWriter/IData");
-   IDataWriter *writer = static_cast<IDataWriter*>(arg);
-   int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
+   DB_BULK_INSERT hBulk = DBBulkInsertBegin(hdb, table, s_idataColumns, 4, s_idataColumnTypes, ignoreDuplicates);
+   if (hBulk == NULL)
+      return false;
+
+   bool success = true;
+   for(int i = 0; (i < count) && success; i++)
+      success = AddIDataRow(hBulk, rows[i]);
+   if (!DBBulkInsertEnd(hBulk))
+      success = false;
+   return success;
+}
 
-   TCHAR query[1024];
-   while(true)
+/**
+ * Insert idata records one by one outside of transaction, so that record rejected
+ * by database does not affect other records. Returns number of records stored.
+ */
+static int InsertIDataRows(DB_HANDLE hdb, const TCHAR *table, DELAYED_IDATA_INSERT **rows, int count, bool ignoreDuplicates)
+{
+   TCHAR query[256];
+   _sntprintf(query, 256, _T("INSERT INTO %s (%s) VALUES (?,?,?,?)%s"), table, s_idataColumns,
+            ignoreDuplicates ? _T(" ON CONFLICT DO NOTHING") : _T(""));
+   DB_STATEMENT hStmt = DBPrepare(hdb, query, count > 1);
+   if (hStmt == NULL)
+      return 0;
+
+   int stored = 0;
+   TCHAR rawValue[MAX_RESULT_LENGTH], transformedValue[MAX_RESULT_LENGTH];
+   for(int i = 0; i < count; i++)
    {
-      DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
+      DELAYED_IDATA_INSERT *rq = rows[i];
+      DecodeIDataValue(rq->rawValue(), rawValue);
+      DecodeIDataValue(rq->transformedValue(), transformedValue);
+      DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, rq->dciId);
+      DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, static_cast<INT64>(rq->timestamp));
+      DBBind(hStmt, 3, DB_SQLTYPE_VARCHAR, transformedValue, DB_BIND_STATIC);
+      DBBind(hStmt, 4, DB_SQLTYPE_VARCHAR, rawValue, DB_BIND_STATIC);
+      if (DBExecute(hStmt))
+         stored++;
+   }
+   DBFreeStatement(hStmt);
+   return stored;
+}
 
-      DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-      if (DBBegin(hdb))
+/**
+ * Write group of idata records into single table in separate transaction. If bulk insert
+ * fails, transaction is rolled back and records are inserted one by one, so only records
+ * rejected by database are lost. Returns number of records stored.
+ */
+static int WriteIDataGroup(DB_HANDLE hdb, const TCHAR *table, DELAYED_IDATA_INSERT **rows, int count, bool ignoreDuplicates)
+{
+   if (DBBegin(hdb))
+   {
+      if (BulkInsertIDataRows(hdb, table, rows, count, ignoreDuplicates))
       {
-         int count = 0;
-         while(true)
-         {
-            _sntprintf(query, 1024, _T("INSERT INTO idata (item_id,idata_timestamp,idata_value,raw_value) VALUES (%d,%d,%s,%s)"),
-                       (int)rq->dciId, (int)rq->timestamp,
-                       (const TCHAR *)DBPrepareString(hdb, rq->transformedValue),
-                       (const TCHAR *)DBPrepareString(hdb, rq->rawValue));
-            bool success = DBQuery(hdb, query);
-
-            MemFree(rq);
-
-            count++;
-            if (!success || (count > maxRecords))
-               break;
-
-            rq = writer->queue->getOrBlock(500);
-            if ((rq == NULL) || (rq == INVALID_POINTER_VALUE))
-               break;
-         }
-         DBCommit(hdb);
+         if (DBCommit(hdb))
+            return count;
       }
       else
       {
-         MemFree(rq);
+         DBRollback(hdb);
       }
-      DBConnectionPoolReleaseConnection(hdb);
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
    }
 
-   return THREAD_OK;
+   nxlog_debug_tag(DEBUG_TAG, 4, _T("Bulk insert of %d records into %s failed, inserting records one by one"), count, table);
+   int stored = InsertIDataRows(hdb, table, rows, count, ignoreDuplicates);
+   if (stored < count)
+      nxlog_debug_tag(DEBUG_TAG, 3, _T("%d of %d records were not written into %s"), count - stored, count, table);
+   return stored;
 }
 
 /**
- * Database "lazy" write thread for idata INSERTs - PostgreSQL version
+ * Compare idata INSERT requests by node ID
  */
-static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_PostgreSQL(void *arg)
+static int CompareIDataRequestsByNode(const void *e1, const void *e2)
 {
-   ThreadSetName("DBWriter/IData");
-   IDataWriter *writer = static_cast<IDataWriter*>(arg);
-
-   TCHAR queryBase[256];
-   if (writer->storageClass != NULL)
-      _sntprintf(queryBase, 256, _T("INSERT INTO idata_sc_%s (item_id,idata_timestamp,idata_value,raw_value) VALUES"), writer->storageClass);
-   else
-      _tcscpy(queryBase, _T("INSERT INTO idata (item_id,idata_timestamp,idata_value,raw_value) VALUES"));
-
-   int maxRecordsPerTxn = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
-   int maxRecordsPerStmt = ConfigReadInt(_T("DBWriter.MaxRecordsPerStatement"), 100);
-
-   StringBuffer query;
-   query.setAllocationStep(65536);
+   UINT32 n1 = (*static_cast<DELAYED_IDATA_INSERT* const*>(e1))->nodeId;
+   UINT32 n2 = (*static_cast<DELAYED_IDATA_INSERT* const*>(e2))->nodeId;
+   return (n1 < n2) ? -1 : ((n1 > n2) ? 1 : 0);
+}
 
-   TCHAR data[1024];
+/**
+ * Get size of group of idata requests for same node starting at given position
+ */
+static inline int GetIDataGroupSize(DELAYED_IDATA_INSERT **batch, int start, int count)
+{
+   int end = start + 1;
+   while((end < count) && (batch[end]->nodeId == batch[start]->nodeId))
+      end++;
+   return end - start;
+}
 
-   while(true)
+/**
+ * Database "lazy" write thread for idata_xxx INSERTs
+ */
+static THREAD_RESULT THREAD_CALL IDataWriteThread(void *arg)
+{
+   ThreadSetName("DBWriter/IData");
+   IDataWriter *writer = static_cast<IDataWriter*>(arg);
+   DELAYED_IDATA_INSERT **batch = AllocateIDataBatch();
+   bool shutdown = false;
+   while(!shutdown)
    {
-      DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
-
-      DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-      if (DBBegin(hdb))
+      IDataQueueChunk *chain = WaitForIDataRecords(writer, &shutdown);
+      while(chain != NULL)
       {
-         query = queryBase;
-         int countTxn = 0, countStmt = 0;
-         while(true)
+         int count;
+         IDataQueueChunk *next = ReadIDataBatch(chain, batch, s_idataMaxRecords, &count);
+
+         // Group requests by target table
+         qsort(batch, count, sizeof(DELAYED_IDATA_INSERT*), CompareIDataRequestsByNode);
+
+         // Write all tables in one transaction, and if it fails, write
+         // each table in separate transaction so that failure on one table
+         // (for example, missing table for deleted node) does not affect others
+         DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+         bool success = false;
+         if (DBBegin(hdb))
          {
-            _sntprintf(data, 1024, _T("%c(%u,%u,%s,%s)"),
-                       (countStmt > 0) ? _T(',') : _T(' '),
-                       rq->dciId, (unsigned int)rq->timestamp,
-                       (const TCHAR *)DBPrepareString(hdb, rq->transformedValue),
-                       (const TCHAR *)DBPrepareString(hdb, rq->rawValue));
-            query.append(data);
-            MemFree(rq);
-
-            countTxn++;
-            countStmt++;
-
-            if (countStmt >= maxRecordsPerStmt)
+            success = true;
+            for(int i = 0; (i < count) && success;)
             {
-               countStmt = 0;
-               query.append(_T(" ON CONFLICT DO NOTHING"));
-               if (!DBQuery(hdb, query))
-                  break;
-               query = queryBase;
+               int groupSize = GetIDataGroupSize(batch, i, count);
+               TCHAR table[64];
+               _sntprintf(table, 64, _T("idata_%u"), batch[i]->nodeId);
+               success = BulkInsertIDataRows(hdb, table, &batch[i], groupSize, false);
+               i += groupSize;
             }
-
-            if (countTxn >= maxRecordsPerTxn)
-               break;
-
-            rq = writer->queue->getOrBlock(500);
-            if ((rq == NULL) || (rq == INVALID_POINTER_VALUE))
-               break;
+            if (success)
+               success = DBCommit(hdb);
+            else
+               DBRollback(hdb);
          }
-         if (countStmt > 0)
+         if (!success)
          {
-            query.append(_T(" ON CONFLICT DO NOTHING"));
-            DBQuery(hdb, query);
+            for(int i = 0; i < count;)
+            {
+               int groupSize = GetIDataGroupSize(batch, i, count);
+               TCHAR table[64];
+               _sntprintf(table, 64, _T("idata_%u"), batch[i]->nodeId);
+               WriteIDataGroup(hdb, table, &batch[i], groupSize, false);
+               i += groupSize;
+            }
          }
-         DBCommit(hdb);
-      }
-      else
-      {
-         MemFree(rq);
+         DBConnectionPoolReleaseConnection(hdb);
+
+         ReleaseIDataChunks(writer, chain, next, count);
+         chain = next;
       }
-      DBConnectionPoolReleaseConnection(hdb);
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
    }
-
+   MemFree(batch);
    return THREAD_OK;
 }
 
 /**
- * Database "lazy" write thread for idata INSERTs - Oracle version
+ * Database "lazy" write thread for idata INSERTs - single table version
  */
-static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable_Oracle(void *arg)
+static THREAD_RESULT THREAD_CALL IDataWriteThreadSingleTable(void *arg)
 {
    ThreadSetName("DBWriter/IData");
    IDataWriter *writer = static_cast<IDataWriter*>(arg);
-   int maxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
-   while(true)
-   {
-      DELAYED_IDATA_INSERT *rq = writer->queue->getOrBlock();
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
 
-      DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-      if (DBBegin(hdb))
-      {
-         int count = 0;
-         DB_STATEMENT hStmt = DBPrepare(hdb, _T("INSERT INTO idata (item_id,idata_timestamp,idata_value,raw_value) VALUES (?,?,?,?)"));
-         if (hStmt != NULL)
-         {
-            while(true)
-            {
-               DBBind(hStmt, 1, DB_SQLTYPE_INTEGER, rq->dciId);
-               DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, (INT64)rq->timestamp);
-               DBBind(hStmt, 3, DB_SQLTYPE_VARCHAR, rq->transformedValue, DB_BIND_STATIC);
-               DBBind(hStmt, 4, DB_SQLTYPE_VARCHAR, rq->rawValue, DB_BIND_STATIC);
-               bool success = DBExecute(hStmt);
+   TCHAR table[64];
+   if (writer->storageClass != NULL)
+      _sntprintf(table, 64, _T("idata_sc_%s"), writer->storageClass);
+   else
+      _tcscpy(table, _T("idata"));
 
-               MemFree(rq);
+   // PostgreSQL and TimescaleDB writers skip duplicate records instead of failing whole batch
+   bool ignoreDuplicates = (g_dbSyntax == DB_SYNTAX_PGSQL) || (g_dbSyntax == DB_SYNTAX_TSDB);
 
-               count++;
-               if (!success || (count > maxRecords))
-                  break;
-
-               rq = writer->queue->getOrBlock(500);
-               if ((rq == NULL) || (rq == INVALID_POINTER_VALUE))
-                  break;
-            }
-            DBFreeStatement(hStmt);
-         }
-         else
-         {
-            MemFree(rq);
-         }
-         DBCommit(hdb);
-      }
-      else
+   DELAYED_IDATA_INSERT **batch = AllocateIDataBatch();
+   bool shutdown = false;
+   while(!shutdown)
+   {
+      IDataQueueChunk *chain = WaitForIDataRecords(writer, &shutdown);
+      while(chain != NULL)
       {
-         MemFree(rq);
+         int count;
+         IDataQueueChunk *next = ReadIDataBatch(chain, batch, s_idataMaxRecords, &count);
+
+         DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+         WriteIDataGroup(hdb, table, batch, count, ignoreDuplicates);
+         DBConnectionPoolReleaseConnection(hdb);
+
+         ReleaseIDataChunks(writer, chain, next, count);
+         chain = next;
       }
-      DBConnectionPoolReleaseConnection(hdb);
-      if (rq == INVALID_POINTER_VALUE)   // End-of-job indicator
-         break;
    }
-
+   MemFree(batch);
    return THREAD_OK;
 }
 
@@ -652,6 +808,24 @@ static THREAD_RESULT THREAD_CALL RawDataWriteThread(void *arg)
    return THREAD_OK;
 }
 
+/**
+ * Initialize IData writer
+ */
+static void InitIDataWriter(IDataWriter *writer)
+{
+   writer->mutex = MutexCreateFast();
+   writer->wakeup = ConditionCreate(false);
+   writer->head = NULL;
+   writer->tail = NULL;
+   writer->freeChunks = NULL;
+   writer->freeChunkCount = 0;
+   writer->queued = 0;
+   writer->count = 0;
+   writer->memoryUsage = 0;
+   writer->memoryUsagePeak = 0;
+   writer->shutdown = false;
+}
+
 /**
  * Start writer thread
  */
@@ -660,35 +834,29 @@ void StartDBWriter()
    s_writerThread = ThreadCreateEx(DBWriteThread, 0, NULL);
 	s_rawDataWriterThread = ThreadCreateEx(RawDataWriteThread, 0, NULL);
 
+   s_idataMaxRecords = ConfigReadInt(_T("DBWriter.MaxRecordsPerTransaction"), 1000);
+   if (s_idataMaxRecords < 1)
+      s_idataMaxRecords = 1;
+
 	if (g_flags & AF_SINGLE_TABLE_PERF_DATA)
 	{
 	   // Always use single writer if performance data stored in single table
-      switch(g_dbSyntax)
+	   // (except TimescaleDB where each storage class has its own table)
+      if (g_dbSyntax == DB_SYNTAX_TSDB)
       {
-         case DB_SYNTAX_ORACLE:
-            s_idataWriters[0].storageClass = NULL;
-            s_idataWriters[0].queue = new ObjectQueue<DELAYED_IDATA_INSERT>();
-            s_idataWriters[0].thread = ThreadCreateEx(IDataWriteThreadSingleTable_Oracle, 0, &s_idataWriters[0]);
-            break;
-         case DB_SYNTAX_PGSQL:
-            s_idataWriters[0].storageClass = NULL;
-            s_idataWriters[0].queue = new ObjectQueue<DELAYED_IDATA_INSERT>();
-            s_idataWriters[0].thread = ThreadCreateEx(IDataWriteThreadSingleTable_PostgreSQL, 0, &s_idataWriters[0]);
-            break;
-         case DB_SYNTAX_TSDB:
-            s_idataWriterCount = static_cast<int>(DCObjectStorageClass::OTHER) + 1;
-            for(int i = 0; i < s_idataWriterCount; i++)
-            {
-               s_idataWriters[i].storageClass = DCObject::getStorageClassName(static_cast<DCObjectStorageClass>(i));
-               s_idataWriters[i].queue = new ObjectQueue<DELAYED_IDATA_INSERT>();
-               s_idataWriters[i].thread = ThreadCreateEx(IDataWriteThreadSingleTable_PostgreSQL, 0, &s_idataWriters[i]);
-            }
-            break;
-         default:
-            s_idataWriters[0].storageClass = NULL;
-            s_idataWriters[0].queue = new ObjectQueue<DELAYED_IDATA_INSERT>();
-            s_idataWriters[0].thread = ThreadCreateEx(IDataWriteThreadSingleTable_Generic, 0, &s_idataWriters[0]);
-            break;
+         s_idataWriterCount = static_cast<int>(DCObjectStorageClass::OTHER) + 1;
+         for(int i = 0; i < s_idataWriterCount; i++)
+         {
+            s_idataWriters[i].storageClass = DCObject::getStorageClassName(static_cast<DCObjectStorageClass>(i));
+            InitIDataWriter(&s_idataWriters[i]);
+            s_idataWriters[i].thread = ThreadCreateEx(IDataWriteThreadSingleTable, 0, &s_idataWriters[i]);
+         }
+      }
+      else
+      {
+         s_idataWriters[0].storageClass = NULL;
+         InitIDataWriter(&s_idataWriters[0]);
+         s_idataWriters[0].thread = ThreadCreateEx(IDataWriteThreadSingleTable, 0, &s_idataWriters[0]);
       }
 	}
 	else
@@ -702,7 +870,7 @@ void StartDBWriter()
       for(int i = 0; i < s_idataWriterCount; i++)
       {
          s_idataWriters[i].storageClass = NULL;
-         s_idataWriters[i].queue = new ObjectQueue<DELAYED_IDATA_INSERT>();
+         InitIDataWriter(&s_idataWriters[i]);
          s_idataWriters[i].thread = ThreadCreateEx(IDataWriteThread, 0, &s_idataWriters[i]);
       }
 	}
@@ -717,9 +885,23 @@ void StopDBWriter()
    ThreadJoin(s_writerThread);
    for(int i = 0; i < s_idataWriterCount; i++)
    {
-      s_idataWriters[i].queue->put(INVALID_POINTER_VALUE);
-      ThreadJoin(s_idataWriters[i].thread);
-      delete s_idataWriters[i].queue;
+      IDataWriter *writer = &s_idataWriters[i];
+      MutexLock(writer->mutex);
+      writer->shutdown = true;
+      MutexUnlock(writer->mutex);
+      ConditionSet(writer->wakeup);
+      ThreadJoin(writer->thread);
+
+      while(writer->freeChunks != NULL)
+      {
+         IDataQueueChunk *next = writer->freeChunks->next;
+         MemFree(writer->freeChunks);
+         writer->freeChunks = next;
+      }
+      writer->freeChunkCount = 0;
+      writer->memoryUsage = 0;
+      MutexDestroy(writer->mutex);
+      ConditionDestroy(writer->wakeup);
    }
    ThreadJoin(s_rawDataWriterThread);
    nxlog_debug_tag(DEBUG_TAG, 1, _T("All background database writers stopped"));
@@ -732,10 +914,42 @@ INT64 GetIDataWriterQueueSize()
 {
    size_t size = 0;
    for(int i = 0; i < s_idataWriterCount; i++)
-      size += s_idataWriters[i].queue->size();
+   {
+      MutexLock(s_idataWriters[i].mutex);
+      size += s_idataWriters[i].count;
+      MutexUnlock(s_idataWriters[i].mutex);
+   }
    return size;
 }
 
+/**
+ * Get memory consumption by IData writer queues
+ */
+UINT64 GetIDataWriterMemoryUsage()
+{
+   UINT64 size = 0;
+   for(int i = 0; i < s_idataWriterCount; i++)
+   {
+      MutexLock(s_idataWriters[i].mutex);
+      size += s_idataWriters[i].memoryUsage;
+      MutexUnlock(s_idataWriters[i].mutex);
+   }
+   return size;
+}
+
+/**
+ * Get peak memory consumption by given IData writer queue. Returns false if queue index is invalid.
+ */
+bool GetIDataWriterMemoryUsagePeak(int queue, UINT64 *value)
+{
+   if ((queue < 0) || (queue >= s_idataWriterCount))
+      return false;
+   MutexLock(s_idataWriters[queue].mutex);
+   *value = s_idataWriters[queue].memoryUsagePeak;
+   MutexUnlock(s_idataWriters[queue].mutex);
+   return true;
+}
+
 /**
  * Get size of raw data writer queue
  */
@@ -40,18 +40,9 @@ DCItem::DCItem(const DCItem *src, bool shadowCopy) : DCObject(src, shadowCopy)
    m_dataType = src->m_dataType;
    m_deltaCalculation = src->m_deltaCalculation;
 	m_sampleCount = src->m_sampleCount;
-   m_cacheSize = shadowCopy ? src->m_cacheSize : 0;
    m_requiredCacheSize = shadowCopy ? src->m_requiredCacheSize : 0;
-   if (m_cacheSize > 0)
-   {
-      m_ppValueCache = MemAllocArray<ItemValue*>(m_cacheSize);
-      for(UINT32 i = 0; i < m_cacheSize; i++)
-         m_ppValueCache[i] = new ItemValue(src->m_ppValueCache[i]);
-   }
-   else
-   {
-      m_ppValueCache = NULL;
-   }
+   if (shadowCopy)
+      m_valueCache.copyFrom(src->m_valueCache);
    m_tPrevValueTimeStamp = shadowCopy ? src->m_tPrevValueTimeStamp : 0;
    m_bCacheLoaded = shadowCopy ? src->m_bCacheLoaded : false;
 	m_nBaseUnits = src->m_nBaseUnits;
@@ -108,9 +99,7 @@ DCItem::DCItem(DB_HANDLE hdb, DB_RESULT hResult, int row, DataCollectionOwner *o
    m_instance = DBGetField(hResult, row, 11, readBuffer, 4096);
    m_dwTemplateItemId = DBGetFieldULong(hResult, row, 12);
    m_thresholds = NULL;
-   m_cacheSize = 0;
    m_requiredCacheSize = 0;
-   m_ppValueCache = NULL;
    m_tPrevValueTimeStamp = 0;
    m_bCacheLoaded = false;
    m_flags = (WORD)DBGetFieldLong(hResult, row, 13);
@@ -180,9 +169,7 @@ DCItem::DCItem(UINT32 id, const TCHAR *name, int source, int dataType,
    m_deltaCalculation = DCM_ORIGINAL_VALUE;
 	m_sampleCount = 0;
    m_thresholds = NULL;
-   m_cacheSize = 0;
    m_requiredCacheSize = 0;
-   m_ppValueCache = NULL;
    m_tPrevValueTimeStamp = 0;
    m_bCacheLoaded = false;
 	m_nBaseUnits = DCI_BASEUNITS_OTHER;
@@ -202,9 +189,7 @@ DCItem::DCItem(ConfigEntry *config, DataCollectionOwner *owner) : DCObject(confi
    m_dataType = (BYTE)config->getSubEntryValueAsInt(_T("dataType"));
    m_deltaCalculation = (BYTE)config->getSubEntryValueAsInt(_T("delta"));
    m_sampleCount = (BYTE)config->getSubEntryValueAsInt(_T("samples"));
-   m_cacheSize = 0;
    m_requiredCacheSize = 0;
-   m_ppValueCache = NULL;
    m_tPrevValueTimeStamp = 0;
    m_bCacheLoaded = false;
 	m_nBaseUnits = DCI_BASEUNITS_OTHER;
@@ -263,11 +248,7 @@ void DCItem::deleteAllThresholds()
  */
 void DCItem::clearCache()
 {
-   for(UINT32 i = 0; i < m_cacheSize; i++)
-      delete m_ppValueCache[i];
-   MemFree(m_ppValueCache);
-   m_ppValueCache = NULL;
-   m_cacheSize = 0;
+   m_valueCache.resize(0);
 }
 
 /**
@@ -438,7 +419,7 @@ void DCItem::checkThresholds(ItemValue &value)
    {
 		Threshold *t = m_thresholds->get(i);
       ItemValue checkValue, thresholdValue;
-      ThresholdCheckResult result = t->check(value, m_ppValueCache, checkValue, thresholdValue, m_owner, this);
+      ThresholdCheckResult result = t->check(value, m_valueCache, checkValue, thresholdValue, m_owner, this);
       t->setLastCheckedValue(checkValue);
       switch(result)
       {
@@ -658,8 +639,6 @@ void DCItem::updateFromMessage(NXCPMessage *pMsg, UINT32 *pdwNumMaps, UINT32 **p
  */
 bool DCItem::processNewValue(time_t tmTimeStamp, void *originalValue, bool *updateStatus)
 {
-   ItemValue rawValue, *pValue;
-
    lock();
 
    // Normally m_owner shouldn't be NULL for polled items, but who knows...
@@ -670,26 +649,25 @@ bool DCItem::processNewValue(time_t tmTimeStamp, void *originalValue, bool *upda
    }
 
    // Create new ItemValue object and transform it as needed
-   pValue = new ItemValue(static_cast<TCHAR*>(originalValue), tmTimeStamp);
+   ItemValue value(static_cast<TCHAR*>(originalValue), tmTimeStamp);
    if (m_tPrevValueTimeStamp == 0)
-      m_prevRawValue = *pValue;  // Delta should be zero for first poll
-   rawValue = *pValue;
+      m_prevRawValue = value;  // Delta should be zero for first poll
+   ItemValue rawValue = value;
 
    // Cluster can have only aggregated data, and transformation
    // should not be used on aggregation
    if ((m_owner->getObjectClass() != OBJECT_CLUSTER) || (m_flags & DCF_TRANSFORM_AGGREGATED))
    {
-      if (!transform(*pValue, (tmTimeStamp > m_tPrevValueTimeStamp) ? (tmTimeStamp - m_tPrevValueTimeStamp) : 0))
+      if (!transform(value, (tmTimeStamp > m_tPrevValueTimeStamp) ? (tmTimeStamp - m_tPrevValueTimeStamp) : 0))
       {
          unlock();
-         delete pValue;
          return false;
       }
    }
 
    m_dwErrorCount = 0;
 
-   if (isStatusDCO() && (tmTimeStamp > m_tPrevValueTimeStamp) && ((m_cacheSize == 0) || !m_bCacheLoaded || ((UINT32)*pValue != (UINT32)*m_ppValueCache[0])))
+   if (isStatusDCO() && (tmTimeStamp > m_tPrevValueTimeStamp) && ((m_valueCache.size() == 0) || !m_bCacheLoaded || ((UINT32)value != m_valueCache.getUInt32(0))))
    {
       *updateStatus = true;
    }
@@ -704,17 +682,17 @@ bool DCItem::processNewValue(time_t tmTimeStamp, void *originalValue, bool *upda
       m_tPrevValueTimeStamp = tmTimeStamp;
 
       // Save raw value into database
-      QueueRawDciDataUpdate(tmTimeStamp, m_id, static_cast<TCHAR*>(originalValue), pValue->getString());
+      QueueRawDciDataUpdate(tmTimeStamp, m_id, static_cast<TCHAR*>(originalValue), value.getString());
    }
 
 	// Save transformed value to database
    if (m_retentionType != DC_RETENTION_NONE)
-	   QueueIDataInsert(tmTimeStamp, m_owner->getId(), m_id, static_cast<TCHAR*>(originalValue), pValue->getString(), getStorageClass());
+	   QueueIDataInsert(tmTimeStamp, m_owner->getId(), m_id, static_cast<TCHAR*>(originalValue), value.getString(), getStorageClass());
    if (g_flags & AF_PERFDATA_STORAGE_DRIVER_LOADED)
-      PerfDataStorageRequest(this, tmTimeStamp, pValue->getString());
+      PerfDataStorageRequest(this, tmTimeStamp, value.getString());
 
 #ifdef WITH_ZMQ
-   ZmqPublishData(m_owner->getId(), m_id, m_name, pValue->getString());
+   ZmqPublishData(m_owner->getId(), m_id, m_name, value.getString());
 #endif
 
    // Update prediction engine
@@ -722,7 +700,7 @@ bool DCItem::processNewValue(time_t tmTimeStamp, void *originalValue, bool *upda
    {
       PredictionEngine *engine = FindPredictionEngine(m_predictionEngine);
       if (engine != NULL)
-         engine->update(m_owner->getId(), m_id, getStorageClass(), tmTimeStamp, pValue->getDouble());
+         engine->update(m_owner->getId(), m_id, getStorageClass(), tmTimeStamp, value.getDouble());
    }
 
    // Check thresholds and add value to cache
@@ -735,7 +713,7 @@ bool DCItem::processNewValue(time_t tmTimeStamp, void *originalValue, bool *upda
          // to avoid possible server deadlock if script causes agent reconnect
          DCItem *shadowCopy = new DCItem(this, true);
          unlock();
-         shadowCopy->checkThresholds(*pValue);
+         shadowCopy->checkThresholds(value);
          lock();
 
          // Reconcile threshold updates
@@ -753,36 +731,22 @@ bool DCItem::processNewValue(time_t tmTimeStamp, void *originalValue, bool *upda
       }
       else
       {
-         checkThresholds(*pValue);
+         checkThresholds(value);
       }
    }
 
-   if ((m_cacheSize > 0) && (tmTimeStamp >= m_tPrevValueTimeStamp))
+   if ((m_valueCache.size() > 0) && (tmTimeStamp >= m_tPrevValueTimeStamp))
    {
-      delete m_ppValueCache[m_cacheSize - 1];
-      memmove(&m_ppValueCache[1], m_ppValueCache, sizeof(ItemValue *) * (m_cacheSize - 1));
-      m_ppValueCache[0] = pValue;
+      m_valueCache.add(value, m_dataType);
    }
    else if (!m_bCacheLoaded && (m_requiredCacheSize == 1))
    {
       // If required cache size is 1 and we got value before cache loader
       // loads DCI cache then update it directly
-      for(UINT32 i = 0; i < m_cacheSize; i++)
-         delete m_ppValueCache[i];
-
-      if (m_cacheSize != m_requiredCacheSize)
-      {
-         m_ppValueCache = MemReallocArray(m_ppValueCache, m_requiredCacheSize);
-         m_cacheSize = m_requiredCacheSize;
-      }
-
-      m_ppValueCache[0] = pValue;
+      m_valueCache.reset(m_requiredCacheSize, m_dataType);
+      m_valueCache.add(value, m_dataType);
       m_bCacheLoaded = true;
    }
-   else
-   {
-      delete pValue;
-   }
 
    unlock();
 
@@ -892,14 +856,14 @@ void DCItem::generateEventsBasedOnThrDiff()
             PostDciEventWithNames(t->getEventCode(), m_owner->getId(), m_id, "ssssisds",
                               s_paramNamesReach, m_name.cstr(), m_description.cstr(), t->getStringValue(),
                               t->getLastCheckValue().getString(), m_id, m_instance.cstr(), 0,
-                              (m_bCacheLoaded && (m_cacheSize > 0)) ? m_ppValueCache[0]->getString() : _T(""));
+                              (m_bCacheLoaded && (m_valueCache.size() > 0)) ? m_valueCache.getLastValue() : _T(""));
          }
          else
          {
             PostDciEventWithNames(t->getRearmEventCode(), m_owner->getId(), m_id, "ssissss",
                               s_paramNamesRearm, m_name.cstr(), m_description.cstr(), m_id, m_instance.cstr(), t->getStringValue(),
                               t->getLastCheckValue().getString(),
-                              (m_bCacheLoaded && (m_cacheSize > 0)) ? m_ppValueCache[0]->getString() : _T(""));
+                              (m_bCacheLoaded && (m_valueCache.size() > 0)) ? m_valueCache.getLastValue() : _T(""));
          }
       }
    }
@@ -1153,35 +1117,20 @@ void DCItem::updateCacheSizeInternal(bool allowLoad, UINT32 conditionId)
    }
 
    nxlog_debug_tag(_T("obj.dc.cache"), 8, _T("DCItem::updateCacheSizeInternal(dci=\"%s\", node=%s [%d]): requiredSize=%d cacheSize=%d"),
-            m_name.cstr(), m_owner->getName(), m_owner->getId(), m_requiredCacheSize, m_cacheSize);
+            m_name.cstr(), m_owner->getName(), m_owner->getId(), m_requiredCacheSize, m_valueCache.size());
 
    // Update cache if needed
-   if (m_requiredCacheSize < m_cacheSize)
+   if (m_requiredCacheSize < m_valueCache.size())
    {
       // Destroy unneeded values
-      if (m_cacheSize > 0)
-		{
-         for(UINT32 i = m_requiredCacheSize; i < m_cacheSize; i++)
-            delete m_ppValueCache[i];
-		}
-
-      m_cacheSize = m_requiredCacheSize;
-      if (m_cacheSize > 0)
-      {
-         m_ppValueCache = MemReallocArray(m_ppValueCache, m_cacheSize);
-      }
-      else
-      {
-         MemFree(m_ppValueCache);
-         m_ppValueCache = NULL;
-      }
+      m_valueCache.resize(m_requiredCacheSize);
    }
-   else if (m_requiredCacheSize > m_cacheSize)
+   else if (m_requiredCacheSize > m_valueCache.size())
    {
       // Load missing values from database
       // Skip caching for DCIs where estimated time to fill the cache is less then 5 minutes
       // to reduce load on database at server startup
-      if (allowLoad && (m_owner != NULL) && (((m_requiredCacheSize - m_cacheSize) * getEffectivePollingInterval() > 300) || (m_source == DS_PUSH_AGENT)))
+      if (allowLoad && (m_owner != NULL) && (((m_requiredCacheSize - m_valueCache.size()) * getEffectivePollingInterval() > 300) || (m_source == DS_PUSH_AGENT)))
       {
          m_bCacheLoaded = false;
          g_dciCacheLoaderQueue.put(createDescriptor());
@@ -1189,11 +1138,8 @@ void DCItem::updateCacheSizeInternal(bool allowLoad, UINT32 conditionId)
       else
       {
          // will not read data from database, fill cache with empty values
-         m_ppValueCache = MemReallocArray(m_ppValueCache, m_requiredCacheSize);
-         for(UINT32 i = m_cacheSize; i < m_requiredCacheSize; i++)
-            m_ppValueCache[i] = new ItemValue(_T(""), 1);
+         m_valueCache.resize(m_requiredCacheSize);
          DbgPrintf(7, _T("Cache load skipped for parameter %s [%u]"), m_name.cstr(), m_id);
-         m_cacheSize = m_requiredCacheSize;
          m_bCacheLoaded = true;
       }
    }
@@ -1205,7 +1151,7 @@ void DCItem::updateCacheSizeInternal(bool allowLoad, UINT32 conditionId)
 void DCItem::reloadCache(bool forceReload)
 {
    lock();
-   if (!forceReload && m_bCacheLoaded && (m_cacheSize == m_requiredCacheSize))
+   if (!forceReload && m_bCacheLoaded && (m_valueCache.size() == m_requiredCacheSize))
    {
       unlock();
       return;  // Cache already fully populated
@@ -1307,55 +1253,30 @@ void DCItem::reloadCache(bool forceReload)
 
    // While reload request was in queue DCI cache may have been already filled
    lock();
-   if (forceReload || !m_bCacheLoaded || (m_cacheSize != m_requiredCacheSize))
+   if (forceReload || !m_bCacheLoaded || (m_valueCache.size() != m_requiredCacheSize))
    {
-      UINT32 i;
-      for(i = 0; i < m_cacheSize; i++)
-         delete m_ppValueCache[i];
-
-      if (m_cacheSize != m_requiredCacheSize)
-      {
-         m_ppValueCache = MemReallocArray(m_ppValueCache, m_requiredCacheSize);
-      }
-
       nxlog_debug_tag(_T("obj.dc.cache"), 8, _T("DCItem::reloadCache(dci=\"%s\", node=%s [%d]): requiredSize=%d cacheSize=%d"),
-               m_name.cstr(), m_owner->getName(), m_owner->getId(), m_requiredCacheSize, m_cacheSize);
+               m_name.cstr(), m_owner->getName(), m_owner->getId(), m_requiredCacheSize, m_valueCache.size());
+
+      // Start with empty values and replace them with values from database
+      m_valueCache.reset(m_requiredCacheSize, m_dataType);
       if (hResult != NULL)
       {
-         // Create cache entries
-         bool moreData = true;
-         for(i = 0; (i < m_requiredCacheSize) && moreData; i++)
+         UINT32 i;
+         for(i = 0; (i < m_requiredCacheSize) && DBFetch(hResult); i++)
          {
-            moreData = DBFetch(hResult);
-            if (moreData)
-            {
-               DBGetField(hResult, 0, szBuffer, MAX_DB_STRING);
-               m_ppValueCache[i] = new ItemValue(szBuffer, DBGetFieldULong(hResult, 1));
-            }
-            else
-            {
-               m_ppValueCache[i] = new ItemValue(_T(""), 1);   // Empty value
-            }
+            DBGetField(hResult, 0, szBuffer, MAX_DB_STRING);
+            m_valueCache.set(i, szBuffer, DBGetFieldULong(hResult, 1));
          }
 
-         // Fill up cache with empty values if we don't have enough values in database
          if (i < m_requiredCacheSize)
          {
             nxlog_debug_tag(_T("obj.dc.cache"), 8, _T("DCItem::reloadCache(dci=\"%s\", node=%s [%d]): %d values missing in DB"),
                      m_name.cstr(), m_owner->getName(), m_owner->getId(), m_requiredCacheSize - i);
-            for(; i < m_requiredCacheSize; i++)
-               m_ppValueCache[i] = new ItemValue(_T(""), 1);
          }
          DBFreeResult(hResult);
       }
-      else
-      {
-         // Error reading data from database, fill cache with empty values
-         for(i = 0; i < m_requiredCacheSize; i++)
-            m_ppValueCache[i] = new ItemValue(_T(""), 1);
-      }
 
-      m_cacheSize = m_requiredCacheSize;
       m_bCacheLoaded = true;
    }
    else if (hResult != NULL)
@@ -1373,7 +1294,7 @@ void DCItem::reloadCache(bool forceReload)
 UINT64 DCItem::getCacheMemoryUsage() const
 {
    lock();
-   INT64 size = m_cacheSize * (sizeof(ItemValue) + sizeof(ItemValue*));
+   UINT64 size = m_valueCache.getMemoryUsage();
    unlock();
    return size;
 }
@@ -1389,11 +1310,11 @@ void DCItem::fillLastValueMessage(NXCPMessage *pMsg, UINT32 dwId)
    pMsg->setField(dwId++, m_flags);
    pMsg->setField(dwId++, m_description);
    pMsg->setField(dwId++, (UINT16)m_source);
-   if (m_cacheSize > 0)
+   if (m_valueCache.size() > 0)
    {
       pMsg->setField(dwId++, (UINT16)m_dataType);
-      pMsg->setField(dwId++, m_ppValueCache[0]->getString());
-      pMsg->setFieldFromTime(dwId++, m_ppValueCache[0]->getTimeStamp());
+      pMsg->setField(dwId++, m_valueCache.getLastValue());
+      pMsg->setFieldFromTime(dwId++, m_valueCache.getTimeStamp(0));
    }
    else
    {
@@ -1471,13 +1392,13 @@ NXSL_Value *DCItem::getValueForNXSL(NXSL_VM *vm, int nFunction, int nPolls)
    {
       case F_LAST:
          // cache placeholders will have timestamp 1
-         pValue = (m_bCacheLoaded && (m_cacheSize > 0) && (m_ppValueCache[0]->getTimeStamp() != 1)) ? vm->createValue(m_ppValueCache[0]->getString()) : vm->createValue();
+         pValue = (m_bCacheLoaded && (m_valueCache.size() > 0) && (m_valueCache.getTimeStamp(0) != 1)) ? vm->createValue(m_valueCache.getLastValue()) : vm->createValue();
          break;
       case F_DIFF:
-         if (m_bCacheLoaded && (m_cacheSize >= 2))
+         if (m_bCacheLoaded && (m_valueCache.size() >= 2))
          {
-            ItemValue result;
-            CalculateItemValueDiff(result, m_dataType, *m_ppValueCache[0], *m_ppValueCache[1]);
+            ItemValue result, lastValue(m_valueCache.getLastValue(), m_valueCache.getTimeStamp(0));
+            CalculateItemValueDiff(result, m_dataType, lastValue, m_valueCache, 1);
             pValue = vm->createValue(result.getString());
          }
          else
@@ -1486,10 +1407,10 @@ NXSL_Value *DCItem::getValueForNXSL(NXSL_VM *vm, int nFunction, int nPolls)
          }
          break;
       case F_AVERAGE:
-         if (m_bCacheLoaded && (m_cacheSize > 0))
+         if (m_bCacheLoaded && (m_valueCache.size() > 0))
          {
             ItemValue result;
-            CalculateItemValueAverage(result, m_dataType, m_ppValueCache, std::min(m_cacheSize, (UINT32)nPolls));
+            CalculateItemValueAverage(result, m_dataType, m_valueCache, std::min(m_valueCache.size(), (UINT32)nPolls));
             pValue = vm->createValue(result.getString());
          }
          else
@@ -1498,10 +1419,10 @@ NXSL_Value *DCItem::getValueForNXSL(NXSL_VM *vm, int nFunction, int nPolls)
          }
          break;
       case F_DEVIATION:
-         if (m_bCacheLoaded && (m_cacheSize > 0))
+         if (m_bCacheLoaded && (m_valueCache.size() > 0))
          {
             ItemValue result;
-            CalculateItemValueMD(result, m_dataType, m_ppValueCache, std::min(m_cacheSize, (UINT32)nPolls));
+            CalculateItemValueMD(result, m_dataType, m_valueCache, std::min(m_valueCache.size(), (UINT32)nPolls));
             pValue = vm->createValue(result.getString());
          }
          else
@@ -1526,7 +1447,7 @@ NXSL_Value *DCItem::getValueForNXSL(NXSL_VM *vm, int nFunction, int nPolls)
 const TCHAR *DCItem::getLastValue()
 {
    lock();
-   const TCHAR *v = (m_cacheSize > 0) ? (const TCHAR *)m_ppValueCache[0]->getString() : NULL;
+   const TCHAR *v = (m_valueCache.size() > 0) ? m_valueCache.getLastValue() : NULL;
    unlock();
    return v;
 }
@@ -1537,7 +1458,7 @@ const TCHAR *DCItem::getLastValue()
 ItemValue *DCItem::getInternalLastValue()
 {
    lock();
-   ItemValue *v = (m_cacheSize > 0) ? new ItemValue(m_ppValueCache[0]) : NULL;
+   ItemValue *v = (m_valueCache.size() > 0) ? new ItemValue(m_valueCache.getLastValue(), m_valueCache.getTimeStamp(0)) : NULL;
    unlock();
    return v;
 }
@@ -1701,17 +1622,8 @@ bool DCItem::deleteEntry(time_t timestamp)
       return false;
 
    lock();
-   for(UINT32 i = 0; i < m_cacheSize; i++)
-   {
-      if (m_ppValueCache[i]->getTimeStamp() == timestamp)
-      {
-         delete m_ppValueCache[i];
-         memmove(&m_ppValueCache[i], &m_ppValueCache[i + 1], sizeof(ItemValue *) * (m_cacheSize - (i + 1)));
-         m_cacheSize--;
-         updateCacheSizeInternal(true);
-         break;
-      }
-   }
+   if (m_valueCache.remove(timestamp))
+      updateCacheSizeInternal(true);
    unlock();
 
    return success;
@@ -2160,12 +2072,8 @@ void DCItem::recalculateValue(ItemValue &value)
       m_tPrevValueTimeStamp = value.getTimeStamp();
    }
 
-   if ((m_cacheSize > 0) && (value.getTimeStamp() >= m_tPrevValueTimeStamp))
-   {
-      delete m_ppValueCache[m_cacheSize - 1];
-      memmove(&m_ppValueCache[1], m_ppValueCache, sizeof(ItemValue *) * (m_cacheSize - 1));
-      m_ppValueCache[0] = new ItemValue(&value);
-   }
+   if ((m_valueCache.size() > 0) && (value.getTimeStamp() >= m_tPrevValueTimeStamp))
+      m_valueCache.add(value, m_dataType);
 
    m_lastPoll = value.getTimeStamp();
 }
@@ -2208,5 +2116,6 @@ DCObjectInfo *DCItem::createDescriptor() const
    DCObjectInfo *info = DCObject::createDescriptor();
    info->m_hasActiveThreshold = hasActiveThreshold();
    info->m_thresholdSeverity = getThresholdSeverity();
+   info->m_cacheMemoryUsage = getCacheMemoryUsage();
    return info;
 }
@@ -46,6 +46,7 @@ Threshold::Threshold(DCItem *pRelatedItem)
 	m_repeatInterval = -1;
 	m_lastEventTimestamp = 0;
 	m_numMatches = 0;
+   resetWindowSum();
 }
 
 /**
@@ -72,6 +73,7 @@ Threshold::Threshold()
 	m_repeatInterval = -1;
 	m_lastEventTimestamp = 0;
 	m_numMatches = 0;
+   resetWindowSum();
 }
 
 /**
@@ -100,6 +102,19 @@ Threshold::Threshold(Threshold *src, bool shadowCopy)
 	m_repeatInterval = src->m_repeatInterval;
 	m_lastEventTimestamp = shadowCopy ? src->m_lastEventTimestamp : 0;
 	m_numMatches = shadowCopy ? src->m_numMatches : 0;
+   if (shadowCopy)
+   {
+      m_windowSum = src->m_windowSum;
+      m_windowCacheVersion = src->m_windowCacheVersion;
+      m_windowSampleCount = src->m_windowSampleCount;
+      m_windowUpdates = src->m_windowUpdates;
+      m_windowDataType = src->m_windowDataType;
+      m_windowSumValid = src->m_windowSumValid;
+   }
+   else
+   {
+      resetWindowSum();
+   }
 }
 
 /**
@@ -140,6 +155,7 @@ Threshold::Threshold(DB_RESULT hResult, int iRow, DCItem *pRelatedItem)
 	m_numMatches = DBGetFieldLong(hResult, iRow, 13);
    DBGetField(hResult, iRow, 14, szBuffer, MAX_DB_STRING);
    m_lastCheckValue = szBuffer;
+   resetWindowSum();
 }
 
 /**
@@ -169,6 +185,7 @@ Threshold::Threshold(ConfigEntry *config, DCItem *parentItem)
 	m_repeatInterval = config->getSubEntryValueAsInt(_T("repeatInterval"), 0, -1);
 	m_lastEventTimestamp = 0;
 	m_numMatches = 0;
+   resetWindowSum();
 }
 
 /**
@@ -247,20 +264,20 @@ BOOL Threshold::saveToDB(DB_HANDLE hdb, UINT32 dwIndex)
  *    THRESHOLD_REARMED - when item's value doesn't match the threshold condition while previous check do
  *    NO_ACTION - when there are no changes in item's value match to threshold's condition
  */
-ThresholdCheckResult Threshold::check(ItemValue &value, ItemValue **ppPrevValues, ItemValue &fvalue, ItemValue &tvalue, NetObj *target, DCItem *dci)
+ThresholdCheckResult Threshold::check(ItemValue &value, const ItemValueCache &prevValues, ItemValue &fvalue, ItemValue &tvalue, NetObj *target, DCItem *dci)
 {
    // check if there is enough cached data
    switch(m_function)
    {
       case F_DIFF:
-         if (ppPrevValues[0]->getTimeStamp() == 1) // Timestamp 1 means placeholder value inserted by cache loader
+         if (prevValues.getTimeStamp(0) == 1) // Timestamp 1 means placeholder value inserted by cache loader
             return m_isReached ? ThresholdCheckResult::ALREADY_ACTIVE : ThresholdCheckResult::ALREADY_INACTIVE;
          break;
       case F_AVERAGE:
       case F_SUM:
       case F_DEVIATION:
          for(int i = 0; i < m_sampleCount - 1; i++)
-            if (ppPrevValues[i]->getTimeStamp() == 1) // Timestamp 1 means placeholder value inserted by cache loader
+            if (prevValues.getTimeStamp(i) == 1) // Timestamp 1 means placeholder value inserted by cache loader
                return m_isReached ? ThresholdCheckResult::ALREADY_ACTIVE : ThresholdCheckResult::ALREADY_INACTIVE;
          break;
       default:
@@ -278,16 +295,19 @@ ThresholdCheckResult Threshold::check(ItemValue &value, ItemValue **ppPrevValues
          fvalue = value;
          break;
       case F_AVERAGE:      // Check average value for last n polls
-         calculateAverageValue(&fvalue, value, ppPrevValues);
+         updateWindowSum(value, prevValues);
+         calculateAverageValue(&fvalue);
          break;
 		case F_SUM:
-         calculateSumValue(&fvalue, value, ppPrevValues);
+         updateWindowSum(value, prevValues);
+         calculateSumValue(&fvalue);
 			break;
       case F_DEVIATION:    // Check mean absolute deviation
-         calculateMDValue(&fvalue, value, ppPrevValues);
+         updateWindowSum(value, prevValues);
+         calculateMDValue(&fvalue, value, prevValues);
          break;
       case F_DIFF:
-         calculateDiff(&fvalue, value, ppPrevValues);
+         calculateDiff(&fvalue, value, prevValues);
          switch(m_dataType)
          {
             case DCI_DT_STRING:
@@ -636,88 +656,143 @@ void Threshold::updateFromMessage(NXCPMessage *msg, UINT32 baseId)
 	m_repeatInterval = (int)msg->getFieldAsUInt32(varId++);
 	m_value = msg->getFieldAsString(varId++, buffer, MAX_DCI_STRING_VALUE);
    m_expandValue = (NumChars(m_value, '%') > 0);
+   resetWindowSum();
 }
 
 /**
- * Calculate average value for parameter
+ * Reset window sum state so that it will be recalculated from value cache on next update
+ */
+void Threshold::resetWindowSum()
+{
+   m_windowSum.integer = 0;
+   m_windowCacheVersion = 0;
+   m_windowSampleCount = 0;
+   m_windowUpdates = 0;
+   m_windowDataType = 0;
+   m_windowSumValid = false;
+}
+
+/**
+ * Number of incremental updates of floating point window sum before it is
+ * recalculated from scratch to avoid accumulation of rounding errors
+ */
+#define WINDOW_SUM_RECALCULATION_INTERVAL 1000
+
+/**
+ * Update running sum for values of given type
  */
-#define CALC_AVG_VALUE(vtype) \
+#define UPDATE_WINDOW_SUM(vtype, field, stype) \
 { \
-   vtype var; \
-   var = (vtype)lastValue; \
-   for(int i = 1; i < m_sampleCount; i++) \
+   if (incremental) \
+   { \
+      m_windowSum.field += static_cast<stype>((vtype)lastValue) - static_cast<stype>(prevValues.get<vtype>(m_sampleCount - 1)); \
+   } \
+   else \
    { \
-      var += (vtype)(*ppPrevValues[i - 1]); \
+      m_windowSum.field = static_cast<stype>((vtype)lastValue); \
+      for(int i = 1; i < m_sampleCount; i++) \
+         m_windowSum.field += static_cast<stype>(prevValues.get<vtype>(i - 1)); \
    } \
-   *pResult = var / (vtype)m_sampleCount; \
 }
 
-void Threshold::calculateAverageValue(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues)
+/**
+ * Update running sum of last m_sampleCount values. Sum is updated in constant time
+ * by adding new value and subtracting value which leaves the window. It is
+ * recalculated from cached values if threshold or DCI was reconfigured or cache was
+ * changed in any other way than by adding value checked last time.
+ */
+void Threshold::updateWindowSum(ItemValue &lastValue, const ItemValueCache &prevValues)
 {
+   bool incremental = m_windowSumValid && (m_windowSampleCount == m_sampleCount) && (m_windowDataType == m_dataType) &&
+            (prevValues.getVersion() == m_windowCacheVersion + 1) && (prevValues.size() >= static_cast<UINT32>(m_sampleCount));
    switch(m_dataType)
    {
       case DCI_DT_INT:
-         CALC_AVG_VALUE(INT32);
+         UPDATE_WINDOW_SUM(INT32, integer, UINT64);
          break;
       case DCI_DT_UINT:
       case DCI_DT_COUNTER32:
-         CALC_AVG_VALUE(UINT32);
+         UPDATE_WINDOW_SUM(UINT32, integer, UINT64);
          break;
       case DCI_DT_INT64:
-         CALC_AVG_VALUE(INT64);
+         UPDATE_WINDOW_SUM(INT64, integer, UINT64);
          break;
       case DCI_DT_UINT64:
       case DCI_DT_COUNTER64:
-         CALC_AVG_VALUE(UINT64);
+         UPDATE_WINDOW_SUM(UINT64, integer, UINT64);
          break;
       case DCI_DT_FLOAT:
-         CALC_AVG_VALUE(double);
-         break;
-      case DCI_DT_STRING:
-         *pResult = _T("");   // Average value for string is meaningless
+         if (m_windowUpdates >= WINDOW_SUM_RECALCULATION_INTERVAL)
+            incremental = false;
+         UPDATE_WINDOW_SUM(double, real, double);
          break;
       default:
-         break;
+         m_windowSumValid = false;
+         return;
    }
+
+   m_windowUpdates = incremental ? m_windowUpdates + 1 : 0;
+   m_windowCacheVersion = prevValues.getVersion();
+   m_windowSampleCount = m_sampleCount;
+   m_windowDataType = m_dataType;
+   m_windowSumValid = true;
 }
 
 /**
- * Calculate sum value for values of given type
+ * Calculate average value for parameter
  */
-#define CALC_SUM_VALUE(vtype) \
-{ \
-   vtype var; \
-   var = (vtype)lastValue; \
-   for(int i = 1; i < m_sampleCount; i++) \
-   { \
-      var += (vtype)(*ppPrevValues[i - 1]); \
-   } \
-   *pResult = var; \
+void Threshold::calculateAverageValue(ItemValue *pResult)
+{
+   switch(m_dataType)
+   {
+      case DCI_DT_INT:
+         *pResult = static_cast<INT32>(m_windowSum.integer) / static_cast<INT32>(m_sampleCount);
+         break;
+      case DCI_DT_UINT:
+      case DCI_DT_COUNTER32:
+         *pResult = static_cast<UINT32>(m_windowSum.integer) / static_cast<UINT32>(m_sampleCount);
+         break;
+      case DCI_DT_INT64:
+         *pResult = static_cast<INT64>(m_windowSum.integer) / static_cast<INT64>(m_sampleCount);
+         break;
+      case DCI_DT_UINT64:
+      case DCI_DT_COUNTER64:
+         *pResult = m_windowSum.integer / static_cast<UINT64>(m_sampleCount);
+         break;
+      case DCI_DT_FLOAT:
+         *pResult = m_windowSum.real / static_cast<double>(m_sampleCount);
+         break;
+      case DCI_DT_STRING:
+         *pResult = _T("");   // Average value for string is meaningless
+         break;
+      default:
+         break;
+   }
 }
 
 /**
  * Calculate sum value for parameter
  */
-void Threshold::calculateSumValue(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues)
+void Threshold::calculateSumValue(ItemValue *pResult)
 {
    switch(m_dataType)
    {
       case DCI_DT_INT:
-         CALC_SUM_VALUE(INT32);
+         *pResult = static_cast<INT32>(m_windowSum.integer);
          break;
       case DCI_DT_UINT:
       case DCI_DT_COUNTER32:
-         CALC_SUM_VALUE(UINT32);
+         *pResult = static_cast<UINT32>(m_windowSum.integer);
          break;
       case DCI_DT_INT64:
-         CALC_SUM_VALUE(INT64);
+         *pResult = static_cast<INT64>(m_windowSum.integer);
          break;
       case DCI_DT_UINT64:
       case DCI_DT_COUNTER64:
-         CALC_SUM_VALUE(UINT64);
+         *pResult = m_windowSum.integer;
          break;
       case DCI_DT_FLOAT:
-         CALC_SUM_VALUE(double);
+         *pResult = m_windowSum.real;
          break;
       case DCI_DT_STRING:
          *pResult = _T("");   // Sum value for string is meaningless
@@ -728,21 +803,17 @@ void Threshold::calculateSumValue(ItemValue *pResult, ItemValue &lastValue, Item
 }
 
 /**
- * Calculate mean absolute deviation for values of given type
+ * Calculate mean absolute deviation for values of given type. Mean is taken from
+ * running sum, but deviation still has to be calculated over whole window.
  */
-#define CALC_MD_VALUE(vtype) \
+#define CALC_MD_VALUE(vtype, field) \
 { \
    vtype mean, dev; \
-   mean = (vtype)lastValue; \
-   for(i = 1; i < m_sampleCount; i++) \
-   { \
-      mean += (vtype)(*ppPrevValues[i - 1]); \
-   } \
-   mean /= (vtype)m_sampleCount; \
+   mean = static_cast<vtype>(m_windowSum.field) / (vtype)m_sampleCount; \
    dev = ABS((vtype)lastValue - mean); \
    for(i = 1; i < m_sampleCount; i++) \
    { \
-      dev += ABS((vtype)(*ppPrevValues[i - 1]) - mean); \
+      dev += ABS(prevValues.get<vtype>(i - 1) - mean); \
    } \
    *pResult = dev / (vtype)m_sampleCount; \
 }
@@ -750,7 +821,7 @@ void Threshold::calculateSumValue(ItemValue *pResult, ItemValue &lastValue, Item
 /**
  * Calculate mean absolute deviation for parameter
  */
-void Threshold::calculateMDValue(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues)
+void Threshold::calculateMDValue(ItemValue *pResult, ItemValue &lastValue, const ItemValueCache &prevValues)
 {
    int i;
 
@@ -758,23 +829,23 @@ void Threshold::calculateMDValue(ItemValue *pResult, ItemValue &lastValue, ItemV
    {
       case DCI_DT_INT:
 #define ABS(x) ((x) < 0 ? -(x) : (x))
-         CALC_MD_VALUE(INT32);
+         CALC_MD_VALUE(INT32, integer);
          break;
       case DCI_DT_INT64:
-         CALC_MD_VALUE(INT64);
+         CALC_MD_VALUE(INT64, integer);
          break;
       case DCI_DT_FLOAT:
-         CALC_MD_VALUE(double);
+         CALC_MD_VALUE(double, real);
          break;
       case DCI_DT_UINT:
       case DCI_DT_COUNTER32:
 #undef ABS
 #define ABS(x) (x)
-         CALC_MD_VALUE(UINT32);
+         CALC_MD_VALUE(UINT32, integer);
          break;
       case DCI_DT_UINT64:
       case DCI_DT_COUNTER64:
-         CALC_MD_VALUE(UINT64);
+         CALC_MD_VALUE(UINT64, integer);
          break;
       case DCI_DT_STRING:
          *pResult = _T("");   // Mean deviation for string is meaningless
@@ -789,9 +860,9 @@ void Threshold::calculateMDValue(ItemValue *pResult, ItemValue &lastValue, ItemV
 /**
  * Calculate difference between last and previous value
  */
-void Threshold::calculateDiff(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues)
+void Threshold::calculateDiff(ItemValue *pResult, ItemValue &lastValue, const ItemValueCache &prevValues)
 {
-   CalculateItemValueDiff(*pResult, m_dataType, lastValue, *ppPrevValues[0]);
+   CalculateItemValueDiff(*pResult, m_dataType, lastValue, prevValues, 0);
 }
 
 /**
@@ -960,4 +1031,10 @@ void Threshold::reconcile(const Threshold *src)
    m_lastEventTimestamp = src->m_lastEventTimestamp;
    m_currentSeverity = src->m_currentSeverity;
    m_lastScriptErrorReport = src->m_lastScriptErrorReport;
+   m_windowSum = src->m_windowSum;
+   m_windowCacheVersion = src->m_windowCacheVersion;
+   m_windowSampleCount = src->m_windowSampleCount;
+   m_windowUpdates = src->m_windowUpdates;
+   m_windowDataType = src->m_windowDataType;
+   m_windowSumValid = src->m_windowSumValid;
 }
@@ -200,10 +200,60 @@ void CalculateItemValueDiff(ItemValue &result, int nDataType, const ItemValue &c
    }
 }
 
+/**
+ * Calculate difference between given value and value at given position in DCI value cache
+ */
+void CalculateItemValueDiff(ItemValue &result, int nDataType, const ItemValue &curr, const ItemValueCache &cache, UINT32 index)
+{
+   TCHAR buffer[64];
+   switch(nDataType)
+   {
+      case DCI_DT_INT:
+         result = curr.getInt32() - cache.getInt32(index);
+         break;
+      case DCI_DT_UINT:
+      case DCI_DT_COUNTER32:
+         result = diff_uint32(curr.getUInt32(), cache.getUInt32(index));
+         break;
+      case DCI_DT_INT64:
+         result = curr.getInt64() - cache.getInt64(index);
+         break;
+      case DCI_DT_UINT64:
+      case DCI_DT_COUNTER64:
+         result = diff_uint64(curr.getUInt64(), cache.getUInt64(index));
+         break;
+      case DCI_DT_FLOAT:
+         result = curr.getDouble() - cache.getDouble(index);
+         break;
+      case DCI_DT_STRING:
+         result = (INT32)((_tcscmp(curr.getString(), cache.getString(index, buffer, 64)) == 0) ? 0 : 1);
+         break;
+      default:
+         // Delta calculation is not supported for other types
+         result = curr;
+         break;
+   }
+}
+
+/**
+ * Adapter for accessing array of item values from aggregation functions
+ */
+class ItemValueArray
+{
+private:
+   const ItemValue * const *m_values;
+
+public:
+   ItemValueArray(const ItemValue * const *values) { m_values = values; }
+
+   time_t getTimeStamp(size_t index) const { return m_values[index]->getTimeStamp(); }
+   template<typename T> T get(size_t index) const { return (T)(*m_values[index]); }
+};
+
 /**
  * Calculate average value for set of values
  */
-void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValue * const *valueList, size_t numValues)
+template<typename L> static void CalculateAverage(ItemValue &result, int nDataType, const L &valueList, size_t numValues)
 {
 #define CALC_AVG_VALUE(vtype) \
 { \
@@ -211,9 +261,9 @@ void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValue
    var = 0; \
    for(i = 0, valueCount = 0; i < numValues; i++) \
    { \
-      if (valueList[i]->getTimeStamp() != 1) \
+      if (valueList.getTimeStamp(i) != 1) \
       { \
-         var += (vtype)(*valueList[i]); \
+         var += valueList.template get<vtype>(i); \
          valueCount++; \
       } \
    } \
@@ -251,6 +301,22 @@ void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValue
    }
 }
 
+/**
+ * Calculate average value for set of values
+ */
+void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValue * const *valueList, size_t numValues)
+{
+   CalculateAverage(result, nDataType, ItemValueArray(valueList), numValues);
+}
+
+/**
+ * Calculate average value for first values in DCI value cache
+ */
+void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValueCache &cache, size_t numValues)
+{
+   CalculateAverage(result, nDataType, cache, numValues);
+}
+
 /**
  * Calculate total value for set of values
  */
@@ -302,7 +368,7 @@ void CalculateItemValueTotal(ItemValue &result, int nDataType, const ItemValue *
 /**
  * Calculate mean absolute deviation for set of values
  */
-void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValue * const *valueList, size_t numValues)
+template<typename L> static void CalculateMD(ItemValue &result, int nDataType, const L &valueList, size_t numValues)
 {
 #define CALC_MD_VALUE(vtype) \
 { \
@@ -310,9 +376,9 @@ void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValue * co
    mean = 0; \
    for(i = 0, valueCount = 0; i < numValues; i++) \
    { \
-      if (valueList[i]->getTimeStamp() != 1) \
+      if (valueList.getTimeStamp(i) != 1) \
       { \
-         mean += (vtype)(*valueList[i]); \
+         mean += valueList.template get<vtype>(i); \
          valueCount++; \
       } \
    } \
@@ -320,9 +386,9 @@ void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValue * co
    dev = 0; \
    for(i = 0, valueCount = 0; i < numValues; i++) \
    { \
-      if (valueList[i]->getTimeStamp() != 1) \
+      if (valueList.getTimeStamp(i) != 1) \
       { \
-         dev += ABS((vtype)(*valueList[i]) - mean); \
+         dev += ABS(valueList.template get<vtype>(i) - mean); \
          valueCount++; \
       } \
    } \
@@ -362,6 +428,22 @@ void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValue * co
    }
 }
 
+/**
+ * Calculate mean absolute deviation for set of values
+ */
+void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValue * const *valueList, size_t numValues)
+{
+   CalculateMD(result, nDataType, ItemValueArray(valueList), numValues);
+}
+
+/**
+ * Calculate mean absolute deviation for first values in DCI value cache
+ */
+void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValueCache &cache, size_t numValues)
+{
+   CalculateMD(result, nDataType, cache, numValues);
+}
+
 /**
  * Calculate min value for set of values
  */
@@ -459,3 +541,376 @@ void CalculateItemValueMax(ItemValue &result, int nDataType, const ItemValue * c
          break;
    }
 }
+
+/**
+ * Create empty value cache
+ */
+ItemValueCache::ItemValueCache()
+{
+   m_elements = NULL;
+   m_size = 0;
+   m_allocated = 0;
+   m_head = 0;
+   m_version = 0;
+   m_dataType = DCI_DT_NULL;
+   m_lastValueText = NULL;
+   m_lastValueTextSize = 0;
+}
+
+/**
+ * Value cache destructor
+ */
+ItemValueCache::~ItemValueCache()
+{
+   reset(0, m_dataType);
+   MemFree(m_elements);
+   MemFree(m_lastValueText);
+}
+
+/**
+ * Make this cache exact copy of given cache
+ */
+void ItemValueCache::copyFrom(const ItemValueCache& src)
+{
+   reset(0, src.m_dataType);
+   if (src.m_size > m_allocated)
+   {
+      m_elements = MemReallocArray(m_elements, src.m_size);
+      m_allocated = src.m_size;
+   }
+   memcpy(m_elements, src.m_elements, sizeof(Element) * src.m_size);
+   if (isStringStorage(m_dataType))
+   {
+      for(UINT32 i = 0; i < src.m_size; i++)
+         m_elements[i].value.string = MemCopyString(src.m_elements[i].value.string);
+   }
+   m_size = src.m_size;
+   m_head = src.m_head;
+   m_version = src.m_version;
+   if (src.m_lastValueText != NULL)
+      setLastValueText(src.m_lastValueText);
+}
+
+/**
+ * Create value of given data type from text
+ */
+ItemValueCache::Value ItemValueCache::createValue(const TCHAR *text, int dataType) const
+{
+   Value v;
+   switch(dataType)
+   {
+      case DCI_DT_INT:
+         parseValue(text, &v.int32);
+         break;
+      case DCI_DT_UINT:
+      case DCI_DT_COUNTER32:
+         parseValue(text, &v.uint32);
+         break;
+      case DCI_DT_INT64:
+         parseValue(text, &v.int64);
+         break;
+      case DCI_DT_UINT64:
+      case DCI_DT_COUNTER64:
+         parseValue(text, &v.uint64);
+         break;
+      case DCI_DT_FLOAT:
+         parseValue(text, &v.real);
+         break;
+      default:
+         v.string = (*text != 0) ? MemCopyString(text) : NULL;
+         break;
+   }
+   return v;
+}
+
+/**
+ * Set text of most recent value. Buffer is only re-allocated when new text does not fit.
+ */
+void ItemValueCache::setLastValueText(const TCHAR *text)
+{
+   size_t len = _tcslen(text) + 1;
+   if (len > m_lastValueTextSize)
+   {
+      m_lastValueTextSize = std::max(len, static_cast<size_t>(32));
+      m_lastValueText = MemReallocArray(m_lastValueText, m_lastValueTextSize);
+   }
+   memcpy(m_lastValueText, text, len * sizeof(TCHAR));
+}
+
+/**
+ * Set string value of cache element. Buffer of evicted value is reused if new string fits into it.
+ */
+void ItemValueCache::setStringValue(Element *e, const TCHAR *text)
+{
+   size_t len = _tcslen(text);
+   if (len == 0)
+   {
+      MemFreeAndNull(e->value.string);
+   }
+   else if ((e->value.string != NULL) && (_tcslen(e->value.string) >= len))
+   {
+      memcpy(e->value.string, text, (len + 1) * sizeof(TCHAR));
+   }
+   else
+   {
+      MemFree(e->value.string);
+      e->value.string = MemCopyString(text);
+   }
+}
+
+/**
+ * Re-arrange elements so that most recent value is at position 0
+ */
+void ItemValueCache::linearize()
+{
+   if (m_head != 0)
+   {
+      std::rotate(m_elements, &m_elements[m_head], &m_elements[m_size]);
+      m_head = 0;
+   }
+}
+
+/**
+ * Convert cached values to new data type
+ */
+void ItemValueCache::setDataType(int dataType)
+{
+   if (dataType == m_dataType)
+      return;
+
+   if (!isStringStorage(dataType) && isStringStorage(m_dataType) && (m_size > 0))
+      setLastValueText(CHECK_NULL_EX(element(0).value.string));
+
+   TCHAR buffer[64];
+   for(UINT32 i = 0; i < m_size; i++)
+   {
+      Element *e = &element(i);
+      Value v = createValue(getString(i, buffer, 64), dataType);
+      if (isStringStorage(m_dataType))
+         MemFree(e->value.string);
+      e->value = v;
+   }
+   m_dataType = dataType;
+   m_version++;
+}
+
+/**
+ * Add new value to cache, replacing oldest one. Value is stored according to given data type.
+ */
+void ItemValueCache::add(const ItemValue& value, int dataType)
+{
+   if (m_size == 0)
+      return;
+
+   setDataType(dataType);
+   m_head = (m_head > 0) ? m_head - 1 : m_size - 1;
+   Element *e = &m_elements[m_head];
+   switch(m_dataType)
+   {
+      case DCI_DT_INT:
+         e->value.int32 = value.getInt32();
+         break;
+      case DCI_DT_UINT:
+      case DCI_DT_COUNTER32:
+         e->value.uint32 = value.getUInt32();
+         break;
+      case DCI_DT_INT64:
+         e->value.int64 = value.getInt64();
+         break;
+      case DCI_DT_UINT64:
+      case DCI_DT_COUNTER64:
+         e->value.uint64 = value.getUInt64();
+         break;
+      case DCI_DT_FLOAT:
+         e->value.real = value.getDouble();
+         break;
+      default:
+         setStringValue(e, value.getString());
+         break;
+   }
+   if (!isStringStorage(m_dataType))
+      setLastValueText(value.getString());
+   e->timestamp = value.getTimeStamp();
+   m_version++;
+}
+
+/**
+ * Set value at given position (used by cache loader)
+ */
+void ItemValueCache::set(UINT32 index, const TCHAR *text, time_t timestamp)
+{
+   Element *e = &element(index);
+   if (isStringStorage(m_dataType))
+   {
+      setStringValue(e, text);
+   }
+   else
+   {
+      e->value = createValue(text, m_dataType);
+      if (index == 0)
+         setLastValueText(text);
+   }
+   e->timestamp = timestamp;
+   m_version++;
+}
+
+/**
+ * Remove value with given timestamp. Cache size is reduced by one if value was found.
+ */
+bool ItemValueCache::remove(time_t timestamp)
+{
+   for(UINT32 i = 0; i < m_size; i++)
+   {
+      if (element(i).timestamp != timestamp)
+         continue;
+
+      linearize();
+      if (isStringStorage(m_dataType))
+         MemFree(m_elements[i].value.string);
+      memmove(&m_elements[i], &m_elements[i + 1], sizeof(Element) * (m_size - (i + 1)));
+      m_size--;
+      if ((i == 0) && (m_size > 0) && !isStringStorage(m_dataType))
+      {
+         TCHAR buffer[64];
+         setLastValueText(formatValue(m_elements[0], buffer, 64));
+      }
+      m_version++;
+      return true;
+   }
+   return false;
+}
+
+/**
+ * Reset cache to given size and data type and fill it with placeholder values
+ */
+void ItemValueCache::reset(UINT32 size, int dataType)
+{
+   if (isStringStorage(m_dataType))
+   {
+      for(UINT32 i = 0; i < m_size; i++)
+         MemFree(m_elements[i].value.string);
+   }
+   if (size > m_allocated)
+   {
+      m_elements = MemReallocArray(m_elements, size);
+      m_allocated = size;
+   }
+   if (size > 0)
+      memset(m_elements, 0, sizeof(Element) * size);
+   for(UINT32 i = 0; i < size; i++)
+      m_elements[i].timestamp = 1;
+   m_size = size;
+   m_head = 0;
+   m_dataType = dataType;
+   if (m_lastValueText != NULL)
+      m_lastValueText[0] = 0;
+   m_version++;
+}
+
+/**
+ * Change cache size. Oldest values are dropped when cache is shrinking and
+ * placeholder values are added when it is growing.
+ */
+void ItemValueCache::resize(UINT32 size)
+{
+   if (size == m_size)
+      return;
+
+   if (size == 0)
+   {
+      reset(0, m_dataType);
+      MemFreeAndNull(m_elements);
+      m_allocated = 0;
+      return;
+   }
+
+   linearize();
+   if (size < m_size)
+   {
+      if (isStringStorage(m_dataType))
+      {
+         for(UINT32 i = size; i < m_size; i++)
+            MemFree(m_elements[i].value.string);
+      }
+      m_elements = MemReallocArray(m_elements, size);
+      m_allocated = size;
+   }
+   else
+   {
+      if (size > m_allocated)
+      {
+         m_elements = MemReallocArray(m_elements, size);
+         m_allocated = size;
+      }
+      memset(&m_elements[m_size], 0, sizeof(Element) * (size - m_size));
+      for(UINT32 i = m_size; i < size; i++)
+         m_elements[i].timestamp = 1;
+   }
+   m_size = size;
+   m_version++;
+}
+
+/**
+ * Format numeric value of cache element
+ */
+const TCHAR *ItemValueCache::formatValue(const Element& e, TCHAR *buffer, size_t size) const
+{
+   if (e.timestamp == 1)
+      return _T("");  // placeholder
+
+   switch(m_dataType)
+   {
+      case DCI_DT_INT:
+         _sntprintf(buffer, size, _T("%d"), e.value.int32);
+         break;
+      case DCI_DT_UINT:
+      case DCI_DT_COUNTER32:
+         _sntprintf(buffer, size, _T("%u"), e.value.uint32);
+         break;
+      case DCI_DT_INT64:
+         _sntprintf(buffer, size, INT64_FMT, e.value.int64);
+         break;
+      case DCI_DT_UINT64:
+      case DCI_DT_COUNTER64:
+         _sntprintf(buffer, size, UINT64_FMT, e.value.uint64);
+         break;
+      case DCI_DT_FLOAT:
+         _sntprintf(buffer, size, _T("%f"), e.value.real);
+         break;
+      default:
+         buffer[0] = 0;
+         break;
+   }
+   return buffer;
+}
+
+/**
+ * Get value at given position as string. Numeric values other than most recent one
+ * are formatted into provided buffer.
+ */
+const TCHAR *ItemValueCache::getString(UINT32 index, TCHAR *buffer, size_t size) const
+{
+   const Element& e = element(index);
+   if (isStringStorage(m_dataType))
+      return CHECK_NULL_EX(e.value.string);
+   if (index == 0)
+      return CHECK_NULL_EX(m_lastValueText);
+   return (buffer != NULL) ? formatValue(e, buffer, size) : _T("");
+}
+
+/**
+ * Get memory used by cache
+ */
+UINT64 ItemValueCache::getMemoryUsage() const
+{
+   UINT64 size = sizeof(Element) * m_allocated + sizeof(TCHAR) * m_lastValueTextSize;
+   if (isStringStorage(m_dataType))
+   {
+      for(UINT32 i = 0; i < m_size; i++)
+      {
+         if (m_elements[i].value.string != NULL)
+            size += (_tcslen(m_elements[i].value.string) + 1) * sizeof(TCHAR);
+      }
+   }
+   return size;
+}
@@ -104,6 +104,7 @@ DCObject::DCObject()
    m_instanceGracePeriodStart = 0;
    m_startTime = 0;
    m_relatedObject = 0;
+   m_scheduledPollTime = 0;
 }
 
 /**
@@ -158,6 +159,7 @@ DCObject::DCObject(const DCObject *src, bool shadowCopy) :
    m_instanceGracePeriodStart = src->m_instanceGracePeriodStart;
    m_startTime = src->m_startTime;
    m_relatedObject = src->m_relatedObject;
+   m_scheduledPollTime = 0;
 }
 
 /**
@@ -207,6 +209,7 @@ DCObject::DCObject(UINT32 id, const TCHAR *name, int source,
    m_instanceGracePeriodStart = 0;
    m_startTime = 0;
    m_relatedObject = 0;
+   m_scheduledPollTime = 0;
 
    updateTimeIntervalsInternal();
 }
@@ -301,6 +304,7 @@ DCObject::DCObject(ConfigEntry *config, DataCollectionOwner *owner)
    m_instanceGracePeriodStart = 0;
    m_startTime = 0;
    m_relatedObject = 0;
+   m_scheduledPollTime = 0;
 
    updateTimeIntervalsInternal();
 }
@@ -743,6 +747,128 @@ bool DCObject::isReadyForPolling(time_t currTime)
    return result;
 }
 
+/**
+ * Look-ahead window (in seconds) for finding next match of advanced schedule
+ * (separately for schedules with minute and second resolution)
+ */
+#define SCHEDULE_LOOKAHEAD_WINDOW            86400
+#define SCHEDULE_LOOKAHEAD_WINDOW_SECONDS    3600
+
+/**
+ * Check if schedule has seconds field
+ */
+static bool ScheduleHasSeconds(const TCHAR *schedule)
+{
+   TCHAR value[256];
+   const TCHAR *curr = schedule;
+   for(int i = 0; i < 5; i++)
+      curr = ExtractWord(curr, value);
+   value[0] = 0;
+   ExtractWord(curr, value);
+   return value[0] != 0;
+}
+
+/**
+ * Find first time after given time which matches one of advanced schedules. If there is no match
+ * within look-ahead window, end of the window is returned, so schedule will be checked again
+ * at that time. Schedules produced by scripts cannot be predicted and are checked every second.
+ */
+time_t DCObject::getNextScheduleMatch(time_t currTime)
+{
+   if (!tryLock())
+      return currTime + 1;
+
+   if ((m_schedules == NULL) || (m_schedules->size() == 0))
+   {
+      unlock();
+      return 0;
+   }
+
+   bool withSeconds = false;
+   for(int i = 0; i < m_schedules->size(); i++)
+   {
+      const TCHAR *schedule = m_schedules->get(i);
+      if (!_tcsncmp(schedule, _T("%["), 2))
+      {
+         unlock();
+         return currTime;
+      }
+      if (ScheduleHasSeconds(schedule))
+         withSeconds = true;
+   }
+
+   // Schedules without seconds match for whole minute, so only minute boundaries are checked
+   time_t step = withSeconds ? 1 : 60;
+   time_t t = withSeconds ? currTime + 1 : currTime - currTime % 60 + 60;
+   time_t end = currTime + (withSeconds ? SCHEDULE_LOOKAHEAD_WINDOW_SECONDS : SCHEDULE_LOOKAHEAD_WINDOW);
+   time_t result = end;
+   for(; t < end; t += step)
+   {
+      struct tm tmLocal;
+#if HAVE_LOCALTIME_R
+      localtime_r(&t, &tmLocal);
+#else
+      memcpy(&tmLocal, localtime(&t), sizeof(struct tm));
+#endif
+      for(int i = 0; i < m_schedules->size(); i++)
+      {
+         if (matchSchedule(m_schedules->get(i), NULL, &tmLocal, t))
+         {
+            result = t;
+            break;
+         }
+      }
+      if (result != end)
+         break;
+   }
+   unlock();
+   return result;
+}
+
+/**
+ * Maximum initial polling offset for data collection objects (in seconds)
+ */
+#define MAX_POLLING_JITTER    60
+
+/**
+ * Get time when data collection object should be checked for polling next time.
+ * Returns 0 if object cannot be scheduled for polling in current state. Object
+ * is not locked (except for advanced schedule evaluation) because result is only
+ * used as a hint for data collection scheduler - final decision is made by
+ * isReadyForPolling().
+ */
+time_t DCObject::getNextPollTime(time_t currTime)
+{
+   if ((m_status == ITEM_STATUS_DISABLED) || m_busy || m_scheduledForDeletion ||
+       (m_source == DS_PUSH_AGENT) || !isCacheLoaded() || !hasValue() ||
+       !matchClusterResource() || (getAgentCacheMode() != AGENT_CACHE_OFF))
+      return 0;
+
+   if (m_doForcePoll)
+      return currTime;
+
+   if (m_pollingScheduleType == DC_POLLING_SCHEDULE_ADVANCED)
+      return getNextScheduleMatch(currTime);
+
+   int interval = getEffectivePollingInterval();
+   if (m_status == ITEM_STATUS_NOT_SUPPORTED)
+      interval *= 10;
+
+   time_t nextPoll;
+   if (m_lastPoll == 0)
+   {
+      // Spread first polls of new objects over polling interval to avoid
+      // bursts after server startup or mass DCI creation from templates
+      int range = std::min(interval, MAX_POLLING_JITTER);
+      nextPoll = currTime + static_cast<time_t>((m_id * 2654435761U) % static_cast<UINT32>(range));
+   }
+   else
+   {
+      nextPoll = m_lastPoll + interval;
+   }
+   return std::max(nextPoll, m_startTime);
+}
+
 /**
  * Returns true if internal cache is loaded. If data collection object
  * does not have cache should return true
@@ -1642,6 +1768,7 @@ DCObjectInfo::DCObjectInfo(const DCObject *object)
    m_hasActiveThreshold = false;
    m_thresholdSeverity = SEVERITY_NORMAL;
    m_relatedObject = object->getRelatedObject();
+   m_cacheMemoryUsage = 0;
 }
 
 /**
@@ -1669,6 +1796,7 @@ DCObjectInfo::DCObjectInfo(const NXCPMessage *msg, const DCObject *object)
    m_hasActiveThreshold = false;
    m_thresholdSeverity = SEVERITY_NORMAL;
    m_relatedObject = (object != NULL) ? object->getRelatedObject() : 0;
+   m_cacheMemoryUsage = 0;
 }
 
 /**
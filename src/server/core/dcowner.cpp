@@ -765,6 +765,31 @@ shared_ptr<DCObject> DataCollectionOwner::getDCObjectByDescription(const TCHAR *
    return object;
 }
 
+/**
+ * Compare DCI IDs (used for binary search)
+ */
+static int CompareDCObjectId(const void *key, const void *element)
+{
+   UINT32 id1 = *static_cast<const UINT32*>(key);
+   UINT32 id2 = *static_cast<const UINT32*>(element);
+   return (id1 < id2) ? -1 : ((id1 > id2) ? 1 : 0);
+}
+
+/**
+ * Get data collection objects with given IDs. ID list should be sorted in ascending order.
+ */
+void DataCollectionOwner::getDCObjectsById(const IntegerArray<UINT32>& ids, SharedObjectArray<DCObject> *objects)
+{
+   lockDciAccess(false);
+   for(int i = 0; i < m_dcObjects->size(); i++)
+   {
+      UINT32 id = m_dcObjects->get(i)->getId();
+      if (bsearch(&id, ids.getBuffer(), ids.size(), sizeof(UINT32), CompareDCObjectId) != NULL)
+         objects->add(m_dcObjects->getShared(i));
+   }
+   unlockDciAccess();
+}
+
 /**
  * Get item by GUID
  */
@@ -603,20 +603,42 @@ bool DataCollectionTarget::isDataCollectionDisabled()
 }
 
 /**
- * Put items which requires polling into the queue
+ * Add data collection objects to data collection scheduler
  */
-void DataCollectionTarget::queueItemsForPolling()
+void DataCollectionTarget::scheduleItemsForPolling(time_t currTime)
 {
    if ((m_status == STATUS_UNMANAGED) || isDataCollectionDisabled() || m_isDeleted)
       return;  // Do not collect data for unmanaged objects or if data collection is disabled
 
-   time_t currTime = time(NULL);
-
    lockDciAccess(false);
    for(int i = 0; i < m_dcObjects->size(); i++)
    {
-		DCObject *object = m_dcObjects->get(i);
-      if (m_dcObjects->get(i)->isReadyForPolling(currTime))
+      const shared_ptr<DCObject>& object = m_dcObjects->getShared(i);
+      if (object->getScheduledPollTime() == 0)
+         ScheduleDataCollection(object, currTime);
+   }
+   unlockDciAccess();
+}
+
+/**
+ * Queue data collection objects taken from data collection scheduler for polling.
+ * Objects not ready for polling are returned back to scheduler.
+ */
+void DataCollectionTarget::queueItemsForPolling(SharedObjectArray<DCObject> *items, time_t currTime)
+{
+   if ((m_status == STATUS_UNMANAGED) || isDataCollectionDisabled() || m_isDeleted)
+      return;  // Do not collect data for unmanaged objects or if data collection is disabled
+
+   const shared_ptr<DCObject> **batch = MemAllocArrayNoInit<const shared_ptr<DCObject>*>(items->size());
+   int batchSize = 0;
+   SharedObjectArray<DCObject> snmpItems;
+   for(int i = 0; i < items->size(); i++)
+   {
+		DCObject *object = items->get(i);
+		if (object->getOwner() != this)
+		   continue;   // Object was moved to another owner
+
+      if (object->isReadyForPolling(currTime))
       {
          object->setBusyFlag();
          incRefCount();   // Increment reference count for each queued DCI
@@ -630,17 +652,33 @@ void DataCollectionTarget::queueItemsForPolling()
             _sntprintf(key, 32, _T("%08X/%s"),
                      m_id, (object->getDataSource() == DS_SSH) ? _T("ssh") :
                               (object->getDataSource() == DS_SMCLP) ? _T("smclp") : _T("agent"));
-            ThreadPoolExecuteSerialized(g_dataCollectorThreadPool, key, DataCollector, m_dcObjects->getShared(i));
+            ThreadPoolExecuteSerialized(g_dataCollectorThreadPool, key, DataCollector, items->getShared(i));
+         }
+         else if ((object->getDataSource() == DS_SNMP_AGENT) && (object->getType() == DCO_TYPE_ITEM) &&
+                  (getObjectClass() == OBJECT_NODE) && (getEffectiveSourceNode(object) == 0))
+         {
+            // SNMP DCIs of same node are collected with multi-variable requests
+            snmpItems.add(items->getShared(i));
          }
          else
          {
-            ThreadPoolExecute(g_dataCollectorThreadPool, DataCollector, m_dcObjects->getShared(i));
+            batch[batchSize++] = &items->getShared(i);
          }
 			nxlog_debug_tag(_T("obj.dc.queue"), 8, _T("DataCollectionTarget(%s)->QueueItemsForPolling(): item %d \"%s\" added to queue"),
 			         m_name, object->getId(), object->getName().cstr());
       }
+      else
+      {
+         ScheduleDataCollection(items->getShared(i), currTime);
+      }
    }
-   unlockDciAccess();
+   if (snmpItems.size() > 1)
+      QueueSNMPDataCollection(static_cast<Node*>(this), &snmpItems);
+   else if (snmpItems.size() == 1)
+      batch[batchSize++] = &snmpItems.getShared(0);
+   if (batchSize > 0)
+      ThreadPoolExecuteBatch(g_dataCollectorThreadPool, DataCollector, batch, batchSize);
+   MemFree(batch);
 }
 
 /**
@@ -1912,6 +1950,7 @@ void DataCollectionTarget::onDataCollectionChange()
 {
    super::onDataCollectionChange();
    calculateProxyLoad();
+   scheduleItemsForPolling(time(NULL));
 }
 
 /**
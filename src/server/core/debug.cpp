@@ -144,12 +144,14 @@ void ShowThreadPool(CONSOLE_CTX console, ThreadPool *p)
                           _T("   Total requests....... ") UINT64_FMT _T("\n")
                           _T("   Thread starts........ ") UINT64_FMT _T("\n")
                           _T("   Thread stops......... ") UINT64_FMT _T("\n")
-                          _T("   Average wait time.... %u ms\n\n"),
+                          _T("   Average wait time.... %u ms\n")
+                          _T("   Scheduler lateness... ") UINT64_FMT _T(" / ") UINT64_FMT _T(" / ") UINT64_FMT _T(" / ") UINT64_FMT _T(" / ") UINT64_FMT _T(" (1ms/10ms/100ms/1s/more)\n\n"),
                  info.name, info.curThreads, info.minThreads, info.maxThreads, 
                  info.loadAvg[0], info.loadAvg[1], info.loadAvg[2],
                  info.load, info.usage, info.activeRequests, info.scheduledRequests,
                  info.totalRequests, info.threadStarts, info.threadStops,
-                 info.averageWaitTime);
+                 info.averageWaitTime, info.schedulerLateness[0], info.schedulerLateness[1],
+                 info.schedulerLateness[2], info.schedulerLateness[3], info.schedulerLateness[4]);
 }
 
 /**
@@ -207,6 +209,9 @@ DataCollectionError GetThreadPoolStat(ThreadPoolStat stat, const TCHAR *param, T
       case THREAD_POOL_USAGE:
          ret_int(value, info.usage);
          break;
+      case THREAD_POOL_AVERAGE_WAIT_TIME:
+         ret_uint(value, info.averageWaitTime);
+         break;
       default:
          return DCE_NOT_SUPPORTED;
    }
@@ -29,6 +29,12 @@
  */
 EPRule::EPRule(UINT32 id) : m_actions(0, 16, true)
 {
+   m_sourceCache = NULL;
+   m_sourceCacheVersion = 0;
+   m_sourceCacheTimestamp = 0;
+   m_evaluationCount = 0;
+   m_scriptCacheKey = 0;
+   m_matchCount = 0;
    m_id = id;
    m_guid = uuid::generate();
    m_flags = 0;
@@ -49,6 +55,12 @@ EPRule::EPRule(UINT32 id) : m_actions(0, 16, true)
  */
 EPRule::EPRule(ConfigEntry *config) : m_actions(0, 16, true)
 {
+   m_sourceCache = NULL;
+   m_sourceCacheVersion = 0;
+   m_sourceCacheTimestamp = 0;
+   m_evaluationCount = 0;
+   m_scriptCacheKey = 0;
+   m_matchCount = 0;
    m_id = 0;
    m_guid = config->getSubEntryValueAsUUID(_T("guid"));
    if (m_guid.isNull())
@@ -130,10 +142,10 @@ EPRule::EPRule(ConfigEntry *config) : m_actions(0, 16, true)
    {
       TCHAR szError[256];
 
-      m_script = NXSLCompileAndCreateVM(m_scriptSource, szError, 256, new NXSL_ServerEnv);
+      m_script = NXSLCompile(m_scriptSource, szError, 256, NULL);
       if (m_script != NULL)
       {
-      	m_script->setGlobalVariable("CUSTOM_MESSAGE", m_script->createValue(_T("")));
+         m_scriptCacheKey = CreateScriptVMCacheKey();
       }
       else
       {
@@ -194,6 +206,12 @@ EPRule::EPRule(ConfigEntry *config) : m_actions(0, 16, true)
  */
 EPRule::EPRule(DB_RESULT hResult, int row) : m_actions(0, 16, true)
 {
+   m_sourceCache = NULL;
+   m_sourceCacheVersion = 0;
+   m_sourceCacheTimestamp = 0;
+   m_evaluationCount = 0;
+   m_scriptCacheKey = 0;
+   m_matchCount = 0;
    m_id = DBGetFieldULong(hResult, row, 0);
    m_guid = DBGetFieldGUID(hResult, row, 1);
    m_flags = DBGetFieldULong(hResult, row, 2);
@@ -206,10 +224,10 @@ EPRule::EPRule(DB_RESULT hResult, int row) : m_actions(0, 16, true)
    {
       TCHAR szError[256];
 
-      m_script = NXSLCompileAndCreateVM(m_scriptSource, szError, 256, new NXSL_ServerEnv);
+      m_script = NXSLCompile(m_scriptSource, szError, 256, NULL);
       if (m_script != NULL)
       {
-      	m_script->setGlobalVariable("CUSTOM_MESSAGE", m_script->createValue(_T("")));
+         m_scriptCacheKey = CreateScriptVMCacheKey();
       }
       else
       {
@@ -231,6 +249,12 @@ EPRule::EPRule(DB_RESULT hResult, int row) : m_actions(0, 16, true)
  */
 EPRule::EPRule(NXCPMessage *msg) : m_actions(0, 16, true)
 {
+   m_sourceCache = NULL;
+   m_sourceCacheVersion = 0;
+   m_sourceCacheTimestamp = 0;
+   m_evaluationCount = 0;
+   m_scriptCacheKey = 0;
+   m_matchCount = 0;
    m_flags = msg->getFieldAsUInt32(VID_FLAGS);
    m_id = msg->getFieldAsUInt32(VID_RULE_ID);
    m_guid = msg->getFieldAsGUID(VID_GUID);
@@ -296,10 +320,10 @@ EPRule::EPRule(NXCPMessage *msg) : m_actions(0, 16, true)
    {
       TCHAR szError[256];
 
-      m_script = NXSLCompileAndCreateVM(m_scriptSource, szError, 256, new NXSL_ServerEnv);
+      m_script = NXSLCompile(m_scriptSource, szError, 256, NULL);
       if (m_script != NULL)
       {
-      	m_script->setGlobalVariable("CUSTOM_MESSAGE", m_script->createValue(_T("")));
+         m_scriptCacheKey = CreateScriptVMCacheKey();
       }
       else
       {
@@ -317,13 +341,18 @@ EPRule::EPRule(NXCPMessage *msg) : m_actions(0, 16, true)
  */
 EPRule::~EPRule()
 {
+   delete m_sourceCache;
    MemFree(m_alarmMessage);
    MemFree(m_alarmImpact);
    MemFree(m_alarmKey);
    MemFree(m_rcaScriptName);
    MemFree(m_comments);
    MemFree(m_scriptSource);
-   delete m_script;
+   if (m_script != NULL)
+   {
+      InvalidateScriptVMCacheKey(m_scriptCacheKey);
+      delete m_script;
+   }
 }
 
 /**
@@ -445,13 +474,10 @@ void EPRule::createExportRecord(StringBuffer &xml) const
 }
 
 /**
- * Check if source object's id match to the rule
+ * Check if given object is one of rule's source objects or their child (without source cache)
  */
-bool EPRule::matchSource(UINT32 objectId)
+bool EPRule::matchSourceUncached(UINT32 objectId)
 {
-   if (m_sources.isEmpty())
-      return (m_flags & RF_NEGATED_SOURCE) ? false : true;
-
    bool match = false;
    for(int i = 0; i < m_sources.size(); i++)
    {
@@ -475,6 +501,71 @@ bool EPRule::matchSource(UINT32 objectId)
          nxlog_write(NXLOG_WARNING, _T("Invalid object identifier %u in event processing policy rule #%u"), m_sources.get(i), m_id + 1);
       }
    }
+   return match;
+}
+
+
+/**
+ * Minimal interval in seconds between source cache rebuilds
+ */
+#define SOURCE_CACHE_REBUILD_INTERVAL  1
+
+/**
+ * Add object to source cache
+ */
+static void AddObjectToSourceCache(NetObj *object, HashSet<UINT32> *cache)
+{
+   cache->put(object->getId());
+   ObjectArray<NetObj> *children = object->getAllChildren(false, false);
+   for(int i = 0; i < children->size(); i++)
+      cache->put(children->get(i)->getId());
+   delete children;
+}
+
+/**
+ * Check if event's source match to the rule. Uses set of source objects
+ * expanded through containers, which is rebuilt on object tree change (but not
+ * more often than once per second - direct check is used between rebuilds).
+ */
+bool EPRule::matchSource(UINT32 objectId)
+{
+   if (m_sources.isEmpty())
+      return (m_flags & RF_NEGATED_SOURCE) ? false : true;
+
+   bool match;
+   m_sourceCacheLock.lock();
+   INT32 version = g_objectTreeVersion;
+   if ((m_sourceCache != NULL) && (m_sourceCacheVersion == version))
+   {
+      match = m_sourceCache->contains(objectId);
+   }
+   else if ((m_sourceCache == NULL) || (time(NULL) - m_sourceCacheTimestamp >= SOURCE_CACHE_REBUILD_INTERVAL))
+   {
+      delete m_sourceCache;
+      m_sourceCache = new HashSet<UINT32>();
+      for(int i = 0; i < m_sources.size(); i++)
+      {
+         NetObj *object = FindObjectById(m_sources.get(i));
+         if (object != NULL)
+         {
+            AddObjectToSourceCache(object, m_sourceCache);
+         }
+         else
+         {
+            m_sourceCache->put(m_sources.get(i));
+            nxlog_write(NXLOG_WARNING, _T("Invalid object identifier %u in event processing policy rule #%u"), m_sources.get(i), m_id + 1);
+         }
+      }
+      m_sourceCacheVersion = version;
+      m_sourceCacheTimestamp = time(NULL);
+      nxlog_debug_tag(DEBUG_TAG, 7, _T("Source cache for EPP rule %u rebuilt (%d objects)"), m_id + 1, m_sourceCache->size());
+      match = m_sourceCache->contains(objectId);
+   }
+   else
+   {
+      match = matchSourceUncached(objectId);
+   }
+   m_sourceCacheLock.unlock();
    return (m_flags & RF_NEGATED_SOURCE) ? !match : match;
 }
 
@@ -519,27 +610,32 @@ bool EPRule::matchScript(Event *pEvent)
    if (m_script == NULL)
       return true;
 
-   SetupServerScriptVM(m_script, FindObjectById(pEvent->getSourceId()), NULL);
-   m_script->setGlobalVariable("$event", m_script->createValue(new NXSL_Object(m_script, &g_nxslEventClass, pEvent, true)));
-   m_script->setGlobalVariable("CUSTOM_MESSAGE", m_script->createValue());
-   m_script->setGlobalVariable("EVENT_CODE", m_script->createValue(pEvent->getCode()));
-   m_script->setGlobalVariable("SEVERITY", m_script->createValue(pEvent->getSeverity()));
-   m_script->setGlobalVariable("SEVERITY_TEXT", m_script->createValue(GetStatusAsText(pEvent->getSeverity(), true)));
-   m_script->setGlobalVariable("OBJECT_ID", m_script->createValue(pEvent->getSourceId()));
-   m_script->setGlobalVariable("EVENT_TEXT", m_script->createValue((TCHAR *)pEvent->getMessage()));
+   ScriptVMHandle vm = AcquireServerScriptVM(m_scriptCacheKey, m_script, FindObjectById(pEvent->getSourceId()));
+   if (!vm.isValid())
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("Cannot create VM for evaluation script for event processing policy rule #%u"), m_id + 1);
+      return true;
+   }
+
+   vm->setGlobalVariable("$event", vm->createValue(new NXSL_Object(vm, &g_nxslEventClass, pEvent, true)));
+   vm->setGlobalVariable("CUSTOM_MESSAGE", vm->createValue());
+   vm->setGlobalVariable("EVENT_CODE", vm->createValue(pEvent->getCode()));
+   vm->setGlobalVariable("SEVERITY", vm->createValue(pEvent->getSeverity()));
+   vm->setGlobalVariable("SEVERITY_TEXT", vm->createValue(GetStatusAsText(pEvent->getSeverity(), true)));
+   vm->setGlobalVariable("OBJECT_ID", vm->createValue(pEvent->getSourceId()));
+   vm->setGlobalVariable("EVENT_TEXT", vm->createValue((TCHAR *)pEvent->getMessage()));
 
    // Pass event's parameters as arguments and
    // other information as variables
-   NXSL_Value **ppValueList = (NXSL_Value **)malloc(sizeof(NXSL_Value *) * pEvent->getParametersCount());
-   memset(ppValueList, 0, sizeof(NXSL_Value *) * pEvent->getParametersCount());
+   ObjectRefArray<NXSL_Value> args(pEvent->getParametersCount(), 8);
    for(int i = 0; i < pEvent->getParametersCount(); i++)
-      ppValueList[i] = m_script->createValue(pEvent->getParameter(i));
+      args.add(vm->createValue(pEvent->getParameter(i)));
 
    // Run script
    NXSL_VariableSystem *globals = NULL;
-   if (m_script->run(pEvent->getParametersCount(), ppValueList, &globals))
+   if (vm->run(args, &globals))
    {
-      NXSL_Value *value = m_script->getResult();
+      NXSL_Value *value = vm->getResult();
       if (value != NULL)
       {
          bRet = value->getValueAsBoolean();
@@ -558,11 +654,11 @@ bool EPRule::matchScript(Event *pEvent)
    {
       TCHAR buffer[1024];
       _sntprintf(buffer, 1024, _T("EPP::%d"), m_id + 1);
-      PostSystemEvent(EVENT_SCRIPT_ERROR, g_dwMgmtNode, "ssd", buffer, m_script->getErrorText(), 0);
-      nxlog_write(NXLOG_ERROR, _T("Failed to execute evaluation script for event processing policy rule #%u (%s)"), m_id + 1, m_script->getErrorText());
+      PostSystemEvent(EVENT_SCRIPT_ERROR, g_dwMgmtNode, "ssd", buffer, vm->getErrorText(), 0);
+      nxlog_write(NXLOG_ERROR, _T("Failed to execute evaluation script for event processing policy rule #%u (%s)"), m_id + 1, vm->getErrorText());
    }
-   free(ppValueList);
    delete globals;
+   ReleaseServerScriptVM(vm);
 
    return bRet;
 }
@@ -588,11 +684,15 @@ bool EPRule::processEvent(Event *event)
    if (m_flags & RF_DISABLED)
       return false;
 
+   InterlockedIncrement64(&m_evaluationCount);
+
    // Check if event match
-   if (!matchSource(event->getSourceId()) || !matchEvent(event->getCode()) ||
-       !matchSeverity(event->getSeverity()) || !matchScript(event))
+   if (!matchEvent(event->getCode()) || !matchSeverity(event->getSeverity()) ||
+       !matchSource(event->getSourceId()) || !matchScript(event))
       return false;
 
+   InterlockedIncrement64(&m_matchCount);
+
    nxlog_debug_tag(DEBUG_TAG, 6, _T("Event ") UINT64_FMT _T(" match EPP rule %d"), event->getId(), (int)m_id + 1);
 
    // Generate alarm if requested
@@ -1076,7 +1176,7 @@ bool EPRule::isActionInUse(UINT32 actionId) const
 /**
  * Event processing policy constructor
  */
-EventPolicy::EventPolicy() : m_rules(128, 128, true)
+EventPolicy::EventPolicy() : m_rules(128, 128, true), m_eventCodeIndex(true), m_genericRules(64, 64)
 {
    m_rwlock = RWLockCreate();
 }
@@ -1118,9 +1218,72 @@ bool EventPolicy::loadFromDB()
    }
 
    DBConnectionPoolReleaseConnection(hdb);
+
+   writeLock();
+   buildEventCodeIndex();
+   unlock();
+
    return success;
 }
 
+/**
+ * Build index of candidate rules by event code. Each candidate list contains, in policy
+ * order, rules that explicitly reference event code and rules that can match any event
+ * code (with empty or negated event list). Disabled rules are not included. Should be
+ * called with policy locked for writing.
+ */
+void EventPolicy::buildEventCodeIndex()
+{
+   m_eventCodeIndex.clear();
+   m_genericRules.clear();
+
+   // Create candidate lists for all referenced event codes
+   for(int i = 0; i < m_rules.size(); i++)
+   {
+      const EPRule *rule = m_rules.get(i);
+      if (rule->isDisabled() || rule->isEventListNegated())
+         continue;
+      const IntegerArray<UINT32>& events = rule->getEvents();
+      for(int j = 0; j < events.size(); j++)
+      {
+         if (!m_eventCodeIndex.contains(events.get(j)))
+            m_eventCodeIndex.set(events.get(j), new IntegerArray<int>(16, 16));
+      }
+   }
+
+   // Add rules in policy order
+   for(int i = 0; i < m_rules.size(); i++)
+   {
+      const EPRule *rule = m_rules.get(i);
+      if (rule->isDisabled())
+         continue;
+
+      const IntegerArray<UINT32>& events = rule->getEvents();
+      if (events.isEmpty() || rule->isEventListNegated())
+      {
+         if (events.isEmpty() && rule->isEventListNegated())
+            continue;   // Rule will never match
+
+         m_genericRules.add(i);
+         Iterator<IntegerArray<int>> *it = m_eventCodeIndex.iterator();
+         while(it->hasNext())
+            it->next()->add(i);
+         delete it;
+      }
+      else
+      {
+         for(int j = 0; j < events.size(); j++)
+         {
+            IntegerArray<int> *candidates = m_eventCodeIndex.get(events.get(j));
+            if (candidates->isEmpty() || (candidates->get(candidates->size() - 1) != i))
+               candidates->add(i);
+         }
+      }
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 4, _T("EPP: event code index built (%d event codes, %d generic rules)"), m_eventCodeIndex.size(), m_genericRules.size());
+}
+
 /**
  * Save event processing policy to database
  */
@@ -1162,12 +1325,18 @@ void EventPolicy::processEvent(Event *pEvent)
 {
 	nxlog_debug_tag(DEBUG_TAG, 7, _T("EPP: processing event ") UINT64_FMT, pEvent->getId());
    readLock();
-   for(int i = 0; i < m_rules.size(); i++)
-      if (m_rules.get(i)->processEvent(pEvent))
+   const IntegerArray<int> *candidates = m_eventCodeIndex.get(pEvent->getCode());
+   if (candidates == NULL)
+      candidates = &m_genericRules;
+   for(int i = 0; i < candidates->size(); i++)
+   {
+      int ruleIndex = candidates->get(i);
+      if (m_rules.get(ruleIndex)->processEvent(pEvent))
 		{
-			nxlog_debug_tag(DEBUG_TAG, 7, _T("EPP: got \"stop processing\" flag for event ") UINT64_FMT _T(" at rule %d"), pEvent->getId(), i + 1);
+			nxlog_debug_tag(DEBUG_TAG, 7, _T("EPP: got \"stop processing\" flag for event ") UINT64_FMT _T(" at rule %d"), pEvent->getId(), ruleIndex + 1);
          break;   // EPRule::ProcessEvent() return TRUE if we should stop processing this event
 		}
+   }
    unlock();
 }
 
@@ -1206,6 +1375,7 @@ void EventPolicy::replacePolicy(UINT32 dwNumRules, EPRule **ppRuleList)
          m_rules.add(r);
       }
    }
+   buildEventCodeIndex();
    unlock();
 }
 
@@ -1367,6 +1537,7 @@ void EventPolicy::importRule(EPRule *rule, bool overwrite, ObjectArray<uuid> *ru
       }
    }
 
+   buildEventCodeIndex();
    unlock();
 }
 
@@ -1386,3 +1557,24 @@ json_t *EventPolicy::toJson() const
    json_object_set_new(root, "rules", rules);
    return root;
 }
+
+/**
+ * Show rule evaluation statistics on server console
+ */
+void EventPolicy::showStatistics(CONSOLE_CTX console) const
+{
+   ConsolePrintf(console, _T("Rule | Evaluations | Matches    | Comments\n"));
+   ConsolePrintf(console, _T("-----+-------------+------------+--------------------------------------------\n"));
+   readLock();
+   for(int i = 0; i < m_rules.size(); i++)
+   {
+      const EPRule *rule = m_rules.get(i);
+      TCHAR evaluations[32], matches[32];
+      _sntprintf(evaluations, 32, UINT64_FMT, rule->getEvaluationCount());
+      _sntprintf(matches, 32, UINT64_FMT, rule->getMatchCount());
+      ConsolePrintf(console, _T("%4d | %11s | %10s | %-.44s%s\n"), i + 1, evaluations, matches,
+               rule->getComments(), rule->isDisabled() ? _T(" (disabled)") : _T(""));
+   }
+   ConsolePrintf(console, _T("\n%d event codes in index, %d rules can match any event code\n\n"), m_eventCodeIndex.size(), m_genericRules.size());
+   unlock();
+}
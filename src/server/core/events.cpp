@@ -208,6 +208,7 @@ Event::Event()
    m_messageTemplate = NULL;
    m_timestamp = 0;
    m_originTimestamp = 0;
+   m_queueTime = 0;
 	m_customMessage = NULL;
 	m_parameters.setOwner(true);
 }
@@ -231,6 +232,7 @@ Event::Event(const Event *src)
    m_messageTemplate = MemCopyString(src->m_messageTemplate);
    m_timestamp = src->m_timestamp;
    m_originTimestamp = src->m_originTimestamp;
+   m_queueTime = src->m_queueTime;
    m_tags.addAll(src->m_tags);
 	m_customMessage = MemCopyString(src->m_customMessage);
 	m_parameters.setOwner(true);
@@ -473,6 +475,7 @@ void Event::init(const EventTemplate *eventTemplate, EventOrigin origin, time_t
    _tcscpy(m_name, eventTemplate->getName());
    m_timestamp = time(NULL);
    m_originTimestamp = (originTimestamp != 0) ? originTimestamp : m_timestamp;
+   m_queueTime = 0;
    m_id = CreateUniqueEventId();
    m_rootId = 0;
    m_code = eventTemplate->getCode();
@@ -31,7 +31,7 @@
 /**
  * Number of processed events since start
  */
-UINT64 g_totalEventsProcessed = 0;
+VolatileCounter64 g_totalEventsProcessed = 0;
 
 /**
  * Static data
@@ -97,6 +97,164 @@ static THREAD_RESULT THREAD_CALL EventStormDetector(void *arg)
 	return THREAD_OK;
 }
 
+/**
+ * Columns of event_log table used by event logger
+ */
+static const TCHAR *s_eventLogColumns = _T("event_id,event_code,event_timestamp,origin,origin_timestamp,event_source,zone_uin,dci_id,event_severity,event_message,root_event_id,event_tags,raw_data");
+static int s_eventLogColumnTypes[] = { DB_SQLTYPE_BIGINT, DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER,
+         DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER, DB_SQLTYPE_INTEGER, DB_SQLTYPE_VARCHAR, DB_SQLTYPE_BIGINT, DB_SQLTYPE_VARCHAR, DB_SQLTYPE_TEXT };
+
+/**
+ * Batch of events currently being written by event logger. Events in the batch are already
+ * removed from logger queue, so they are guarded by separate lock to be visible for FindEventInLoggerQueue.
+ */
+static Event **s_loggerBatch = NULL;
+static int s_loggerBatchSize = 0;
+static Mutex s_loggerBatchLock;
+
+/**
+ * Event logger statistics
+ */
+static VolatileCounter64 s_eventLogRecordsWritten = 0;
+static INT64 s_eventLogRateWindowStart = 0;
+static UINT64 s_eventLogRateWindowRecords = 0;
+static double s_eventLogRecordsPerSecond = 0;
+
+/**
+ * Add event to event log bulk insert
+ */
+static bool AddEventLogRow(DB_BULK_INSERT hBulk, Event *event)
+{
+   TCHAR id[32], code[16], timestamp[16], origin[16], originTimestamp[16], source[16], zone[16], dciId[16], severity[16], rootId[32];
+   _sntprintf(id, 32, UINT64_FMT, event->getId());
+   _sntprintf(code, 16, _T("%u"), event->getCode());
+   _sntprintf(timestamp, 16, _T("%u"), static_cast<UINT32>(event->getTimestamp()));
+   _sntprintf(origin, 16, _T("%d"), static_cast<int>(event->getOrigin()));
+   _sntprintf(originTimestamp, 16, _T("%u"), static_cast<UINT32>(event->getOriginTimestamp()));
+   _sntprintf(source, 16, _T("%u"), event->getSourceId());
+   _sntprintf(zone, 16, _T("%u"), event->getZoneUIN());
+   _sntprintf(dciId, 16, _T("%u"), event->getDciId());
+   _sntprintf(severity, 16, _T("%u"), event->getSeverity());
+   _sntprintf(rootId, 32, UINT64_FMT, event->getRootId());
+
+   TCHAR message[MAX_EVENT_MSG_LENGTH];
+   _tcslcpy(message, CHECK_NULL_EX(event->getMessage()), MAX_EVENT_MSG_LENGTH);
+
+   StringBuffer tags = event->getTagsAsList();
+   if (tags.length() > 2000)
+      tags.shrink(tags.length() - 2000);
+
+   json_t *json = event->toJson();
+   char *jsonText = json_dumps(json, JSON_INDENT(3) | JSON_EMBED);
+   json_decref(json);
+   TCHAR *rawData = (jsonText != NULL) ? TStringFromUTF8String(jsonText) : NULL;
+   MemFree(jsonText);
+
+   const TCHAR *values[13] = { id, code, timestamp, origin, originTimestamp, source, zone, dciId, severity, message, rootId, tags.getBuffer(), CHECK_NULL_EX(rawData) };
+   bool success = DBBulkInsertAddRow(hBulk, values);
+   MemFree(rawData);
+   return success;
+}
+
+/**
+ * Add events to event log with single bulk insert
+ */
+static bool BulkInsertEventLogRows(DB_HANDLE hdb, Event **batch, int count)
+{
+   DB_BULK_INSERT hBulk = DBBulkInsertBegin(hdb, _T("event_log"), s_eventLogColumns, 13, s_eventLogColumnTypes);
+   if (hBulk == NULL)
+      return false;
+
+   bool success = true;
+   for(int i = 0; (i < count) && success; i++)
+      success = AddEventLogRow(hBulk, batch[i]);
+   if (!DBBulkInsertEnd(hBulk))
+      success = false;
+   return success;
+}
+
+/**
+ * Insert events into event log one by one outside of transaction, so that event rejected
+ * by database does not affect other events. Returns number of events stored.
+ */
+static int InsertEventLogRows(DB_HANDLE hdb, Event **batch, int count)
+{
+   DB_STATEMENT hStmt = DBPrepare(hdb, _T("INSERT INTO event_log (event_id,event_code,event_timestamp,origin,")
+      _T("origin_timestamp,event_source,zone_uin,dci_id,event_severity,event_message,root_event_id,event_tags,raw_data) ")
+      _T("VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?)"), count > 1);
+   if (hStmt == NULL)
+      return 0;
+
+   int stored = 0;
+   for(int i = 0; i < count; i++)
+   {
+      Event *event = batch[i];
+      DBBind(hStmt, 1, DB_SQLTYPE_BIGINT, event->getId());
+      DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, event->getCode());
+      DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, static_cast<UINT32>(event->getTimestamp()));
+      DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, static_cast<INT32>(event->getOrigin()));
+      DBBind(hStmt, 5, DB_SQLTYPE_INTEGER, static_cast<UINT32>(event->getOriginTimestamp()));
+      DBBind(hStmt, 6, DB_SQLTYPE_INTEGER, event->getSourceId());
+      DBBind(hStmt, 7, DB_SQLTYPE_INTEGER, event->getZoneUIN());
+      DBBind(hStmt, 8, DB_SQLTYPE_INTEGER, event->getDciId());
+      DBBind(hStmt, 9, DB_SQLTYPE_INTEGER, event->getSeverity());
+      DBBind(hStmt, 10, DB_SQLTYPE_VARCHAR, event->getMessage(), DB_BIND_STATIC, MAX_EVENT_MSG_LENGTH);
+      DBBind(hStmt, 11, DB_SQLTYPE_BIGINT, event->getRootId());
+      DBBind(hStmt, 12, DB_SQLTYPE_VARCHAR, event->getTagsAsList(), DB_BIND_TRANSIENT, 2000);
+      DBBind(hStmt, 13, DB_SQLTYPE_TEXT, event->toJson(), DB_BIND_DYNAMIC);
+      if (DBExecute(hStmt))
+         stored++;
+      else
+         nxlog_debug_tag(DEBUG_TAG, 4, _T("EventLogger: cannot write event ") UINT64_FMT _T(" (code %u) to event log"), event->getId(), event->getCode());
+   }
+   DBFreeStatement(hStmt);
+   return stored;
+}
+
+/**
+ * Write batch of events to event log. If bulk insert fails, transaction is rolled back
+ * and events are inserted one by one, so only events rejected by database are lost.
+ */
+static void WriteEventLogBatch(Event **batch, int count)
+{
+   INT64 startTime = GetCurrentTimeMs();
+
+   int stored = 0;
+   DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
+   if (DBBegin(hdb))
+   {
+      if (BulkInsertEventLogRows(hdb, batch, count))
+      {
+         if (DBCommit(hdb))
+            stored = count;
+      }
+      else
+      {
+         DBRollback(hdb);
+      }
+   }
+   if (stored == 0)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 4, _T("EventLogger: bulk insert of %d events failed, inserting events one by one"), count);
+      stored = InsertEventLogRows(hdb, batch, count);
+      if (stored < count)
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Event logger: %d of %d events were not written to event log"), count - stored, count);
+   }
+   DBConnectionPoolReleaseConnection(hdb);
+
+   InterlockedAdd64(&s_eventLogRecordsWritten, stored);
+   s_eventLogRateWindowRecords += stored;
+
+   INT64 now = GetCurrentTimeMs();
+   if (now - s_eventLogRateWindowStart >= 1000)
+   {
+      s_eventLogRecordsPerSecond = static_cast<double>(s_eventLogRateWindowRecords) * 1000 / static_cast<double>(now - s_eventLogRateWindowStart);
+      s_eventLogRateWindowStart = now;
+      s_eventLogRateWindowRecords = 0;
+   }
+   nxlog_debug_tag(DEBUG_TAG, 8, _T("EventLogger: %d of %d events written in ") INT64_FMT _T(" ms"), stored, count, now - startTime);
+}
+
 /**
  * Event logger
  */
@@ -104,199 +262,318 @@ static THREAD_RESULT THREAD_CALL EventLogger(void *arg)
 {
    ThreadSetName("EventLogger");
 
-   while(true)
+   int maxBatchSize = ConfigReadInt(_T("Events.LogWriter.BatchSize"), 1000);
+   if (maxBatchSize < 1)
+      maxBatchSize = 1;
+   UINT32 maxDelay = ConfigReadULong(_T("Events.LogWriter.MaxDelay"), 500);
+
+   s_loggerBatch = MemAllocArray<Event*>(maxBatchSize);
+   s_eventLogRateWindowStart = GetCurrentTimeMs();
+
+   bool shutdown = false;
+   while(!shutdown)
    {
-      Event *pEvent = s_loggerQueue.getOrBlock();
-      if (pEvent == INVALID_POINTER_VALUE)
+      Event *event = s_loggerQueue.getOrBlock();
+      if (event == INVALID_POINTER_VALUE)
          break;   // Shutdown indicator
 
-		DB_HANDLE hdb = DBConnectionPoolAcquireConnection();
-		int syntaxId = DBGetSyntax(hdb);
-		if (syntaxId == DB_SYNTAX_SQLITE)
-		{ 
-			StringBuffer query = _T("INSERT INTO event_log (event_id,event_code,event_timestamp,event_source,zone_uin,origin,")
-			               _T("origin_timestamp,dci_id,event_severity,event_message,root_event_id,event_tags,raw_data) VALUES (");
-			query.append(pEvent->getId());
-         query.append(_T(','));
-			query.append(pEvent->getCode());
-         query.append(_T(','));
-         query.append((UINT32)pEvent->getTimestamp());
-         query.append(_T(','));
-         query.append(pEvent->getSourceId());
-         query.append(_T(','));
-         query.append(pEvent->getZoneUIN());
-         query.append(_T(','));
-         query.append(static_cast<INT32>(pEvent->getOrigin()));
-         query.append(_T(','));
-         query.append(static_cast<UINT32>(pEvent->getOriginTimestamp()));
-         query.append(_T(','));
-         query.append(pEvent->getDciId());
-         query.append(_T(','));
-         query.append(pEvent->getSeverity());
-         query.append(_T(','));
-         query.append(DBPrepareString(hdb, pEvent->getMessage(), MAX_EVENT_MSG_LENGTH));
-         query.append(_T(','));
-         query.append(pEvent->getRootId());
-         query.append(_T(','));
-         query.append(DBPrepareString(hdb, pEvent->getTagsAsList(), 2000));
-         query.append(_T(','));
-         json_t *json = pEvent->toJson();
-         char *jsonText = json_dumps(json, JSON_INDENT(3) | JSON_EMBED);
-         query.append(DBPrepareStringUTF8(hdb, jsonText));
-         MemFree(jsonText);
-         json_decref(json);
-         query.append(_T(')'));
-
-			DBQuery(hdb, query);
-			nxlog_debug_tag(DEBUG_TAG, 8, _T("EventLogger: DBQuery: id=%d,code=%d"), (int)pEvent->getId(), (int)pEvent->getCode());
-			delete pEvent;
-		}
-		else
-		{
-			DB_STATEMENT hStmt = DBPrepare(hdb, _T("INSERT INTO event_log (event_id,event_code,event_timestamp,origin,")
-				_T("origin_timestamp,event_source,zone_uin,dci_id,event_severity,event_message,root_event_id,event_tags,raw_data) ")
-				_T("VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?)"), true);
-			if (hStmt != NULL)
-			{
-				do
-				{
-					DBBind(hStmt, 1, DB_SQLTYPE_BIGINT, pEvent->getId());
-					DBBind(hStmt, 2, DB_SQLTYPE_INTEGER, pEvent->getCode());
-					DBBind(hStmt, 3, DB_SQLTYPE_INTEGER, static_cast<UINT32>(pEvent->getTimestamp()));
-               DBBind(hStmt, 4, DB_SQLTYPE_INTEGER, static_cast<INT32>(pEvent->getOrigin()));
-               DBBind(hStmt, 5, DB_SQLTYPE_INTEGER, static_cast<UINT32>(pEvent->getOriginTimestamp()));
-					DBBind(hStmt, 6, DB_SQLTYPE_INTEGER, pEvent->getSourceId());
-               DBBind(hStmt, 7, DB_SQLTYPE_INTEGER, pEvent->getZoneUIN());
-               DBBind(hStmt, 8, DB_SQLTYPE_INTEGER, pEvent->getDciId());
-					DBBind(hStmt, 9, DB_SQLTYPE_INTEGER, pEvent->getSeverity());
-               DBBind(hStmt, 10, DB_SQLTYPE_VARCHAR, pEvent->getMessage(), DB_BIND_STATIC, MAX_EVENT_MSG_LENGTH);
-					DBBind(hStmt, 11, DB_SQLTYPE_BIGINT, pEvent->getRootId());
-               DBBind(hStmt, 12, DB_SQLTYPE_VARCHAR, pEvent->getTagsAsList(), DB_BIND_TRANSIENT, 2000);
-               DBBind(hStmt, 13, DB_SQLTYPE_TEXT, pEvent->toJson(), DB_BIND_DYNAMIC);
-					DBExecute(hStmt);
-					nxlog_debug_tag(DEBUG_TAG, 8, _T("EventLogger: DBExecute: id=%d,code=%d"), (int)pEvent->getId(), (int)pEvent->getCode());
-					delete pEvent;
-					pEvent = s_loggerQueue.getOrBlock(500);
-				} while((pEvent != NULL) && (pEvent != INVALID_POINTER_VALUE));
-				DBFreeStatement(hStmt);
-			}
-			else
-			{
-				delete pEvent;
-			}
-		}
+      // Collect batch until it is full or flush delay expires
+      INT64 deadline = GetCurrentTimeMs() + maxDelay;
+      while(true)
+      {
+         s_loggerBatchLock.lock();
+         s_loggerBatch[s_loggerBatchSize++] = event;
+         s_loggerBatchLock.unlock();
+         if (s_loggerBatchSize == maxBatchSize)
+            break;
+
+         INT64 now = GetCurrentTimeMs();
+         event = (now < deadline) ? s_loggerQueue.getOrBlock(static_cast<UINT32>(deadline - now)) : s_loggerQueue.get();
+         if (event == NULL)
+            break;
+         if (event == INVALID_POINTER_VALUE)
+         {
+            shutdown = true;
+            break;
+         }
+      }
 
-		DBConnectionPoolReleaseConnection(hdb);
-		if (pEvent == INVALID_POINTER_VALUE)
-         break;   // Shutdown indicator (need second check if got it in inner loop)
-	}
-	return THREAD_OK;
+      WriteEventLogBatch(s_loggerBatch, s_loggerBatchSize);
+
+      s_loggerBatchLock.lock();
+      int count = s_loggerBatchSize;
+      s_loggerBatchSize = 0;
+      s_loggerBatchLock.unlock();
+      for(int i = 0; i < count; i++)
+         delete s_loggerBatch[i];
+   }
+
+   nxlog_debug_tag(DEBUG_TAG, 1, _T("Event logger thread stopped"));
+   return THREAD_OK;
 }
 
 /**
- * Event processing thread
+ * Event processing thread (shard) data
  */
-THREAD_RESULT THREAD_CALL EventProcessor(void *arg)
+struct EventProcessingShard
 {
-   ThreadSetName("EventProcessor");
-
-	s_threadLogger = ThreadCreateEx(EventLogger, 0, NULL);
-	s_threadStormDetector = ThreadCreateEx(EventStormDetector, 0, NULL);
-   while(true)
+   int index;
+   THREAD thread;
+   ObjectQueue<Event> queue;
+   VolatileCounter64 processedEvents;
+   double averageWaitTime;        // Moving average of time from dispatch to processing start (milliseconds)
+   double averageProcessingTime;  // Moving average of event processing time (milliseconds)
+
+   EventProcessingShard(int _index)
    {
-      Event *pEvent = g_eventQueue.getOrBlock();
-      if (pEvent == INVALID_POINTER_VALUE)
-         break;   // Shutdown indicator
+      index = _index;
+      thread = INVALID_THREAD_HANDLE;
+      processedEvents = 0;
+      averageWaitTime = 0;
+      averageProcessingTime = 0;
+   }
+};
 
-		if (g_flags & AF_EVENT_STORM_DETECTED)
-		{
-	      delete pEvent;
-	      g_totalEventsProcessed++;
-			continue;
-		}
+/**
+ * Event processing shards (only used if more than one event processing thread is configured)
+ */
+static ObjectArray<EventProcessingShard> s_shards(0, 16, true);
 
-      // Expand message text
-      // We cannot expand message text in PostEvent because of
-      // possible deadlock on g_rwlockIdIndex
-      pEvent->expandMessageText();
+/**
+ * Process single event. Event object will be destroyed or passed to event log writer.
+ */
+static void ProcessEvent(Event *pEvent, bool correlate)
+{
+   // Expand message text
+   // We cannot expand message text in PostEvent because of
+   // possible deadlock on g_rwlockIdIndex
+   pEvent->expandMessageText();
 
-      // Attempt to correlate event to some of previous events
+   // Attempt to correlate event to some of previous events
+   if (correlate)
       CorrelateEvent(pEvent);
 
-		// Pass event to modules
-      CALL_ALL_MODULES(pfEventHandler, (pEvent));
+   // Pass event to modules
+   CALL_ALL_MODULES(pfEventHandler, (pEvent));
 
-      NetObj *sourceObject = FindObjectById(pEvent->getSourceId());
+   NetObj *sourceObject = FindObjectById(pEvent->getSourceId());
+   if (sourceObject == NULL)
+   {
+      sourceObject = FindObjectById(g_dwMgmtNode);
       if (sourceObject == NULL)
-      {
-         sourceObject = FindObjectById(g_dwMgmtNode);
-         if (sourceObject == NULL)
-            sourceObject = g_pEntireNet;
-      }
+         sourceObject = g_pEntireNet;
+   }
 
-      ScriptVMHandle vm = CreateServerScriptVM(_T("Hook::EventProcessor"), sourceObject);
-      if (vm.isValid())
+   ScriptVMHandle vm = AcquireServerScriptVM(_T("Hook::EventProcessor"), sourceObject);
+   if (vm.isValid())
+   {
+      nxlog_debug_tag(DEBUG_TAG, 7, _T("Running event processor hook script"));
+      vm->setGlobalVariable("$event", vm->createValue(new NXSL_Object(vm, &g_nxslEventClass, pEvent, true)));
+      if (!vm->run())
       {
-         nxlog_debug_tag(DEBUG_TAG, 7, _T("Running event processor hook script"));
-         vm->setGlobalVariable("$event", vm->createValue(new NXSL_Object(vm, &g_nxslEventClass, pEvent, true)));
-         if (!vm->run())
+         if (pEvent->getCode() != EVENT_SCRIPT_ERROR) // To avoid infinite loop
          {
-            if (pEvent->getCode() != EVENT_SCRIPT_ERROR) // To avoid infinite loop
-            {
-               PostSystemEvent(EVENT_SCRIPT_ERROR, g_dwMgmtNode, "ssd", _T("Hook::EventProcessor"), vm->getErrorText(), 0);
-            }
-            nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Event processor hook script execution error (%s)"), vm->getErrorText());
+            PostSystemEvent(EVENT_SCRIPT_ERROR, g_dwMgmtNode, "ssd", _T("Hook::EventProcessor"), vm->getErrorText(), 0);
          }
+         nxlog_write_tag(NXLOG_WARNING, DEBUG_TAG, _T("Event processor hook script execution error (%s)"), vm->getErrorText());
       }
+      ReleaseServerScriptVM(vm);
+   }
 
-      // Send event to all connected clients
-      EnumerateClientSessions(BroadcastEvent, pEvent);
+   // Send event to all connected clients
+   EnumerateClientSessions(BroadcastEvent, pEvent);
 
-      // Write event information to debug
-      if (nxlog_get_debug_level_tag(DEBUG_TAG) >= 5)
-      {
-			nxlog_debug_tag(DEBUG_TAG, 5, _T("EVENT %s [%d] (ID:") UINT64_FMT _T(" F:0x%04X S:%d TAGS:\"%s\"%s) FROM %s: %s"),
-                         pEvent->getName(), pEvent->getCode(), pEvent->getId(), pEvent->getFlags(), pEvent->getSeverity(),
-						       (const TCHAR *)pEvent->getTagsAsList(),
-                         (pEvent->getRootId() == 0) ? _T("") : _T(" CORRELATED"),
-                         sourceObject->getName(), pEvent->getMessage());
-      }
+   // Write event information to debug
+   if (nxlog_get_debug_level_tag(DEBUG_TAG) >= 5)
+   {
+      nxlog_debug_tag(DEBUG_TAG, 5, _T("EVENT %s [%d] (ID:") UINT64_FMT _T(" F:0x%04X S:%d TAGS:\"%s\"%s) FROM %s: %s"),
+                      pEvent->getName(), pEvent->getCode(), pEvent->getId(), pEvent->getFlags(), pEvent->getSeverity(),
+                      (const TCHAR *)pEvent->getTagsAsList(),
+                      (pEvent->getRootId() == 0) ? _T("") : _T(" CORRELATED"),
+                      sourceObject->getName(), pEvent->getMessage());
+   }
 
-      // Pass event through event processing policy if it is not correlated
-      if (pEvent->getRootId() == 0)
-		{
+   // Pass event through event processing policy if it is not correlated
+   if (pEvent->getRootId() == 0)
+   {
 #ifdef WITH_ZMQ
-         ZmqPublishEvent(pEvent);
+      ZmqPublishEvent(pEvent);
 #endif
 
-         g_pEventPolicy->processEvent(pEvent);
-         nxlog_debug_tag(DEBUG_TAG, 7, _T("Event ") UINT64_FMT _T(" with code %d passed event processing policy"), pEvent->getId(), pEvent->getCode());
-		}
+      g_pEventPolicy->processEvent(pEvent);
+      nxlog_debug_tag(DEBUG_TAG, 7, _T("Event ") UINT64_FMT _T(" with code %d passed event processing policy"), pEvent->getId(), pEvent->getCode());
+   }
 
-      // Write event to log if required, otherwise destroy it
-		// Don't write SYS_DB_QUERY_FAILED to log to prevent
-		// possible event recursion in case of severe DB failure
-		// Logger will destroy event object after logging
-		if ((pEvent->getFlags() & EF_LOG) && (pEvent->getCode() != EVENT_DB_QUERY_FAILED))
-		{
-			s_loggerQueue.put(pEvent);
-		}
-		else
+   // Write event to log if required, otherwise destroy it
+   // Don't write SYS_DB_QUERY_FAILED to log to prevent
+   // possible event recursion in case of severe DB failure
+   // Logger will destroy event object after logging
+   if ((pEvent->getFlags() & EF_LOG) && (pEvent->getCode() != EVENT_DB_QUERY_FAILED))
+   {
+      s_loggerQueue.put(pEvent);
+   }
+   else
+   {
+      delete pEvent;
+      nxlog_debug_tag(DEBUG_TAG, 7, _T("Event object destroyed"));
+   }
+
+   InterlockedIncrement64(&g_totalEventsProcessed);
+}
+
+/**
+ * Event processing shard thread
+ */
+static THREAD_RESULT THREAD_CALL EventProcessingShardThread(void *arg)
+{
+   EventProcessingShard *shard = static_cast<EventProcessingShard*>(arg);
+
+   char threadName[16];
+   snprintf(threadName, 16, "EventProc/%d", shard->index);
+   ThreadSetName(threadName);
+   EnableScriptVMCache();
+
+   while(true)
+   {
+      Event *pEvent = shard->queue.getOrBlock();
+      if (pEvent == INVALID_POINTER_VALUE)
+         break;   // Shutdown indicator
+
+      INT64 startTime = GetCurrentTimeMs();
+      shard->averageWaitTime = (shard->averageWaitTime * 15 + static_cast<double>(startTime - pEvent->getQueueTime())) / 16;
+
+      // Correlation is done by dispatcher thread
+      ProcessEvent(pEvent, false);
+
+      shard->averageProcessingTime = (shard->averageProcessingTime * 15 + static_cast<double>(GetCurrentTimeMs() - startTime)) / 16;
+      InterlockedIncrement64(&shard->processedEvents);
+   }
+
+   DisableScriptVMCache();
+   nxlog_debug_tag(DEBUG_TAG, 2, _T("Event processing thread #%d stopped"), shard->index);
+   return THREAD_OK;
+}
+
+/**
+ * Event processing thread. If event processing pool size is greater than one, this thread
+ * only dispatches events to processing threads. Events are assigned to threads by source object ID,
+ * so events from same object are always processed in order they were posted. Event correlation
+ * uses and updates state of multiple objects, so it is always done by this thread in event posting order.
+ */
+THREAD_RESULT THREAD_CALL EventProcessor(void *arg)
+{
+   ThreadSetName("EventProcessor");
+
+   s_threadLogger = ThreadCreateEx(EventLogger, 0, NULL);
+   s_threadStormDetector = ThreadCreateEx(EventStormDetector, 0, NULL);
+   EnableScriptVMCache();
+
+   int poolSize = ConfigReadInt(_T("Events.Processor.PoolSize"), 1);
+   if (poolSize > 1)
+   {
+      if (poolSize > 64)
+         poolSize = 64;
+      for(int i = 0; i < poolSize; i++)
       {
-			delete pEvent;
-			nxlog_debug_tag(DEBUG_TAG, 7, _T("Event object destroyed"));
-		}
-      
-      g_totalEventsProcessed++;
+         EventProcessingShard *shard = new EventProcessingShard(i);
+         s_shards.add(shard);
+         shard->thread = ThreadCreateEx(EventProcessingShardThread, 0, shard);
+      }
+      nxlog_debug_tag(DEBUG_TAG, 1, _T("%d event processing threads started"), poolSize);
+   }
+
+   while(true)
+   {
+      Event *pEvent = g_eventQueue.getOrBlock();
+      if (pEvent == INVALID_POINTER_VALUE)
+         break;   // Shutdown indicator
+
+      if (g_flags & AF_EVENT_STORM_DETECTED)
+      {
+         delete pEvent;
+         InterlockedIncrement64(&g_totalEventsProcessed);
+         continue;
+      }
+
+      if (s_shards.isEmpty())
+      {
+         ProcessEvent(pEvent, true);
+         continue;
+      }
+
+      CorrelateEvent(pEvent);
+      pEvent->setQueueTime(GetCurrentTimeMs());
+      s_shards.get(pEvent->getSourceId() % s_shards.size())->queue.put(pEvent);
    }
 
-	s_loggerQueue.put(INVALID_POINTER_VALUE);
-	ThreadJoin(s_threadStormDetector);
-	ThreadJoin(s_threadLogger);
+   for(int i = 0; i < s_shards.size(); i++)
+      s_shards.get(i)->queue.put(INVALID_POINTER_VALUE);
+   for(int i = 0; i < s_shards.size(); i++)
+      ThreadJoin(s_shards.get(i)->thread);
+   DisableScriptVMCache();
+
+   s_loggerQueue.put(INVALID_POINTER_VALUE);
+   ThreadJoin(s_threadStormDetector);
+   ThreadJoin(s_threadLogger);
    nxlog_debug_tag(DEBUG_TAG, 1, _T("Event processing thread stopped"));
    return THREAD_OK;
 }
 
+/**
+ * Get event processing thread statistic for internal parameter Server.EventProcessor.*(index)
+ */
+DataCollectionError GetEventProcessorStatistic(const TCHAR *parameter, TCHAR *value)
+{
+   TCHAR buffer[32];
+   if (!AgentGetParameterArg(parameter, 1, buffer, 32))
+      return DCE_NOT_SUPPORTED;
+
+   TCHAR *eptr;
+   int index = _tcstol(buffer, &eptr, 10);
+   if (*eptr != 0)
+      return DCE_NOT_SUPPORTED;
+
+   // Shard list is only modified during event processor startup
+   EventProcessingShard *shard = s_shards.get(index);
+   if (shard == NULL)
+      return DCE_NO_SUCH_INSTANCE;
+
+   if (MatchString(_T("Server.EventProcessor.AverageProcessingTime(*)"), parameter, false))
+      ret_double(value, shard->averageProcessingTime, 3);
+   else if (MatchString(_T("Server.EventProcessor.AverageWaitTime(*)"), parameter, false))
+      ret_double(value, shard->averageWaitTime, 3);
+   else if (MatchString(_T("Server.EventProcessor.ProcessedEvents(*)"), parameter, false))
+      ret_uint64(value, shard->processedEvents);
+   else if (MatchString(_T("Server.EventProcessor.QueueSize(*)"), parameter, false))
+      ret_int(value, static_cast<int>(shard->queue.size()));
+   else
+      return DCE_NOT_SUPPORTED;
+   return DCE_SUCCESS;
+}
+
+/**
+ * Show event processing threads statistics on server console
+ */
+void ShowEventProcessorStatistics(CONSOLE_CTX console)
+{
+   if (s_shards.isEmpty())
+   {
+      ConsolePrintf(console, _T("Parallel event processing is disabled\n\n"));
+      return;
+   }
+
+   ConsolePrintf(console, _T("\x1b[1mThread | Queue    | Processed events     | Avg. wait (ms) | Avg. processing (ms)\x1b[0m\n"));
+   for(int i = 0; i < s_shards.size(); i++)
+   {
+      EventProcessingShard *shard = s_shards.get(i);
+      TCHAR processed[32];
+      _sntprintf(processed, 32, UINT64_FMT, static_cast<UINT64>(shard->processedEvents));
+      ConsolePrintf(console, _T("%6d | %8d | %20s | %14.3f | %20.3f\n"), shard->index, static_cast<int>(shard->queue.size()),
+               processed, shard->averageWaitTime, shard->averageProcessingTime);
+   }
+   ConsolePrintf(console, _T("\n"));
+}
+
 /**
  * Compare event with ID
  */
@@ -319,7 +596,22 @@ static Event *CopyEvent(Event *event)
  */
 Event *FindEventInLoggerQueue(UINT64 eventId)
 {
-   return s_loggerQueue.find(&eventId, CompareEvent, CopyEvent);
+   Event *event = s_loggerQueue.find(&eventId, CompareEvent, CopyEvent);
+   if (event != NULL)
+      return event;
+
+   // Event could be already taken from queue but not written yet
+   s_loggerBatchLock.lock();
+   for(int i = 0; i < s_loggerBatchSize; i++)
+   {
+      if (s_loggerBatch[i]->getId() == eventId)
+      {
+         event = new Event(s_loggerBatch[i]);
+         break;
+      }
+   }
+   s_loggerBatchLock.unlock();
+   return event;
 }
 
 /**
@@ -327,5 +619,22 @@ Event *FindEventInLoggerQueue(UINT64 eventId)
  */
 INT64 GetEventLogWriterQueueSize()
 {
-   return s_loggerQueue.size();
+   return s_loggerQueue.size() + s_loggerBatchSize;
+}
+
+/**
+ * Get number of records written to event log since server start
+ */
+UINT64 GetEventLogWriterRecordsWritten()
+{
+   return static_cast<UINT64>(InterlockedAdd64(&s_eventLogRecordsWritten, 0));
+}
+
+/**
+ * Get event log write rate (records per second). Rate is calculated by event logger thread
+ * after each batch, so it is reset to zero if there were no writes for some time.
+ */
+double GetEventLogWriterRecordsPerSecond()
+{
+   return (GetCurrentTimeMs() - s_eventLogRateWindowStart < 5000) ? s_eventLogRecordsPerSecond : 0;
 }
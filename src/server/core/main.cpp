@@ -159,6 +159,7 @@ RSA *g_pServerKey = NULL;
 time_t g_serverStartTime = 0;
 UINT32 g_lockTimeout = 60000;   // Default timeout for acquiring mutex
 UINT32 g_agentCommandTimeout = 4000;  // Default timeout for requests to agent
+UINT32 g_snmpTransportIdleTimeout = 300;  // Idle timeout for pooled SNMP transports
 UINT32 g_thresholdRepeatInterval = 0;	// Disabled by default
 UINT32 g_requiredPolls = 1;
 INT32 g_instanceRetentionTime = 0; // Default instance retention time
@@ -405,6 +406,8 @@ static void LoadGlobalConfig()
 
    UINT32 snmpTimeout = ConfigReadInt(_T("SNMPRequestTimeout"), 1500);
    SnmpSetDefaultTimeout(snmpTimeout);
+   SnmpSetBulkWalkMaxRepetitions(ConfigReadInt(_T("SNMPBulkWalkMaxRepetitions"), 64));
+   g_snmpTransportIdleTimeout = ConfigReadInt(_T("SNMPTransportIdleTimeout"), 300);
 }
 
 /**
@@ -943,6 +946,21 @@ BOOL NXCORE_EXPORTABLE Initialize()
          ConfigReadInt(_T("ThreadPool.Agent.BaseSize"), 4),
          ConfigReadInt(_T("ThreadPool.Agent.MaxSize"), 256));
 
+   NXCPSetCompressionThreshold(ConfigReadULong(_T("NXCP.CompressionThreshold"), NXCP_DEFAULT_COMPRESSION_THRESHOLD));
+   NXCPSetCompressedFileDetection(ConfigReadBoolean(_T("NXCP.DetectCompressedFiles"), true));
+
+   // Start shared receiver for agent connections and tunnels
+   int receiverThreads = ConfigReadInt(_T("AgentConnections.ReceiverThreads"), 4);
+   if (receiverThreads > 0)
+   {
+      g_agentReceiverThreadPool = ThreadPoolCreate(_T("AGENTRECV"), receiverThreads, ConfigReadInt(_T("ThreadPool.Agent.MaxSize"), 256));
+      if (!SocketReceiver::start(receiverThreads))
+      {
+         ThreadPoolDestroy(g_agentReceiverThreadPool);
+         g_agentReceiverThreadPool = NULL;
+      }
+   }
+
    // Setup unique identifiers table
    if (!InitIdTable())
       return FALSE;
@@ -1219,6 +1237,7 @@ void NXCORE_EXPORTABLE Shutdown()
    ThreadJoin(s_mobileDeviceListenerThread);
 
    CloseAgentTunnels();
+   SocketReceiver::shutdown();
    StopSyslogServer();
 
    nxlog_debug(2, _T("Waiting for event processor to stop"));
@@ -1269,6 +1288,8 @@ void NXCORE_EXPORTABLE Shutdown()
    nxlog_debug(1, _T("Event processing stopped"));
 
    ThreadPoolDestroy(g_clientThreadPool);
+   if (g_agentReceiverThreadPool != NULL)
+      ThreadPoolDestroy(g_agentReceiverThreadPool);
    ThreadPoolDestroy(g_agentConnectionThreadPool);
    ThreadPoolDestroy(g_mainThreadPool);
    WatchdogShutdown();
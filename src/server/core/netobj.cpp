@@ -716,6 +716,7 @@ void NetObj::addChild(NetObj *object)
    super::addChild(object);
 	incRefCount();
 	markAsModified(MODIFY_RELATIONS);
+   InterlockedIncrement(&g_objectTreeVersion);
    DbgPrintf(7, _T("NetObj::addChild: this=%s [%d]; object=%s [%d]"), m_name, m_id, object->m_name, object->m_id);
 }
 
@@ -739,6 +740,7 @@ void NetObj::deleteChild(NetObj *object)
    super::deleteChild(object);
 	decRefCount();
 	markAsModified(MODIFY_RELATIONS);
+   InterlockedIncrement(&g_objectTreeVersion);
 }
 
 /**
@@ -35,6 +35,7 @@
 extern VolatileCounter64 g_syslogMessagesReceived;
 extern VolatileCounter64 g_snmpTrapsReceived;
 extern UINT32 g_averageDCIQueuingTime;
+extern UINT32 g_averageDCISchedulingLag;
 
 /**
  * Poller thread pool
@@ -74,7 +75,8 @@ ObjectArray<HardwareComponent> *CalculateHardwareChanges(ObjectArray<HardwareCom
  * Node class default constructor
  */
 Node::Node() : super(), m_topologyPollState(_T("topology")),
-         m_discoveryPollState(_T("discovery")), m_routingPollState(_T("routing")), m_icmpPollState(_T("icmp)"))
+         m_discoveryPollState(_T("discovery")), m_routingPollState(_T("routing")), m_icmpPollState(_T("icmp)")),
+         m_snmpTransportPool(0, 4, true)
 {
    m_primaryName[0] = 0;
    m_status = STATUS_UNKNOWN;
@@ -100,6 +102,7 @@ Node::Node() : super(), m_topologyPollState(_T("topology")),
    m_hSmclpAccessMutex = MutexCreate();
    m_mutexRTAccess = MutexCreate();
    m_mutexTopoAccess = MutexCreate();
+   m_snmpTransportPoolLock = MutexCreateFast();
    m_agentConnection = NULL;
    m_proxyConnections = new ProxyAgentConnection[MAX_PROXY_TYPE];
    m_pendingDataConfigurationSync = 0;
@@ -175,7 +178,8 @@ Node::Node() : super(), m_topologyPollState(_T("topology")),
  * Create new node from new node data
  */
 Node::Node(const NewNodeData *newNodeData, UINT32 flags)  : super(), m_topologyPollState(_T("topology")),
-         m_discoveryPollState(_T("discovery")), m_routingPollState(_T("routing")), m_icmpPollState(_T("icmp)"))
+         m_discoveryPollState(_T("discovery")), m_routingPollState(_T("routing")), m_icmpPollState(_T("icmp)")),
+         m_snmpTransportPool(0, 4, true)
 {
    m_runtimeFlags |= ODF_CONFIGURATION_POLL_PENDING;
    newNodeData->ipAddr.toString(m_primaryName);
@@ -211,6 +215,7 @@ Node::Node(const NewNodeData *newNodeData, UINT32 flags)  : super(), m_topologyP
    m_hSmclpAccessMutex = MutexCreate();
    m_mutexRTAccess = MutexCreate();
    m_mutexTopoAccess = MutexCreate();
+   m_snmpTransportPoolLock = MutexCreateFast();
    m_agentConnection = NULL;
    m_proxyConnections = new ProxyAgentConnection[MAX_PROXY_TYPE];
    m_pendingDataConfigurationSync = 0;
@@ -295,6 +300,7 @@ Node::~Node()
    MutexDestroy(m_hSmclpAccessMutex);
    MutexDestroy(m_mutexRTAccess);
    MutexDestroy(m_mutexTopoAccess);
+   MutexDestroy(m_snmpTransportPoolLock);
    if (m_agentConnection != NULL)
       m_agentConnection->decRefCount();
    for(int i = 0; i < MAX_PROXY_TYPE; i++)
@@ -1145,11 +1151,11 @@ ArpCache *Node::getArpCache(bool forceRead)
    }
    else if ((m_capabilities & NC_IS_SNMP) && (m_driver != NULL))
    {
-      SNMP_Transport *transport = createSnmpTransport();
+      SNMP_Transport *transport = acquireSnmpTransport();
       if (transport != NULL)
       {
          arpCache = m_driver->getArpCache(transport, m_driverData);
-         delete transport;
+         releaseSnmpTransport(transport);
       }
    }
 
@@ -1191,7 +1197,7 @@ InterfaceList *Node::getInterfaceList()
    if ((pIfList == NULL) && (m_capabilities & NC_IS_SNMP) &&
        (!(m_flags & NF_DISABLE_SNMP)) && (m_driver != NULL))
    {
-      SNMP_Transport *pTransport = createSnmpTransport();
+      SNMP_Transport *pTransport = acquireSnmpTransport();
       if (pTransport != NULL)
       {
          bool useIfXTable;
@@ -1213,7 +1219,7 @@ InterfaceList *Node::getInterfaceList()
          {
             BridgeMapPorts(pTransport, pIfList);
          }
-         delete pTransport;
+         releaseSnmpTransport(pTransport, pIfList != NULL);
       }
       else
       {
@@ -1907,7 +1913,7 @@ void Node::statusPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId)
       UINT32 dwResult;
 
       nxlog_debug_tag(DEBUG_TAG_STATUS_POLL, 6, _T("StatusPoll(%s): check SNMP"), m_name);
-      SNMP_Transport *pTransport = createSnmpTransport();
+      SNMP_Transport *pTransport = acquireSnmpTransport();
       if (pTransport != NULL)
       {
          poller->setStatus(_T("check SNMP"));
@@ -1951,7 +1957,8 @@ void Node::statusPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId)
             lockProperties();
             m_snmpSecurity->setAuthoritativeEngine(SNMP_Engine());
             unlockProperties();
-            delete pTransport;
+            invalidateSnmpTransportPool();
+            releaseSnmpTransport(pTransport, false);
             retryCount--;
             goto restart_agent_check;
          }
@@ -1966,7 +1973,7 @@ void Node::statusPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId)
                   if (retryCount > 0)
                   {
                      retryCount--;
-                     delete pTransport;
+                     releaseSnmpTransport(pTransport, false);
                      goto restart_agent_check;
                   }
                }
@@ -1996,7 +2003,7 @@ void Node::statusPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId)
                }
             }
          }
-         delete pTransport;
+         releaseSnmpTransport(pTransport, (dwResult == SNMP_ERR_SUCCESS) || (dwResult == SNMP_ERR_NO_OBJECT));
       }
       else
       {
@@ -2139,7 +2146,7 @@ void Node::statusPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId)
    poller->setStatus(_T("child poll"));
    DbgPrintf(7, _T("StatusPoll(%s): starting child object poll"), m_name);
    Cluster *cluster = getMyCluster();
-   SNMP_Transport *snmp = createSnmpTransport();
+   SNMP_Transport *snmp = acquireSnmpTransport();
    for(int i = 0; i < pollList.size(); i++)
    {
       NetObj *curr = pollList.get(i);
@@ -2166,9 +2173,9 @@ void Node::statusPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId)
       }
       curr->decRefCount();
 
-      POLL_CANCELLATION_CHECKPOINT_EX({ for(i++; i < pollList.size(); i++) pollList.get(i)->decRefCount(); delete eventQueue; delete snmp; });
+      POLL_CANCELLATION_CHECKPOINT_EX({ for(i++; i < pollList.size(); i++) pollList.get(i)->decRefCount(); delete eventQueue; releaseSnmpTransport(snmp); });
    }
-   delete snmp;
+   releaseSnmpTransport(snmp);
    if (pollerNode != NULL)
       pollerNode->decRefCount();
    nxlog_debug(7, _T("StatusPoll(%s): finished child object poll"), m_name);
@@ -3888,6 +3895,7 @@ bool Node::confPollSnmp(UINT32 rqId)
       sendPollerMsg(rqId, POLLER_INFO _T("   Connectivity with SNMP agent restored\r\n"));
    }
    unlockProperties();
+   invalidateSnmpTransportPool();
    sendPollerMsg(rqId, _T("   SNMP agent is active (version %s)\r\n"),
             (m_snmpVersion == SNMP_VERSION_3) ? _T("3") : ((m_snmpVersion == SNMP_VERSION_2C) ? _T("2c") : _T("1")));
    nxlog_debug_tag(DEBUG_TAG_CONF_POLL, 5, _T("ConfPoll(%s): SNMP agent detected (version %s)"), m_name,
@@ -4962,6 +4970,71 @@ inline DataCollectionError DCErrorFromSNMPError(UINT32 snmpError)
    }
 }
 
+/**
+ * Format SNMP raw value according to requested interpretation
+ */
+static void FormatSNMPRawValue(const BYTE *rawValue, int interpretRawValue, TCHAR *buffer, size_t bufSize)
+{
+   switch(interpretRawValue)
+   {
+      case SNMP_RAWTYPE_INT32:
+         _sntprintf(buffer, bufSize, _T("%d"), ntohl(*((LONG *)rawValue)));
+         break;
+      case SNMP_RAWTYPE_UINT32:
+         _sntprintf(buffer, bufSize, _T("%u"), ntohl(*((UINT32 *)rawValue)));
+         break;
+      case SNMP_RAWTYPE_INT64:
+         _sntprintf(buffer, bufSize, INT64_FMT, (INT64)ntohq(*((INT64 *)rawValue)));
+         break;
+      case SNMP_RAWTYPE_UINT64:
+         _sntprintf(buffer, bufSize, UINT64_FMT, ntohq(*((QWORD *)rawValue)));
+         break;
+      case SNMP_RAWTYPE_DOUBLE:
+         _sntprintf(buffer, bufSize, _T("%f"), ntohd(*((double *)rawValue)));
+         break;
+      case SNMP_RAWTYPE_IP_ADDR:
+         IpToStr(ntohl(*((UINT32 *)rawValue)), buffer);
+         break;
+      case SNMP_RAWTYPE_MAC_ADDR:
+         MACToStr(rawValue, buffer);
+         break;
+      default:
+         buffer[0] = 0;
+         break;
+   }
+}
+
+/**
+ * Get single value via SNMP using given transport
+ */
+static UINT32 GetSNMPValue(SNMP_Transport *snmp, const TCHAR *param, size_t bufSize, TCHAR *buffer, int interpretRawValue)
+{
+   UINT32 rc;
+   if (interpretRawValue == SNMP_RAWTYPE_NONE)
+   {
+      rc = SnmpGetEx(snmp, param, NULL, 0, buffer, bufSize * sizeof(TCHAR), SG_PSTRING_RESULT, NULL);
+   }
+   else
+   {
+      BYTE rawValue[1024];
+      memset(rawValue, 0, 1024);
+      rc = SnmpGetEx(snmp, param, NULL, 0, rawValue, 1024, SG_RAW_RESULT, NULL);
+      if (rc == SNMP_ERR_SUCCESS)
+         FormatSNMPRawValue(rawValue, interpretRawValue, buffer, bufSize);
+   }
+   return rc;
+}
+
+/**
+ * Check if SNMP data collection is possible for given port
+ */
+bool Node::isSNMPDataCollectionPossible(UINT16 port)
+{
+   return !((((m_state & NSF_SNMP_UNREACHABLE) || !(m_capabilities & NC_IS_SNMP)) && (port == 0)) ||
+            (m_state & DCSF_UNREACHABLE) ||
+            (m_flags & NF_DISABLE_SNMP));
+}
+
 /**
  * Get DCI value via SNMP
  */
@@ -4969,66 +5042,259 @@ DataCollectionError Node::getItemFromSNMP(UINT16 port, SNMP_Version version, con
 {
    UINT32 dwResult;
 
-   if ((((m_state & NSF_SNMP_UNREACHABLE) || !(m_capabilities & NC_IS_SNMP)) && (port == 0)) ||
-       (m_state & DCSF_UNREACHABLE) ||
-       (m_flags & NF_DISABLE_SNMP))
+   if (!isSNMPDataCollectionPossible(port))
    {
       dwResult = SNMP_ERR_COMM;
    }
    else
    {
-      SNMP_Transport *snmp = createSnmpTransport(port, version);
+      SNMP_Transport *snmp = acquireSnmpTransport(port, version);
       if (snmp != NULL)
       {
-         if (interpretRawValue == SNMP_RAWTYPE_NONE)
+         dwResult = GetSNMPValue(snmp, param, bufSize, buffer, interpretRawValue);
+         releaseSnmpTransport(snmp, dwResult != SNMP_ERR_COMM);
+      }
+      else
+      {
+         dwResult = SNMP_ERR_COMM;
+      }
+   }
+   DbgPrintf(7, _T("Node(%s)->GetItemFromSNMP(%s): dwResult=%d"), m_name, param, dwResult);
+   return DCErrorFromSNMPError(dwResult);
+}
+
+/**
+ * Bind variables for given DCIs to multi-variable GET request. Returns number of
+ * bound variables. For each bound variable index will contain position of DCI in items array.
+ */
+static int BuildSNMPBatchRequest(SNMP_PDU *request, DCItem **items, int count, int *index, DataCollectionError *errors)
+{
+   int boundVariables = 0;
+   for(int i = 0; i < count; i++)
+   {
+      UINT32 oid[MAX_OID_LEN];
+      size_t oidLen = SNMPParseOID(items[i]->getName(), oid, MAX_OID_LEN);
+      if (oidLen != 0)
+      {
+         request->bindVariable(new SNMP_Variable(oid, oidLen));
+         index[boundVariables++] = i;
+      }
+      else
+      {
+         errors[i] = DCErrorFromSNMPError(SNMP_ERR_BAD_OID);
+      }
+   }
+   return boundVariables;
+}
+
+/**
+ * Process response to multi-variable GET request. Returns false
+ * if request should be repeated for each DCI separately.
+ */
+static bool ProcessSNMPBatchResponse(SNMP_PDU *request, UINT32 rc, SNMP_PDU *response, DCItem **items, const int *index, int boundVariables, TCHAR **buffers, DataCollectionError *errors)
+{
+   if (rc != SNMP_ERR_SUCCESS)
+   {
+      // Communication error - repeating requests one by one will not help
+      for(int i = 0; i < boundVariables; i++)
+         errors[index[i]] = DCErrorFromSNMPError(rc);
+      return true;
+   }
+
+   bool success = (response->getErrorCode() == SNMP_PDU_ERR_SUCCESS) && (response->getNumVariables() == boundVariables);
+   if (success)
+   {
+      for(int i = 0; i < boundVariables; i++)
+      {
+         SNMP_Variable *v = response->getVariable(i);
+         if (v->getName().compare(request->getVariable(i)->getName()) != OID_EQUAL)
          {
-            dwResult = SnmpGetEx(snmp, param, NULL, 0, buffer, bufSize * sizeof(TCHAR), SG_PSTRING_RESULT, NULL);
+            success = false;   // Broken agent, retry with individual requests
+            break;
          }
-         else
+
+         int n = index[i];
+         if ((v->getType() == ASN_NO_SUCH_OBJECT) || (v->getType() == ASN_NO_SUCH_INSTANCE) || (v->getType() == ASN_END_OF_MIBVIEW))
+         {
+            errors[n] = DCErrorFromSNMPError(SNMP_ERR_NO_OBJECT);
+         }
+         else if (items[n]->isInterpretSnmpRawValue())
          {
             BYTE rawValue[1024];
             memset(rawValue, 0, 1024);
-            dwResult = SnmpGetEx(snmp, param, NULL, 0, rawValue, 1024, SG_RAW_RESULT, NULL);
-            if (dwResult == SNMP_ERR_SUCCESS)
-            {
-               switch(interpretRawValue)
-               {
-                  case SNMP_RAWTYPE_INT32:
-                     _sntprintf(buffer, bufSize, _T("%d"), ntohl(*((LONG *)rawValue)));
-                     break;
-                  case SNMP_RAWTYPE_UINT32:
-                     _sntprintf(buffer, bufSize, _T("%u"), ntohl(*((UINT32 *)rawValue)));
-                     break;
-                  case SNMP_RAWTYPE_INT64:
-                     _sntprintf(buffer, bufSize, INT64_FMT, (INT64)ntohq(*((INT64 *)rawValue)));
-                     break;
-                  case SNMP_RAWTYPE_UINT64:
-                     _sntprintf(buffer, bufSize, UINT64_FMT, ntohq(*((QWORD *)rawValue)));
-                     break;
-                  case SNMP_RAWTYPE_DOUBLE:
-                     _sntprintf(buffer, bufSize, _T("%f"), ntohd(*((double *)rawValue)));
-                     break;
-                  case SNMP_RAWTYPE_IP_ADDR:
-                     IpToStr(ntohl(*((UINT32 *)rawValue)), buffer);
-                     break;
-                  case SNMP_RAWTYPE_MAC_ADDR:
-                     MACToStr(rawValue, buffer);
-                     break;
-                  default:
-                     buffer[0] = 0;
-                     break;
-               }
-            }
+            v->getRawValue(rawValue, 1024);
+            FormatSNMPRawValue(rawValue, items[n]->getSnmpRawValueType(), buffers[n], MAX_LINE_SIZE);
+            errors[n] = DCE_SUCCESS;
+         }
+         else
+         {
+            bool convert = true;
+            v->getValueAsPrintableString(buffers[n], MAX_LINE_SIZE, &convert);
+            errors[n] = DCE_SUCCESS;
          }
-         delete snmp;
       }
-      else
+   }
+   else if ((response->getErrorCode() != SNMP_PDU_ERR_TOO_BIG) &&
+            (response->getErrorCode() != SNMP_PDU_ERR_NO_SUCH_NAME) &&
+            (response->getErrorCode() != SNMP_PDU_ERR_GENERIC) &&
+            (response->getErrorCode() != SNMP_PDU_ERR_SUCCESS))
+   {
+      for(int i = 0; i < boundVariables; i++)
+         errors[index[i]] = DCErrorFromSNMPError(SNMP_ERR_AGENT);
+      success = true;
+   }
+   return success;
+}
+
+/**
+ * Get values for multiple DCIs with single SNMP GET request. Returns false
+ * if request should be repeated for each DCI separately. Sets commError
+ * to true if request failed with communication error.
+ */
+static bool GetSNMPValueBatch(SNMP_Transport *snmp, DCItem **items, int count, TCHAR **buffers, DataCollectionError *errors, bool *commError)
+{
+   SNMP_PDU request(SNMP_GET_REQUEST, SnmpNewRequestId(), snmp->getSnmpVersion());
+   int *index = MemAllocArrayNoInit<int>(count);
+   int boundVariables = BuildSNMPBatchRequest(&request, items, count, index, errors);
+   if (boundVariables == 0)
+   {
+      MemFree(index);
+      return true;
+   }
+
+   SNMP_PDU *response = NULL;
+   UINT32 rc = snmp->doRequest(&request, &response, SnmpGetDefaultTimeout(), 3);
+   if (rc == SNMP_ERR_COMM)
+      *commError = true;
+   bool success = ProcessSNMPBatchResponse(&request, rc, response, items, index, boundVariables, buffers, errors);
+   delete response;
+   MemFree(index);
+   return success;
+}
+
+/**
+ * Asynchronous multi-variable SNMP GET request
+ */
+struct SNMPAsyncBatchRequest
+{
+   SNMP_PDU *request;
+   DCItem **items;
+   int *index;
+   int boundVariables;
+   TCHAR **buffers;
+   DataCollectionError *errors;
+   void (*callback)(bool, void*);
+   void *context;
+};
+
+/**
+ * Completion callback for asynchronous multi-variable SNMP GET request
+ */
+static void SNMPAsyncBatchRequestCallback(UINT32 rc, SNMP_PDU *response, void *arg)
+{
+   SNMPAsyncBatchRequest *r = static_cast<SNMPAsyncBatchRequest*>(arg);
+   bool success = ProcessSNMPBatchResponse(r->request, rc, response, r->items, r->index, r->boundVariables, r->buffers, r->errors);
+   r->callback(success, r->context);
+   delete r->request;
+   MemFree(r->index);
+   delete r;
+}
+
+/**
+ * Start asynchronous collection of multiple SNMP DCIs with single GET request. Returns false if
+ * asynchronous request cannot be used for this node (SNMP proxy is configured, SNMP is not
+ * available, or request cannot be sent) and getItemsFromSNMP should be used instead. Otherwise
+ * callback will be called on completion, with success flag set to false if values should be
+ * requested again with getItemsFromSNMP. Buffers and error array should remain valid until then.
+ */
+bool Node::getItemsFromSNMPAsync(SNMP_AsyncClient *client, UINT16 port, SNMP_Version version, DCItem **items, int count,
+         TCHAR **buffers, DataCollectionError *errors, void (*callback)(bool, void*), void *context)
+{
+   if ((m_flags & NF_DISABLE_SNMP) || (m_status == STATUS_UNMANAGED) || (g_flags & AF_SHUTDOWN) || m_isDeleteInitiated ||
+       !isSNMPDataCollectionPossible(port) || (getEffectiveSnmpProxy() != 0))
+      return false;
+
+   // Pooled transport is used only as source of security context - it already has localized
+   // keys and discovered authoritative engine, so request can be sent without engine ID discovery
+   SNMP_Transport *snmp = acquireSnmpTransport(port, version);
+   if (snmp == NULL)
+      return false;
+   if (snmp->isProxyTransport())
+   {
+      releaseSnmpTransport(snmp);
+      return false;
+   }
+
+   SNMPAsyncBatchRequest *r = new SNMPAsyncBatchRequest;
+   r->request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), snmp->getSnmpVersion());
+   const SNMP_Engine *engine = snmp->getAuthoritativeEngine();
+   if ((snmp->getSnmpVersion() == SNMP_VERSION_3) && (engine != NULL))
+      r->request->setContextEngineId(engine->getId(), engine->getIdLen());
+   r->index = MemAllocArrayNoInit<int>(count);
+   r->boundVariables = BuildSNMPBatchRequest(r->request, items, count, r->index, errors);
+   r->items = items;
+   r->buffers = buffers;
+   r->errors = errors;
+   r->callback = callback;
+   r->context = context;
+
+   UINT32 rc = (r->boundVariables > 0) ?
+            client->sendRequest(snmp->getPeerIpAddress(), snmp->getPort(), new SNMP_PDU(r->request), snmp->getSecurityContext(),
+                     SnmpGetDefaultTimeout(), 3, SNMPAsyncBatchRequestCallback, r) :
+            SNMP_ERR_PARAM;
+   releaseSnmpTransport(snmp);
+   if (rc != SNMP_ERR_SUCCESS)
+   {
+      delete r->request;
+      MemFree(r->index);
+      delete r;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Get values for multiple DCIs via SNMP. All DCIs should use same SNMP port and version.
+ * DCI values are requested in batches of up to maxBatchSize variables per request. If
+ * batch request fails because response is too big or one of the variables is missing
+ * (SNMPv1 agents), values from that batch are requested one by one. Each buffer
+ * should be at least MAX_LINE_SIZE characters.
+ */
+void Node::getItemsFromSNMP(UINT16 port, SNMP_Version version, DCItem **items, int count, int maxBatchSize, TCHAR **buffers, DataCollectionError *errors)
+{
+   SNMP_Transport *snmp = isSNMPDataCollectionPossible(port) ? acquireSnmpTransport(port, version) : NULL;
+   if (snmp == NULL)
+   {
+      for(int i = 0; i < count; i++)
+         errors[i] = DCE_COMM_ERROR;
+      DbgPrintf(7, _T("Node(%s)->GetItemsFromSNMP(): SNMP data collection not possible (%d items)"), m_name, count);
+      return;
+   }
+
+   bool commError = false;
+   for(int start = 0; start < count; start += maxBatchSize)
+   {
+      int batchSize = std::min(maxBatchSize, count - start);
+      if (!GetSNMPValueBatch(snmp, &items[start], batchSize, &buffers[start], &errors[start], &commError))
       {
-         dwResult = SNMP_ERR_COMM;
+         DbgPrintf(7, _T("Node(%s)->GetItemsFromSNMP(): batch request failed, falling back to individual requests (%d items)"), m_name, batchSize);
+         for(int i = start; i < start + batchSize; i++)
+         {
+            if (IsShutdownInProgress())
+            {
+               errors[i] = DCE_COMM_ERROR;
+               continue;
+            }
+            UINT32 rc = GetSNMPValue(snmp, items[i]->getName(), MAX_LINE_SIZE, buffers[i],
+                     items[i]->isInterpretSnmpRawValue() ? (int)items[i]->getSnmpRawValueType() : SNMP_RAWTYPE_NONE);
+            errors[i] = DCErrorFromSNMPError(rc);
+            if (rc == SNMP_ERR_COMM)
+               commError = true;
+         }
       }
    }
-   DbgPrintf(7, _T("Node(%s)->GetItemFromSNMP(%s): dwResult=%d"), m_name, param, dwResult);
-   return DCErrorFromSNMPError(dwResult);
+   releaseSnmpTransport(snmp, !commError);
+   DbgPrintf(7, _T("Node(%s)->GetItemsFromSNMP(): %d items processed"), m_name, count);
 }
 
 /**
@@ -5111,7 +5377,7 @@ DataCollectionError Node::getTableFromSNMP(UINT16 port, SNMP_Version version, co
 {
    *table = NULL;
 
-   SNMP_Transport *snmp = createSnmpTransport(port, version);
+   SNMP_Transport *snmp = acquireSnmpTransport(port, version);
    if (snmp == NULL)
       return DCE_COMM_ERROR;
 
@@ -5138,7 +5404,7 @@ DataCollectionError Node::getTableFromSNMP(UINT16 port, SNMP_Version version, co
          }
       }
    }
-   delete snmp;
+   releaseSnmpTransport(snmp, rc != SNMP_ERR_COMM);
    return DCErrorFromSNMPError(rc);
 }
 
@@ -5159,13 +5425,13 @@ static UINT32 SNMPGetListCallback(SNMP_Variable *varbind, SNMP_Transport *snmp,
 DataCollectionError Node::getListFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *oid, StringList **list)
 {
    *list = NULL;
-   SNMP_Transport *snmp = createSnmpTransport(port, version);
+   SNMP_Transport *snmp = acquireSnmpTransport(port, version);
    if (snmp == NULL)
       return DCE_COMM_ERROR;
 
    *list = new StringList;
    UINT32 rc = SnmpWalk(snmp, oid, SNMPGetListCallback, *list);
-   delete snmp;
+   releaseSnmpTransport(snmp, rc != SNMP_ERR_COMM);
    if (rc != SNMP_ERR_SUCCESS)
    {
       delete *list;
@@ -5210,7 +5476,7 @@ static UINT32 SNMPOIDSuffixListCallback(SNMP_Variable *varbind, SNMP_Transport *
 DataCollectionError Node::getOIDSuffixListFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *oid, StringMap **values)
 {
    *values = NULL;
-   SNMP_Transport *snmp = createSnmpTransport(port, version);
+   SNMP_Transport *snmp = acquireSnmpTransport(port, version);
    if (snmp == NULL)
       return DCE_COMM_ERROR;
 
@@ -5219,13 +5485,13 @@ DataCollectionError Node::getOIDSuffixListFromSNMP(UINT16 port, SNMP_Version ver
    data.oidLen = SNMPParseOID(oid, oidBin, 256);
    if (data.oidLen == 0)
    {
-      delete snmp;
+      releaseSnmpTransport(snmp);
       return DCE_NOT_SUPPORTED;
    }
 
    data.values = new StringMap;
    UINT32 rc = SnmpWalk(snmp, oid, SNMPOIDSuffixListCallback, &data);
-   delete snmp;
+   releaseSnmpTransport(snmp, rc != SNMP_ERR_COMM);
    if (rc == SNMP_ERR_SUCCESS)
    {
       *values = data.values;
@@ -5552,11 +5818,11 @@ DataCollectionError Node::getItemFromDeviceDriver(const TCHAR *param, TCHAR *buf
    if ((driver == NULL) || !driver->hasMetrics())
       return DCE_NOT_SUPPORTED;
 
-   SNMP_Transport *transport = createSnmpTransport();
+   SNMP_Transport *transport = acquireSnmpTransport();
    if (transport == NULL)
       return DCE_COMM_ERROR;
    DataCollectionError rc = driver->getMetric(transport, this, m_driverData, param, buffer, size);
-   delete transport;
+   releaseSnmpTransport(transport, rc != DCE_COMM_ERROR);
    return rc;
 }
 
@@ -5802,6 +6068,10 @@ DataCollectionError Node::getInternalItem(const TCHAR *param, size_t bufSize, TC
       {
          _sntprintf(buffer, bufSize, _T("%u"), g_averageDCIQueuingTime);
       }
+      else if (!_tcsicmp(param, _T("Server.AverageDCISchedulingLag")))
+      {
+         _sntprintf(buffer, bufSize, _T("%u"), g_averageDCISchedulingLag);
+      }
       else if (!_tcsicmp(param, _T("Server.ClientSessions.Authenticated")))
       {
          _sntprintf(buffer, bufSize, _T("%d"), GetSessionCount(true, false, -1, NULL));
@@ -5888,6 +6158,18 @@ DataCollectionError Node::getInternalItem(const TCHAR *param, size_t bufSize, TC
       {
          _sntprintf(buffer, bufSize, UINT64_FMT, g_rawDataWriteRequests);
       }
+      else if (!_tcsicmp(param, _T("Server.EventLogWriter.RecordsPerSecond")))
+      {
+         ret_double(buffer, GetEventLogWriterRecordsPerSecond(), 2);
+      }
+      else if (!_tcsicmp(param, _T("Server.EventLogWriter.RecordsWritten")))
+      {
+         ret_uint64(buffer, GetEventLogWriterRecordsWritten());
+      }
+      else if (MatchString(_T("Server.EventProcessor.*(*)"), param, false))
+      {
+         rc = GetEventProcessorStatistic(param, buffer);
+      }
       else if (!_tcsicmp(param, _T("Server.Heap.Active")))
       {
          INT64 bytes = GetActiveHeapMemory();
@@ -5920,6 +6202,19 @@ DataCollectionError Node::getInternalItem(const TCHAR *param, size_t bufSize, TC
       {
          ret_uint64(buffer, GetAlarmMemoryUsage());
       }
+      else if (!_tcsicmp(param, _T("Server.MemoryUsage.IDataWriter")))
+      {
+         ret_uint64(buffer, GetIDataWriterMemoryUsage());
+      }
+      else if (MatchString(_T("Server.MemoryUsage.IDataWriter.Peak(*)"), param, false))
+      {
+         TCHAR queue[16];
+         UINT64 value;
+         if (AgentGetParameterArg(param, 1, queue, 16) && GetIDataWriterMemoryUsagePeak(_tcstol(queue, NULL, 10), &value))
+            ret_uint64(buffer, value);
+         else
+            rc = DCE_NOT_SUPPORTED;
+      }
       else if (!_tcsicmp(param, _T("Server.MemoryUsage.RawDataWriter")))
       {
          ret_uint64(buffer, GetRawDataWriterMemoryUsage());
@@ -5944,6 +6239,22 @@ DataCollectionError Node::getInternalItem(const TCHAR *param, size_t bufSize, TC
       {
          _sntprintf(buffer, bufSize, UINT64_FMT, g_snmpTrapsReceived);
       }
+      else if (MatchString(_T("Server.SNMP.KeyCache.*"), param, false))
+      {
+         UINT64 hits, misses;
+         int size;
+         SnmpGetKeyCacheStatistics(&hits, &misses, &size);
+         if (!_tcsicmp(param, _T("Server.SNMP.KeyCache.Hits")))
+            _sntprintf(buffer, bufSize, UINT64_FMT, hits);
+         else if (!_tcsicmp(param, _T("Server.SNMP.KeyCache.Misses")))
+            _sntprintf(buffer, bufSize, UINT64_FMT, misses);
+         else if (!_tcsicmp(param, _T("Server.SNMP.KeyCache.HitRatio")))
+            _sntprintf(buffer, bufSize, _T("%f"), (hits + misses > 0) ? static_cast<double>(hits) * 100.0 / static_cast<double>(hits + misses) : 0.0);
+         else if (!_tcsicmp(param, _T("Server.SNMP.KeyCache.Size")))
+            _sntprintf(buffer, bufSize, _T("%d"), size);
+         else
+            rc = DCE_NOT_SUPPORTED;
+      }
       else if (!_tcsicmp(param, _T("Server.ReceivedSyslogMessages")))
       {
          _sntprintf(buffer, bufSize, UINT64_FMT, g_syslogMessagesReceived);
@@ -5952,6 +6263,10 @@ DataCollectionError Node::getInternalItem(const TCHAR *param, size_t bufSize, TC
       {
          rc = GetThreadPoolStat(THREAD_POOL_ACTIVE_REQUESTS, param, buffer);
       }
+      else if (MatchString(_T("Server.ThreadPool.AverageWaitTime(*)"), param, false))
+      {
+         rc = GetThreadPoolStat(THREAD_POOL_AVERAGE_WAIT_TIME, param, buffer);
+      }
       else if (MatchString(_T("Server.ThreadPool.CurrSize(*)"), param, false))
       {
          rc = GetThreadPoolStat(THREAD_POOL_CURR_SIZE, param, buffer);
@@ -5990,7 +6305,7 @@ DataCollectionError Node::getInternalItem(const TCHAR *param, size_t bufSize, TC
       }
       else if (!_tcsicmp(param, _T("Server.TotalEventsProcessed")))
       {
-         _sntprintf(buffer, bufSize, UINT64_FMT, g_totalEventsProcessed);
+         _sntprintf(buffer, bufSize, UINT64_FMT, static_cast<UINT64>(g_totalEventsProcessed));
       }
       else
       {
@@ -6369,6 +6684,10 @@ UINT32 Node::modifyFromMessageInternal(NXCPMessage *pRequest)
       m_snmpSecurity->setPrivMethod((int)(methods >> 8));
    }
 
+   // Pooled SNMP transports use old settings
+   if (pRequest->isFieldExist(VID_SNMP_VERSION) || pRequest->isFieldExist(VID_SNMP_PORT) || pRequest->isFieldExist(VID_SNMP_AUTH_OBJECT))
+      invalidateSnmpTransportPool();
+
    // Change proxy node
    if (pRequest->isFieldExist(VID_AGENT_PROXY))
       m_agentProxy = pRequest->getFieldAsUInt32(VID_AGENT_PROXY);
@@ -7077,11 +7396,11 @@ ROUTING_TABLE *Node::getRoutingTable()
    }
    if ((pRT == NULL) && (m_capabilities & NC_IS_SNMP) && (!(m_flags & NF_DISABLE_SNMP)))
    {
-      SNMP_Transport *pTransport = createSnmpTransport();
+      SNMP_Transport *pTransport = acquireSnmpTransport();
       if (pTransport != NULL)
       {
          pRT = SnmpGetRoutingTable(pTransport);
-         delete pTransport;
+         releaseSnmpTransport(pTransport, pRT != NULL);
       }
    }
 
@@ -7284,11 +7603,11 @@ UINT32 Node::callSnmpEnumerate(const TCHAR *pszRootOid,
        (!(m_state & DCSF_UNREACHABLE)))
    {
       UINT32 dwResult;
-      SNMP_Transport *pTransport = createSnmpTransport(0, SNMP_VERSION_DEFAULT, context);
+      SNMP_Transport *pTransport = acquireSnmpTransport(0, SNMP_VERSION_DEFAULT, context);
       if (pTransport != NULL)
       {
          dwResult = SnmpWalk(pTransport, pszRootOid, pHandler, pArg, false, failOnShutdown);
-         delete pTransport;
+         releaseSnmpTransport(pTransport, dwResult != SNMP_ERR_COMM);
       }
       else
       {
@@ -7544,6 +7863,136 @@ SNMP_Transport *Node::createSnmpTransport(UINT16 port, SNMP_Version version, con
    return pTransport;
 }
 
+/**
+ * Maximum number of SNMP transports in node's transport pool
+ */
+#define MAX_POOLED_SNMP_TRANSPORTS  16
+
+/**
+ * Acquire SNMP transport from node's transport pool or create new one if there are
+ * no idle transports with matching parameters. Transport keeps socket and discovered
+ * SNMPv3 engine IDs between requests. Transport acquired by this method should be
+ * returned by calling releaseSnmpTransport and should not be deleted directly.
+ */
+SNMP_Transport *Node::acquireSnmpTransport(UINT16 port, SNMP_Version version, const TCHAR *context)
+{
+   if ((m_flags & NF_DISABLE_SNMP) || (m_status == STATUS_UNMANAGED) || (g_flags & AF_SHUTDOWN) || m_isDeleteInitiated)
+      return NULL;
+
+   // Only direct UDP transports are pooled, proxy connections are managed separately
+   if ((g_snmpTransportIdleTimeout == 0) || (getEffectiveSnmpProxy() != 0))
+      return createSnmpTransport(port, version, context);
+
+   lockProperties();
+   UINT16 effectivePort = (port != 0) ? port : m_snmpPort;
+   SNMP_Version effectiveVersion = (version != SNMP_VERSION_DEFAULT) ? version : m_snmpVersion;
+   InetAddress ipAddress = m_ipAddress;
+   unlockProperties();
+
+   SNMP_Transport *transport = NULL;
+   MutexLock(m_snmpTransportPoolLock);
+   for(int i = 0; i < m_snmpTransportPool.size(); i++)
+   {
+      PooledSNMPTransport *p = m_snmpTransportPool.get(i);
+      if (!p->inUse && (p->port == effectivePort) && (p->version == effectiveVersion) &&
+          !_tcscmp(CHECK_NULL_EX(p->context), CHECK_NULL_EX(context)))
+      {
+         if (p->transport->getPeerIpAddress().equals(ipAddress))
+         {
+            p->inUse = true;
+            transport = p->transport;
+            break;
+         }
+         m_snmpTransportPool.remove(i);   // Node IP address was changed
+         i--;
+      }
+   }
+   MutexUnlock(m_snmpTransportPoolLock);
+   if (transport != NULL)
+      return transport;
+
+   transport = createSnmpTransport(effectivePort, effectiveVersion, context);
+   if ((transport == NULL) || transport->isProxyTransport())
+      return transport;
+
+   MutexLock(m_snmpTransportPoolLock);
+   if (m_snmpTransportPool.size() < MAX_POOLED_SNMP_TRANSPORTS)
+      m_snmpTransportPool.add(new PooledSNMPTransport(transport, effectivePort, effectiveVersion, context));
+   MutexUnlock(m_snmpTransportPoolLock);
+   return transport;
+}
+
+/**
+ * Return SNMP transport acquired by acquireSnmpTransport. If reuse is false
+ * (for example, after communication error) transport will be destroyed.
+ */
+void Node::releaseSnmpTransport(SNMP_Transport *transport, bool reuse)
+{
+   if (transport == NULL)
+      return;
+
+   MutexLock(m_snmpTransportPoolLock);
+   for(int i = 0; i < m_snmpTransportPool.size(); i++)
+   {
+      PooledSNMPTransport *p = m_snmpTransportPool.get(i);
+      if (p->transport == transport)
+      {
+         if (reuse)
+         {
+            p->inUse = false;
+            p->lastUsed = time(NULL);
+         }
+         else
+         {
+            m_snmpTransportPool.remove(i);
+         }
+         transport = NULL;
+         break;
+      }
+   }
+   MutexUnlock(m_snmpTransportPoolLock);
+
+   // Transport is not pooled (proxy transport, pool overflow, or pool invalidated while in use)
+   delete transport;
+}
+
+/**
+ * Invalidate SNMP transport pool after change of node's SNMP settings. Transports
+ * currently in use will be destroyed when released.
+ */
+void Node::invalidateSnmpTransportPool()
+{
+   MutexLock(m_snmpTransportPoolLock);
+   for(int i = 0; i < m_snmpTransportPool.size(); i++)
+   {
+      PooledSNMPTransport *p = m_snmpTransportPool.get(i);
+      if (p->inUse)
+         p->transport = NULL;   // will be deleted by releaseSnmpTransport
+   }
+   m_snmpTransportPool.clear();
+   MutexUnlock(m_snmpTransportPoolLock);
+}
+
+/**
+ * Destroy SNMP transports that were not used for given time (in seconds)
+ */
+void Node::reapIdleSnmpTransports(time_t idleTimeout)
+{
+   time_t now = time(NULL);
+   MutexLock(m_snmpTransportPoolLock);
+   for(int i = 0; i < m_snmpTransportPool.size(); i++)
+   {
+      PooledSNMPTransport *p = m_snmpTransportPool.get(i);
+      if (!p->inUse && (now - p->lastUsed >= idleTimeout))
+      {
+         nxlog_debug(7, _T("Node::reapIdleSnmpTransports(%s [%u]): closing idle SNMP transport to port %d"), m_name, m_id, p->port);
+         m_snmpTransportPool.remove(i);
+         i--;
+      }
+   }
+   MutexUnlock(m_snmpTransportPoolLock);
+}
+
 /**
  * Get SNMP security context
  * ATTENTION: This method returns new copy of security context
@@ -7880,11 +8329,11 @@ void Node::topologyPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId
    if (m_driver != NULL)
    {
       poller->setStatus(_T("reading VLANs"));
-      SNMP_Transport *snmp = createSnmpTransport();
+      SNMP_Transport *snmp = acquireSnmpTransport();
       if (snmp != NULL)
       {
          VlanList *vlanList = m_driver->getVlans(snmp, this, m_driverData);
-         delete snmp;
+         releaseSnmpTransport(snmp);
 
          if (vlanList != NULL)
          {
@@ -8079,11 +8528,11 @@ void Node::topologyPoll(PollerInfo *poller, ClientSession *pSession, UINT32 rqId
    if ((m_driver != NULL) && (m_capabilities & NC_IS_WIFI_CONTROLLER))
    {
       poller->setStatus(_T("reading wireless stations"));
-      SNMP_Transport *snmp = createSnmpTransport();
+      SNMP_Transport *snmp = acquireSnmpTransport();
       if (snmp != NULL)
       {
          ObjectArray<WirelessStationInfo> *stations = m_driver->getWirelessStations(snmp, this, m_driverData);
-         delete snmp;
+         releaseSnmpTransport(snmp, stations != NULL);
          if (stations != NULL)
          {
             sendPollerMsg(rqId, _T("   %d wireless stations found\r\n"), stations->size());
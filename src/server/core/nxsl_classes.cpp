@@ -2730,6 +2730,7 @@ NXSL_METHOD_DEFINITION(DCI, forcePoll)
       if (dcObject != NULL)
       {
          dcObject->requestForcePoll(NULL);
+         ScheduleDataCollection(dcObject, time(NULL));
       }
    }
    *result = vm->createValue();
@@ -2766,6 +2767,10 @@ NXSL_Value *NXSL_DciClass::getAttr(NXSL_Object *object, const char *attr)
    {
       value = vm->createValue(dci->getThresholdSeverity());
    }
+   else if (!strcmp(attr, "cacheMemoryUsage"))
+   {
+      value = vm->createValue(dci->getCacheMemoryUsage());
+   }
    else if (!strcmp(attr, "comments"))
    {
 		value = vm->createValue(dci->getComments());
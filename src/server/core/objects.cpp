@@ -39,6 +39,8 @@ UINT32 NXCORE_EXPORTABLE g_dwMgmtNode = 0;
 
 Queue g_templateUpdateQueue;
 
+VolatileCounter g_objectTreeVersion = 0;   // Incremented on every change in object tree
+
 ObjectIndex g_idxObjectById;
 HashIndex<uuid> g_idxObjectByGUID;
 ObjectIndex g_idxSubnetById;
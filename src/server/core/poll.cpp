@@ -797,6 +797,14 @@ static void QueueForPolling(NetObj *object, void *data)
 	}
 }
 
+/**
+ * Callback for closing idle SNMP transports
+ */
+static void ReapIdleSNMPTransports(NetObj *object, void *data)
+{
+   static_cast<Node*>(object)->reapIdleSnmpTransports(g_snmpTransportIdleTimeout);
+}
+
 /**
  * Node and condition queuing thread
  */
@@ -806,7 +814,8 @@ THREAD_RESULT THREAD_CALL PollManager(void *arg)
    g_pollerThreadPool = ThreadPoolCreate( _T("POLLERS"),
          ConfigReadInt(_T("ThreadPool.Poller.BaseSize"), 10),
          ConfigReadInt(_T("ThreadPool.Poller.MaxSize"), 250),
-         256 * 1024);
+         256 * 1024,
+         ConfigReadBoolean(_T("ThreadPool.Poller.WorkStealing"), false) ? THREAD_POOL_WORK_STEALING : 0);
 
    // Start active discovery poller
    THREAD activeDiscoveryPollerThread = ThreadCreateEx(ActiveDiscoveryPoller, 0, NULL);
@@ -829,6 +838,10 @@ THREAD_RESULT THREAD_CALL PollManager(void *arg)
          CheckForMgmtNode();
       }
 
+      // Close idle SNMP transports every minute
+      if ((counter % 12 == 0) && (g_snmpTransportIdleTimeout > 0))
+         g_idxNodeById.forEach(ReapIdleSNMPTransports, NULL);
+
       // Walk through objects and queue them for status
       // and/or configuration poll
 		g_idxObjectById.forEach(QueueForPolling, &watchdogId);
@@ -98,6 +98,225 @@ ScriptVMHandle NXCORE_EXPORTABLE CreateServerScriptVM(const NXSL_Program *script
    return ScriptVMHandle(SetupServerScriptVM(vm, object, dci));
 }
 
+/**
+ * Cached script VM
+ */
+struct CachedScriptVM
+{
+   NXSL_VM *vm;
+   ScriptVMFailureReason failureReason;
+
+   CachedScriptVM(NXSL_VM *_vm, ScriptVMFailureReason _failureReason)
+   {
+      vm = _vm;
+      failureReason = _failureReason;
+   }
+
+   ~CachedScriptVM()
+   {
+      delete vm;
+   }
+};
+
+/**
+ * Cache of loaded script VMs owned by single thread. VMs for library scripts are invalidated
+ * when script library changes, VMs for other compiled scripts - when their cache key is invalidated.
+ */
+struct ScriptVMCache
+{
+   StringObjectMap<CachedScriptVM> libraryScripts;
+   HashMap<UINT32, CachedScriptVM> programs;
+   UINT32 libraryChangeCounter;
+   int invalidatedKeyCount;   // Number of processed elements in invalidated key list
+
+   ScriptVMCache() : libraryScripts(true), programs(true)
+   {
+      libraryChangeCounter = 0;
+      invalidatedKeyCount = 0;
+   }
+
+   void validate();
+};
+
+/**
+ * Script VM cache key generator
+ */
+static VolatileCounter s_scriptVMCacheKey = 0;
+
+/**
+ * Invalidated cache keys. Keys are never reused, so list is only appended and each cache
+ * tracks position up to which it was processed.
+ */
+static IntegerArray<UINT32> s_invalidatedScriptVMCacheKeys(0, 64);
+static VolatileCounter s_invalidatedScriptVMCacheKeyCount = 0;
+static Mutex s_invalidatedScriptVMCacheKeysLock;
+
+/**
+ * Drop outdated VMs from cache. Library change counter is checked instead of per-script versions
+ * because VM also contains copies of all modules imported by script.
+ */
+void ScriptVMCache::validate()
+{
+   UINT32 counter = s_scriptLibrary.getChangeCounter();
+   if (counter != libraryChangeCounter)
+   {
+      libraryScripts.clear();
+      programs.clear();   // compiled scripts can import library modules as well
+      libraryChangeCounter = counter;
+   }
+
+   if (invalidatedKeyCount != s_invalidatedScriptVMCacheKeyCount)
+   {
+      s_invalidatedScriptVMCacheKeysLock.lock();
+      for(; invalidatedKeyCount < s_invalidatedScriptVMCacheKeys.size(); invalidatedKeyCount++)
+         programs.remove(s_invalidatedScriptVMCacheKeys.get(invalidatedKeyCount));
+      s_invalidatedScriptVMCacheKeysLock.unlock();
+   }
+}
+
+#if HAVE_THREAD_LOCAL_STORAGE
+
+/**
+ * Script VM cache for current thread
+ */
+static thread_local ScriptVMCache *s_vmCache = NULL;
+
+/**
+ * Enable script VM cache for calling thread. Cached VMs are kept loaded between runs, only global
+ * variables are cleared when VM is released. Cache should be disabled by same thread before it exits.
+ */
+void EnableScriptVMCache()
+{
+   if (s_vmCache == NULL)
+   {
+      s_vmCache = new ScriptVMCache();
+      s_vmCache->validate();
+   }
+}
+
+/**
+ * Disable script VM cache for calling thread and destroy all cached VMs
+ */
+void DisableScriptVMCache()
+{
+   delete_and_null(s_vmCache);
+}
+
+#define GetScriptVMCache() (s_vmCache)
+
+#else /* HAVE_THREAD_LOCAL_STORAGE */
+
+/**
+ * Script VM cache is not supported without thread local storage
+ */
+void EnableScriptVMCache()
+{
+}
+
+/**
+ * Script VM cache is not supported without thread local storage
+ */
+void DisableScriptVMCache()
+{
+}
+
+#define GetScriptVMCache() (static_cast<ScriptVMCache*>(NULL))
+
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+
+/**
+ * Create new key for caching VMs of compiled script
+ */
+UINT32 NXCORE_EXPORTABLE CreateScriptVMCacheKey()
+{
+   return InterlockedIncrement(&s_scriptVMCacheKey);
+}
+
+/**
+ * Invalidate cache key. Should be called when compiled script associated with key is destroyed.
+ * VMs cached for this key are dropped by each thread on next cache access.
+ */
+void NXCORE_EXPORTABLE InvalidateScriptVMCacheKey(UINT32 cacheKey)
+{
+   s_invalidatedScriptVMCacheKeysLock.lock();
+   s_invalidatedScriptVMCacheKeys.add(cacheKey);
+   InterlockedIncrement(&s_invalidatedScriptVMCacheKeyCount);
+   s_invalidatedScriptVMCacheKeysLock.unlock();
+}
+
+/**
+ * Get VM for library script from calling thread's VM cache. If cache is not enabled for calling thread
+ * new VM is created. VM must be returned by calling ReleaseServerScriptVM before same script
+ * can be acquired again by same thread.
+ */
+ScriptVMHandle NXCORE_EXPORTABLE AcquireServerScriptVM(const TCHAR *name, NetObj *object, DCObject *dci)
+{
+   ScriptVMCache *cache = GetScriptVMCache();
+   if (cache == NULL)
+      return CreateServerScriptVM(name, object, dci);
+
+   cache->validate();
+   CachedScriptVM *entry = cache->libraryScripts.get(name);
+   if (entry == NULL)
+   {
+      ScriptVMFailureReason failureReason = ScriptVMFailureReason::SCRIPT_NOT_FOUND;
+      NXSL_VM *vm = s_scriptLibrary.createVM(name, CreateServerEnvironment, ScriptValidator, &failureReason);
+      entry = new CachedScriptVM(vm, (vm != NULL) ? ScriptVMFailureReason::SUCCESS : failureReason);
+      cache->libraryScripts.set(name, entry);
+   }
+   return (entry->vm == NULL) ? ScriptVMHandle(entry->failureReason) : ScriptVMHandle(SetupServerScriptVM(entry->vm, object, dci));
+}
+
+/**
+ * Get VM for compiled script from calling thread's VM cache. If cache is not enabled for calling thread
+ * new VM is created. VM must be returned by calling ReleaseServerScriptVM before same script
+ * can be acquired again by same thread.
+ */
+ScriptVMHandle NXCORE_EXPORTABLE AcquireServerScriptVM(UINT32 cacheKey, const NXSL_Program *script, NetObj *object, DCObject *dci)
+{
+   ScriptVMCache *cache = GetScriptVMCache();
+   if (cache == NULL)
+      return CreateServerScriptVM(script, object, dci);
+
+   cache->validate();
+   CachedScriptVM *entry = cache->programs.get(cacheKey);
+   if (entry == NULL)
+   {
+      if (script->isEmpty())
+      {
+         entry = new CachedScriptVM(NULL, ScriptVMFailureReason::SCRIPT_IS_EMPTY);
+      }
+      else
+      {
+         NXSL_VM *vm = new NXSL_VM(new NXSL_ServerEnv());
+         if (vm->load(script))
+         {
+            entry = new CachedScriptVM(vm, ScriptVMFailureReason::SUCCESS);
+         }
+         else
+         {
+            delete vm;
+            entry = new CachedScriptVM(NULL, ScriptVMFailureReason::SCRIPT_LOAD_ERROR);
+         }
+      }
+      cache->programs.set(cacheKey, entry);
+   }
+   return (entry->vm == NULL) ? ScriptVMHandle(entry->failureReason) : ScriptVMHandle(SetupServerScriptVM(entry->vm, object, dci));
+}
+
+/**
+ * Return VM obtained by AcquireServerScriptVM. Cached VM is kept loaded, only its global variables are cleared.
+ */
+void NXCORE_EXPORTABLE ReleaseServerScriptVM(NXSL_VM *vm)
+{
+   if (vm == NULL)
+      return;
+   if (GetScriptVMCache() != NULL)
+      vm->clearGlobalVariables();
+   else
+      delete vm;
+}
+
 /**
  * Load scripts from database
  */
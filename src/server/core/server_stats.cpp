@@ -119,9 +119,11 @@ THREAD_RESULT THREAD_CALL ServerStatCollector(void *arg)
 
    s_queuesLock.lock();
    AddQueueToCollector(_T("DataCollector"), g_dataCollectorThreadPool);
+   AddQueueToCollector(_T("DataCollectionScheduler"), GetDataCollectionSchedulerQueueSize);
    AddQueueToCollector(_T("DBWriter.IData"), GetIDataWriterQueueSize);
    AddQueueToCollector(_T("DBWriter.Other"), g_dbWriterQueue);
    AddQueueToCollector(_T("DBWriter.RawData"), GetRawDataWriterQueueSize);
+   AddQueueToCollector(_T("SNMPAsyncRequests"), GetSNMPAsyncPendingRequestCount);
    AddQueueToCollector(_T("DBWriter.Total"), GetTotalDBWriterQueueSize);
    AddQueueToCollector(_T("EventLogWriter"), GetEventLogWriterQueueSize);
    AddQueueToCollector(_T("EventProcessor"), &g_eventQueue);
@@ -3965,6 +3965,7 @@ void ClientSession::forceDCIPoll(NXCPMessage *request)
 				if (dci != NULL)
 				{
 				   dci->requestForcePoll(this);
+				   ScheduleDataCollection(dci, time(NULL));
 					msg.setField(VID_RCC, RCC_SUCCESS);
 					debugPrintf(4, _T("ForceDCIPoll: DCI %d at node %d"), dwItemId, object->getId());
 				}
@@ -27,6 +27,11 @@
 
 #define REQUEST_TIMEOUT 10000
 
+/**
+ * Size of buffer used to coalesce small blocks into single TLS record (maximum TLS record size)
+ */
+#define TLS_WRITE_BUFFER_SIZE 16384
+
 #define DEBUG_TAG       _T("agent.tunnel")
 
 /**
@@ -259,6 +264,7 @@ AgentTunnel::AgentTunnel(SSL_CTX *context, SSL *ssl, SOCKET sock, const InetAddr
    m_ssl = ssl;
    m_sslLock = MutexCreate();
    m_writeLock = MutexCreate();
+   m_messageReceiver = new TlsMessageReceiver(sock, ssl, m_sslLock, 4096, MAX_MSG_SIZE);
    m_requestId = 0;
    m_nodeId = nodeId;
    m_zoneUIN = zoneUIN;
@@ -286,6 +292,7 @@ AgentTunnel::~AgentTunnel()
 {
    m_channels.clear();
    shutdown();
+   delete m_messageReceiver;
    SSL_CTX_free(m_context);
    SSL_free(m_ssl);
    MutexDestroy(m_sslLock);
@@ -316,11 +323,10 @@ void AgentTunnel::debugPrintf(int level, const TCHAR *format, ...)
  */
 void AgentTunnel::recvThread()
 {
-   TlsMessageReceiver receiver(m_socket, m_ssl, m_sslLock, 4096, MAX_MSG_SIZE);
    while(true)
    {
       MessageReceiverResult result;
-      NXCPMessage *msg = receiver.readMessage(60000, &result);
+      NXCPMessage *msg = m_messageReceiver->readMessage(60000, &result);
       if (result != MSGRECV_SUCCESS)
       {
          if (result == MSGRECV_CLOSED)
@@ -329,55 +335,71 @@ void AgentTunnel::recvThread()
             debugPrintf(4, _T("Communication error (%s)"), AbstractMessageReceiver::resultToText(result));
          break;
       }
+      processMessage(msg);
+   }
 
-      if (nxlog_get_debug_level_tag(DEBUG_TAG) >= 6)
-      {
-         TCHAR buffer[64];
-         debugPrintf(6, _T("Received message %s"), NXCPMessageCodeName(msg->getCode(), buffer));
-      }
+   onRecvStop();
+   debugPrintf(4, _T("Receiver thread stopped"));
+}
 
-      switch(msg->getCode())
-      {
-         case CMD_KEEPALIVE:
+/**
+ * Process message received from agent
+ */
+void AgentTunnel::processMessage(NXCPMessage *msg)
+{
+   if (nxlog_get_debug_level_tag(DEBUG_TAG) >= 6)
+   {
+      TCHAR buffer[64];
+      debugPrintf(6, _T("Received message %s"), NXCPMessageCodeName(msg->getCode(), buffer));
+   }
+
+   switch(msg->getCode())
+   {
+      case CMD_KEEPALIVE:
+         {
+            NXCPMessage response(CMD_KEEPALIVE, msg->getId());
+            sendMessage(&response);
+         }
+         break;
+      case CMD_SETUP_AGENT_TUNNEL:
+         setup(msg);
+         break;
+      case CMD_REQUEST_CERTIFICATE:
+         processCertificateRequest(msg);
+         break;
+      case CMD_CHANNEL_DATA:
+         if (msg->isBinary())
+         {
+            MutexLock(m_channelLock);
+            AgentTunnelCommChannel *channel = m_channels.get(msg->getId());
+            MutexUnlock(m_channelLock);
+            if (channel != NULL)
             {
-               NXCPMessage response(CMD_KEEPALIVE, msg->getId());
-               sendMessage(&response);
+               channel->putData(msg->getBinaryData(), msg->getBinaryDataSize());
+               channel->decRefCount();
             }
-            break;
-         case CMD_SETUP_AGENT_TUNNEL:
-            setup(msg);
-            break;
-         case CMD_REQUEST_CERTIFICATE:
-            processCertificateRequest(msg);
-            break;
-         case CMD_CHANNEL_DATA:
-            if (msg->isBinary())
+            else
             {
-               MutexLock(m_channelLock);
-               AgentTunnelCommChannel *channel = m_channels.get(msg->getId());
-               MutexUnlock(m_channelLock);
-               if (channel != NULL)
-               {
-                  channel->putData(msg->getBinaryData(), msg->getBinaryDataSize());
-                  channel->decRefCount();
-               }
-               else
-               {
-                  debugPrintf(6, _T("Received channel data for non-existing channel %u"), msg->getId());
-               }
+               debugPrintf(6, _T("Received channel data for non-existing channel %u"), msg->getId());
             }
-            break;
-         case CMD_CLOSE_CHANNEL:    // channel close notification
-            processChannelClose(msg->getFieldAsUInt32(VID_CHANNEL_ID));
-            break;
-         default:
-            m_queue.put(msg);
-            msg = NULL; // prevent message deletion
-            break;
-      }
-      delete msg;
+         }
+         break;
+      case CMD_CLOSE_CHANNEL:    // channel close notification
+         processChannelClose(msg->getFieldAsUInt32(VID_CHANNEL_ID));
+         break;
+      default:
+         m_queue.put(msg);
+         msg = NULL; // prevent message deletion
+         break;
    }
+   delete msg;
+}
 
+/**
+ * Unregister tunnel and shutdown all channels after receiver stop
+ */
+void AgentTunnel::onRecvStop()
+{
    UnregisterTunnel(this);
    m_state = AGENT_TUNNEL_SHUTDOWN;
 
@@ -389,8 +411,19 @@ void AgentTunnel::recvThread()
    delete it;
    m_channels.clear();
    MutexUnlock(m_channelLock);
+}
 
-   debugPrintf(4, _T("Receiver thread stopped"));
+/**
+ * Handle shutdown of shared socket receiver for this tunnel
+ */
+void AgentTunnel::onReceiverShutdown(MessageReceiverResult reason)
+{
+   if (reason == MSGRECV_CLOSED)
+      debugPrintf(4, _T("Tunnel closed by peer"));
+   else
+      debugPrintf(4, _T("Communication error (%s)"), AbstractMessageReceiver::resultToText(reason));
+   onRecvStop();
+   debugPrintf(4, _T("Tunnel removed from socket receiver"));
 }
 
 /**
@@ -405,13 +438,12 @@ THREAD_RESULT THREAD_CALL AgentTunnel::recvThreadStarter(void *arg)
 }
 
 /**
- * Write to SSL
+ * Write to SSL (caller should hold write lock)
  */
-int AgentTunnel::sslWrite(const void *data, size_t size)
+int AgentTunnel::sslWriteInternal(const void *data, size_t size)
 {
    bool canRetry;
    int bytes;
-   MutexLock(m_writeLock);
    do
    {
       canRetry = false;
@@ -439,10 +471,78 @@ int AgentTunnel::sslWrite(const void *data, size_t size)
       MutexUnlock(m_sslLock);
    }
    while(canRetry);
+   return bytes;
+}
+
+/**
+ * Write to SSL
+ */
+int AgentTunnel::sslWrite(const void *data, size_t size)
+{
+   MutexLock(m_writeLock);
+   int bytes = sslWriteInternal(data, size);
    MutexUnlock(m_writeLock);
    return bytes;
 }
 
+/**
+ * Write multiple data blocks to SSL without interleaving with other writers. Small blocks
+ * are coalesced to avoid creating separate TLS record for each, large blocks are written directly.
+ * Returns total number of bytes written or result of failed SSL_write call.
+ */
+int AgentTunnel::sslWritev(const SGBuffer *blocks, int count)
+{
+   BYTE buffer[TLS_WRITE_BUFFER_SIZE];
+   size_t pending = 0;
+   int total = 0;
+   MutexLock(m_writeLock);
+   for(int i = 0; i < count; i++)
+   {
+      if (pending + blocks[i].size <= TLS_WRITE_BUFFER_SIZE)
+      {
+         memcpy(&buffer[pending], blocks[i].data, blocks[i].size);
+         pending += blocks[i].size;
+         continue;
+      }
+
+      if (pending > 0)
+      {
+         int bytes = sslWriteInternal(buffer, pending);
+         if (bytes <= 0)
+         {
+            total = bytes;
+            break;
+         }
+         total += bytes;
+         pending = 0;
+      }
+
+      if (blocks[i].size <= TLS_WRITE_BUFFER_SIZE)
+      {
+         memcpy(buffer, blocks[i].data, blocks[i].size);
+         pending = blocks[i].size;
+      }
+      else
+      {
+         int bytes = sslWriteInternal(blocks[i].data, blocks[i].size);
+         if (bytes <= 0)
+         {
+            total = bytes;
+            pending = 0;
+            break;
+         }
+         total += bytes;
+      }
+   }
+   if (pending > 0)
+   {
+      int bytes = sslWriteInternal(buffer, pending);
+      total = (bytes > 0) ? total + bytes : bytes;
+   }
+   MutexUnlock(m_writeLock);
+   return total;
+}
+
 /**
  * Send message on tunnel
  */
@@ -468,6 +568,11 @@ bool AgentTunnel::sendMessage(NXCPMessage *msg)
 void AgentTunnel::start()
 {
    debugPrintf(4, _T("Tunnel started"));
+   if (SocketReceiver::addConsumer(this, g_agentReceiverThreadPool))
+   {
+      debugPrintf(6, _T("Tunnel registered with socket receiver"));
+      return;
+   }
    incRefCount();
    ThreadCreate(AgentTunnel::recvThreadStarter, 0, this);
 }
@@ -758,11 +863,47 @@ void AgentTunnel::closeChannel(AgentTunnelCommChannel *channel)
  */
 int AgentTunnel::sendChannelData(UINT32 id, const void *data, size_t len)
 {
-   NXCP_MESSAGE *msg = CreateRawNXCPMessage(CMD_CHANNEL_DATA, id, 0, data, len, NULL, false);
-   int rc = sslWrite(msg, ntohl(msg->size));
-   if (rc == static_cast<int>(ntohl(msg->size)))
-      rc = (int)len;  // adjust number of bytes to exclude tunnel overhead
-   free(msg);
+   SGBuffer block;
+   block.data = data;
+   block.size = len;
+   return sendChannelData(id, &block, 1);
+}
+
+/**
+ * Send channel data from multiple blocks as single channel data message
+ */
+int AgentTunnel::sendChannelData(UINT32 id, const SGBuffer *data, int count)
+{
+   size_t len = 0;
+   for(int i = 0; i < count; i++)
+      len += data[i].size;
+
+   // Message should be aligned to 8 bytes boundary
+   static const BYTE padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+   size_t paddingSize = (8 - ((len + NXCP_HEADER_SIZE) % 8)) & 7;
+   size_t msgSize = len + NXCP_HEADER_SIZE + paddingSize;
+
+   NXCP_MESSAGE header;
+   header.code = htons(CMD_CHANNEL_DATA);
+   header.flags = htons(MF_BINARY);
+   header.size = htonl(static_cast<UINT32>(msgSize));
+   header.id = htonl(id);
+   header.numFields = htonl(static_cast<UINT32>(len));   // numFields contains actual data size for binary message
+
+   SGBuffer localBlocks[16];
+   SGBuffer *blocks = (count + 2 <= 16) ? localBlocks : MemAllocArrayNoInit<SGBuffer>(count + 2);
+   blocks[0].data = &header;
+   blocks[0].size = NXCP_HEADER_SIZE;
+   memcpy(&blocks[1], data, sizeof(SGBuffer) * count);
+   blocks[count + 1].data = padding;
+   blocks[count + 1].size = paddingSize;
+
+   int rc = sslWritev(blocks, count + 2);
+   if (rc == static_cast<int>(msgSize))
+      rc = static_cast<int>(len);  // adjust number of bytes to exclude tunnel overhead
+
+   if (blocks != localBlocks)
+      MemFree(blocks);
    return rc;
 }
 
@@ -832,6 +973,14 @@ int AgentTunnelCommChannel::send(const void *data, size_t size, MUTEX mutex)
    return m_active ? m_tunnel->sendChannelData(m_id, data, size) : -1;
 }
 
+/**
+ * Send data from multiple buffers as single channel data message
+ */
+int AgentTunnelCommChannel::sendv(const SGBuffer *buffers, int count, MUTEX mutex)
+{
+   return m_active ? m_tunnel->sendChannelData(m_id, buffers, count) : -1;
+}
+
 /**
  * Receive data
  */
@@ -132,24 +132,26 @@ VrrpInfo *GetVRRPInfo(Node *node)
 	if (!node->isSNMPSupported())
 		return NULL;
 
-	SNMP_Transport *transport = node->createSnmpTransport();
+	SNMP_Transport *transport = node->acquireSnmpTransport();
 	if (transport == NULL)
 		return NULL;
 
 	LONG version;
-	if (SnmpGetEx(transport, _T(".1.3.6.1.2.1.68.1.1.0"), NULL, 0, &version, sizeof(LONG), 0, NULL) != SNMP_ERR_SUCCESS)
+	UINT32 rc = SnmpGetEx(transport, _T(".1.3.6.1.2.1.68.1.1.0"), NULL, 0, &version, sizeof(LONG), 0, NULL);
+	if (rc != SNMP_ERR_SUCCESS)
 	{
-		delete transport;
+		node->releaseSnmpTransport(transport, rc != SNMP_ERR_COMM);
 		return NULL;
 	}
 
 	VrrpInfo *info = new VrrpInfo(version);
-	if (SnmpWalk(transport, _T(".1.3.6.1.2.1.68.1.3.1.3"), VRRPHandler, info) != SNMP_ERR_SUCCESS)
+	rc = SnmpWalk(transport, _T(".1.3.6.1.2.1.68.1.3.1.3"), VRRPHandler, info);
+	if (rc != SNMP_ERR_SUCCESS)
 	{
 		delete info;
 		info = NULL;
 	}
 
-	delete transport;
+	node->releaseSnmpTransport(transport, rc != SNMP_ERR_COMM);
 	return info;
 }
@@ -55,6 +55,7 @@ class AgentTunnelCommChannel : public AbstractCommChannel
    AgentTunnelCommChannel(AgentTunnel *tunnel, UINT32 id);
 
    virtual int send(const void *data, size_t size, MUTEX mutex = INVALID_MUTEX_HANDLE);
+   virtual int sendv(const SGBuffer *buffers, int count, MUTEX mutex = INVALID_MUTEX_HANDLE);
    virtual int recv(void *buffer, size_t size, UINT32 timeout = INFINITE);
    virtual int poll(UINT32 timeout, bool write = false);
    virtual int shutdown();
@@ -79,7 +80,7 @@ enum AgentTunnelState
 /**
  * Agent tunnel
  */
-class AgentTunnel : public RefCountObject
+class AgentTunnel : public RefCountObject, public MessageConsumer
 {
 protected:
    INT32 m_id;
@@ -90,6 +91,7 @@ class AgentTunnel : public RefCountObject
    SSL *m_ssl;
    MUTEX m_sslLock;
    MUTEX m_writeLock;
+   TlsMessageReceiver *m_messageReceiver;
    MsgWaitQueue m_queue;
    VolatileCounter m_requestId;
    UINT32 m_nodeId;
@@ -117,8 +119,11 @@ class AgentTunnel : public RefCountObject
 
    void recvThread();
    static THREAD_RESULT THREAD_CALL recvThreadStarter(void *arg);
+   void onRecvStop();
    
+   int sslWriteInternal(const void *data, size_t size);
    int sslWrite(const void *data, size_t size);
+   int sslWritev(const SGBuffer *blocks, int count);
    bool sendMessage(NXCPMessage *msg);
    NXCPMessage *waitForMessage(UINT16 code, UINT32 id) { return m_queue.waitForMessage(code, id, g_agentCommandTimeout); }
 
@@ -136,6 +141,7 @@ class AgentTunnel : public RefCountObject
    AgentTunnelCommChannel *createChannel();
    void closeChannel(AgentTunnelCommChannel *channel);
    int sendChannelData(UINT32 id, const void *data, size_t len);
+   int sendChannelData(UINT32 id, const SGBuffer *data, int count);
    void resetStartTime() { m_startTime = time(NULL); }
 
    UINT32 getId() const { return m_id; }
@@ -157,6 +163,14 @@ class AgentTunnel : public RefCountObject
    void fillMessage(NXCPMessage *msg, UINT32 baseId) const;
 
    void debugPrintf(int level, const TCHAR *format, ...);
+
+   virtual SOCKET getSocket() override { return m_socket; }
+   virtual AbstractMessageReceiver *getMessageReceiver() override { return m_messageReceiver; }
+   virtual UINT32 getReceiveTimeout() override { return 60000; }
+   virtual void processMessage(NXCPMessage *msg) override;
+   virtual void onReceiverShutdown(MessageReceiverResult reason) override;
+   virtual void incConsumerRefCount() override { incRefCount(); }
+   virtual void decConsumerRefCount() override { decRefCount(); }
 };
 
 /**
@@ -912,7 +912,8 @@ enum ThreadPoolStat
    THREAD_POOL_USAGE,
    THREAD_POOL_LOADAVG_1,
    THREAD_POOL_LOADAVG_5,
-   THREAD_POOL_LOADAVG_15
+   THREAD_POOL_LOADAVG_15,
+   THREAD_POOL_AVERAGE_WAIT_TIME
 };
 
 /**
@@ -1065,11 +1066,16 @@ void QueueIDataInsert(time_t timestamp, UINT32 nodeId, UINT32 dciId, const TCHAR
 void QueueRawDciDataUpdate(time_t timestamp, UINT32 dciId, const TCHAR *rawValue, const TCHAR *transformedValue);
 void QueueRawDciDataDelete(UINT32 dciId);
 INT64 GetIDataWriterQueueSize();
+UINT64 GetIDataWriterMemoryUsage();
+bool GetIDataWriterMemoryUsagePeak(int queue, UINT64 *value);
 INT64 GetRawDataWriterQueueSize();
 UINT64 GetRawDataWriterMemoryUsage();
 void StartDBWriter();
 void StopDBWriter();
 
+UINT64 GetEventLogWriterRecordsWritten();
+double GetEventLogWriterRecordsPerSecond();
+
 void PerfDataStorageRequest(DCItem *dci, time_t timestamp, const TCHAR *value);
 void PerfDataStorageRequest(DCTable *dci, time_t timestamp, Table *value);
 
@@ -1386,6 +1392,7 @@ extern UINT32 g_auditFlags;
 extern time_t g_serverStartTime;
 extern UINT32 g_lockTimeout;
 extern UINT32 g_agentCommandTimeout;
+extern UINT32 g_snmpTransportIdleTimeout;
 extern UINT32 g_thresholdRepeatInterval;
 extern UINT32 g_requiredPolls;
 extern UINT32 g_slmPollingInterval;
@@ -112,9 +112,125 @@ class NXCORE_EXPORTABLE ItemValue
    const ItemValue& operator=(UINT64 value);
 };
 
+/**
+ * DCI value cache. Values are kept in circular buffer in compact form - only
+ * value of DCI's data type and timestamp. Strings are stored out of line and
+ * only for DCIs with non-numeric data type. Element 0 is the most recent value.
+ * Placeholder values inserted when there are not enough values have timestamp 1.
+ */
+class NXCORE_EXPORTABLE ItemValueCache
+{
+private:
+   union Value
+   {
+      INT32 int32;
+      UINT32 uint32;
+      INT64 int64;
+      UINT64 uint64;
+      double real;
+      TCHAR *string;
+   };
+
+   struct Element
+   {
+      Value value;
+      time_t timestamp;
+   };
+
+   Element *m_elements;
+   UINT32 m_size;
+   UINT32 m_allocated;
+   UINT32 m_head;             // Position of most recent value
+   UINT32 m_version;          // Incremented on every change
+   int m_dataType;
+   TCHAR *m_lastValueText;    // Original text of most recent value (only for numeric data types)
+   size_t m_lastValueTextSize;
+
+   static bool isStringStorage(int dataType)
+   {
+      return (dataType == DCI_DT_STRING) || (dataType == DCI_DT_NULL) || (dataType > DCI_DT_COUNTER64);
+   }
+
+   static void parseValue(const TCHAR *text, INT32 *value) { *value = static_cast<INT32>(_tcstol(text, NULL, 0)); }
+   static void parseValue(const TCHAR *text, UINT32 *value) { *value = static_cast<UINT32>(_tcstoul(text, NULL, 0)); }
+   static void parseValue(const TCHAR *text, INT64 *value) { *value = _tcstoll(text, NULL, 0); }
+   static void parseValue(const TCHAR *text, UINT64 *value) { *value = _tcstoull(text, NULL, 0); }
+   static void parseValue(const TCHAR *text, double *value) { *value = _tcstod(text, NULL); }
+
+   const Element& element(UINT32 index) const
+   {
+      UINT32 pos = m_head + index;
+      return m_elements[(pos < m_size) ? pos : pos - m_size];
+   }
+   Element& element(UINT32 index)
+   {
+      UINT32 pos = m_head + index;
+      return m_elements[(pos < m_size) ? pos : pos - m_size];
+   }
+
+   template<typename T> T convert(const Element& e) const
+   {
+      switch(m_dataType)
+      {
+         case DCI_DT_INT:
+            return static_cast<T>(e.value.int32);
+         case DCI_DT_UINT:
+         case DCI_DT_COUNTER32:
+            return static_cast<T>(e.value.uint32);
+         case DCI_DT_INT64:
+            return static_cast<T>(e.value.int64);
+         case DCI_DT_UINT64:
+         case DCI_DT_COUNTER64:
+            return static_cast<T>(e.value.uint64);
+         case DCI_DT_FLOAT:
+            return static_cast<T>(e.value.real);
+         default:
+            T value;
+            parseValue(CHECK_NULL_EX(e.value.string), &value);
+            return value;
+      }
+   }
+
+   Value createValue(const TCHAR *text, int dataType) const;
+   void setLastValueText(const TCHAR *text);
+   void setStringValue(Element *e, const TCHAR *text);
+   const TCHAR *formatValue(const Element& e, TCHAR *buffer, size_t size) const;
+   void linearize();
+   void setDataType(int dataType);
+
+public:
+   ItemValueCache();
+   ~ItemValueCache();
+
+   void copyFrom(const ItemValueCache& src);
+
+   UINT32 size() const { return m_size; }
+   UINT32 getVersion() const { return m_version; }
+
+   void add(const ItemValue& value, int dataType);
+   void set(UINT32 index, const TCHAR *text, time_t timestamp);
+   bool remove(time_t timestamp);
+   void reset(UINT32 size, int dataType);
+   void resize(UINT32 size);
+   void clear() { reset(0, m_dataType); }
+
+   time_t getTimeStamp(UINT32 index) const { return element(index).timestamp; }
+   INT32 getInt32(UINT32 index) const { return convert<INT32>(element(index)); }
+   UINT32 getUInt32(UINT32 index) const { return convert<UINT32>(element(index)); }
+   INT64 getInt64(UINT32 index) const { return convert<INT64>(element(index)); }
+   UINT64 getUInt64(UINT32 index) const { return convert<UINT64>(element(index)); }
+   double getDouble(UINT32 index) const { return convert<double>(element(index)); }
+   template<typename T> T get(UINT32 index) const { return convert<T>(element(index)); }
+   const TCHAR *getString(UINT32 index, TCHAR *buffer, size_t size) const;
+   const TCHAR *getLastValue() const { return getString(0, NULL, 0); }
+
+   UINT64 getMemoryUsage() const;
+};
+
 
 class DCItem;
 class DataCollectionTarget;
+class Node;
 
 /**
  * Threshold definition class
@@ -143,12 +259,24 @@ class NXCORE_EXPORTABLE Threshold
 	int m_numMatches;			// Number of consecutive matches
 	int m_repeatInterval;		// -1 = default, 0 = off, >0 = seconds between repeats
 	time_t m_lastEventTimestamp;
+   union
+   {
+      UINT64 integer;         // Integer types are summed modulo 2^64
+      double real;
+   } m_windowSum;             // Running sum of last m_sampleCount values
+   UINT32 m_windowCacheVersion;  // Value cache version at the moment of last window sum update
+   int m_windowSampleCount;   // Sample count used for window sum calculation
+   int m_windowUpdates;       // Incremental updates since last full recalculation
+   BYTE m_windowDataType;     // Data type used for window sum calculation
+   bool m_windowSumValid;
 
    const ItemValue& value() { return m_value; }
-   void calculateAverageValue(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues);
-   void calculateSumValue(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues);
-   void calculateMDValue(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues);
-   void calculateDiff(ItemValue *pResult, ItemValue &lastValue, ItemValue **ppPrevValues);
+   void resetWindowSum();
+   void updateWindowSum(ItemValue &lastValue, const ItemValueCache &prevValues);
+   void calculateAverageValue(ItemValue *pResult);
+   void calculateSumValue(ItemValue *pResult);
+   void calculateMDValue(ItemValue *pResult, ItemValue &lastValue, const ItemValueCache &prevValues);
+   void calculateDiff(ItemValue *pResult, ItemValue &lastValue, const ItemValueCache &prevValues);
    void setScript(TCHAR *script);
 
 public:
@@ -180,7 +308,7 @@ class NXCORE_EXPORTABLE Threshold
    void setLastCheckedValue(const ItemValue &value) { m_lastCheckValue = value; }
 
    BOOL saveToDB(DB_HANDLE hdb, UINT32 dwIndex);
-   ThresholdCheckResult check(ItemValue &value, ItemValue **ppPrevValues, ItemValue &fvalue, ItemValue &tvalue, NetObj *target, DCItem *dci);
+   ThresholdCheckResult check(ItemValue &value, const ItemValueCache &prevValues, ItemValue &fvalue, ItemValue &tvalue, NetObj *target, DCItem *dci);
    ThresholdCheckResult checkError(UINT32 dwErrorCount);
 
    void createMessage(NXCPMessage *msg, UINT32 baseId) const;
@@ -289,6 +417,7 @@ class NXCORE_EXPORTABLE DCObject
    INT32 m_instanceRetentionTime;      // Retention time if instance is not found
    time_t m_startTime;                 // Time to start data collection
    UINT32 m_relatedObject;
+   time_t m_scheduledPollTime;         // Time of next scheduled poll or 0 if not scheduled (protected by scheduler lock)
 
    void lock() const { MutexLock(m_hMutex); }
    bool tryLock() const { return MutexTryLock(m_hMutex); }
@@ -297,6 +426,7 @@ class NXCORE_EXPORTABLE DCObject
    bool loadAccessList(DB_HANDLE hdb);
 	bool loadCustomSchedules(DB_HANDLE hdb);
    bool matchSchedule(const TCHAR *schedule, bool *withSeconds, struct tm *currLocalTime, time_t currTimestamp);
+   time_t getNextScheduleMatch(time_t currTime);
 
    void updateTimeIntervalsInternal();
 
@@ -371,6 +501,9 @@ class NXCORE_EXPORTABLE DCObject
 
 	bool matchClusterResource();
    bool isReadyForPolling(time_t currTime);
+   time_t getNextPollTime(time_t currTime);
+   time_t getScheduledPollTime() const { return m_scheduledPollTime; }
+   void setScheduledPollTime(time_t t) { m_scheduledPollTime = t; }
 	bool isScheduledForDeletion() { return m_scheduledForDeletion ? true : false; }
    void setLastPollTime(time_t lastPoll) { m_lastPoll = lastPoll; }
    void setStatus(int status, bool generateEvent);
@@ -431,9 +564,8 @@ class NXCORE_EXPORTABLE DCItem : public DCObject
    BYTE m_dataType;
 	int m_sampleCount;            // Number of samples required to calculate value
 	ObjectArray<Threshold> *m_thresholds;
-   UINT32 m_cacheSize;          // Number of items in cache
    UINT32 m_requiredCacheSize;
-   ItemValue **m_ppValueCache;
+   ItemValueCache m_valueCache;
    ItemValue m_prevRawValue;     // Previous raw value (used for delta calculation)
    time_t m_tPrevValueTimeStamp;
    bool m_bCacheLoaded;
@@ -810,6 +942,7 @@ class DCObjectInfo
    bool m_hasActiveThreshold;
    int m_thresholdSeverity;
    UINT32 m_relatedObject;
+   UINT64 m_cacheMemoryUsage;
 
 protected:
    DCObjectInfo(const DCObject *object);
@@ -838,24 +971,33 @@ class DCObjectInfo
    bool hasActiveThreshold() const { return m_hasActiveThreshold; }
    int getThresholdSeverity() const { return m_thresholdSeverity; }
    UINT32 getRelatedObject() const { return m_relatedObject; }
+   UINT64 getCacheMemoryUsage() const { return m_cacheMemoryUsage; }
 };
 
 /**
  * Functions
  */
 void InitDataCollector();
+void ScheduleDataCollection(const shared_ptr<DCObject>& dcObject, time_t currTime);
+INT64 GetDataCollectionSchedulerQueueSize();
+void QueueSNMPDataCollection(Node *node, SharedObjectArray<DCObject> *items);
+INT64 GetSNMPAsyncPendingRequestCount();
 void DeleteAllItemsForNode(UINT32 dwNodeId);
 void WriteFullParamListToMessage(NXCPMessage *pMsg, int origin, WORD flags);
 int GetDCObjectType(UINT32 nodeId, UINT32 dciId);
 
 void CalculateItemValueDiff(ItemValue &result, int nDataType, const ItemValue &value1, const ItemValue &value2);
+void CalculateItemValueDiff(ItemValue &result, int nDataType, const ItemValue &value, const ItemValueCache &cache, UINT32 index);
 void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValue * const *valueList, size_t numValues);
+void CalculateItemValueAverage(ItemValue &result, int nDataType, const ItemValueCache &cache, size_t numValues);
 void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValue * const *valueList, size_t numValues);
+void CalculateItemValueMD(ItemValue &result, int nDataType, const ItemValueCache &cache, size_t numValues);
 void CalculateItemValueTotal(ItemValue &result, int nDataType, const ItemValue *const *valueList, size_t numValues);
 void CalculateItemValueMin(ItemValue &result, int nDataType, const ItemValue *const *valueList, size_t numValues);
 void CalculateItemValueMax(ItemValue &result, int nDataType, const ItemValue *const *valueList, size_t numValues);
 
 DataCollectionError GetQueueStatistic(const TCHAR *parameter, StatisticType type, TCHAR *value);
+DataCollectionError GetEventProcessorStatistic(const TCHAR *parameter, TCHAR *value);
 
 UINT64 GetDCICacheMemoryUsage();
 
@@ -98,6 +98,7 @@ class NXCORE_EXPORTABLE Event
    TCHAR *m_messageTemplate;
    time_t m_timestamp;
    time_t m_originTimestamp;
+   INT64 m_queueTime;   // Time when event was queued for processing (milliseconds)
    StringSet m_tags;
 	TCHAR *m_customMessage;
 	Array m_parameters;
@@ -132,6 +133,9 @@ class NXCORE_EXPORTABLE Event
 
    void setSeverity(int severity) { m_severity = severity; }
 
+   INT64 getQueueTime() const { return m_queueTime; }
+   void setQueueTime(INT64 t) { m_queueTime = t; }
+
    UINT64 getRootId() const { return m_rootId; }
    void setRootId(UINT64 id) { m_rootId = id; }
 
@@ -238,7 +242,8 @@ class EPRule
    StringList m_timerCancellations;
    TCHAR *m_comments;
    TCHAR *m_scriptSource;
-   NXSL_VM *m_script;
+   NXSL_Program *m_script;
+   UINT32 m_scriptCacheKey;
 
    TCHAR *m_alarmMessage;
    TCHAR *m_alarmImpact;
@@ -252,6 +257,15 @@ class EPRule
 	StringMap m_pstorageSetActions;
 	StringList m_pstorageDeleteActions;
 
+   Mutex m_sourceCacheLock;
+   HashSet<UINT32> *m_sourceCache;  // Source objects with all their children
+   INT32 m_sourceCacheVersion;      // Object tree version source cache was built for
+   time_t m_sourceCacheTimestamp;
+
+   VolatileCounter64 m_evaluationCount;
+   VolatileCounter64 m_matchCount;
+
+   bool matchSourceUncached(UINT32 objectId);
    bool matchSource(UINT32 objectId);
    bool matchEvent(UINT32 eventCode);
    bool matchSeverity(UINT32 severity);
@@ -279,6 +293,13 @@ class EPRule
 
    bool isActionInUse(UINT32 actionId) const;
    bool isCategoryInUse(UINT32 categoryId) const { return m_alarmCategoryList.contains(categoryId); }
+
+   bool isDisabled() const { return (m_flags & RF_DISABLED) != 0; }
+   bool isEventListNegated() const { return (m_flags & RF_NEGATED_EVENTS) != 0; }
+   const IntegerArray<UINT32>& getEvents() const { return m_events; }
+   const TCHAR *getComments() const { return CHECK_NULL_EX(m_comments); }
+   UINT64 getEvaluationCount() const { return static_cast<UINT64>(m_evaluationCount); }
+   UINT64 getMatchCount() const { return static_cast<UINT64>(m_matchCount); }
 };
 
 /**
@@ -288,12 +309,15 @@ class EventPolicy
 {
 private:
    ObjectArray<EPRule> m_rules;
+   HashMap<UINT32, IntegerArray<int>> m_eventCodeIndex;  // Candidate rules for event codes referenced in rules
+   IntegerArray<int> m_genericRules;   // Rules that can match any event code
    RWLOCK m_rwlock;
 
    void readLock() const { RWLockReadLock(m_rwlock, INFINITE); }
    void writeLock() { RWLockWriteLock(m_rwlock, INFINITE); }
    void unlock() const { RWLockUnlock(m_rwlock); }
    int findRuleIndexByGuid(const uuid& guid, int shift = 0) const;
+   void buildEventCodeIndex();
 
 public:
    EventPolicy();
@@ -313,6 +337,8 @@ class EventPolicy
 
    bool isActionInUse(UINT32 actionId) const;
    bool isCategoryInUse(UINT32 categoryId) const;
+
+   void showStatistics(CONSOLE_CTX console) const;
 };
 
 /**
@@ -364,6 +390,6 @@ const TCHAR NXCORE_EXPORTABLE *GetStatusAsText(int status, bool allCaps);
  */
 extern ObjectQueue<Event> g_eventQueue;
 extern EventPolicy *g_pEventPolicy;
-extern UINT64 g_totalEventsProcessed;
+extern VolatileCounter64 g_totalEventsProcessed;
 
 #endif   /* _nms_events_h_ */
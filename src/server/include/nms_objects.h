@@ -1118,6 +1118,7 @@ class NXCORE_EXPORTABLE DataCollectionOwner : public NetObj
    bool setItemStatus(UINT32 dwNumItems, UINT32 *pdwItemList, int iStatus);
    shared_ptr<DCObject> getDCObjectById(UINT32 itemId, UINT32 userId, bool lock = true);
    shared_ptr<DCObject> getDCObjectByGUID(const uuid& guid, UINT32 userId, bool lock = true);
+   void getDCObjectsById(const IntegerArray<UINT32>& ids, SharedObjectArray<DCObject> *objects);
    shared_ptr<DCObject> getDCObjectByTemplateId(UINT32 tmplItemId, UINT32 userId);
    shared_ptr<DCObject> getDCObjectByName(const TCHAR *name, UINT32 userId);
    shared_ptr<DCObject> getDCObjectByDescription(const TCHAR *description, UINT32 userId);
@@ -1825,7 +1826,8 @@ class NXCORE_EXPORTABLE DataCollectionTarget : public DataCollectionOwner
    void reloadDCItemCache(UINT32 dciId);
    void cleanDCIData(DB_HANDLE hdb);
    void calculateDciCutoffTimes(time_t *cutoffTimeIData, time_t *cutoffTimeTData);
-   void queueItemsForPolling();
+   void scheduleItemsForPolling(time_t currTime);
+   void queueItemsForPolling(SharedObjectArray<DCObject> *items, time_t currTime);
    bool processNewDCValue(shared_ptr<DCObject> dco, time_t currTime, void *value);
    void scheduleItemDataCleanup(UINT32 dciId);
    void scheduleTableDataCleanup(UINT32 dciId);
@@ -2381,6 +2383,35 @@ class ProxyAgentConnection : public ObjectLock<AgentConnectionEx>
    time_t getLastConnectTime() const { return m_lastConnect; }
 };
 
+/**
+ * SNMP transport in node's transport pool
+ */
+class PooledSNMPTransport
+{
+public:
+   SNMP_Transport *transport;
+   UINT16 port;
+   SNMP_Version version;
+   TCHAR *context;
+   time_t lastUsed;
+   bool inUse;
+
+   PooledSNMPTransport(SNMP_Transport *_transport, UINT16 _port, SNMP_Version _version, const TCHAR *_context)
+   {
+      transport = _transport;
+      port = _port;
+      version = _version;
+      context = MemCopyString(_context);
+      lastUsed = time(NULL);
+      inUse = true;
+   }
+   ~PooledSNMPTransport()
+   {
+      delete transport;
+      MemFree(context);
+   }
+};
+
 // Explicit instantiation of shared_ptr<*> to enable DLL interface for them
 #ifdef _WIN32
 template class NXCORE_EXPORTABLE shared_ptr<VlanList>;
@@ -2472,6 +2503,8 @@ class NXCORE_EXPORTABLE Node : public DataCollectionTarget
 	MUTEX m_mutexTopoAccess;
    AgentConnectionEx *m_agentConnection;
    ProxyAgentConnection *m_proxyConnections;
+   MUTEX m_snmpTransportPoolLock;
+   ObjectArray<PooledSNMPTransport> m_snmpTransportPool;
    VolatileCounter m_pendingDataConfigurationSync;
    SMCLP_Connection *m_smclpConnection;
 	UINT64 m_lastAgentTrapId;	     // ID of last received agent trap
@@ -2571,6 +2604,7 @@ class NXCORE_EXPORTABLE Node : public DataCollectionTarget
    bool updateSoftwarePackages(PollerInfo *poller, UINT32 requestId);
    bool updateHardwareComponents(PollerInfo *poller, UINT32 requestId);
    bool querySnmpSysProperty(SNMP_Transport *snmp, const TCHAR *oid, const TCHAR *propName, UINT32 pollRqId, TCHAR **value);
+   bool isSNMPDataCollectionPossible(UINT16 port);
    void checkBridgeMib(SNMP_Transport *pTransport);
    void checkIfXTable(SNMP_Transport *pTransport);
    bool checkNetworkPath(UINT32 requestId);
@@ -2768,6 +2802,9 @@ class NXCORE_EXPORTABLE Node : public DataCollectionTarget
    virtual DataCollectionError getInternalItem(const TCHAR *param, size_t bufSize, TCHAR *buffer) override;
 
    DataCollectionError getItemFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *param, size_t bufSize, TCHAR *buffer, int interpretRawValue);
+   void getItemsFromSNMP(UINT16 port, SNMP_Version version, DCItem **items, int count, int maxBatchSize, TCHAR **buffers, DataCollectionError *errors);
+   bool getItemsFromSNMPAsync(SNMP_AsyncClient *client, UINT16 port, SNMP_Version version, DCItem **items, int count,
+            TCHAR **buffers, DataCollectionError *errors, void (*callback)(bool, void*), void *context);
    DataCollectionError getTableFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *oid, ObjectArray<DCTableColumn> *columns, Table **table);
    DataCollectionError getListFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *oid, StringList **list);
    DataCollectionError getOIDSuffixListFromSNMP(UINT16 port, SNMP_Version version, const TCHAR *oid, StringMap **values);
@@ -2799,6 +2836,10 @@ class NXCORE_EXPORTABLE Node : public DataCollectionTarget
    AgentConnectionEx *getAgentConnection(bool forcePrimary = false);
    AgentConnectionEx *acquireProxyConnection(ProxyType type, bool validate = false);
 	SNMP_Transport *createSnmpTransport(UINT16 port = 0, SNMP_Version version = SNMP_VERSION_DEFAULT, const TCHAR *context = NULL);
+   SNMP_Transport *acquireSnmpTransport(UINT16 port = 0, SNMP_Version version = SNMP_VERSION_DEFAULT, const TCHAR *context = NULL);
+   void releaseSnmpTransport(SNMP_Transport *transport, bool reuse = true);
+   void invalidateSnmpTransportPool();
+   void reapIdleSnmpTransports(time_t idleTimeout);
 	SNMP_SecurityContext *getSnmpSecurityContext() const;
 
 	UINT32 getEffectiveSnmpProxy(bool backup = false);
@@ -4002,6 +4043,7 @@ extern UINT32 NXCORE_EXPORTABLE g_dwMgmtNode;
 extern BOOL g_bModificationsLocked;
 extern Queue g_templateUpdateQueue;
 
+extern VolatileCounter g_objectTreeVersion;
 extern ObjectIndex NXCORE_EXPORTABLE g_idxObjectById;
 extern HashIndex<uuid> g_idxObjectByGUID;
 extern InetAddressIndex NXCORE_EXPORTABLE g_idxSubnetByAddr;
@@ -380,6 +380,29 @@ ScriptVMHandle NXCORE_EXPORTABLE CreateServerScriptVM(const TCHAR *name, NetObj
  */
 ScriptVMHandle NXCORE_EXPORTABLE CreateServerScriptVM(const NXSL_Program *script, NetObj *object, DCObject *dci = NULL);
 
+/**
+ * Get VM for library script from calling thread's VM cache (or create new VM if cache is not enabled)
+ */
+ScriptVMHandle NXCORE_EXPORTABLE AcquireServerScriptVM(const TCHAR *name, NetObj *object, DCObject *dci = NULL);
+
+/**
+ * Get VM for compiled script from calling thread's VM cache (or create new VM if cache is not enabled)
+ */
+ScriptVMHandle NXCORE_EXPORTABLE AcquireServerScriptVM(UINT32 cacheKey, const NXSL_Program *script, NetObj *object, DCObject *dci = NULL);
+
+/**
+ * Return VM obtained by AcquireServerScriptVM
+ */
+void NXCORE_EXPORTABLE ReleaseServerScriptVM(NXSL_VM *vm);
+
+/**
+ * Script VM cache management
+ */
+void EnableScriptVMCache();
+void DisableScriptVMCache();
+UINT32 NXCORE_EXPORTABLE CreateScriptVMCacheKey();
+void NXCORE_EXPORTABLE InvalidateScriptVMCacheKey(UINT32 cacheKey);
+
 /**
  * Functions
  */
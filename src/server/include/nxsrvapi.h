@@ -738,6 +738,8 @@ class LIBNXSRV_EXPORTABLE RemoteFileInfo
    const BYTE *hash() const { return m_hash; }
 };
 
+class AgentConnectionReceiver;
+
 /**
  * Agent connection
  */
@@ -764,6 +766,8 @@ class LIBNXSRV_EXPORTABLE AgentConnection
    MUTEX m_mutexDataLock;
 	MUTEX m_mutexSocketWrite;
    THREAD m_hReceiverThread;
+   AgentConnectionReceiver *m_receiver;
+   CONDITION m_condReceiverStopped;
    NXCPEncryptionContext *m_pCtx;
    int m_iEncryptionPolicy;
    bool m_useProxy;
@@ -783,10 +787,16 @@ class LIBNXSRV_EXPORTABLE AgentConnection
 	void (*m_sendToClientMessageCallback)(NXCP_MESSAGE *, void *);
 	bool m_fileUploadInProgress;
 	bool m_allowCompression;
+	NXCPStreamCompressionMethod m_compressionMethod;
 	VolatileCounter m_bulkDataProcessing;
 
    void receiverThread();
    static THREAD_RESULT THREAD_CALL receiverThreadStarter(void *);
+   bool startReceiver();
+   void waitForReceiverStop();
+   void onReceiverStop(AbstractCommChannel *channel);
+   void processRawMessage(NXCP_MESSAGE *rawMsg);
+   void updateReceiverEncryptionContext();
 
    UINT32 setupEncryption(RSA *pServerKey);
    UINT32 authenticate(BOOL bProxyData);
@@ -801,6 +811,8 @@ class LIBNXSRV_EXPORTABLE AgentConnection
    void onSyslogMessageCallback(NXCPMessage *msg);
    void postRawMessageCallback(NXCP_MESSAGE *msg);
 
+   friend class AgentConnectionReceiver;
+
 protected:
    virtual ~AgentConnection();
 
@@ -844,6 +856,7 @@ class LIBNXSRV_EXPORTABLE AgentConnection
 	bool isControlServer() const { return m_controlServer; }
 	bool isMasterServer() const { return m_masterServer; }
 	bool isCompressionAllowed() const { return m_allowCompression && (m_nProtocolVersion >= 4); }
+	NXCPStreamCompressionMethod getCompressionMethod() const { return isCompressionAllowed() ? m_compressionMethod : NXCP_STREAM_COMPRESSION_NONE; }
 
    bool sendMessage(NXCPMessage *msg);
    bool sendRawMessage(NXCP_MESSAGE *msg);
@@ -957,6 +970,11 @@ class LIBNXSRV_EXPORTABLE ISC
 
    void receiverThread();
    static THREAD_RESULT THREAD_CALL receiverThreadStarter(void *);
+   bool startReceiver();
+   void waitForReceiverStop();
+   void onReceiverStop(AbstractCommChannel *channel);
+   void processRawMessage(NXCP_MESSAGE *rawMsg);
+   void updateReceiverEncryptionContext();
 
 protected:
    UINT32 setupEncryption(RSA *pServerKey);
@@ -1022,6 +1040,7 @@ const TCHAR LIBNXSRV_EXPORTABLE *ISCErrorCodeToText(UINT32 code);
  */
 extern LIBNXSRV_EXPORTABLE_VAR(UINT64 g_flags);
 extern LIBNXSRV_EXPORTABLE_VAR(ThreadPool *g_agentConnectionThreadPool);
+extern LIBNXSRV_EXPORTABLE_VAR(ThreadPool *g_agentReceiverThreadPool);
 
 /**
  * Helper finctions for checking server flags
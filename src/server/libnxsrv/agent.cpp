@@ -41,6 +41,13 @@
  */
 LIBNXSRV_EXPORTABLE_VAR(ThreadPool *g_agentConnectionThreadPool) = NULL;
 
+/**
+ * Thread pool for delivering messages received by shared socket receiver. It is separate
+ * from agent connection thread pool because tasks on that pool may block waiting for
+ * responses, and responses would not be delivered if all its threads are blocked.
+ */
+LIBNXSRV_EXPORTABLE_VAR(ThreadPool *g_agentReceiverThreadPool) = NULL;
+
 /**
  * Unique connection ID
  */
@@ -76,6 +83,73 @@ THREAD_RESULT THREAD_CALL AgentConnection::receiverThreadStarter(void *pArg)
    return THREAD_OK;
 }
 
+/**
+ * Agent connection receiver - used when connection is served by shared socket receiver
+ */
+class AgentConnectionReceiver : public MessageConsumer
+{
+private:
+   VolatileCounter m_refCount;
+   AgentConnection *m_connection;
+   AbstractCommChannel *m_channel;
+   SOCKET m_socket;
+   CommChannelMessageReceiver m_receiver;
+
+public:
+   AgentConnectionReceiver(AgentConnection *connection, AbstractCommChannel *channel) : m_receiver(channel, 4096, MAX_MSG_SIZE)
+   {
+      m_refCount = 1;
+      m_connection = connection;
+      m_connection->incInternalRefCount();
+      m_channel = channel;
+      m_channel->incRefCount();
+      m_socket = channel->getSocket();
+      m_receiver.setEncryptionContext(connection->m_pCtx);
+   }
+
+   virtual ~AgentConnectionReceiver()
+   {
+      m_channel->decRefCount();
+      m_connection->decInternalRefCount();
+   }
+
+   void setEncryptionContext(NXCPEncryptionContext *ctx) { m_receiver.setEncryptionContext(ctx); }
+
+   virtual SOCKET getSocket() override { return m_socket; }
+   virtual AbstractMessageReceiver *getMessageReceiver() override { return &m_receiver; }
+   virtual UINT32 getReceiveTimeout() override { return m_connection->m_dwRecvTimeout; }
+   virtual bool isRawMessageConsumer() override { return true; }
+
+   virtual void processRawMessage(NXCP_MESSAGE *msg) override
+   {
+      m_connection->processRawMessage(msg);
+      MemFree(msg);
+   }
+
+   virtual bool onReceiveTimeout() override
+   {
+      // Receive timeout may occur when uploading large files via slow links
+      if (m_connection->m_fileUploadInProgress)
+         return true;
+      m_connection->debugPrintf(6, _T("Timed out waiting for message"));
+      return false;
+   }
+
+   virtual void onReceiverShutdown(MessageReceiverResult reason) override
+   {
+      m_connection->debugPrintf(6, _T("Connection removed from socket receiver (%s)"), AbstractMessageReceiver::resultToText(reason));
+      m_connection->onReceiverStop(m_channel);
+      m_connection->lock();
+      if (m_connection->m_receiver == this)
+         m_connection->m_receiver = NULL;
+      m_connection->unlock();
+      ConditionSet(m_connection->m_condReceiverStopped);
+   }
+
+   virtual void incConsumerRefCount() override { InterlockedIncrement(&m_refCount); }
+   virtual void decConsumerRefCount() override { if (InterlockedDecrement(&m_refCount) == 0) delete this; }
+};
+
 /**
  * Constructor for AgentConnection
  */
@@ -101,6 +175,7 @@ AgentConnection::AgentConnection(const InetAddress& addr, WORD port, int authMet
       m_szSecret[0] = 0;
    }
    m_allowCompression = allowCompression;
+   m_compressionMethod = NXCP_STREAM_COMPRESSION_DEFLATE;
    m_channel = NULL;
    m_tLastCommandTime = 0;
    m_pMsgWaitQueue = new MsgWaitQueue;
@@ -111,6 +186,8 @@ AgentConnection::AgentConnection(const InetAddress& addr, WORD port, int authMet
    m_mutexDataLock = MutexCreate();
 	m_mutexSocketWrite = MutexCreate();
    m_hReceiverThread = INVALID_THREAD_HANDLE;
+   m_receiver = NULL;
+   m_condReceiverStopped = ConditionCreate(true);
    m_pCtx = NULL;
    m_iEncryptionPolicy = m_iDefaultEncryptionPolicy;
    m_useProxy = false;
@@ -161,6 +238,7 @@ AgentConnection::~AgentConnection()
    MutexDestroy(m_mutexDataLock);
 	MutexDestroy(m_mutexSocketWrite);
 	ConditionDestroy(m_condFileDownload);
+   ConditionDestroy(m_condReceiverStopped);
 }
 
 /**
@@ -255,213 +333,237 @@ void AgentConnection::receiverThread()
          continue;   // Bad packet, wait for next
       }
 
-      if (ntohs(rawMsg->flags) & MF_BINARY)
+      processRawMessage(rawMsg);
+   }
+   debugPrintf(6, _T("Receiver loop terminated"));
+
+   onReceiverStop(channel);
+   channel->decRefCount();
+
+   MemFree(rawMsg);
+   MemFree(msgBuffer);
+#ifdef _WITH_ENCRYPTION
+   MemFree(decryptionBuffer);
+#endif
+
+   debugPrintf(6, _T("Receiver thread stopped"));
+}
+
+/**
+ * Process raw message received from agent
+ */
+void AgentConnection::processRawMessage(NXCP_MESSAGE *rawMsg)
+{
+   if (ntohs(rawMsg->flags) & MF_BINARY)
+   {
+      // Convert message header to host format
+      rawMsg->id = ntohl(rawMsg->id);
+      rawMsg->code = ntohs(rawMsg->code);
+      rawMsg->numFields = ntohl(rawMsg->numFields);
+      if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_debugId) >= 6)
       {
-         // Convert message header to host format
-         rawMsg->id = ntohl(rawMsg->id);
-         rawMsg->code = ntohs(rawMsg->code);
-         rawMsg->numFields = ntohl(rawMsg->numFields);
-         if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_debugId) >= 6)
-         {
-            TCHAR buffer[64];
-            debugPrintf(6, _T("Received raw message %s (%d) from agent at %s"),
-               NXCPMessageCodeName(rawMsg->code, buffer), rawMsg->id, (const TCHAR *)m_addr.toString());
-         }
+         TCHAR buffer[64];
+         debugPrintf(6, _T("Received raw message %s (%d) from agent at %s"),
+            NXCPMessageCodeName(rawMsg->code, buffer), rawMsg->id, (const TCHAR *)m_addr.toString());
+      }
 
-         if ((rawMsg->code == CMD_FILE_DATA) && (rawMsg->id == m_dwDownloadRequestId))
+      if ((rawMsg->code == CMD_FILE_DATA) && (rawMsg->id == m_dwDownloadRequestId))
+      {
+         if (m_sendToClientMessageCallback != NULL)
          {
-            if (m_sendToClientMessageCallback != NULL)
-            {
-               rawMsg->code = ntohs(rawMsg->code);
-               rawMsg->numFields = ntohl(rawMsg->numFields);
-               m_sendToClientMessageCallback(rawMsg, m_downloadProgressCallbackArg);
+            rawMsg->code = ntohs(rawMsg->code);
+            rawMsg->numFields = ntohl(rawMsg->numFields);
+            m_sendToClientMessageCallback(rawMsg, m_downloadProgressCallbackArg);
 
-               if (ntohs(rawMsg->flags) & MF_END_OF_FILE)
-               {
-                  m_sendToClientMessageCallback = NULL;
-                  onFileDownload(true);
-               }
-               else
+            if (ntohs(rawMsg->flags) & MF_END_OF_FILE)
+            {
+               m_sendToClientMessageCallback = NULL;
+               onFileDownload(true);
+            }
+            else
+            {
+               if (m_downloadProgressCallback != NULL)
                {
-                  if (m_downloadProgressCallback != NULL)
-                  {
-                     m_downloadProgressCallback(rawMsg->size - (NXCP_HEADER_SIZE + 8), m_downloadProgressCallbackArg);
-                  }
+                  m_downloadProgressCallback(rawMsg->size - (NXCP_HEADER_SIZE + 8), m_downloadProgressCallbackArg);
                }
             }
-            else
+         }
+         else
+         {
+            if (m_hCurrFile != -1)
             {
-               if (m_hCurrFile != -1)
+               if (_write(m_hCurrFile, rawMsg->fields, rawMsg->numFields) == (int)rawMsg->numFields)
                {
-                  if (_write(m_hCurrFile, rawMsg->fields, rawMsg->numFields) == (int)rawMsg->numFields)
+                  if (ntohs(rawMsg->flags) & MF_END_OF_FILE)
                   {
-                     if (ntohs(rawMsg->flags) & MF_END_OF_FILE)
-                     {
-                        _close(m_hCurrFile);
-                        m_hCurrFile = -1;
+                     _close(m_hCurrFile);
+                     m_hCurrFile = -1;
 
-                        onFileDownload(true);
-                     }
-                     else
+                     onFileDownload(true);
+                  }
+                  else
+                  {
+                     if (m_downloadProgressCallback != NULL)
                      {
-                        if (m_downloadProgressCallback != NULL)
-                        {
-                           m_downloadProgressCallback(_tell(m_hCurrFile), m_downloadProgressCallbackArg);
-                        }
+                        m_downloadProgressCallback(_tell(m_hCurrFile), m_downloadProgressCallbackArg);
                      }
                   }
                }
-               else
-               {
-                  // I/O error
-                  _close(m_hCurrFile);
-                  m_hCurrFile = -1;
-
-                  onFileDownload(false);
-               }
-            }
-         }
-         else if ((rawMsg->code == CMD_ABORT_FILE_TRANSFER) && (rawMsg->id == m_dwDownloadRequestId))
-         {
-            if (m_sendToClientMessageCallback != NULL)
-            {
-               rawMsg->code = ntohs(rawMsg->code);
-               rawMsg->numFields = ntohl(rawMsg->numFields);
-               m_sendToClientMessageCallback(rawMsg, m_downloadProgressCallbackArg);
-               m_sendToClientMessageCallback = NULL;
-
-               onFileDownload(false);
             }
             else
             {
-               //error on agent side
+               // I/O error
                _close(m_hCurrFile);
                m_hCurrFile = -1;
 
                onFileDownload(false);
             }
          }
-         else if (rawMsg->code == CMD_TCP_PROXY_DATA)
+      }
+      else if ((rawMsg->code == CMD_ABORT_FILE_TRANSFER) && (rawMsg->id == m_dwDownloadRequestId))
+      {
+         if (m_sendToClientMessageCallback != NULL)
          {
-            processTcpProxyData(rawMsg->id, rawMsg->fields, rawMsg->numFields);
+            rawMsg->code = ntohs(rawMsg->code);
+            rawMsg->numFields = ntohl(rawMsg->numFields);
+            m_sendToClientMessageCallback(rawMsg, m_downloadProgressCallbackArg);
+            m_sendToClientMessageCallback = NULL;
+
+            onFileDownload(false);
+         }
+         else
+         {
+            //error on agent side
+            _close(m_hCurrFile);
+            m_hCurrFile = -1;
+
+            onFileDownload(false);
          }
       }
-      else if (ntohs(rawMsg->flags) & MF_CONTROL)
+      else if (rawMsg->code == CMD_TCP_PROXY_DATA)
+      {
+         processTcpProxyData(rawMsg->id, rawMsg->fields, rawMsg->numFields);
+      }
+   }
+   else if (ntohs(rawMsg->flags) & MF_CONTROL)
+   {
+      // Convert message header to host format
+      rawMsg->id = ntohl(rawMsg->id);
+      rawMsg->code = ntohs(rawMsg->code);
+      rawMsg->flags = ntohs(rawMsg->flags);
+      rawMsg->numFields = ntohl(rawMsg->numFields);
+      if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_debugId) >= 6)
+      {
+         TCHAR buffer[64];
+         debugPrintf(6, _T("Received control message %s from agent at %s"),
+            NXCPMessageCodeName(rawMsg->code, buffer), (const TCHAR *)m_addr.toString());
+      }
+      m_pMsgWaitQueue->put((NXCP_MESSAGE *)nx_memdup(rawMsg, ntohl(rawMsg->size)));
+   }
+   else
+   {
+      // Create message object from raw message
+      NXCPMessage *msg = NXCPMessage::deserialize(rawMsg, m_nProtocolVersion);
+      if (msg != NULL)
       {
-         // Convert message header to host format
-         rawMsg->id = ntohl(rawMsg->id);
-         rawMsg->code = ntohs(rawMsg->code);
-         rawMsg->flags = ntohs(rawMsg->flags);
-         rawMsg->numFields = ntohl(rawMsg->numFields);
          if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_debugId) >= 6)
          {
             TCHAR buffer[64];
-            debugPrintf(6, _T("Received control message %s from agent at %s"),
-               NXCPMessageCodeName(rawMsg->code, buffer), (const TCHAR *)m_addr.toString());
+            debugPrintf(6, _T("Received message %s (%d) from agent at %s"),
+               NXCPMessageCodeName(msg->getCode(), buffer), msg->getId(), (const TCHAR *)m_addr.toString());
          }
-         m_pMsgWaitQueue->put((NXCP_MESSAGE *)nx_memdup(rawMsg, ntohl(rawMsg->size)));
-      }
-      else
-      {
-         // Create message object from raw message
-         NXCPMessage *msg = NXCPMessage::deserialize(rawMsg, m_nProtocolVersion);
-         if (msg != NULL)
+         switch(msg->getCode())
          {
-            if (nxlog_get_debug_level_tag_object(DEBUG_TAG, m_debugId) >= 6)
-            {
-               TCHAR buffer[64];
-               debugPrintf(6, _T("Received message %s (%d) from agent at %s"),
-                  NXCPMessageCodeName(msg->getCode(), buffer), msg->getId(), (const TCHAR *)m_addr.toString());
-            }
-            switch(msg->getCode())
-            {
-               case CMD_REQUEST_COMPLETED:
-               case CMD_SESSION_KEY:
-                  m_pMsgWaitQueue->put(msg);
-                  break;
-               case CMD_TRAP:
-                  if (g_agentConnectionThreadPool != NULL)
-                  {
-                     incInternalRefCount();
-                     ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onTrapCallback, msg);
-                  }
-                  else
-                  {
-                     delete msg;
-                  }
-                  break;
-               case CMD_SYSLOG_RECORDS:
-                  if (g_agentConnectionThreadPool != NULL)
-                  {
-                     incInternalRefCount();
-                     ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onSyslogMessageCallback, msg);
-                  }
-                  else
-                  {
-                     delete msg;
-                  }
-                  break;
-               case CMD_PUSH_DCI_DATA:
-                  if (g_agentConnectionThreadPool != NULL)
-                  {
-                     incInternalRefCount();
-                     ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onDataPushCallback, msg);
-                  }
-                  else
-                  {
-                     delete msg;
-                  }
-                  break;
-               case CMD_DCI_DATA:
-                  if (g_agentConnectionThreadPool != NULL)
-                  {
-                     incInternalRefCount();
-                     ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::processCollectedDataCallback, msg);
-                  }
-                  else
-                  {
-                     NXCPMessage response(CMD_REQUEST_COMPLETED, msg->getId(), m_nProtocolVersion);
-                     response.setField(VID_RCC, ERR_INTERNAL_ERROR);
-                     sendMessage(&response);
-                     delete msg;
-                  }
-                  break;
-               case CMD_FILE_MONITORING:
-                  onFileMonitoringData(msg);
+            case CMD_REQUEST_COMPLETED:
+            case CMD_SESSION_KEY:
+               m_pMsgWaitQueue->put(msg);
+               break;
+            case CMD_TRAP:
+               if (g_agentConnectionThreadPool != NULL)
+               {
+                  incInternalRefCount();
+                  ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onTrapCallback, msg);
+               }
+               else
+               {
                   delete msg;
-                  break;
-               case CMD_SNMP_TRAP:
-                  if (g_agentConnectionThreadPool != NULL)
-                  {
-                     incInternalRefCount();
-                     ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onSnmpTrapCallback, msg);
-                  }
-                  else
-                  {
-                     delete msg;
-                  }
-                  break;
-               case CMD_CLOSE_TCP_PROXY:
-                  processTcpProxyData(msg->getFieldAsUInt32(VID_CHANNEL_ID), NULL, 0);
+               }
+               break;
+            case CMD_SYSLOG_RECORDS:
+               if (g_agentConnectionThreadPool != NULL)
+               {
+                  incInternalRefCount();
+                  ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onSyslogMessageCallback, msg);
+               }
+               else
+               {
                   delete msg;
-                  break;
-               default:
-                  if (processCustomMessage(msg))
-                     delete msg;
-                  else
-                     m_pMsgWaitQueue->put(msg);
-                  break;
-            }
-         }
-         else
-         {
-            debugPrintf(6, _T("RecvMsg: message deserialization error"));
+               }
+               break;
+            case CMD_PUSH_DCI_DATA:
+               if (g_agentConnectionThreadPool != NULL)
+               {
+                  incInternalRefCount();
+                  ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onDataPushCallback, msg);
+               }
+               else
+               {
+                  delete msg;
+               }
+               break;
+            case CMD_DCI_DATA:
+               if (g_agentConnectionThreadPool != NULL)
+               {
+                  incInternalRefCount();
+                  ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::processCollectedDataCallback, msg);
+               }
+               else
+               {
+                  NXCPMessage response(CMD_REQUEST_COMPLETED, msg->getId(), m_nProtocolVersion);
+                  response.setField(VID_RCC, ERR_INTERNAL_ERROR);
+                  sendMessage(&response);
+                  delete msg;
+               }
+               break;
+            case CMD_FILE_MONITORING:
+               onFileMonitoringData(msg);
+               delete msg;
+               break;
+            case CMD_SNMP_TRAP:
+               if (g_agentConnectionThreadPool != NULL)
+               {
+                  incInternalRefCount();
+                  ThreadPoolExecute(g_agentConnectionThreadPool, this, &AgentConnection::onSnmpTrapCallback, msg);
+               }
+               else
+               {
+                  delete msg;
+               }
+               break;
+            case CMD_CLOSE_TCP_PROXY:
+               processTcpProxyData(msg->getFieldAsUInt32(VID_CHANNEL_ID), NULL, 0);
+               delete msg;
+               break;
+            default:
+               if (processCustomMessage(msg))
+                  delete msg;
+               else
+                  m_pMsgWaitQueue->put(msg);
+               break;
          }
       }
+      else
+      {
+         debugPrintf(6, _T("RecvMsg: message deserialization error"));
+      }
    }
-   debugPrintf(6, _T("Receiver loop terminated"));
+}
 
-   // Close socket and mark connection as disconnected
+/**
+ * Close communication channel and mark connection as disconnected after receiver stop
+ */
+void AgentConnection::onReceiverStop(AbstractCommChannel *channel)
+{
    lock();
 	if (m_hCurrFile != -1)
 	{
@@ -477,7 +579,6 @@ void AgentConnection::receiverThread()
 
 	debugPrintf(6, _T("Closing communication channel"));
 	channel->close();
-	channel->decRefCount();
 	if (m_pCtx != NULL)
 	{
 		m_pCtx->decRefCount();
@@ -485,14 +586,72 @@ void AgentConnection::receiverThread()
 	}
    m_isConnected = false;
    unlock();
+}
 
-   MemFree(rawMsg);
-   MemFree(msgBuffer);
-#ifdef _WITH_ENCRYPTION
-   MemFree(decryptionBuffer);
-#endif
+/**
+ * Start receiver for current channel. Connection is served by shared socket receiver
+ * if it is running and channel is backed by socket, otherwise dedicated receiver thread is started.
+ */
+bool AgentConnection::startReceiver()
+{
+   if (SocketReceiver::isRunning() && (m_channel->getSocket() != INVALID_SOCKET))
+   {
+      AgentConnectionReceiver *receiver = new AgentConnectionReceiver(this, m_channel);
+      ConditionReset(m_condReceiverStopped);
+      lock();
+      m_receiver = receiver;
+      unlock();
+      bool success = SocketReceiver::addConsumer(receiver, g_agentReceiverThreadPool);
+      if (!success)
+      {
+         lock();
+         m_receiver = NULL;
+         unlock();
+      }
+      receiver->decConsumerRefCount();
+      if (success)
+      {
+         debugPrintf(7, _T("Connection registered with socket receiver"));
+         return true;
+      }
+   }
 
-   debugPrintf(6, _T("Receiver thread stopped"));
+   incInternalRefCount();
+   m_channel->incRefCount();  // for receiver thread
+   m_hReceiverThread = ThreadCreateEx(receiverThreadStarter, 0, this);
+   if (m_hReceiverThread == INVALID_THREAD_HANDLE)
+   {
+      m_channel->decRefCount();
+      decInternalRefCount();
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Wait for receiver from previous connection to stop
+ */
+void AgentConnection::waitForReceiverStop()
+{
+   ThreadJoin(m_hReceiverThread);
+   m_hReceiverThread = INVALID_THREAD_HANDLE;
+
+   lock();
+   bool registered = (m_receiver != NULL);
+   unlock();
+   if (registered)
+      ConditionWait(m_condReceiverStopped, INFINITE);
+}
+
+/**
+ * Pass current encryption context to receiver registered with socket receiver
+ */
+void AgentConnection::updateReceiverEncryptionContext()
+{
+   lock();
+   if (m_receiver != NULL)
+      m_receiver->setEncryptionContext(m_pCtx);
+   unlock();
 }
 
 /**
@@ -551,9 +710,8 @@ bool AgentConnection::connect(RSA *pServerKey, UINT32 *pdwError, UINT32 *pdwSock
    if (m_isConnected)
       return false;
 
-   // Wait for receiver thread from previous connection, if any
-   ThreadJoin(m_hReceiverThread);
-   m_hReceiverThread = INVALID_THREAD_HANDLE;
+   // Wait for receiver from previous connection, if any
+   waitForReceiverStop();
 
    // Check if we need to close existing channel
    if (m_channel != NULL)
@@ -578,15 +736,11 @@ bool AgentConnection::connect(RSA *pServerKey, UINT32 *pdwError, UINT32 *pdwSock
    }
    debugPrintf(6, _T("Using NXCP version %d"), m_nProtocolVersion);
 
-   // Start receiver thread
-   incInternalRefCount();
-   m_channel->incRefCount();  // for receiver thread
-   m_hReceiverThread = ThreadCreateEx(receiverThreadStarter, 0, this);
-   if (m_hReceiverThread == INVALID_THREAD_HANDLE)
+   // Start receiver
+   if (!startReceiver())
    {
       debugPrintf(3, _T("Cannot start receiver thread"));
       dwError = ERR_INTERNAL_ERROR;
-      m_channel->decRefCount();
       goto connect_cleanup;
    }
 
@@ -655,6 +809,7 @@ bool AgentConnection::connect(RSA *pServerKey, UINT32 *pdwError, UINT32 *pdwSock
 	      m_pCtx = NULL;
 		}
 		unlock();
+		updateReceiverEncryptionContext();
 
 		debugPrintf(6, _T("Proxy connection established"));
 
@@ -709,8 +864,7 @@ bool AgentConnection::connect(RSA *pServerKey, UINT32 *pdwError, UINT32 *pdwSock
       if (m_channel != NULL)
          m_channel->shutdown();
       unlock();
-      ThreadJoin(m_hReceiverThread);
-      m_hReceiverThread = INVALID_THREAD_HANDLE;
+      waitForReceiverStop();
 
       lock();
       if (m_channel != NULL)
@@ -1086,7 +1240,9 @@ UINT32 AgentConnection::setServerCapabilities()
    msg.setField(VID_IPV6_SUPPORT, (INT16)1);
    msg.setField(VID_BULK_RECONCILIATION, (INT16)1);
    msg.setField(VID_ENABLE_COMPRESSION, (INT16)(m_allowCompression ? 1 : 0));
+   msg.setField(VID_COMPRESSION_METHODS, NXCPGetSupportedCompressionMethods());
    msg.setId(dwRqId);
+   m_compressionMethod = NXCP_STREAM_COMPRESSION_DEFLATE;   // until agent confirms support for other methods
    if (!sendMessage(&msg))
       return ERR_CONNECTION_BROKEN;
 
@@ -1111,6 +1267,12 @@ UINT32 AgentConnection::setServerCapabilities()
          m_controlServer = true;
          m_masterServer = true;
       }
+
+      // Agents without support for message compression methods negotiation can only use deflate
+      if (response->isFieldExist(VID_COMPRESSION_METHODS))
+         m_compressionMethod = NXCPSelectCompressionMethod(response->getFieldAsUInt16(VID_COMPRESSION_METHODS) & NXCPGetSupportedCompressionMethods());
+      if (m_allowCompression)
+         debugPrintf(6, _T("Using %s message compression"), (m_compressionMethod == NXCP_STREAM_COMPRESSION_LZ4) ? _T("LZ4") : _T("deflate"));
    }
    delete response;
    return rcc;
@@ -1168,15 +1330,27 @@ bool AgentConnection::sendMessage(NXCPMessage *pMsg)
    }
 
    bool success;
-   NXCP_MESSAGE *rawMsg = pMsg->serialize(m_allowCompression);
 	NXCPEncryptionContext *pCtx = acquireEncryptionContext();
+   if ((pCtx == NULL) && !pMsg->isCompressible(getCompressionMethod()))
+   {
+      // Send message as list of blocks to avoid copying large binary fields
+      NXCPMessageBlocks blocks;
+      pMsg->serializeToBlocks(&blocks);
+      success = (channel->sendv(blocks.getBlocks(), blocks.getCount(), m_mutexSocketWrite) == (int)blocks.getSize());
+      channel->decRefCount();
+      return success;
+   }
+
+   NXCP_MESSAGE *rawMsg = pMsg->serialize(getCompressionMethod());
    if (pCtx != NULL)
    {
-      NXCP_ENCRYPTED_MESSAGE *pEnMsg = pCtx->encryptMessage(rawMsg);
+      BYTE localBuffer[8192];
+      NXCP_ENCRYPTED_MESSAGE *pEnMsg = pCtx->encryptMessage(rawMsg, localBuffer, sizeof(localBuffer));
       if (pEnMsg != NULL)
       {
          success = (channel->send(pEnMsg, ntohl(pEnMsg->size), m_mutexSocketWrite) == (int)ntohl(pEnMsg->size));
-         free(pEnMsg);
+         if (reinterpret_cast<BYTE*>(pEnMsg) != localBuffer)
+            MemFree(pEnMsg);
       }
       else
       {
@@ -1795,6 +1969,7 @@ UINT32 AgentConnection::setupEncryption(RSA *pServerKey)
       if (pResp != NULL)
       {
          dwResult = SetupEncryptionContext(pResp, &m_pCtx, NULL, pServerKey, m_nProtocolVersion);
+         updateReceiverEncryptionContext();
          switch(dwResult)
          {
             case RCC_SUCCESS:
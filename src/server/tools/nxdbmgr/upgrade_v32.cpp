@@ -23,6 +23,111 @@
 #include "nxdbmgr.h"
 #include <nxevent.h>
 
+/**
+ * Upgrade from 32.15 to 32.16
+ */
+static bool H_UpgradeFromV15()
+{
+   CHK_EXEC(SQLQuery(_T("UPDATE config SET var_value='127' WHERE var_name='AllowedCiphers' AND var_value='63'")));
+   CHK_EXEC(SQLQuery(_T("UPDATE config SET default_value='127',description='A bitmask for encryption algorithms allowed in the server(sum the values to allow multiple algorithms at once): \n\t*1 - AES256 \n\t*2 - Blowfish-256 \n\t*4 - IDEA \n\t*8 - 3DES\n\t*16 - AES128\n\t*32 - Blowfish-128\n\t*64 - AES256-GCM' WHERE var_name='AllowedCiphers'")));
+   CHK_EXEC(SQLQuery(_T("UPDATE config_values SET var_value='127' WHERE var_name='AllowedCiphers'")));
+   CHK_EXEC(SetMinorSchemaVersion(16));
+   return true;
+}
+
+/**
+ * Upgrade from 32.14 to 32.15
+ */
+static bool H_UpgradeFromV14()
+{
+   CHK_EXEC(CreateConfigParam(_T("NXCP.CompressionThreshold"), _T("128"), _T("Minimal size of NXCP message to be compressed when compression is enabled for connection."), _T("bytes"), 'I', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("NXCP.DetectCompressedFiles"), _T("1"), _T("If enabled, files which are already compressed (archives, images) will be transferred without additional stream compression."), NULL, 'B', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(15));
+   return true;
+}
+
+/**
+ * Upgrade from 32.13 to 32.14
+ */
+static bool H_UpgradeFromV13()
+{
+   CHK_EXEC(CreateConfigParam(_T("AgentConnections.ReceiverThreads"), _T("4"), _T("Number of threads receiving messages from agent connections and tunnels. If set to 0, dedicated receiver thread will be used for each connection."), NULL, 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(14));
+   return true;
+}
+
+/**
+ * Upgrade from 32.12 to 32.13
+ */
+static bool H_UpgradeFromV12()
+{
+   CHK_EXEC(CreateConfigParam(_T("Events.LogWriter.BatchSize"), _T("1000"), _T("Maximum number of events written to event log in single batch."), NULL, 'I', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("Events.LogWriter.MaxDelay"), _T("500"), _T("Maximum time event log writer waits for batch to fill before writing it."), _T("milliseconds"), 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(13));
+   return true;
+}
+
+/**
+ * Upgrade from 32.11 to 32.12
+ */
+static bool H_UpgradeFromV11()
+{
+   CHK_EXEC(CreateConfigParam(_T("Events.Processor.PoolSize"), _T("1"), _T("Number of threads for parallel event processing. Events from same source object are always processed by same thread."), NULL, 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(12));
+   return true;
+}
+
+/**
+ * Upgrade from 32.10 to 32.11
+ */
+static bool H_UpgradeFromV10()
+{
+   CHK_EXEC(CreateConfigParam(_T("SNMPTransportIdleTimeout"), _T("300"), _T("Time in seconds after which idle SNMP transport kept for reuse by node is closed (0 to disable transport reuse)."), _T("seconds"), 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(11));
+   return true;
+}
+
+/**
+ * Upgrade from 32.9 to 32.10
+ */
+static bool H_UpgradeFromV9()
+{
+   CHK_EXEC(CreateConfigParam(_T("SNMPBulkWalkMaxRepetitions"), _T("64"), _T("Maximum number of variables requested with single GETBULK request during SNMP walk (0 or 1 to use GETNEXT requests only)."), NULL, 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(10));
+   return true;
+}
+
+/**
+ * Upgrade from 32.8 to 32.9
+ */
+static bool H_UpgradeFromV8()
+{
+   CHK_EXEC(CreateConfigParam(_T("DataCollection.SNMP.AsyncRequests"), _T("1"), _T("Enable/disable asynchronous requests for batched SNMP data collection from nodes not using SNMP proxy."), NULL, 'B', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(9));
+   return true;
+}
+
+/**
+ * Upgrade from 32.7 to 32.8
+ */
+static bool H_UpgradeFromV7()
+{
+   CHK_EXEC(CreateConfigParam(_T("DataCollection.SNMP.MaxBatchSize"), _T("32"), _T("Maximum number of SNMP DCIs of same node collected with single request (0 or 1 to disable batching)."), NULL, 'I', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(8));
+   return true;
+}
+
+/**
+ * Upgrade from 32.6 to 32.7
+ */
+static bool H_UpgradeFromV6()
+{
+   CHK_EXEC(CreateConfigParam(_T("ThreadPool.DataCollector.WorkStealing"), _T("0"), _T("Use per-worker execution queues with work stealing in data collector thread pool."), NULL, 'B', true, true, false, false));
+   CHK_EXEC(CreateConfigParam(_T("ThreadPool.Poller.WorkStealing"), _T("0"), _T("Use per-worker execution queues with work stealing in poller thread pool"), NULL, 'B', true, true, false, false));
+   CHK_EXEC(SetMinorSchemaVersion(7));
+   return true;
+}
+
 /**
  * Upgrade from 32.4 to 32.5
  */
@@ -133,6 +238,16 @@ static struct
    bool (* upgradeProc)();
 } s_dbUpgradeMap[] =
 {
+   { 15, 32, 16, H_UpgradeFromV15 },
+   { 14, 32, 15, H_UpgradeFromV14 },
+   { 13, 32, 14, H_UpgradeFromV13 },
+   { 12, 32, 13, H_UpgradeFromV12 },
+   { 11, 32, 12, H_UpgradeFromV11 },
+   { 10, 32, 11, H_UpgradeFromV10 },
+   { 9,  32, 10, H_UpgradeFromV9 },
+   { 8,  32, 9, H_UpgradeFromV8 },
+   { 7,  32, 8, H_UpgradeFromV7 },
+   { 6,  32, 7, H_UpgradeFromV6 },
    { 5,  31, 6, H_UpgradeFromV5 },
    { 4,  31, 5, H_UpgradeFromV4 },
    { 3,  32, 4, H_UpgradeFromV3 },
@@ -0,0 +1,692 @@
+/*
+** NetXMS - Network Management System
+** SNMP support library
+** Copyright (C) 2003-2020 Victor Kirhenshtein
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** File: async.cpp
+**
+**/
+
+#include "libnxsnmp.h"
+
+/**
+ * Timer wheel resolution (in milliseconds)
+ */
+#define TIMER_RESOLUTION      10
+
+/**
+ * Maximum time I/O thread waits for incoming data (in milliseconds)
+ */
+#define POLL_INTERVAL         100
+
+/**
+ * Receive buffer size
+ */
+#define RECEIVE_BUFFER_SIZE   65536
+
+/**
+ * Maximum number of request restarts caused by SNMPv3 reports (engine ID discovery or time synchronization)
+ */
+#define MAX_REPORT_RETRIES    3
+
+/**
+ * Asynchronous SNMP request
+ */
+struct SNMP_AsyncRequest
+{
+   SNMP_AsyncRequest *prev;   // Timer wheel list
+   SNMP_AsyncRequest *next;
+   SNMP_AsyncRequestKey key;
+   SockAddrBuffer peer;
+   SOCKET socket;
+   BYTE *data;                // Encoded request
+   size_t size;
+   SNMP_PDU *pdu;             // Request PDU (NULL for raw requests)
+   SNMP_SecurityContext *securityContext;
+   INT64 deadline;
+   int timerSlot;
+   UINT32 timeout;
+   int retries;
+   int reportRetries;
+   SNMP_AsyncRequestCallback callback;
+   SNMP_AsyncRawRequestCallback rawCallback;
+   void *context;
+
+   // Completion data
+   UINT32 rc;
+   SNMP_PDU *response;
+   BYTE *rawResponse;
+   size_t rawResponseSize;
+};
+
+/**
+ * Destroy asynchronous request
+ */
+static void DestroyRequest(SNMP_AsyncRequest *request)
+{
+   MemFree(request->data);
+   MemFree(request->rawResponse);
+   delete request->pdu;
+   delete request->response;
+   delete request->securityContext;
+   MemFree(request);
+}
+
+/**
+ * Call completion callback and destroy request
+ */
+static void CompleteRequest(SNMP_AsyncRequest *request)
+{
+   if (request->rawCallback != NULL)
+      request->rawCallback(request->rc, request->rawResponse, request->rawResponseSize, request->context);
+   else
+      request->callback(request->rc, request->response, request->context);
+   DestroyRequest(request);
+}
+
+/**
+ * Fill request key from ID and peer address
+ */
+static void FillRequestKey(SNMP_AsyncRequestKey *key, UINT32 id, struct sockaddr *addr)
+{
+   memset(key, 0, sizeof(SNMP_AsyncRequestKey));
+   key->id = id;
+   if (addr->sa_family == AF_INET)
+   {
+      memcpy(key->address, &((struct sockaddr_in *)addr)->sin_addr, 4);
+   }
+#ifdef WITH_IPV6
+   else if (addr->sa_family == AF_INET6)
+   {
+      memcpy(key->address, &((struct sockaddr_in6 *)addr)->sin6_addr, 16);
+   }
+#endif
+}
+
+/**
+ * Extract request ID (SNMPv1/v2c) or message ID (SNMPv3) from encoded message
+ */
+static bool PeekMessageId(const BYTE *data, size_t size, UINT32 *id)
+{
+   UINT32 type;
+   size_t length, idLength;
+   const BYTE *curr;
+
+   // Message sequence
+   if (!BER_DecodeIdentifier(data, size, &type, &length, &curr, &idLength) || (type != ASN_SEQUENCE))
+      return false;
+   size_t remaining = length;
+
+   // Version
+   const BYTE *content;
+   if (!BER_DecodeIdentifier(curr, remaining, &type, &length, &content, &idLength) || (type != ASN_INTEGER))
+      return false;
+   UINT32 version = 0;
+   if (!BER_DecodeContent(type, content, length, (BYTE *)&version))
+      return false;
+   curr = content + length;
+   remaining -= length + idLength;
+
+   if (version == SNMP_VERSION_3)
+   {
+      // Header sequence, message ID is first element
+      if (!BER_DecodeIdentifier(curr, remaining, &type, &length, &content, &idLength) || (type != ASN_SEQUENCE))
+         return false;
+      remaining = length;
+      curr = content;
+   }
+   else
+   {
+      // Skip community string
+      if (!BER_DecodeIdentifier(curr, remaining, &type, &length, &content, &idLength) || (type != ASN_OCTET_STRING))
+         return false;
+      curr = content + length;
+      remaining -= length + idLength;
+
+      // PDU, request ID is first element
+      if (!BER_DecodeIdentifier(curr, remaining, &type, &length, &content, &idLength))
+         return false;
+      remaining = length;
+      curr = content;
+   }
+
+   if (!BER_DecodeIdentifier(curr, remaining, &type, &length, &content, &idLength) || (type != ASN_INTEGER))
+      return false;
+   *id = 0;
+   return BER_DecodeContent(type, content, length, (BYTE *)id);
+}
+
+/**
+ * Create UDP socket for asynchronous client
+ */
+static SOCKET CreateClientSocket(int family)
+{
+   SOCKET s = CreateSocket(family, SOCK_DGRAM, 0);
+   if (s == INVALID_SOCKET)
+      return INVALID_SOCKET;
+
+   SockAddrBuffer localAddr;
+   memset(&localAddr, 0, sizeof(SockAddrBuffer));
+   if (family == AF_INET)
+   {
+      localAddr.sa4.sin_family = AF_INET;
+      localAddr.sa4.sin_addr.s_addr = htonl(INADDR_ANY);
+   }
+#ifdef WITH_IPV6
+   else
+   {
+      localAddr.sa6.sin6_family = AF_INET6;
+   }
+#endif
+
+   if (bind(s, (struct sockaddr *)&localAddr, SA_LEN((struct sockaddr *)&localAddr)) != 0)
+   {
+      closesocket(s);
+      return INVALID_SOCKET;
+   }
+   SetSocketNonBlocking(s);
+   return s;
+}
+
+/**
+ * Asynchronous client constructor. If callback pool is given, completion
+ * callbacks are executed on that pool, otherwise on client's I/O thread.
+ */
+SNMP_AsyncClient::SNMP_AsyncClient(ThreadPool *callbackPool) : m_requests(false)
+{
+   m_socketV4 = INVALID_SOCKET;
+   m_socketV6 = INVALID_SOCKET;
+   m_ioThread = INVALID_THREAD_HANDLE;
+   m_mutex = MutexCreateFast();
+   m_shutdown = false;
+   m_accepting = false;
+   m_callbackPool = callbackPool;
+   memset(m_timerWheel, 0, sizeof(m_timerWheel));
+   m_lastTimerTick = 0;
+   m_pendingRequests = 0;
+   m_requestCount = 0;
+   m_retransmitCount = 0;
+   m_timeoutCount = 0;
+}
+
+/**
+ * Asynchronous client destructor
+ */
+SNMP_AsyncClient::~SNMP_AsyncClient()
+{
+   stop();
+   MutexDestroy(m_mutex);
+}
+
+/**
+ * Start client
+ */
+bool SNMP_AsyncClient::start()
+{
+   m_socketV4 = CreateClientSocket(AF_INET);
+#ifdef WITH_IPV6
+   m_socketV6 = CreateClientSocket(AF_INET6);
+#endif
+   if ((m_socketV4 == INVALID_SOCKET) && (m_socketV6 == INVALID_SOCKET))
+   {
+      nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 3, _T("SNMP_AsyncClient: cannot create socket (%d)"), WSAGetLastError());
+      return false;
+   }
+
+   m_lastTimerTick = GetCurrentTimeMs() / TIMER_RESOLUTION;
+   m_shutdown = false;
+   MutexLock(m_mutex);
+   m_accepting = true;
+   MutexUnlock(m_mutex);
+   m_ioThread = ThreadCreateEx(SNMP_AsyncClient::ioThreadStarter, 0, this);
+   return true;
+}
+
+/**
+ * Stop client. All pending requests will be completed with SNMP_ERR_ABORTED.
+ */
+void SNMP_AsyncClient::stop()
+{
+   if (m_ioThread == INVALID_THREAD_HANDLE)
+      return;
+
+   m_shutdown = true;
+   ThreadJoin(m_ioThread);
+   m_ioThread = INVALID_THREAD_HANDLE;
+
+   if (m_socketV4 != INVALID_SOCKET)
+   {
+      closesocket(m_socketV4);
+      m_socketV4 = INVALID_SOCKET;
+   }
+   if (m_socketV6 != INVALID_SOCKET)
+   {
+      closesocket(m_socketV6);
+      m_socketV6 = INVALID_SOCKET;
+   }
+}
+
+/**
+ * Add request to timer wheel (client lock must be held)
+ */
+void SNMP_AsyncClient::scheduleTimeout(SNMP_AsyncRequest *request)
+{
+   INT64 tick = std::max(request->deadline / TIMER_RESOLUTION, m_lastTimerTick + 1);
+   request->timerSlot = static_cast<int>(tick % SNMP_ASYNC_TIMER_WHEEL_SIZE);
+   SNMP_AsyncRequest **slot = &m_timerWheel[request->timerSlot];
+   request->prev = NULL;
+   request->next = *slot;
+   if (*slot != NULL)
+      (*slot)->prev = request;
+   *slot = request;
+}
+
+/**
+ * Remove request from timer wheel (client lock must be held)
+ */
+void SNMP_AsyncClient::cancelTimeout(SNMP_AsyncRequest *request)
+{
+   if (request->prev != NULL)
+   {
+      request->prev->next = request->next;
+   }
+   else
+   {
+      m_timerWheel[request->timerSlot] = request->next;
+   }
+   if (request->next != NULL)
+      request->next->prev = request->prev;
+   request->prev = NULL;
+   request->next = NULL;
+}
+
+/**
+ * Register request in request table and timer wheel and send it. Returns SNMP_ERR_PARAM
+ * if there is already request with same ID outstanding to same peer and SNMP_ERR_ABORTED
+ * if I/O thread already aborted outstanding requests. Check for shutdown is done under
+ * same lock as I/O thread's final sweep, so request is either registered before sweep
+ * (and completed by it) or rejected.
+ */
+UINT32 SNMP_AsyncClient::registerRequest(SNMP_AsyncRequest *request)
+{
+   MutexLock(m_mutex);
+   if (!m_accepting)
+   {
+      MutexUnlock(m_mutex);
+      return SNMP_ERR_ABORTED;
+   }
+   if (m_requests.contains(request->key))
+   {
+      MutexUnlock(m_mutex);
+      return SNMP_ERR_PARAM;
+   }
+   m_requests.set(request->key, request);
+   request->deadline = GetCurrentTimeMs() + request->timeout;
+   scheduleTimeout(request);
+
+   // Send while holding lock so request cannot time out before it is sent
+   sendto(request->socket, (char *)request->data, (int)request->size, 0, (struct sockaddr *)&request->peer, SA_LEN((struct sockaddr *)&request->peer));
+   MutexUnlock(m_mutex);
+   InterlockedIncrement64(&m_requestCount);
+   return SNMP_ERR_SUCCESS;
+}
+
+/**
+ * Submit prepared request
+ */
+UINT32 SNMP_AsyncClient::submit(SNMP_AsyncRequest *request, const InetAddress& addr, UINT16 port)
+{
+   if ((m_ioThread == INVALID_THREAD_HANDLE) || m_shutdown)
+   {
+      DestroyRequest(request);
+      return SNMP_ERR_ABORTED;
+   }
+
+   request->socket = (addr.getFamily() == AF_INET) ? m_socketV4 : m_socketV6;
+   if (request->socket == INVALID_SOCKET)
+   {
+      DestroyRequest(request);
+      return SNMP_ERR_SOCKET;
+   }
+
+   UINT32 id;
+   if (!PeekMessageId(request->data, request->size, &id))
+   {
+      DestroyRequest(request);
+      return SNMP_ERR_PARAM;
+   }
+
+   addr.fillSockAddr(&request->peer, port);
+   FillRequestKey(&request->key, id, (struct sockaddr *)&request->peer);
+
+   InterlockedIncrement(&m_pendingRequests);
+   UINT32 rc = registerRequest(request);
+   if (rc != SNMP_ERR_SUCCESS)
+   {
+      InterlockedDecrement(&m_pendingRequests);
+      DestroyRequest(request);
+   }
+   return rc;
+}
+
+/**
+ * Send SNMP request. Client takes ownership of request PDU. Security context is copied.
+ * Callback is called exactly once if this method returns SNMP_ERR_SUCCESS and never otherwise.
+ */
+UINT32 SNMP_AsyncClient::sendRequest(const InetAddress& addr, UINT16 port, SNMP_PDU *request, SNMP_SecurityContext *securityContext,
+         UINT32 timeout, int numRetries, SNMP_AsyncRequestCallback callback, void *context)
+{
+   if ((request == NULL) || (callback == NULL) || !addr.isValid())
+   {
+      delete request;
+      return SNMP_ERR_PARAM;
+   }
+
+   SNMP_AsyncRequest *r = MemAllocStruct<SNMP_AsyncRequest>();
+   r->pdu = request;
+   r->securityContext = (securityContext != NULL) ? new SNMP_SecurityContext(securityContext) : new SNMP_SecurityContext();
+   r->size = request->encode(&r->data, r->securityContext);
+   if (r->size == 0)
+   {
+      DestroyRequest(r);
+      return SNMP_ERR_PARAM;
+   }
+   r->timeout = timeout;
+   r->retries = std::max(numRetries, 1) - 1;
+   r->reportRetries = MAX_REPORT_RETRIES;
+   r->callback = callback;
+   r->context = context;
+   return submit(r, addr, port);
+}
+
+/**
+ * Send pre-encoded SNMP request. Callback receives raw response message.
+ * Callback is called exactly once if this method returns SNMP_ERR_SUCCESS and never otherwise.
+ */
+UINT32 SNMP_AsyncClient::sendRawRequest(const InetAddress& addr, UINT16 port, const BYTE *pdu, size_t size,
+         UINT32 timeout, int numRetries, SNMP_AsyncRawRequestCallback callback, void *context)
+{
+   if ((pdu == NULL) || (size == 0) || (callback == NULL) || !addr.isValid())
+      return SNMP_ERR_PARAM;
+
+   SNMP_AsyncRequest *r = MemAllocStruct<SNMP_AsyncRequest>();
+   r->data = static_cast<BYTE*>(MemCopyBlock(pdu, size));
+   r->size = size;
+   r->timeout = timeout;
+   r->retries = std::max(numRetries, 1) - 1;
+   r->rawCallback = callback;
+   r->context = context;
+   return submit(r, addr, port);
+}
+
+/**
+ * Complete request (request should be already removed from request table)
+ */
+void SNMP_AsyncClient::complete(SNMP_AsyncRequest *request)
+{
+   InterlockedDecrement(&m_pendingRequests);
+   if (m_callbackPool != NULL)
+      ThreadPoolExecute(m_callbackPool, CompleteRequest, request);
+   else
+      CompleteRequest(request);
+}
+
+/**
+ * Process incoming message
+ */
+void SNMP_AsyncClient::processResponse(const BYTE *data, size_t size, struct sockaddr *sender)
+{
+   UINT32 id;
+   if (!PeekMessageId(data, size, &id))
+      return;
+
+   SNMP_AsyncRequestKey key;
+   FillRequestKey(&key, id, sender);
+
+   MutexLock(m_mutex);
+   SNMP_AsyncRequest *request = m_requests.get(key);
+   if (request != NULL)
+   {
+      m_requests.unlink(key);
+      cancelTimeout(request);
+   }
+   MutexUnlock(m_mutex);
+
+   if (request == NULL)
+      return;  // Late response to timed out request or unrelated message
+
+   if (request->pdu == NULL)
+   {
+      request->rc = SNMP_ERR_SUCCESS;
+      request->rawResponse = static_cast<BYTE*>(MemCopyBlock(data, size));
+      request->rawResponseSize = size;
+      complete(request);
+      return;
+   }
+
+   SNMP_PDU *response = new SNMP_PDU();
+   if (!response->parse(data, size, request->securityContext, true))
+   {
+      delete response;
+      request->rc = SNMP_ERR_PARSE;
+      complete(request);
+      return;
+   }
+
+   if (response->getCommand() == SNMP_REPORT)
+   {
+      request->rc = SnmpGetReportErrorCode(response);
+
+      // Handle engine ID discovery and time synchronization same way as synchronous transport
+      bool canRetry = false;
+      if ((request->rc == SNMP_ERR_ENGINE_ID) && (request->reportRetries > 0))
+      {
+         if (request->pdu->getContextEngineIdLength() == 0)
+         {
+            if (response->getContextEngineIdLength() > 0)
+               request->pdu->setContextEngineId(response->getContextEngineId(), response->getContextEngineIdLength());
+            else if (response->getAuthoritativeEngine().getIdLen() != 0)
+               request->pdu->setContextEngineId(response->getAuthoritativeEngine().getId(), response->getAuthoritativeEngine().getIdLen());
+            canRetry = true;
+         }
+         if (request->securityContext->getAuthoritativeEngine().getIdLen() == 0)
+         {
+            request->securityContext->setAuthoritativeEngine(response->getAuthoritativeEngine());
+            canRetry = true;
+         }
+      }
+      else if ((request->rc == SNMP_ERR_TIME_WINDOW) && (request->reportRetries > 0))
+      {
+         const SNMP_Engine& engine = request->securityContext->getAuthoritativeEngine();
+         if ((response->getAuthoritativeEngine().getBoots() != engine.getBoots()) ||
+             (response->getAuthoritativeEngine().getTime() != engine.getTime()))
+         {
+            request->securityContext->setAuthoritativeEngine(response->getAuthoritativeEngine());
+            canRetry = true;
+         }
+      }
+      delete response;
+
+      if (canRetry)
+      {
+         request->reportRetries--;
+         MemFree(request->data);
+         request->data = NULL;
+         request->size = request->pdu->encode(&request->data, request->securityContext);
+         if (request->size > 0)
+         {
+            UINT32 rc = registerRequest(request);
+            if (rc == SNMP_ERR_SUCCESS)
+               return;
+            request->rc = (rc == SNMP_ERR_ABORTED) ? SNMP_ERR_ABORTED : SNMP_ERR_ENGINE_ID;
+         }
+         else
+         {
+            request->rc = SNMP_ERR_ENGINE_ID;
+         }
+      }
+      complete(request);
+      return;
+   }
+
+   if (response->getCommand() != SNMP_RESPONSE)
+   {
+      delete response;
+      request->rc = SNMP_ERR_BAD_RESPONSE;
+      complete(request);
+      return;
+   }
+
+   request->rc = SNMP_ERR_SUCCESS;
+   request->response = response;
+   complete(request);
+}
+
+/**
+ * Process expired requests
+ */
+void SNMP_AsyncClient::processTimeouts()
+{
+   INT64 now = GetCurrentTimeMs();
+   INT64 currTick = now / TIMER_RESOLUTION;
+
+   SNMP_AsyncRequest *retransmitList = NULL, *timeoutList = NULL;
+   MutexLock(m_mutex);
+   INT64 firstTick = std::max(m_lastTimerTick + 1, currTick - SNMP_ASYNC_TIMER_WHEEL_SIZE + 1);
+   for(INT64 tick = firstTick; tick <= currTick; tick++)
+   {
+      SNMP_AsyncRequest *request = m_timerWheel[tick % SNMP_ASYNC_TIMER_WHEEL_SIZE];
+      while(request != NULL)
+      {
+         SNMP_AsyncRequest *next = request->next;
+         if (request->deadline / TIMER_RESOLUTION <= currTick)   // Requests from later wheel revolutions stay in the slot
+         {
+            cancelTimeout(request);
+            if (request->retries > 0)
+            {
+               request->retries--;
+               request->deadline = now + request->timeout;
+               request->next = retransmitList;
+               retransmitList = request;
+            }
+            else
+            {
+               m_requests.unlink(request->key);
+               request->next = timeoutList;
+               timeoutList = request;
+            }
+         }
+         request = next;
+      }
+   }
+   m_lastTimerTick = std::max(m_lastTimerTick, currTick);
+
+   // Retransmit while holding lock so requests cannot be completed concurrently
+   while(retransmitList != NULL)
+   {
+      SNMP_AsyncRequest *request = retransmitList;
+      retransmitList = request->next;
+      scheduleTimeout(request);
+      sendto(request->socket, (char *)request->data, (int)request->size, 0, (struct sockaddr *)&request->peer, SA_LEN((struct sockaddr *)&request->peer));
+      InterlockedIncrement64(&m_retransmitCount);
+   }
+   MutexUnlock(m_mutex);
+
+   while(timeoutList != NULL)
+   {
+      SNMP_AsyncRequest *request = timeoutList;
+      timeoutList = request->next;
+      request->next = NULL;
+      request->rc = SNMP_ERR_TIMEOUT;
+      InterlockedIncrement64(&m_timeoutCount);
+      complete(request);
+   }
+}
+
+/**
+ * I/O thread starter
+ */
+THREAD_RESULT THREAD_CALL SNMP_AsyncClient::ioThreadStarter(void *arg)
+{
+   ThreadSetName("SNMPAsyncIO");
+   static_cast<SNMP_AsyncClient*>(arg)->ioThread();
+   return THREAD_OK;
+}
+
+/**
+ * I/O thread
+ */
+void SNMP_AsyncClient::ioThread()
+{
+   nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 2, _T("SNMP asynchronous I/O thread started"));
+
+   BYTE *buffer = MemAllocArrayNoInit<BYTE>(RECEIVE_BUFFER_SIZE);
+   SocketPoller sp;
+   while(!m_shutdown)
+   {
+      sp.reset();
+      if (m_socketV4 != INVALID_SOCKET)
+         sp.add(m_socketV4);
+      if (m_socketV6 != INVALID_SOCKET)
+         sp.add(m_socketV6);
+
+      if (sp.poll(POLL_INTERVAL) > 0)
+      {
+         SOCKET sockets[2] = { m_socketV4, m_socketV6 };
+         for(int i = 0; i < 2; i++)
+         {
+            if ((sockets[i] == INVALID_SOCKET) || !sp.isSet(sockets[i]))
+               continue;
+
+            // Read all available datagrams
+            while(true)
+            {
+               SockAddrBuffer sender;
+               socklen_t addrLen = sizeof(SockAddrBuffer);
+               int bytes = recvfrom(sockets[i], (char *)buffer, RECEIVE_BUFFER_SIZE, 0, (struct sockaddr *)&sender, &addrLen);
+               if (bytes <= 0)
+                  break;
+               processResponse(buffer, bytes, (struct sockaddr *)&sender);
+            }
+         }
+      }
+
+      processTimeouts();
+   }
+   MemFree(buffer);
+
+   // Abort all outstanding requests and reject any further registrations
+   MutexLock(m_mutex);
+   m_accepting = false;
+   Iterator<SNMP_AsyncRequest> *it = m_requests.iterator();
+   ObjectArray<SNMP_AsyncRequest> pending(m_requests.size(), 16, false);
+   while(it->hasNext())
+      pending.add(it->next());
+   delete it;
+   m_requests.clear();
+   memset(m_timerWheel, 0, sizeof(m_timerWheel));
+   MutexUnlock(m_mutex);
+
+   for(int i = 0; i < pending.size(); i++)
+   {
+      SNMP_AsyncRequest *request = pending.get(i);
+      request->rc = SNMP_ERR_ABORTED;
+      complete(request);
+   }
+
+   nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 2, _T("SNMP asynchronous I/O thread stopped"));
+}
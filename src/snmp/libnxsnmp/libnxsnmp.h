@@ -125,4 +125,6 @@ bool BER_DecodeIdentifier(const BYTE *rawData, size_t rawSize, UINT32 *type, siz
 bool BER_DecodeContent(UINT32 type, const BYTE *data, size_t length, BYTE *buffer);
 size_t BER_Encode(UINT32 type, const BYTE *data, size_t dataLength, BYTE *buffer, size_t bufferSize);
 
+UINT32 SnmpGetReportErrorCode(SNMP_PDU *report);
+
 #endif   /* _libnxsnmp_h_ */
@@ -1,7 +1,7 @@
 /* 
 ** NetXMS - Network Management System
 ** SNMP support library
-** Copyright (C) 2003-2013 Victor Kirhenshtein
+** Copyright (C) 2003-2020 Victor Kirhenshtein
 **
 ** This program is free software; you can redistribute it and/or modify
 ** it under the terms of the GNU Lesser General Public License as published by
@@ -23,6 +23,173 @@
 
 #include "libnxsnmp.h"
 
+/**
+ * Default maximum number of entries in password to key cache
+ */
+#define DEFAULT_KEY_CACHE_SIZE   1024
+
+/**
+ * Key cache entry key - hash algorithm and SHA1 digest of password
+ */
+struct SNMP_KeyCacheKey
+{
+   int method;
+   BYTE passwordHash[SHA1_DIGEST_SIZE];
+};
+
+/**
+ * Key cache entry
+ */
+struct SNMP_KeyCacheEntry
+{
+   SNMP_KeyCacheEntry *prev;   // LRU list
+   SNMP_KeyCacheEntry *next;
+   SNMP_KeyCacheKey key;
+   BYTE ku[SHA1_DIGEST_SIZE];
+};
+
+/**
+ * Password to key (Ku) cache. Entries are kept in LRU list, most recently used first.
+ */
+static Mutex s_keyCacheLock;
+static HashMap<SNMP_KeyCacheKey, SNMP_KeyCacheEntry> s_keyCache(true);
+static SNMP_KeyCacheEntry *s_keyCacheHead = NULL;
+static SNMP_KeyCacheEntry *s_keyCacheTail = NULL;
+static int s_keyCacheMaxSize = DEFAULT_KEY_CACHE_SIZE;
+static VolatileCounter64 s_keyCacheHits = 0;
+static VolatileCounter64 s_keyCacheMisses = 0;
+
+/**
+ * Unlink key cache entry from LRU list (cache lock must be held)
+ */
+static void UnlinkKeyCacheEntry(SNMP_KeyCacheEntry *entry)
+{
+   if (entry->prev != NULL)
+      entry->prev->next = entry->next;
+   else
+      s_keyCacheHead = entry->next;
+   if (entry->next != NULL)
+      entry->next->prev = entry->prev;
+   else
+      s_keyCacheTail = entry->prev;
+}
+
+/**
+ * Insert key cache entry at the head of LRU list (cache lock must be held)
+ */
+static void InsertKeyCacheEntry(SNMP_KeyCacheEntry *entry)
+{
+   entry->prev = NULL;
+   entry->next = s_keyCacheHead;
+   if (s_keyCacheHead != NULL)
+      s_keyCacheHead->prev = entry;
+   else
+      s_keyCacheTail = entry;
+   s_keyCacheHead = entry;
+}
+
+/**
+ * Convert password to key (Ku) as described in RFC 3414 section A.2 using given
+ * hash algorithm (SNMP_AUTH_MD5 or SNMP_AUTH_SHA1). Results are cached because
+ * hashing of 1 MB of password material is expensive and same passwords are used
+ * for many devices.
+ */
+static void PasswordToKey(int method, const char *password, BYTE *ku)
+{
+   size_t keyLen = (method == SNMP_AUTH_MD5) ? MD5_DIGEST_SIZE : SHA1_DIGEST_SIZE;
+
+   SNMP_KeyCacheKey key;
+   memset(&key, 0, sizeof(key));
+   key.method = method;
+   CalculateSHA1Hash(reinterpret_cast<const BYTE*>(password), strlen(password), key.passwordHash);
+
+   s_keyCacheLock.lock();
+   SNMP_KeyCacheEntry *entry = s_keyCache.get(key);
+   if (entry != NULL)
+   {
+      memcpy(ku, entry->ku, keyLen);
+      if (entry != s_keyCacheHead)
+      {
+         UnlinkKeyCacheEntry(entry);
+         InsertKeyCacheEntry(entry);
+      }
+      s_keyCacheLock.unlock();
+      InterlockedIncrement64(&s_keyCacheHits);
+      return;
+   }
+   s_keyCacheLock.unlock();
+
+   InterlockedIncrement64(&s_keyCacheMisses);
+   if (method == SNMP_AUTH_MD5)
+      MD5HashForPattern(reinterpret_cast<const BYTE*>(password), strlen(password), 1048576, ku);
+   else
+      SHA1HashForPattern(reinterpret_cast<const BYTE*>(password), strlen(password), 1048576, ku);
+
+   if (s_keyCacheMaxSize <= 0)
+      return;
+
+   s_keyCacheLock.lock();
+   if (!s_keyCache.contains(key))  // could be added by another thread while key was calculated
+   {
+      entry = MemAllocStruct<SNMP_KeyCacheEntry>();
+      entry->key = key;
+      memcpy(entry->ku, ku, keyLen);
+      InsertKeyCacheEntry(entry);
+      s_keyCache.set(key, entry);
+      while(s_keyCache.size() > s_keyCacheMaxSize)
+      {
+         SNMP_KeyCacheEntry *lru = s_keyCacheTail;
+         UnlinkKeyCacheEntry(lru);
+         s_keyCache.remove(lru->key);
+      }
+   }
+   s_keyCacheLock.unlock();
+}
+
+/**
+ * Localize key (Ku) for given engine ID
+ */
+static void LocalizeKey(int method, const BYTE *ku, const SNMP_Engine& engine, BYTE *kul)
+{
+   BYTE buffer[256];
+   size_t keyLen = (method == SNMP_AUTH_MD5) ? MD5_DIGEST_SIZE : SHA1_DIGEST_SIZE;
+   memcpy(buffer, ku, keyLen);
+   memcpy(&buffer[keyLen], engine.getId(), engine.getIdLen());
+   memcpy(&buffer[keyLen + engine.getIdLen()], ku, keyLen);
+   if (method == SNMP_AUTH_MD5)
+      CalculateMD5Hash(buffer, engine.getIdLen() + keyLen * 2, kul);
+   else
+      CalculateSHA1Hash(buffer, engine.getIdLen() + keyLen * 2, kul);
+}
+
+/**
+ * Set maximum size of password to key cache (0 disables caching)
+ */
+void LIBNXSNMP_EXPORTABLE SnmpSetKeyCacheSize(int size)
+{
+   s_keyCacheLock.lock();
+   s_keyCacheMaxSize = size;
+   while(s_keyCache.size() > std::max(s_keyCacheMaxSize, 0))
+   {
+      SNMP_KeyCacheEntry *lru = s_keyCacheTail;
+      UnlinkKeyCacheEntry(lru);
+      s_keyCache.remove(lru->key);
+   }
+   s_keyCacheLock.unlock();
+}
+
+/**
+ * Get password to key cache statistics
+ */
+void LIBNXSNMP_EXPORTABLE SnmpGetKeyCacheStatistics(UINT64 *hits, UINT64 *misses, int *size)
+{
+   *hits = static_cast<UINT64>(s_keyCacheHits);
+   *misses = static_cast<UINT64>(s_keyCacheMisses);
+   s_keyCacheLock.lock();
+   *size = s_keyCache.size();
+   s_keyCacheLock.unlock();
+}
+
 /**
  * Default constructor for SNMP_SecurityContext
  */
@@ -202,44 +369,30 @@ void SNMP_SecurityContext::setAuthoritativeEngine(const SNMP_Engine &engine)
 }
 
 /**
- * Recalculate keys
+ * Recalculate keys. Keys are localized only when authoritative engine is known,
+ * because they are not used before engine ID discovery.
  */
 void SNMP_SecurityContext::recalculateKeys()
 {
-   if (m_securityModel != SNMP_SECURITY_MODEL_USM)
+   if ((m_securityModel != SNMP_SECURITY_MODEL_USM) || (m_authoritativeEngine.getIdLen() == 0))
       return;  // no need to recalculate keys
 
-	BYTE buffer[256];
 	const char *authPassword = (m_authPassword != NULL) ? m_authPassword : "";
 	const char *privPassword = (m_privPassword != NULL) ? m_privPassword : "";
+	BYTE ku[SHA1_DIGEST_SIZE];
 
 	// MD5 auth key
-	MD5HashForPattern((const BYTE *)authPassword, strlen(authPassword), 1048576, buffer);
-	memcpy(&buffer[16], m_authoritativeEngine.getId(), m_authoritativeEngine.getIdLen());
-	memcpy(&buffer[16 + m_authoritativeEngine.getIdLen()], buffer, 16);
-	CalculateMD5Hash(buffer, m_authoritativeEngine.getIdLen() + 32, m_authKeyMD5);
+	PasswordToKey(SNMP_AUTH_MD5, authPassword, ku);
+	LocalizeKey(SNMP_AUTH_MD5, ku, m_authoritativeEngine, m_authKeyMD5);
 
 	// SHA1 auth key
-	SHA1HashForPattern((BYTE *)authPassword, strlen(authPassword), 1048576, buffer);
-	memcpy(&buffer[20], m_authoritativeEngine.getId(), m_authoritativeEngine.getIdLen());
-	memcpy(&buffer[20 + m_authoritativeEngine.getIdLen()], buffer, 20);
-	CalculateSHA1Hash(buffer, m_authoritativeEngine.getIdLen() + 40, m_authKeySHA1);
+	PasswordToKey(SNMP_AUTH_SHA1, authPassword, ku);
+	LocalizeKey(SNMP_AUTH_SHA1, ku, m_authoritativeEngine, m_authKeySHA1);
 
 	// Priv key
-	if (m_authMethod == SNMP_AUTH_MD5)
-	{
-		MD5HashForPattern((const BYTE *)privPassword, strlen(privPassword), 1048576, buffer);
-		memcpy(&buffer[16], m_authoritativeEngine.getId(), m_authoritativeEngine.getIdLen());
-		memcpy(&buffer[16 + m_authoritativeEngine.getIdLen()], buffer, 16);
-		CalculateMD5Hash(buffer, m_authoritativeEngine.getIdLen() + 32, m_privKey);
-	}
-	else
-	{
-		SHA1HashForPattern((BYTE *)privPassword, strlen(privPassword), 1048576, buffer);
-		memcpy(&buffer[20], m_authoritativeEngine.getId(), m_authoritativeEngine.getIdLen());
-		memcpy(&buffer[20 + m_authoritativeEngine.getIdLen()], buffer, 20);
-		CalculateSHA1Hash(buffer, m_authoritativeEngine.getIdLen() + 40, m_privKey);
-	}
+	int method = (m_authMethod == SNMP_AUTH_MD5) ? SNMP_AUTH_MD5 : SNMP_AUTH_SHA1;
+	PasswordToKey(method, privPassword, ku);
+	LocalizeKey(method, ku, m_authoritativeEngine, m_privKey);
 }
 
 /**
@@ -44,6 +44,24 @@ static struct
 	{ { 0 }, 0, 0 }
 };
 
+/**
+ * Get error code from SNMPv3 report PDU
+ */
+UINT32 SnmpGetReportErrorCode(SNMP_PDU *report)
+{
+   SNMP_Variable *var = report->getVariable(0);
+   if (var == NULL)
+      return SNMP_ERR_AGENT;
+
+   const SNMP_ObjectId& oid = var->getName();
+   for(int i = 0; s_oidToErrorMap[i].oidLen != 0; i++)
+   {
+      if (oid.compare(s_oidToErrorMap[i].oid, s_oidToErrorMap[i].oidLen) == OID_EQUAL)
+         return s_oidToErrorMap[i].errorCode;
+   }
+   return SNMP_ERR_AGENT;
+}
+
 /**
  * Create new SNMP transport.
  */
@@ -55,6 +73,7 @@ SNMP_Transport::SNMP_Transport()
 	m_enableEngineIdAutoupdate = false;
 	m_updatePeerOnRecv = false;
 	m_reliable = false;
+	m_getBulkSupported = true;
 	m_snmpVersion = SNMP_VERSION_2C;
 }
 
@@ -153,17 +172,7 @@ UINT32 SNMP_Transport::doRequest(SNMP_PDU *request, SNMP_PDU **response, UINT32
 
                   if ((*response)->getCommand() == SNMP_REPORT)
                   {
-                     SNMP_Variable *var = (*response)->getVariable(0);
-                     rc = SNMP_ERR_AGENT;
-                     const SNMP_ObjectId& oid = var->getName();
-                     for(int i = 0; s_oidToErrorMap[i].oidLen != 0; i++)
-                     {
-                        if (oid.compare(s_oidToErrorMap[i].oid, s_oidToErrorMap[i].oidLen) == OID_EQUAL)
-                        {
-                           rc = s_oidToErrorMap[i].errorCode;
-                           break;
-                        }
-                     }
+                     rc = SnmpGetReportErrorCode(*response);
 
                      // Engine ID discovery - if request contains empty engine ID,
                      // replace it with correct one and retry
@@ -56,6 +56,33 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpGetDefaultTimeout()
    return s_snmpTimeout;
 }
 
+/**
+ * Upper limit for max-repetitions field of GETBULK requests used by SnmpWalk
+ */
+static int s_bulkWalkMaxRepetitions = 64;
+
+/**
+ * Initial value for max-repetitions field of GETBULK requests used by SnmpWalk
+ */
+#define BULK_WALK_INITIAL_REPETITIONS  8
+
+/**
+ * Set upper limit for max-repetitions field of GETBULK requests used by SnmpWalk.
+ * Value 0 or 1 disables use of GETBULK requests.
+ */
+void LIBNXSNMP_EXPORTABLE SnmpSetBulkWalkMaxRepetitions(int maxRepetitions)
+{
+   s_bulkWalkMaxRepetitions = std::max(maxRepetitions, 0);
+}
+
+/**
+ * Get upper limit for max-repetitions field of GETBULK requests used by SnmpWalk
+ */
+int LIBNXSNMP_EXPORTABLE SnmpGetBulkWalkMaxRepetitions()
+{
+   return s_bulkWalkMaxRepetitions;
+}
+
 /**
  * Get value for SNMP variable
  * If szOidStr is not NULL, string representation of OID is used, otherwise -
@@ -255,7 +282,12 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const TCHAR *roo
 }
 
 /**
- * Enumerate multiple values by walking through MIB, starting at given root
+ * Enumerate multiple values by walking through MIB, starting at given root.
+ * For SNMPv2c and SNMPv3 GETBULK requests are used, with max-repetitions
+ * value increased after each full response and decreased when agent reports
+ * that response is too big or does not respond. If agent does not support
+ * GETBULK requests walk continues with GETNEXT requests, and transport is
+ * marked so that following walks use GETNEXT requests from the start.
  */
 UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *rootOid, size_t rootOidLen,
                                      UINT32 (* handler)(SNMP_Variable *, SNMP_Transport *, void *),
@@ -269,6 +301,16 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
    memcpy(pdwName, rootOid, rootOidLen * sizeof(UINT32));
    size_t nameLength = rootOidLen;
 
+   // Current max-repetitions value, 0 means that GETNEXT requests should be used
+   int maxRepetitions = ((transport->getSnmpVersion() != SNMP_VERSION_1) && (s_bulkWalkMaxRepetitions > 1) && transport->isGetBulkSupported()) ?
+            std::min(BULK_WALK_INITIAL_REPETITIONS, s_bulkWalkMaxRepetitions) : 0;
+   bool bulkConfirmed = false;   // set when agent returns valid response to GETBULK request
+   bool bulkTimedOut = false;    // set when first GETBULK request timed out and walk switched to GETNEXT
+
+   // Walk statistics
+   INT64 startTime = GetCurrentTimeMs();
+   int requestCount = 0, variableCount = 0, peakRepetitions = maxRepetitions;
+
    // Walk the MIB
    UINT32 dwResult;
    BOOL bRunning = TRUE;
@@ -282,10 +324,68 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
          break;
       }
 
-      SNMP_PDU *pRqPDU = new SNMP_PDU(SNMP_GET_NEXT_REQUEST, (UINT32)InterlockedIncrement(&s_requestId) & 0x7FFFFFFF, transport->getSnmpVersion());
+      SNMP_PDU *pRqPDU;
+      if (maxRepetitions > 0)
+      {
+         pRqPDU = new SNMP_PDU(SNMP_GET_BULK_REQUEST, (UINT32)InterlockedIncrement(&s_requestId) & 0x7FFFFFFF, transport->getSnmpVersion());
+         pRqPDU->setBulkParameters(0, maxRepetitions);
+      }
+      else
+      {
+         pRqPDU = new SNMP_PDU(SNMP_GET_NEXT_REQUEST, (UINT32)InterlockedIncrement(&s_requestId) & 0x7FFFFFFF, transport->getSnmpVersion());
+      }
       pRqPDU->bindVariable(new SNMP_Variable(pdwName, nameLength));
 	   SNMP_PDU *pRespPDU;
-      dwResult = transport->doRequest(pRqPDU, &pRespPDU, s_snmpTimeout, 3);
+	   // Do not retry large GETBULK requests - repeat them with smaller max-repetitions instead
+      dwResult = transport->doRequest(pRqPDU, &pRespPDU, s_snmpTimeout, (maxRepetitions > 1) ? 1 : 3);
+      requestCount++;
+
+      if ((dwResult == SNMP_ERR_TIMEOUT) && (maxRepetitions > 0))
+      {
+         delete pRqPDU;
+         if (bulkConfirmed && (maxRepetitions > 1))
+         {
+            maxRepetitions /= 2;
+            continue;
+         }
+         if (!bulkConfirmed)
+         {
+            // Agent may silently drop GETBULK requests
+            maxRepetitions = 0;
+            bulkTimedOut = true;
+            continue;
+         }
+         break;
+      }
+
+      if ((dwResult == SNMP_ERR_SUCCESS) && (maxRepetitions > 0))
+      {
+         if ((pRespPDU->getErrorCode() == SNMP_PDU_ERR_TOO_BIG) && (maxRepetitions > 1))
+         {
+            maxRepetitions /= 2;
+            delete pRespPDU;
+            delete pRqPDU;
+            continue;
+         }
+         if ((pRespPDU->getErrorCode() != SNMP_PDU_ERR_SUCCESS) || (pRespPDU->getNumVariables() == 0))
+         {
+            // Agent does not handle GETBULK requests properly, continue with GETNEXT
+            nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("SnmpWalk: GETBULK request failed (error %u), switching to GETNEXT requests"), pRespPDU->getErrorCode());
+            transport->setGetBulkSupported(false);
+            maxRepetitions = 0;
+            delete pRespPDU;
+            delete pRqPDU;
+            continue;
+         }
+         bulkConfirmed = true;
+      }
+      else if ((dwResult == SNMP_ERR_SUCCESS) && bulkTimedOut)
+      {
+         // Agent responds to GETNEXT but not to GETBULK - do not waste timeout on next walk
+         nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("SnmpWalk: agent does not respond to GETBULK requests, switching to GETNEXT requests"));
+         transport->setGetBulkSupported(false);
+         bulkTimedOut = false;
+      }
 
       // Analyze response
       if (dwResult == SNMP_ERR_SUCCESS)
@@ -293,43 +393,52 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
          if ((pRespPDU->getNumVariables() > 0) &&
              (pRespPDU->getErrorCode() == SNMP_PDU_ERR_SUCCESS))
          {
-            SNMP_Variable *pVar = pRespPDU->getVariable(0);
-
-            if ((pVar->getType() != ASN_NO_SUCH_OBJECT) &&
-                (pVar->getType() != ASN_NO_SUCH_INSTANCE) &&
-                (pVar->getType() != ASN_END_OF_MIBVIEW))
+            for(int i = 0; (i < pRespPDU->getNumVariables()) && bRunning; i++)
             {
+               SNMP_Variable *pVar = pRespPDU->getVariable(i);
+
+               if ((pVar->getType() == ASN_NO_SUCH_OBJECT) ||
+                   (pVar->getType() == ASN_NO_SUCH_INSTANCE) ||
+                   (pVar->getType() == ASN_END_OF_MIBVIEW))
+               {
+                  // Consider no object/no instance as end of walk signal instead of failure
+                  bRunning = FALSE;
+                  break;
+               }
+
                // Should we stop walking?
-					// Some buggy SNMP agents may return first value after last one
-					// (Toshiba Strata CTX do that for example), so last check is here
+               // Some buggy SNMP agents may return first value after last one
+               // (Toshiba Strata CTX do that for example), so last check is here
                if ((pVar->getName().length() < rootOidLen) ||
                    (memcmp(rootOid, pVar->getName().value(), rootOidLen * sizeof(UINT32))) ||
-						 (pVar->getName().compare(pdwName, nameLength) == OID_EQUAL) ||
-						 (pVar->getName().compare(firstObjectName, firstObjectNameLen) == OID_EQUAL))
+                   (pVar->getName().compare(pdwName, nameLength) == OID_EQUAL) ||
+                   (pVar->getName().compare(firstObjectName, firstObjectNameLen) == OID_EQUAL))
                {
-                  delete pRespPDU;
-                  delete pRqPDU;
+                  bRunning = FALSE;
                   break;
                }
                nameLength = pVar->getName().length();
                memcpy(pdwName, pVar->getName().value(), nameLength * sizeof(UINT32));
-					if (firstObjectNameLen == 0)
-					{
-						firstObjectNameLen = nameLength;
-						memcpy(firstObjectName, pdwName, nameLength * sizeof(UINT32));
-					}
+               if (firstObjectNameLen == 0)
+               {
+                  firstObjectNameLen = nameLength;
+                  memcpy(firstObjectName, pdwName, nameLength * sizeof(UINT32));
+               }
 
                // Call user's callback function for processing
+               variableCount++;
                dwResult = handler(pVar, transport, userArg);
                if (dwResult != SNMP_ERR_SUCCESS)
                {
                   bRunning = FALSE;
                }
             }
-            else
+
+            // Request more variables next time if agent returned everything requested
+            if (bRunning && (maxRepetitions > 0) && (pRespPDU->getNumVariables() >= maxRepetitions))
             {
-               // Consider no object/no instance as end of walk signal instead of failure
-               bRunning = FALSE;
+               maxRepetitions = std::min(maxRepetitions * 2, std::max(s_bulkWalkMaxRepetitions, 1));
+               peakRepetitions = std::max(peakRepetitions, maxRepetitions);
             }
          }
          else
@@ -348,6 +457,15 @@ UINT32 LIBNXSNMP_EXPORTABLE SnmpWalk(SNMP_Transport *transport, const UINT32 *ro
       }
       delete pRqPDU;
    }
+
+   if (nxlog_get_debug_level_tag(LIBNXSNMP_DEBUG_TAG) >= 7)
+   {
+      TCHAR oidText[MAX_OID_LEN * 5], addrText[64];
+      SNMPConvertOIDToText(rootOidLen, rootOid, oidText, MAX_OID_LEN * 5);
+      nxlog_debug_tag(LIBNXSNMP_DEBUG_TAG, 7, _T("SnmpWalk(%s, %s): %d variables, %d requests, %s (max repetitions %d), ") INT64_FMT _T(" ms, result %u"),
+               transport->getPeerIpAddress().toString(addrText), oidText, variableCount, requestCount,
+               bulkConfirmed ? _T("GETBULK") : _T("GETNEXT"), peakRepetitions, GetCurrentTimeMs() - startTime, dwResult);
+   }
    return dwResult;
 }
 
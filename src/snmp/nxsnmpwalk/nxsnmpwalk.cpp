@@ -114,7 +114,7 @@ int main(int argc, char *argv[])
 
    // Parse command line
    opterr = 1;
-	while((ch = getopt(argc, argv, "a:A:c:e:E:hn:p:u:v:w:")) != -1)
+	while((ch = getopt(argc, argv, "a:A:c:e:E:hn:p:r:u:v:w:")) != -1)
    {
       switch(ch)
       {
@@ -129,6 +129,7 @@ int main(int argc, char *argv[])
                      _T("   -h           : Display help and exit\n")
 						   _T("   -n <name>    : SNMP v3 context name\n")
                      _T("   -p <port>    : Agent's port number. Default is 161\n")
+                     _T("   -r <number>  : Maximum repetitions for GETBULK requests (0 to use GETNEXT). Default is 64\n")
                      _T("   -u <user>    : User name for SNMP v3 USM\n")
                      _T("   -v <version> : SNMP version to use (valid values is 1, 2c, and 3)\n")
                      _T("   -w <seconds> : Request timeout (default is 3 seconds)\n")
@@ -216,6 +217,18 @@ int main(int argc, char *argv[])
                m_port = (WORD)dwValue;
             }
             break;
+         case 'r':   // Max repetitions
+            dwValue = strtoul(optarg, &eptr, 0);
+            if ((*eptr != 0) || (dwValue > 1000))
+            {
+               _tprintf(_T("Invalid max repetitions value %hs\n"), optarg);
+               bStart = FALSE;
+            }
+            else
+            {
+               SnmpSetBulkWalkMaxRepetitions((int)dwValue);
+            }
+            break;
          case 'v':   // Version
             if (!strcmp(optarg, "1"))
             {
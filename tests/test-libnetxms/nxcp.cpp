@@ -1,6 +1,7 @@
 #include <nms_common.h>
 #include <nms_util.h>
 #include <nxcpapi.h>
+#include <nxcldefs.h>
 #include <testtools.h>
 
 /**
@@ -123,6 +124,94 @@ void TestMessageClass()
 
    EndTest();
 
+   StartTest(_T("NXCP message compression (LZ4)"));
+
+   binMsg = msg.serialize(NXCP_STREAM_COMPRESSION_LZ4);
+   AssertNotNull(binMsg);
+   AssertTrue((ntohs(binMsg->flags) & (MF_COMPRESSED | MF_COMPRESSED_LZ4)) == (MF_COMPRESSED | MF_COMPRESSED_LZ4));
+   AssertTrue(ntohl(binMsg->size) % 8 == 0);
+
+   dmsg = NXCPMessage::deserialize(binMsg);
+   AssertNotNull(dmsg);
+   longTextOut = dmsg->getFieldAsString(100);
+   AssertNotNull(longTextOut);
+   AssertTrue(!_tcscmp(longTextOut, longText));
+   MemFree(longTextOut);
+
+   // Deserialized message should not keep compression flags
+   NXCP_MESSAGE *binMsg2 = dmsg->serialize(false);
+   AssertTrue((ntohs(binMsg2->flags) & (MF_COMPRESSED | MF_COMPRESSED_LZ4)) == 0);
+   MemFree(binMsg2);
+   delete dmsg;
+
+   // Corrupted compressed size should be detected
+   *reinterpret_cast<UINT32*>(reinterpret_cast<BYTE*>(binMsg) + NXCP_HEADER_SIZE + 4) = htonl(ntohl(binMsg->size));
+   AssertNull(NXCPMessage::deserialize(binMsg));
+   MemFree(binMsg);
+
+   NXCPMessage smallMsg;
+   smallMsg.setField(1, _T("short"));
+   binMsg = smallMsg.serialize(NXCP_STREAM_COMPRESSION_LZ4);
+   AssertTrue((ntohs(binMsg->flags) & MF_COMPRESSED) == 0);
+   MemFree(binMsg);
+
+   AssertEquals(NXCPSelectCompressionMethod(NXCP_COMPRESSION_METHOD_DEFLATE | NXCP_COMPRESSION_METHOD_LZ4), NXCP_STREAM_COMPRESSION_LZ4);
+   AssertEquals(NXCPSelectCompressionMethod(0), NXCP_STREAM_COMPRESSION_DEFLATE);
+
+   EndTest();
+
+   StartTest(_T("NXCP message serialization into buffer and blocks"));
+
+   BYTE largeData[10000];
+   for(int i = 0; i < 10000; i++)
+      largeData[i] = static_cast<BYTE>(i);
+   msg.setField(101, largeData, 10000);
+   msg.setField(102, largeData, 5);
+   msg.setField(103, static_cast<UINT32>(42));
+
+   binMsg = msg.serialize(false);
+   size_t size = ntohl(binMsg->size);
+   AssertEquals(size, msg.getSerializedSize());
+
+   BYTE *buffer3 = static_cast<BYTE*>(MemAlloc(size));
+   AssertEquals(msg.serializeTo(reinterpret_cast<NXCP_MESSAGE*>(buffer3), size - 8), 0);
+   AssertEquals(msg.serializeTo(reinterpret_cast<NXCP_MESSAGE*>(buffer3), size), size);
+   AssertTrue(!memcmp(buffer3, binMsg, size));
+
+   NXCPMessageBlocks blocks;
+   msg.serializeToBlocks(&blocks);
+   AssertEquals(blocks.getSize(), size);
+   AssertTrue(blocks.getCount() > 1);
+   memset(buffer3, 0, size);
+   size_t offset = 0;
+   for(int i = 0; i < blocks.getCount(); i++)
+   {
+      AssertTrue(offset + blocks.getBlocks()[i].size <= size);
+      memcpy(&buffer3[offset], blocks.getBlocks()[i].data, blocks.getBlocks()[i].size);
+      offset += blocks.getBlocks()[i].size;
+   }
+   AssertEquals(offset, size);
+   AssertTrue(!memcmp(buffer3, binMsg, size));
+   MemFree(buffer3);
+   MemFree(binMsg);
+
+   // Only messages that will actually be compressed should be reported as compressible
+   AssertTrue(msg.isCompressible(NXCP_STREAM_COMPRESSION_DEFLATE));
+   AssertFalse(msg.isCompressible(NXCP_STREAM_COMPRESSION_NONE));
+   NXCPMessage uncompressedMsg(msg.getCode(), msg.getId());
+   uncompressedMsg.setField(101, largeData, 10000);
+   uncompressedMsg.disableCompression();
+   AssertFalse(uncompressedMsg.isCompressible(NXCP_STREAM_COMPRESSION_DEFLATE));
+   NXCPMessage shortMsg(msg.getCode(), msg.getId());
+   shortMsg.setField(103, static_cast<UINT32>(42));
+   AssertFalse(shortMsg.isCompressible(NXCP_STREAM_COMPRESSION_DEFLATE));
+
+   // Replacing field should update serialized size
+   msg.setField(101, largeData, 16);
+   AssertEquals(msg.getSerializedSize(), size - 9984);
+
+   EndTest();
+
    StartTest(_T("NXCP message compression performance"));
    INT64 start = GetCurrentTimeMs();
    for(int i = 0; i < 10000; i++)
@@ -132,3 +221,585 @@ void TestMessageClass()
    }
    EndTest(GetCurrentTimeMs() - start);
 }
+
+/**
+ * Build message similar to bulk DCI data message sent by agent
+ */
+static NXCPMessage *CreateDataMessage()
+{
+   NXCPMessage *msg = new NXCPMessage(CMD_DCI_DATA, 1);
+   msg->setField(VID_NUM_ELEMENTS, static_cast<UINT32>(500));
+   UINT32 fieldId = VID_ELEMENT_LIST_BASE;
+   for(int i = 0; i < 500; i++, fieldId += 10)
+   {
+      TCHAR value[64];
+      _sntprintf(value, 64, _T("%d.%02d"), (i * 7919) % 100000, i % 100);
+      msg->setField(fieldId, static_cast<UINT32>(i + 10000));
+      msg->setField(fieldId + 1, static_cast<INT16>(0));
+      msg->setField(fieldId + 2, static_cast<INT16>(1));
+      msg->setField(fieldId + 3, value);
+      msg->setFieldFromTime(fieldId + 4, 1577836800 + i * 60);
+      msg->setField(fieldId + 5, static_cast<UINT64>(i));
+   }
+   return msg;
+}
+
+/**
+ * Build message similar to object update message
+ */
+static NXCPMessage *CreateObjectMessage()
+{
+   NXCPMessage *msg = new NXCPMessage(CMD_OBJECT, 1);
+   UINT32 fieldId = VID_ELEMENT_LIST_BASE;
+   for(int i = 0; i < 40; i++, fieldId += 10)
+   {
+      TCHAR buffer[128];
+      _sntprintf(buffer, 128, _T("Interface GigabitEthernet0/%d"), i);
+      msg->setField(fieldId, buffer);
+      _sntprintf(buffer, 128, _T("Uplink to switch rack %d port %d"), i / 8, i % 8);
+      msg->setField(fieldId + 1, buffer);
+      msg->setField(fieldId + 2, static_cast<UINT32>(i + 1));
+      msg->setField(fieldId + 3, InetAddress(0x0A000001 + i));
+      msg->setField(fieldId + 4, uuid::generate());
+   }
+   msg->setField(VID_COMMENTS, longText);
+   return msg;
+}
+
+/**
+ * Build message with incompressible binary content
+ */
+static NXCPMessage *CreateRandomDataMessage()
+{
+   NXCPMessage *msg = new NXCPMessage(CMD_FILE_DATA, 1);
+   BYTE data[16384];
+   UINT32 seed = 12345;
+   for(int i = 0; i < 16384; i++)
+   {
+      seed = seed * 1103515245 + 12345;
+      data[i] = static_cast<BYTE>(seed >> 16);
+   }
+   msg->setField(VID_FILE_DATA, data, 16384);
+   return msg;
+}
+
+/**
+ * Compression benchmark on realistic message mix
+ */
+void TestMessageCompressionBenchmark()
+{
+   static const TCHAR *methodNames[] = { _T("none"), _T("LZ4"), _T("deflate") };
+   NXCPMessage *messages[3];
+   messages[0] = CreateDataMessage();
+   messages[1] = CreateObjectMessage();
+   messages[2] = CreateRandomDataMessage();
+
+   for(int m = 0; m <= 2; m++)
+   {
+      TCHAR name[64];
+      _sntprintf(name, 64, _T("NXCP compression benchmark (%s)"), methodNames[m]);
+      StartTest(name);
+
+      UINT64 originalSize = 0, compressedSize = 0;
+      INT64 start = GetCurrentTimeMs();
+      for(int i = 0; i < 100; i++)
+      {
+         for(int j = 0; j < 3; j++)
+         {
+            NXCP_MESSAGE *rawMsg = messages[j]->serialize(static_cast<NXCPStreamCompressionMethod>(m));
+            NXCPMessage *msg = NXCPMessage::deserialize(rawMsg);
+            AssertNotNull(msg);
+            compressedSize += ntohl(rawMsg->size);
+            originalSize += (ntohs(rawMsg->flags) & MF_COMPRESSED) ? ntohl(*reinterpret_cast<UINT32*>(reinterpret_cast<BYTE*>(rawMsg) + NXCP_HEADER_SIZE)) : ntohl(rawMsg->size);
+            delete msg;
+            MemFree(rawMsg);
+         }
+      }
+      INT64 elapsed = GetCurrentTimeMs() - start;
+      _tprintf(_T("%d ms (size %d%%)\n"), static_cast<int>(elapsed), static_cast<int>(compressedSize * 100 / originalSize));
+   }
+
+   for(int j = 0; j < 3; j++)
+      delete messages[j];
+}
+
+#ifdef _WITH_ENCRYPTION
+
+/**
+ * Create pair of encryption contexts using given ciphers
+ */
+static bool CreateEncryptionContexts(RSA *key, UINT32 ciphers, NXCPEncryptionContext **initiator, NXCPEncryptionContext **responder)
+{
+   NXCPMessage request;
+   PrepareKeyRequestMsg(&request, key, false);
+   request.setField(VID_SUPPORTED_ENCRYPTION, ciphers);
+
+   NXCPMessage *response = NULL;
+   if (SetupEncryptionContext(&request, responder, &response, NULL, NXCP_VERSION) != RCC_SUCCESS)
+   {
+      delete response;
+      return false;
+   }
+
+   UINT32 rcc = SetupEncryptionContext(response, initiator, NULL, key, NXCP_VERSION);
+   delete response;
+   if (rcc != RCC_SUCCESS)
+   {
+      (*responder)->decRefCount();
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Number of encrypting threads and messages per thread for parallel encryption test
+ */
+#define ENCRYPTION_THREADS    8
+#define ENCRYPTION_MESSAGES   500
+
+/**
+ * Parallel encryption task
+ */
+struct EncryptionTask
+{
+   NXCPEncryptionContext *context;
+   const NXCP_MESSAGE *message;
+   NXCP_ENCRYPTED_MESSAGE *results[ENCRYPTION_MESSAGES];
+};
+
+/**
+ * Encrypt message many times using shared context
+ */
+static THREAD_RESULT THREAD_CALL EncryptionThread(void *arg)
+{
+   EncryptionTask *task = static_cast<EncryptionTask*>(arg);
+   for(int i = 0; i < ENCRYPTION_MESSAGES; i++)
+      task->results[i] = task->context->encryptMessage(task->message, NULL, 0);
+   return THREAD_OK;
+}
+
+/**
+ * Get message counter from AEAD encrypted message
+ */
+static UINT64 GetMessageCounter(const NXCP_ENCRYPTED_MESSAGE *msg)
+{
+   UINT64 counter;
+   memcpy(&counter, msg->data, sizeof(UINT64));
+   return ntohq(counter);
+}
+
+/**
+ * Compare encrypted messages by counter
+ */
+static int CompareMessageCounters(const void *m1, const void *m2)
+{
+   UINT64 c1 = GetMessageCounter(*static_cast<NXCP_ENCRYPTED_MESSAGE* const*>(m1));
+   UINT64 c2 = GetMessageCounter(*static_cast<NXCP_ENCRYPTED_MESSAGE* const*>(m2));
+   return (c1 < c2) ? -1 : ((c1 > c2) ? 1 : 0);
+}
+
+/**
+ * Test parallel encryption with shared AEAD context. Every message should have unique counter
+ * and should be decrypted by peer.
+ */
+static void TestParallelEncryption(NXCPEncryptionContext *sender, NXCPEncryptionContext *receiver, const NXCP_MESSAGE *rawMsg, BYTE *decryptionBuffer)
+{
+   EncryptionTask *tasks = new EncryptionTask[ENCRYPTION_THREADS];
+   THREAD threads[ENCRYPTION_THREADS];
+   for(int i = 0; i < ENCRYPTION_THREADS; i++)
+   {
+      tasks[i].context = sender;
+      tasks[i].message = rawMsg;
+      threads[i] = ThreadCreateEx(EncryptionThread, 0, &tasks[i]);
+   }
+   for(int i = 0; i < ENCRYPTION_THREADS; i++)
+      ThreadJoin(threads[i]);
+
+   NXCP_ENCRYPTED_MESSAGE **messages = MemAllocArrayNoInit<NXCP_ENCRYPTED_MESSAGE*>(ENCRYPTION_THREADS * ENCRYPTION_MESSAGES);
+   for(int i = 0; i < ENCRYPTION_THREADS; i++)
+   {
+      for(int j = 0; j < ENCRYPTION_MESSAGES; j++)
+      {
+         AssertNotNull(tasks[i].results[j]);
+         messages[i * ENCRYPTION_MESSAGES + j] = tasks[i].results[j];
+      }
+   }
+   delete[] tasks;
+
+   // Deliver in counter order as if messages were sent over single connection
+   qsort(messages, ENCRYPTION_THREADS * ENCRYPTION_MESSAGES, sizeof(NXCP_ENCRYPTED_MESSAGE*), CompareMessageCounters);
+   size_t msgSize = ntohl(rawMsg->size);
+   for(int i = 0; i < ENCRYPTION_THREADS * ENCRYPTION_MESSAGES; i++)
+   {
+      NXCP_ENCRYPTED_MESSAGE *emsg = messages[i];
+      if (i > 0)
+         AssertTrue(GetMessageCounter(messages[i - 1]) != GetMessageCounter(emsg));
+
+      // Padding should not contain uninitialized data
+      UINT32 size = ntohl(emsg->size);
+      for(int p = 0; p < emsg->padding; p++)
+         AssertEquals(reinterpret_cast<BYTE*>(emsg)[size - p - 1], 0);
+
+      AssertTrue(receiver->decryptMessage(emsg, decryptionBuffer));
+      AssertTrue(!memcmp(emsg, rawMsg, msgSize));
+      MemFree(emsg);
+   }
+   MemFree(messages);
+}
+
+#endif
+
+/**
+ * Test message encryption
+ */
+void TestMessageEncryption()
+{
+#ifdef _WITH_ENCRYPTION
+   InitCryptoLib(0xFFFF);
+   RSA *key = RSAGenerateKey(NETXMS_RSA_KEYLEN);
+
+   static const UINT32 ciphers[] = { NXCP_SUPPORT_AES_256, NXCP_SUPPORT_AES_256_GCM };
+   static const TCHAR *cipherNames[] = { _T("AES-256"), _T("AES-256-GCM") };
+
+   NXCPMessage *messages[3];
+   messages[0] = CreateDataMessage();
+   messages[1] = CreateObjectMessage();
+   messages[2] = CreateRandomDataMessage();
+   NXCP_MESSAGE *rawMessages[3];
+   for(int j = 0; j < 3; j++)
+      rawMessages[j] = messages[j]->serialize(false);
+
+   BYTE *buffer = static_cast<BYTE*>(MemAlloc(65536));
+   BYTE *decryptionBuffer = static_cast<BYTE*>(MemAlloc(65536));
+
+   for(int c = 0; c < 2; c++)
+   {
+      if (!(NXCPGetSupportedCiphers() & ciphers[c]))
+         continue;
+
+      TCHAR name[64];
+      _sntprintf(name, 64, _T("NXCP message encryption (%s)"), cipherNames[c]);
+      StartTest(name);
+
+      NXCPEncryptionContext *initiator, *responder;
+      AssertTrue(CreateEncryptionContexts(key, ciphers[c], &initiator, &responder));
+      AssertEquals(initiator->getCipher(), responder->getCipher());
+      AssertEquals(initiator->isAEAD(), ciphers[c] == NXCP_SUPPORT_AES_256_GCM);
+
+      // Round trip in both directions
+      NXCP_ENCRYPTED_MESSAGE *emsg = initiator->encryptMessage(rawMessages[0], buffer, 65536);
+      AssertTrue(reinterpret_cast<BYTE*>(emsg) == buffer);
+      AssertTrue(ntohl(emsg->size) % 8 == 0);
+      AssertTrue(responder->decryptMessage(emsg, decryptionBuffer));
+      AssertTrue(!memcmp(emsg, rawMessages[0], ntohl(rawMessages[0]->size)));
+
+      emsg = responder->encryptMessage(rawMessages[1]);
+      AssertNotNull(emsg);
+      AssertTrue(initiator->decryptMessage(emsg, decryptionBuffer));
+      AssertTrue(!memcmp(emsg, rawMessages[1], ntohl(rawMessages[1]->size)));
+      MemFree(emsg);
+
+      if (initiator->isAEAD())
+      {
+         // Modified message should be rejected
+         emsg = initiator->encryptMessage(rawMessages[1], buffer, 65536);
+         emsg->data[100] ^= 1;
+         AssertFalse(responder->decryptMessage(emsg, decryptionBuffer));
+
+         // Message reflected back to sender should be rejected
+         emsg = initiator->encryptMessage(rawMessages[1], buffer, 65536);
+         AssertFalse(initiator->decryptMessage(emsg, decryptionBuffer));
+
+         // Replayed message should be rejected, reordered messages within window should be accepted
+         NXCP_ENCRYPTED_MESSAGE *emsg1 = initiator->encryptMessage(rawMessages[0], NULL, 0);
+         NXCP_ENCRYPTED_MESSAGE *emsg2 = initiator->encryptMessage(rawMessages[0], NULL, 0);
+         size_t size = ntohl(emsg1->size);
+         NXCP_ENCRYPTED_MESSAGE *copy = static_cast<NXCP_ENCRYPTED_MESSAGE*>(MemCopyBlock(emsg1, size));
+         AssertTrue(responder->decryptMessage(emsg2, decryptionBuffer));
+         AssertTrue(responder->decryptMessage(emsg1, decryptionBuffer));
+         AssertFalse(responder->decryptMessage(copy, decryptionBuffer));
+         MemFree(emsg1);
+         MemFree(emsg2);
+
+         // Message older than replay window should be rejected
+         emsg1 = initiator->encryptMessage(rawMessages[0], NULL, 0);
+         for(int i = 0; i < 64; i++)
+         {
+            emsg = initiator->encryptMessage(rawMessages[0], buffer, 65536);
+            AssertTrue(responder->decryptMessage(emsg, decryptionBuffer));
+         }
+         AssertFalse(responder->decryptMessage(emsg1, decryptionBuffer));
+         MemFree(emsg1);
+         MemFree(copy);
+
+         TestParallelEncryption(responder, initiator, rawMessages[2], decryptionBuffer);
+      }
+
+      EndTest();
+
+      _sntprintf(name, 64, _T("NXCP encryption benchmark (%s)"), cipherNames[c]);
+      StartTest(name);
+      UINT64 bytes = 0;
+      INT64 start = GetCurrentTimeMs();
+      for(int i = 0; i < 2000; i++)
+      {
+         for(int j = 0; j < 3; j++)
+         {
+            emsg = initiator->encryptMessage(rawMessages[j], buffer, 65536);
+            bytes += ntohl(rawMessages[j]->size);
+            if (!responder->decryptMessage(emsg, decryptionBuffer))
+               AssertTrue(false);
+         }
+      }
+      INT64 elapsed = GetCurrentTimeMs() - start;
+      _tprintf(_T("%d ms (%d MB/s)\n"), static_cast<int>(elapsed), static_cast<int>(bytes / 1024 / std::max(elapsed, static_cast<INT64>(1)) * 1000 / 1024));
+
+      initiator->decRefCount();
+      responder->decRefCount();
+   }
+
+   MemFree(buffer);
+   MemFree(decryptionBuffer);
+   for(int j = 0; j < 3; j++)
+   {
+      MemFree(rawMessages[j]);
+      delete messages[j];
+   }
+   RSAFree(key);
+#endif
+}
+
+#ifndef _WIN32
+
+/**
+ * Message consumer for socket receiver tests. Reads from one end of socket pair
+ * and checks that messages are delivered in order.
+ */
+class TestMessageConsumer : public MessageConsumer
+{
+private:
+   SOCKET m_socket;
+   SOCKET m_peer;
+   SocketMessageReceiver m_receiver;
+   UINT32 m_timeout;
+   bool m_continueOnTimeout;
+
+public:
+   VolatileCounter refCount;
+   VolatileCounter messages;
+   VolatileCounter outOfOrder;
+   VolatileCounter timeouts;
+   VolatileCounter shutdowns;
+   MessageReceiverResult shutdownReason;
+
+   TestMessageConsumer(SOCKET s, SOCKET peer, UINT32 timeout = INFINITE, bool continueOnTimeout = false) : m_receiver(s, 4096, 65536)
+   {
+      m_socket = s;
+      m_peer = peer;
+      m_timeout = timeout;
+      m_continueOnTimeout = continueOnTimeout;
+      refCount = 0;
+      messages = 0;
+      outOfOrder = 0;
+      timeouts = 0;
+      shutdowns = 0;
+      shutdownReason = MSGRECV_SUCCESS;
+   }
+
+   virtual ~TestMessageConsumer()
+   {
+      closesocket(m_socket);
+      if (m_peer != INVALID_SOCKET)
+         closesocket(m_peer);
+   }
+
+   virtual SOCKET getSocket() override { return m_socket; }
+   virtual AbstractMessageReceiver *getMessageReceiver() override { return &m_receiver; }
+   virtual UINT32 getReceiveTimeout() override { return m_timeout; }
+
+   virtual void processMessage(NXCPMessage *msg) override
+   {
+      if (msg->getId() != static_cast<UINT32>(messages) + 1)
+         InterlockedIncrement(&outOfOrder);
+      InterlockedIncrement(&messages);
+      delete msg;
+   }
+
+   virtual bool onReceiveTimeout() override
+   {
+      return InterlockedIncrement(&timeouts) == 1 ? m_continueOnTimeout : false;
+   }
+
+   virtual void onReceiverShutdown(MessageReceiverResult reason) override
+   {
+      shutdownReason = reason;
+      InterlockedIncrement(&shutdowns);
+   }
+
+   virtual void incConsumerRefCount() override { InterlockedIncrement(&refCount); }
+   virtual void decConsumerRefCount() override { InterlockedDecrement(&refCount); }
+
+   void send(UINT32 id)
+   {
+      NXCPMessage msg(CMD_KEEPALIVE, id);
+      NXCP_MESSAGE *rawMsg = msg.serialize(false);
+      SendEx(m_peer, rawMsg, ntohl(rawMsg->size), 0, NULL);
+      MemFree(rawMsg);
+   }
+
+   void closePeer()
+   {
+      shutdown(m_peer, SHUT_RDWR);
+   }
+
+   /**
+    * Wait until consumer is released by receiver (after shutdown notification)
+    */
+   bool waitForRelease(UINT32 timeout)
+   {
+      for(UINT32 elapsed = 0; (refCount > 0) && (elapsed < timeout); elapsed += 10)
+         ThreadSleepMs(10);
+      return (refCount == 0) && (shutdowns > 0);
+   }
+};
+
+/**
+ * Create consumer connected via socket pair
+ */
+static TestMessageConsumer *CreateTestConsumer(UINT32 timeout = INFINITE, bool continueOnTimeout = false)
+{
+   SOCKET s[2];
+   if (socketpair(AF_UNIX, SOCK_STREAM, 0, s) != 0)
+      return NULL;
+   return new TestMessageConsumer(s[0], s[1], timeout, continueOnTimeout);
+}
+
+/**
+ * Socket receiver register/unregister worker
+ */
+static THREAD_RESULT THREAD_CALL SocketReceiverRegistrationWorker(void *arg)
+{
+   ThreadPool *pool = static_cast<ThreadPool*>(arg);
+   for(int i = 0; i < 50; i++)
+   {
+      TestMessageConsumer *c = CreateTestConsumer();
+      if (c == NULL)
+         continue;
+      if (SocketReceiver::addConsumer(c, pool))
+      {
+         for(UINT32 id = 1; id <= 5; id++)
+            c->send(id);
+         SocketReceiver::removeConsumer(c);
+         if (!c->waitForRelease(5000) || (c->shutdowns != 1) || (c->outOfOrder != 0))
+         {
+            _tprintf(_T("\nConsumer not released correctly (refCount=%d shutdowns=%d outOfOrder=%d)\n"), c->refCount, c->shutdowns, c->outOfOrder);
+            exit(1);
+         }
+      }
+      delete c;
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Test socket receiver
+ */
+void TestSocketReceiver()
+{
+   StartTest(_T("SocketReceiver::start"));
+   if (!SocketReceiver::start(2))
+   {
+      _tprintf(_T("SKIPPED (not supported on this platform)\n"));
+      return;
+   }
+   AssertTrue(SocketReceiver::isRunning());
+   AssertFalse(SocketReceiver::start(2));
+   ThreadPool *pool = ThreadPoolCreate(_T("RECEIVER"), 2, 8);
+   EndTest();
+
+   StartTest(_T("SocketReceiver - message delivery"));
+   TestMessageConsumer *consumers[16];
+   for(int i = 0; i < 16; i++)
+   {
+      consumers[i] = CreateTestConsumer();
+      AssertNotNull(consumers[i]);
+      AssertTrue(SocketReceiver::addConsumer(consumers[i], pool));
+   }
+   AssertEquals(SocketReceiver::getConsumerCount(), 16);
+   for(UINT32 id = 1; id <= 200; id++)
+      for(int i = 0; i < 16; i++)
+         consumers[i]->send(id);
+   for(int i = 0; i < 16; i++)
+   {
+      for(int n = 0; (n < 500) && (consumers[i]->messages < 200); n++)
+         ThreadSleepMs(10);
+      AssertEquals(consumers[i]->messages, 200);
+      AssertEquals(consumers[i]->outOfOrder, 0);
+      consumers[i]->closePeer();
+   }
+   for(int i = 0; i < 16; i++)
+   {
+      AssertTrue(consumers[i]->waitForRelease(5000));
+      AssertEquals(consumers[i]->shutdowns, 1);
+      AssertEquals(consumers[i]->shutdownReason, MSGRECV_CLOSED);
+      delete consumers[i];
+   }
+   AssertEquals(SocketReceiver::getConsumerCount(), 0);
+   EndTest();
+
+   StartTest(_T("SocketReceiver - concurrent register/unregister"));
+   THREAD threads[4];
+   for(int i = 0; i < 4; i++)
+      threads[i] = ThreadCreateEx(SocketReceiverRegistrationWorker, 0, pool);
+   for(int i = 0; i < 4; i++)
+      ThreadJoin(threads[i]);
+   AssertEquals(SocketReceiver::getConsumerCount(), 0);
+   EndTest();
+
+   StartTest(_T("SocketReceiver - receive timeout"));
+   TestMessageConsumer *c = CreateTestConsumer(500, true);
+   AssertNotNull(c);
+   AssertTrue(SocketReceiver::addConsumer(c, pool));
+   INT64 startTime = GetCurrentTimeMs();
+   AssertTrue(c->waitForRelease(10000));
+   AssertEquals(c->timeouts, 2);   // first timeout handler call asks to continue waiting
+   AssertEquals(c->shutdowns, 1);
+   AssertEquals(c->shutdownReason, MSGRECV_TIMEOUT);
+   AssertTrue(GetCurrentTimeMs() - startTime >= 1000);
+   delete c;
+   EndTest();
+
+   StartTest(_T("SocketReceiver::shutdown"));
+   for(int i = 0; i < 8; i++)
+   {
+      consumers[i] = CreateTestConsumer();
+      AssertNotNull(consumers[i]);
+      AssertTrue(SocketReceiver::addConsumer(consumers[i], pool));
+   }
+   consumers[0]->send(1);
+   SocketReceiver::shutdown();
+   AssertFalse(SocketReceiver::isRunning());
+   for(int i = 0; i < 8; i++)
+   {
+      AssertTrue(consumers[i]->waitForRelease(5000));
+      AssertEquals(consumers[i]->shutdowns, 1);
+      delete consumers[i];
+   }
+   c = CreateTestConsumer();
+   AssertFalse(SocketReceiver::addConsumer(c, pool));
+   AssertEquals(c->refCount, 0);
+   delete c;
+   ThreadPoolDestroy(pool);
+   EndTest();
+}
+
+#else
+
+/**
+ * Test socket receiver (not supported on Windows)
+ */
+void TestSocketReceiver()
+{
+}
+
+#endif
@@ -16,10 +16,15 @@ void TestObjectMemoryPool();
 void TestThreadPool();
 void TestMsgWaitQueue();
 void TestMessageClass();
+void TestMessageCompressionBenchmark();
+void TestMessageEncryption();
+void TestSocketReceiver();
 void TestMutex();
 void TestMutexWrapper();
 void TestRWLockWrapper();
 void TestConditionWrapper();
+void TestThreadPoolScheduler();
+void TestThreadPoolWorkStealing();
 void TestThreadCountAndMaxWaitTime();
 void TestProcessExecutor(const char *procname);
 void TestProcessExecutorWorker();
@@ -2090,7 +2095,10 @@ int main(int argc, char *argv[])
    TestStringFunctionsW();
    TestPatternMatching();
    TestMessageClass();
+   TestMessageCompressionBenchmark();
+   TestMessageEncryption();
    TestMsgWaitQueue();
+   TestSocketReceiver();
    TestMacAddress();
    TestInetAddress();
    TestItoa();
@@ -2114,6 +2122,8 @@ int main(int argc, char *argv[])
    TestProcessExecutor(argv[0]);
    TestSubProcess(argv[0]);
    TestThreadPool();
+   TestThreadPoolScheduler();
+   TestThreadPoolWorkStealing();
    TestThreadCountAndMaxWaitTime();
    return 0;
 }
@@ -49,6 +49,111 @@ void TestThreadPool()
    ThreadPoolDestroy(p);
 }
 
+static Mutex s_scheduleTestLock;
+static int s_scheduleTestOrder[64];
+static int s_scheduleTestCount = 0;
+
+static void ScheduledWorkload(void *arg)
+{
+   s_scheduleTestLock.lock();
+   s_scheduleTestOrder[s_scheduleTestCount++] = CAST_FROM_POINTER(arg, int);
+   s_scheduleTestLock.unlock();
+}
+
+void TestThreadPoolScheduler()
+{
+   StartTest(_T("Thread pool - scheduler"));
+   ThreadPool *p = ThreadPoolCreate(_T("SCHEDULER"), 1, 1, 0);
+
+   // Schedule in reverse order, tasks with same delay should keep submission order
+   INT64 now = GetCurrentTimeMs();
+   for(int i = 63; i >= 0; i--)
+      ThreadPoolScheduleAbsoluteMs(p, now + 200 + (i / 2) * 10, ScheduledWorkload, CAST_TO_POINTER((i % 2 == 0) ? i + 1 : i - 1, void*));
+
+   ThreadPoolInfo info;
+   ThreadPoolGetInfo(p, &info);
+   AssertEquals(info.scheduledRequests, 64);
+
+   ThreadSleepMs(1000);
+   ThreadPoolGetInfo(p, &info);
+   AssertEquals(info.scheduledRequests, 0);
+   AssertEquals(s_scheduleTestCount, 64);
+   for(int i = 0; i < 64; i++)
+      AssertEquals(s_scheduleTestOrder[i], i);
+
+   UINT64 dispatched = 0;
+   for(int i = 0; i < THREAD_POOL_LATENESS_BUCKETS; i++)
+      dispatched += info.schedulerLateness[i];
+   AssertEquals(dispatched, 64);
+
+   ThreadPoolDestroy(p);
+   EndTest();
+}
+
+static VolatileCounter s_batchTestCounter = 0;
+
+static void BatchWorkload(void *arg)
+{
+   InterlockedIncrement(&s_batchTestCounter);
+}
+
+static VolatileCounter s_maxLatency = 0;
+
+static void LatencyWorkload(void *arg)
+{
+   INT32 latency = static_cast<INT32>(GetCurrentTimeMs() - *static_cast<INT64*>(arg));
+   VolatileCounter curr;
+   do
+   {
+      curr = s_maxLatency;
+   } while((latency > curr) && (InterlockedCompareExchange(&s_maxLatency, latency, curr) != curr));
+}
+
+void TestThreadPoolWorkStealing()
+{
+   StartTest(_T("Thread pool - work stealing"));
+   ThreadPool *p = ThreadPoolCreate(_T("STEALING"), 4, 16, 0, THREAD_POOL_WORK_STEALING);
+   AssertNotNull(p);
+
+   void *args[1000];
+   for(int i = 0; i < 1000; i++)
+      args[i] = CAST_TO_POINTER(i, void*);
+   ThreadPoolExecuteBatch(p, BatchWorkload, args, 1000);
+   for(int i = 0; i < 100; i++)
+      ThreadPoolExecute(p, BatchWorkload, NULL);
+
+   // Slow tasks should not block execution of tasks queued after them
+   for(int i = 0; i < 3; i++)
+      ThreadPoolExecute(p, SlowWorkload, NULL);
+   ThreadPoolExecute(p, BatchWorkload, NULL);
+   ThreadSleepMs(500);
+   AssertEquals(s_batchTestCounter, 1101);
+
+   ThreadPoolInfo info;
+   ThreadPoolGetInfo(p, &info);
+   AssertEquals(info.totalRequests, 1104);
+   AssertEquals(info.curThreads, 4);
+
+   ThreadPoolDestroy(p);
+
+   // Idle workers should be woken up immediately when request is put into queue of busy worker
+   p = ThreadPoolCreate(_T("STEALING"), 4, 4, 0, THREAD_POOL_WORK_STEALING);
+   for(int i = 0; i < 3; i++)
+      ThreadPoolExecute(p, SlowWorkload, NULL);
+   INT64 submitTimes[8];
+   for(int i = 0; i < 8; i++)
+   {
+      submitTimes[i] = GetCurrentTimeMs();
+      ThreadPoolExecute(p, LatencyWorkload, &submitTimes[i]);
+      ThreadSleepMs(100);
+   }
+   ThreadSleepMs(200);
+   AssertTrue(s_maxLatency < 100);
+
+   ThreadPoolDestroy(p);
+   EndTest();
+}
+
 static Mutex s_waitTimeTestLock1;
 static Mutex s_waitTimeTestLock2;
 
@@ -123,6 +123,35 @@ static void CommonTests(const TCHAR *prefix, const TCHAR *driver, const TCHAR *s
    AssertEquals(count, 200);
    EndTest();
 
+   /*** bulk insert ***/
+   StartTest(prefix, _T("bulk insert"));
+   AssertTrue(DBBegin(session));
+   static int sqlTypes[] = { DB_SQLTYPE_INTEGER, DB_SQLTYPE_VARCHAR, DB_SQLTYPE_INTEGER };
+   DB_BULK_INSERT hBulk = DBBulkInsertBegin(session, _T("nx_test"), _T("id,value1,value2_new"), 3, sqlTypes);
+   AssertNotNull(hBulk);
+   for(int i = 2001; i <= 3000; i++)
+   {
+      TCHAR id[16], value[64];
+      _sntprintf(id, 16, _T("%d"), i);
+      _sntprintf(value, 64, _T("bulk\\'%d'\tvalue"), i);
+      const TCHAR *values[3] = { id, value, id };
+      AssertTrue(DBBulkInsertAddRow(hBulk, values));
+   }
+   AssertEquals(DBBulkInsertGetRowCount(hBulk), 1000);
+   AssertTrue(DBBulkInsertEnd(hBulk));
+   AssertTrue(DBCommit(session));
+   hResult = DBSelectEx(session, _T("SELECT count(*),sum(value2_new) FROM nx_test WHERE id>2000"), buffer);
+   AssertNotNullEx(hResult, buffer);
+   AssertEquals(DBGetFieldLong(hResult, 0, 0), 1000);
+   AssertEquals(DBGetFieldLong(hResult, 0, 1), 2500500);
+   DBFreeResult(hResult);
+   hResult = DBSelectEx(session, _T("SELECT value1 FROM nx_test WHERE id=2500"), buffer);
+   AssertNotNullEx(hResult, buffer);
+   TCHAR value[64];
+   AssertTrue(!_tcscmp(DBGetField(hResult, 0, 0, value, 64), _T("bulk\\'2500'\tvalue")));
+   DBFreeResult(hResult);
+   EndTest();
+
    /*** drop test table ***/
    StartTest(prefix, _T("drop test table"));
    AssertTrue(DBQuery(session, _T("DROP TABLE nx_test")));
@@ -0,0 +1,395 @@
+#include <nms_common.h>
+#include <nms_util.h>
+#include <nxmbapi.h>
+#include <testtools.h>
+
+NETXMS_EXECUTABLE_HEADER(test-libnxmb)
+
+/**
+ * Number of dispatcher workers used by tests
+ */
+#define NUM_WORKERS  4
+
+/**
+ * Test message with sequence number
+ */
+class TestMessage : public NXMBMessage
+{
+private:
+   int m_sequence;
+
+public:
+   TestMessage(const TCHAR *type, int sequence) : NXMBMessage(type, _T("TEST")) { m_sequence = sequence; }
+
+   int getSequence() const { return m_sequence; }
+};
+
+/**
+ * Test subscriber. Counts received messages and checks that messages are received in posting order.
+ */
+class TestSubscriber : public NXMBSubscriber
+{
+private:
+   int m_lastSequence;
+
+public:
+   VolatileCounter messages;
+   VolatileCounter outOfOrder;
+   bool removed;
+
+   TestSubscriber(const TCHAR *id) : NXMBSubscriber(id)
+   {
+      m_lastSequence = -1;
+      messages = 0;
+      outOfOrder = 0;
+      removed = false;
+   }
+
+   virtual void messageHandler(NXMBMessage &msg) override
+   {
+      int sequence = static_cast<TestMessage&>(msg).getSequence();
+      if ((sequence <= m_lastSequence) || removed)
+         InterlockedIncrement(&outOfOrder);
+      m_lastSequence = sequence;
+      InterlockedIncrement(&messages);
+   }
+
+   virtual bool isOwnedByDispatcher() override { return false; }
+};
+
+/**
+ * Filter accepting messages with type starting with given prefix (not indexed by type)
+ */
+class PrefixFilter : public NXMBFilter
+{
+private:
+   const TCHAR *m_prefix;
+
+public:
+   PrefixFilter(const TCHAR *prefix) : NXMBFilter() { m_prefix = prefix; }
+
+   virtual bool isAllowed(NXMBMessage &msg) override
+   {
+      return !_tcsncmp(msg.getType(), m_prefix, _tcslen(m_prefix));
+   }
+};
+
+/**
+ * Create type filter for given message type
+ */
+static NXMBTypeFilter *CreateTypeFilter(const TCHAR *type)
+{
+   NXMBTypeFilter *filter = new NXMBTypeFilter();
+   filter->addMessageType(type);
+   return filter;
+}
+
+/**
+ * Wait until all posted messages are processed
+ */
+static bool WaitForDispatch(NXMBDispatcher *dispatcher)
+{
+   for(int i = 0; i < 1000; i++)
+   {
+      NXMBDispatcherStatistics stats;
+      dispatcher->getStatistics(&stats);
+      if (stats.processedMessages == stats.postedMessages)
+         return true;
+      ThreadSleepMs(10);
+   }
+   return false;
+}
+
+/**
+ * Test message ordering for subscribers served by different workers
+ */
+static void TestMessageOrdering(NXMBDispatcher *dispatcher)
+{
+   StartTest(_T("NXMBDispatcher - message order for each subscriber"));
+
+   NXMBDispatcherStatistics stats;
+   dispatcher->getStatistics(&stats);
+   AssertEquals(stats.workers, NUM_WORKERS);
+
+   TestSubscriber *subscribers[NUM_WORKERS * 2];
+   for(int i = 0; i < NUM_WORKERS * 2; i++)
+   {
+      TCHAR id[32];
+      _sntprintf(id, 32, _T("ORDER_%d"), i);
+      subscribers[i] = new TestSubscriber(id);
+      dispatcher->addSubscriber(subscribers[i], (i % 2 == 0) ? CreateTypeFilter(_T("ORDER")) : NULL);
+   }
+
+   for(int i = 0; i < 10000; i++)
+      dispatcher->postMessage(new TestMessage(_T("ORDER"), i));
+   AssertTrue(WaitForDispatch(dispatcher));
+
+   for(int i = 0; i < NUM_WORKERS * 2; i++)
+   {
+      AssertEquals(subscribers[i]->messages, 10000);
+      AssertEquals(subscribers[i]->outOfOrder, 0);
+   }
+
+   // Subscribers should be distributed between workers and have statistics
+   ObjectArray<NXMBSubscriberStatistics> *statistics = dispatcher->getSubscriberStatistics();
+   int workers[NUM_WORKERS];
+   memset(workers, 0, sizeof(workers));
+   int found = 0;
+   for(int i = 0; i < statistics->size(); i++)
+   {
+      NXMBSubscriberStatistics *s = statistics->get(i);
+      if (_tcsncmp(s->id, _T("ORDER_"), 6))
+         continue;
+      found++;
+      AssertEquals(s->messages, 10000);
+      AssertTrue(s->totalHandlerTime >= s->maxHandlerTime);
+      AssertTrue((s->worker >= 0) && (s->worker < NUM_WORKERS));
+      workers[s->worker]++;
+   }
+   delete statistics;
+   AssertEquals(found, NUM_WORKERS * 2);
+   for(int i = 0; i < NUM_WORKERS; i++)
+      AssertEquals(workers[i], 2);
+
+   for(int i = 0; i < NUM_WORKERS * 2; i++)
+   {
+      dispatcher->removeSubscriber(subscribers[i]->getId());
+      delete subscribers[i];
+   }
+   EndTest();
+}
+
+/**
+ * Poster thread for add/remove test
+ */
+static THREAD_RESULT THREAD_CALL PosterThread(void *arg)
+{
+   NXMBDispatcher *dispatcher = static_cast<NXMBDispatcher*>(arg);
+   for(int i = 0; i < 20000; i++)
+      dispatcher->postMessage(new TestMessage(_T("DYNAMIC"), i));
+   return THREAD_OK;
+}
+
+/**
+ * Test adding and removing subscribers while messages are being dispatched
+ */
+static void TestDynamicSubscribers(NXMBDispatcher *dispatcher)
+{
+   StartTest(_T("NXMBDispatcher - add/remove subscribers during dispatch"));
+
+   TestSubscriber *stable = new TestSubscriber(_T("DYNAMIC_STABLE"));
+   dispatcher->addSubscriber(stable, CreateTypeFilter(_T("DYNAMIC")));
+
+   THREAD poster = ThreadCreateEx(PosterThread, 0, dispatcher);
+   for(int i = 0; i < 200; i++)
+   {
+      TestSubscriber *s = new TestSubscriber(_T("DYNAMIC_TEMP"));
+      dispatcher->addSubscriber(s, (i % 2 == 0) ? CreateTypeFilter(_T("DYNAMIC")) : NULL);
+      ThreadSleepMs(1);
+      dispatcher->removeSubscriber(s->getId());
+
+      // Subscriber should not be called after removeSubscriber returns
+      s->removed = true;
+      ThreadSleepMs(1);
+      AssertEquals(s->outOfOrder, 0);
+      delete s;
+   }
+   ThreadJoin(poster);
+   AssertTrue(WaitForDispatch(dispatcher));
+
+   AssertEquals(stable->messages, 20000);
+   AssertEquals(stable->outOfOrder, 0);
+   dispatcher->removeSubscriber(stable->getId());
+   delete stable;
+   EndTest();
+}
+
+/**
+ * Test routing of messages by type index and by generic filters
+ */
+static void TestTypeRouting(NXMBDispatcher *dispatcher)
+{
+   StartTest(_T("NXMBDispatcher - type index routing"));
+
+   TestSubscriber *typeA = new TestSubscriber(_T("ROUTE_A"));
+   NXMBTypeFilter *filterA = CreateTypeFilter(_T("ROUTE.A"));
+   dispatcher->addSubscriber(typeA, filterA);
+
+   TestSubscriber *typeAB = new TestSubscriber(_T("ROUTE_AB"));
+   NXMBTypeFilter *filterAB = CreateTypeFilter(_T("ROUTE.A"));
+   filterAB->addMessageType(_T("ROUTE.B"));
+   dispatcher->addSubscriber(typeAB, filterAB);
+
+   TestSubscriber *prefix = new TestSubscriber(_T("ROUTE_PREFIX"));
+   dispatcher->addSubscriber(prefix, new PrefixFilter(_T("ROUTE.")));
+
+   TestSubscriber *all = new TestSubscriber(_T("ROUTE_ALL"));
+   dispatcher->addSubscriber(all, NULL);
+
+   int sequence = 0;
+   dispatcher->postMessage(new TestMessage(_T("ROUTE.A"), sequence++));
+   dispatcher->postMessage(new TestMessage(_T("ROUTE.B"), sequence++));
+   dispatcher->postMessage(new TestMessage(_T("ROUTE.C"), sequence++));
+   dispatcher->postMessage(new TestMessage(_T("OTHER"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(typeA->messages, 1);
+   AssertEquals(typeAB->messages, 2);
+   AssertEquals(prefix->messages, 3);
+   AssertEquals(all->messages, 4);
+
+   // Types added after registration should be routed
+   filterA->addMessageType(_T("ROUTE.C"));
+   dispatcher->postMessage(new TestMessage(_T("ROUTE.C"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(typeA->messages, 2);
+   AssertEquals(typeAB->messages, 2);
+
+   // Removed types should not be routed
+   filterAB->removeMessageType(_T("ROUTE.A"));
+   dispatcher->postMessage(new TestMessage(_T("ROUTE.A"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(typeA->messages, 3);
+   AssertEquals(typeAB->messages, 2);
+   AssertEquals(prefix->messages, 5);
+   AssertEquals(all->messages, 6);
+
+   AssertEquals(typeA->outOfOrder, 0);
+   AssertEquals(typeAB->outOfOrder, 0);
+   AssertEquals(prefix->outOfOrder, 0);
+   AssertEquals(all->outOfOrder, 0);
+
+   TestSubscriber *subscribers[] = { typeA, typeAB, prefix, all };
+   for(int i = 0; i < 4; i++)
+   {
+      dispatcher->removeSubscriber(subscribers[i]->getId());
+      delete subscribers[i];
+   }
+   EndTest();
+}
+
+/**
+ * Subscriber which changes subscriber list from within message handler
+ */
+class ReentrantSubscriber : public NXMBSubscriber
+{
+private:
+   NXMBDispatcher *m_dispatcher;
+   TestSubscriber *m_helper;
+   NXMBTypeFilter *m_helperFilter;
+
+public:
+   VolatileCounter messages;
+
+   ReentrantSubscriber(NXMBDispatcher *dispatcher, TestSubscriber *helper) : NXMBSubscriber(_T("REENTRANT"))
+   {
+      m_dispatcher = dispatcher;
+      m_helper = helper;
+      m_helperFilter = NULL;
+      messages = 0;
+   }
+
+   virtual void messageHandler(NXMBMessage &msg) override
+   {
+      InterlockedIncrement(&messages);
+      if (!_tcscmp(msg.getType(), _T("REENTER.ADD")))
+      {
+         m_helperFilter = CreateTypeFilter(_T("REENTER.DATA"));
+         m_dispatcher->addSubscriber(m_helper, m_helperFilter);
+      }
+      else if (!_tcscmp(msg.getType(), _T("REENTER.FILTER")))
+      {
+         m_helperFilter->addMessageType(_T("REENTER.EXTRA"));
+      }
+      else if (!_tcscmp(msg.getType(), _T("REENTER.REMOVE")))
+      {
+         m_dispatcher->removeSubscriber(m_helper->getId());
+      }
+      else if (!_tcscmp(msg.getType(), _T("REENTER.SELF")))
+      {
+         m_dispatcher->removeSubscriber(getId());
+      }
+   }
+
+   virtual bool isOwnedByDispatcher() override { return false; }
+};
+
+/**
+ * Test changing subscriber list from within message handler
+ */
+static void TestHandlerReentrancy(NXMBDispatcher *dispatcher)
+{
+   StartTest(_T("NXMBDispatcher - subscriber list changes from message handler"));
+
+   TestSubscriber *helper = new TestSubscriber(_T("REENTER_HELPER"));
+   ReentrantSubscriber *reentrant = new ReentrantSubscriber(dispatcher, helper);
+   dispatcher->addSubscriber(reentrant, CreateTypeFilter(_T("REENTER.ADD")));
+   NXMBTypeFilter *filter = CreateTypeFilter(_T("REENTER.ADD"));
+   filter->addMessageType(_T("REENTER.FILTER"));
+   filter->addMessageType(_T("REENTER.REMOVE"));
+   filter->addMessageType(_T("REENTER.SELF"));
+   dispatcher->addSubscriber(reentrant, filter);   // replace registration with different filter
+
+   int sequence = 0;
+   dispatcher->postMessage(new TestMessage(_T("REENTER.ADD"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   dispatcher->postMessage(new TestMessage(_T("REENTER.DATA"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(helper->messages, 1);
+
+   dispatcher->postMessage(new TestMessage(_T("REENTER.FILTER"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   dispatcher->postMessage(new TestMessage(_T("REENTER.EXTRA"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(helper->messages, 2);
+
+   dispatcher->postMessage(new TestMessage(_T("REENTER.REMOVE"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   dispatcher->postMessage(new TestMessage(_T("REENTER.DATA"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(helper->messages, 2);
+
+   // Repeated add (replacing existing registration) and remove while data messages are flowing
+   for(int i = 0; i < 500; i++)
+   {
+      dispatcher->postMessage(new TestMessage((i % 3 == 0) ? _T("REENTER.ADD") : ((i % 3 == 1) ? _T("REENTER.DATA") : _T("REENTER.REMOVE")), sequence++));
+      if (i % 50 == 0)
+         delete dispatcher->getSubscriberStatistics();
+   }
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(helper->outOfOrder, 0);
+
+   // Subscriber removes itself
+   dispatcher->postMessage(new TestMessage(_T("REENTER.SELF"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   int count = reentrant->messages;
+   dispatcher->postMessage(new TestMessage(_T("REENTER.ADD"), sequence++));
+   AssertTrue(WaitForDispatch(dispatcher));
+   AssertEquals(reentrant->messages, count);
+
+   ObjectArray<NXMBSubscriberStatistics> *statistics = dispatcher->getSubscriberStatistics();
+   for(int i = 0; i < statistics->size(); i++)
+      AssertTrue(_tcsncmp(statistics->get(i)->id, _T("REENTRANT"), 9) != 0);
+   delete statistics;
+
+   dispatcher->removeSubscriber(helper->getId());
+   delete reentrant;
+   delete helper;
+   EndTest();
+}
+
+/**
+ * main()
+ */
+int main(int argc, char *argv[])
+{
+   InitNetXMSProcess(true);
+
+   NXMBDispatcher::setWorkerCount(NUM_WORKERS);
+   NXMBDispatcher *dispatcher = NXMBDispatcher::getInstance();
+
+   TestMessageOrdering(dispatcher);
+   TestDynamicSubscribers(dispatcher);
+   TestTypeRouting(dispatcher);
+   TestHandlerReentrancy(dispatcher);
+   return 0;
+}
@@ -44,9 +44,11 @@ static void TestCompiler()
 /**
  * Run test NXSL script
  */
-static void RunTestScript(const TCHAR *name)
+static void RunTestScript(const TCHAR *name, bool optimize)
 {
-   StartTest(name);
+   TCHAR testName[256];
+   _sntprintf(testName, 256, _T("%s%s"), name, optimize ? _T("") : _T(" (not optimized)"));
+   StartTest(testName);
 
    TCHAR path[MAX_PATH];
    GetNetXMSDirectory(nxDirShare, path);
@@ -61,7 +63,9 @@ static void RunTestScript(const TCHAR *name)
    env->registerIOFunctions();
 
    TCHAR errorMessage[256];
+   NXSLEnableOptimizer(optimize);
    NXSL_VM *vm = NXSLCompileAndCreateVM(source, errorMessage, 256, env);
+   NXSLEnableOptimizer(true);
    MemFree(source);
    AssertNotNull(vm);
 
@@ -74,6 +78,139 @@ static void RunTestScript(const TCHAR *name)
    EndTest();
 }
 
+/**
+ * Script for shared program test
+ */
+static const TCHAR *s_sharedProgramScript =
+   _T("sub suffix(n) { switch(n % 3) { case 0: return \"abc\"; case 1: return \"de\"; default: return \"f\"; } }\n")
+   _T("c = 0;\n")
+   _T("for(i = 0; i < 300; i++) { s = \"x\" . suffix(i); c += length(s); }\n")
+   _T("return c;");
+
+/**
+ * Expected result of shared program test script (100 * 4 + 100 * 3 + 100 * 2)
+ */
+#define SHARED_PROGRAM_RESULT 900
+
+/**
+ * Shared program test worker context
+ */
+struct SharedProgramTestContext
+{
+   const NXSL_Program *program;
+   bool loadForEachRun;
+   VolatileCounter *loaded;
+   VolatileCounter *errors;
+};
+
+/**
+ * Run VM and check result of shared program test script
+ */
+static bool RunSharedProgram(NXSL_VM *vm)
+{
+   return vm->run() && (vm->getResult() != NULL) && (vm->getResult()->getValueAsInt32() == SHARED_PROGRAM_RESULT);
+}
+
+/**
+ * Shared program test worker. Either loads new VM from shared program for each run,
+ * or loads single VM and keeps running it while program is being destroyed.
+ */
+static THREAD_RESULT THREAD_CALL SharedProgramWorker(void *arg)
+{
+   SharedProgramTestContext *context = static_cast<SharedProgramTestContext*>(arg);
+   if (context->loadForEachRun)
+   {
+      for(int i = 0; i < 20; i++)
+      {
+         NXSL_VM *vm = new NXSL_VM(new NXSL_Environment());
+         if (!vm->load(context->program) || !RunSharedProgram(vm))
+            InterlockedIncrement(context->errors);
+         delete vm;
+      }
+   }
+   else
+   {
+      NXSL_VM *vm = new NXSL_VM(new NXSL_Environment());
+      bool success = vm->load(context->program);
+      InterlockedIncrement(context->loaded);
+      for(int i = 0; (i < 50) && success; i++)
+         success = RunSharedProgram(vm);
+      if (!success)
+         InterlockedIncrement(context->errors);
+      delete vm;
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Test sharing of compiled program between VMs running in different threads
+ */
+static void TestSharedProgram()
+{
+   StartTest(_T("NXSL program shared by multiple threads"));
+   TCHAR errorMessage[256];
+   NXSL_Program *program = NXSLCompile(s_sharedProgramScript, errorMessage, 256, NULL);
+   AssertNotNull(program);
+
+   VolatileCounter loaded = 0, errors = 0;
+   SharedProgramTestContext context;
+   context.program = program;
+   context.loadForEachRun = true;
+   context.loaded = &loaded;
+   context.errors = &errors;
+
+   THREAD threads[8];
+   for(int i = 0; i < 8; i++)
+      threads[i] = ThreadCreateEx(SharedProgramWorker, 0, &context);
+   for(int i = 0; i < 8; i++)
+      ThreadJoin(threads[i]);
+   AssertEquals(errors, 0);
+   EndTest();
+
+   StartTest(_T("NXSL program destroyed while VMs are running"));
+   context.loadForEachRun = false;
+   for(int i = 0; i < 8; i++)
+      threads[i] = ThreadCreateEx(SharedProgramWorker, 0, &context);
+   while(loaded < 8)
+      ThreadSleepMs(1);
+   delete program;
+   for(int i = 0; i < 8; i++)
+      ThreadJoin(threads[i]);
+   AssertEquals(errors, 0);
+   EndTest();
+}
+
+/**
+ * Script for local variable access benchmark
+ */
+static const TCHAR *s_perfScript =
+   _T("sub add(a, b) { return a + b; }\n")
+   _T("sum = 0;\n")
+   _T("for(i = 0; i < 200000; i++) { x = i % 7; y = x * 2; sum = add(sum, y); }\n")
+   _T("return sum;");
+
+/**
+ * Local variable access benchmark. Only checks script result and reports execution time,
+ * there is no pass/fail threshold for timing.
+ */
+static void BenchmarkLocalVariableAccess(bool optimize)
+{
+   StartTest(optimize ? _T("NXSL local variable access benchmark") : _T("NXSL local variable access benchmark (not optimized)"));
+
+   TCHAR errorMessage[256];
+   NXSLEnableOptimizer(optimize);
+   NXSL_VM *vm = NXSLCompileAndCreateVM(s_perfScript, errorMessage, 256, new NXSL_Environment());
+   NXSLEnableOptimizer(true);
+   AssertNotNull(vm);
+
+   INT64 start = GetCurrentTimeMs();
+   AssertTrue(vm->run());
+   AssertEquals(vm->getResult()->getValueAsInt64(), static_cast<INT64>(1199988));
+   delete vm;
+
+   EndTest(GetCurrentTimeMs() - start);
+}
+
 /**
  * main()
  */
@@ -82,16 +219,25 @@ int main(int argc, char *argv[])
    InitNetXMSProcess(true);
 
    TestCompiler();
-   RunTestScript(_T("arrays.nxsl"));
-   RunTestScript(_T("base64.nxsl"));
-   RunTestScript(_T("control.nxsl"));
-   RunTestScript(_T("globals.nxsl"));
-   RunTestScript(_T("like.nxsl"));
-   RunTestScript(_T("math.nxsl"));
-   RunTestScript(_T("regexp.nxsl"));
-   RunTestScript(_T("strings.nxsl"));
-   RunTestScript(_T("try-catch.nxsl"));
-   RunTestScript(_T("types.nxsl"));
-   RunTestScript(_T("with.nxsl"));
+   for(int i = 0; i < 2; i++)
+   {
+      bool optimize = (i == 0);
+      RunTestScript(_T("arrays.nxsl"), optimize);
+      RunTestScript(_T("base64.nxsl"), optimize);
+      RunTestScript(_T("control.nxsl"), optimize);
+      RunTestScript(_T("globals.nxsl"), optimize);
+      RunTestScript(_T("like.nxsl"), optimize);
+      RunTestScript(_T("locals.nxsl"), optimize);
+      RunTestScript(_T("math.nxsl"), optimize);
+      RunTestScript(_T("optimizer.nxsl"), optimize);
+      RunTestScript(_T("regexp.nxsl"), optimize);
+      RunTestScript(_T("strings.nxsl"), optimize);
+      RunTestScript(_T("try-catch.nxsl"), optimize);
+      RunTestScript(_T("types.nxsl"), optimize);
+      RunTestScript(_T("with.nxsl"), optimize);
+   }
+   TestSharedProgram();
+   BenchmarkLocalVariableAccess(true);
+   BenchmarkLocalVariableAccess(false);
    return 0;
 }
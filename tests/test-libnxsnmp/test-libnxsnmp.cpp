@@ -142,6 +142,452 @@ static void TestVariableClass()
    EndTest();
 }
 
+/**
+ * Emulated MIB - table under .1.3.6.1.4.1.57163.1 and single object under .1.3.6.1.4.1.57163.2
+ */
+#define EMULATED_TABLE_SIZE   500
+static UINT32 s_emulatedMibRoot[] = { 1, 3, 6, 1, 4, 1, 57163 };
+static UINT32 s_emulatedTableRoot[] = { 1, 3, 6, 1, 4, 1, 57163, 1 };
+
+/**
+ * Agent emulator state
+ */
+static SOCKET s_agentSocket = INVALID_SOCKET;
+static UINT16 s_agentPort = 0;
+static THREAD s_agentThread = INVALID_THREAD_HANDLE;
+static VolatileCounter s_getNextRequests = 0;
+static VolatileCounter s_getBulkRequests = 0;
+
+/**
+ * Agent emulator behavior for GETBULK requests
+ */
+enum BulkMode
+{
+   BULK_NORMAL = 0,
+   BULK_TOO_BIG = 1,    // respond with tooBig error if max-repetitions is above 10
+   BULK_DROP = 2,       // do not respond
+   BULK_REJECT = 3      // respond with genErr error
+};
+static BulkMode s_bulkMode = BULK_NORMAL;
+static VolatileCounter s_tooBigResponses = 0;
+
+/**
+ * Get OID of emulated MIB object with given index (0 based)
+ */
+static SNMP_ObjectId EmulatedObjectName(int index)
+{
+   SNMP_ObjectId oid(s_emulatedMibRoot, sizeof(s_emulatedMibRoot) / sizeof(UINT32));
+   if (index < EMULATED_TABLE_SIZE)
+   {
+      oid.extend(1);
+      oid.extend(index + 1);
+   }
+   else
+   {
+      oid.extend(2);
+      oid.extend(1);
+   }
+   return oid;
+}
+
+/**
+ * Find first emulated MIB object following given OID. Returns -1 if there are no more objects.
+ */
+static int NextEmulatedObject(const SNMP_ObjectId& oid)
+{
+   for(int i = 0; i <= EMULATED_TABLE_SIZE; i++)
+   {
+      int rc = EmulatedObjectName(i).compare(oid);
+      if ((rc == OID_FOLLOWING) || (rc == OID_LONGER))
+         return i;
+   }
+   return -1;
+}
+
+/**
+ * Create variable for emulated MIB object with given index
+ */
+static SNMP_Variable *EmulatedObject(int index, const SNMP_ObjectId& requestedName)
+{
+   if (index == -1)
+   {
+      SNMP_Variable *v = new SNMP_Variable(requestedName);
+      v->setValueFromString(ASN_END_OF_MIBVIEW, _T(""));
+      return v;
+   }
+   SNMP_Variable *v = new SNMP_Variable(EmulatedObjectName(index));
+   TCHAR value[16];
+   _sntprintf(value, 16, _T("%d"), index + 1);
+   v->setValueFromString(ASN_INTEGER, value);
+   return v;
+}
+
+/**
+ * Simple SNMP agent emulator. Responds to GET requests with variable name as value,
+ * serves GETNEXT and GETBULK requests from emulated MIB, and stops on SET request.
+ * GETBULK responses are limited to 40 variables.
+ */
+static THREAD_RESULT THREAD_CALL AgentEmulator(void *arg)
+{
+   BYTE buffer[4096];
+   SocketPoller sp;
+   while(true)
+   {
+      sp.reset();
+      sp.add(s_agentSocket);
+      if (sp.poll(5000) <= 0)
+         break;
+
+      SockAddrBuffer sender;
+      socklen_t addrLen = sizeof(sender);
+      int bytes = recvfrom(s_agentSocket, (char *)buffer, sizeof(buffer), 0, (struct sockaddr *)&sender, &addrLen);
+      if (bytes <= 0)
+         break;
+
+      SNMP_PDU request;
+      SNMP_SecurityContext context;
+      if (!request.parse(buffer, bytes, &context, false))
+         continue;
+      if (request.getCommand() == SNMP_SET_REQUEST)
+         break;   // Stop command
+
+      SNMP_PDU response(SNMP_RESPONSE, request.getRequestId(), request.getVersion());
+      if (request.getCommand() == SNMP_GET_REQUEST)
+      {
+         for(int i = 0; i < request.getNumVariables(); i++)
+         {
+            SNMP_Variable *v = new SNMP_Variable(request.getVariable(i)->getName());
+            v->setValueFromString(ASN_OCTET_STRING, request.getVariable(i)->getName().toString());
+            response.bindVariable(v);
+         }
+      }
+      else if (request.getCommand() == SNMP_GET_NEXT_REQUEST)
+      {
+         InterlockedIncrement(&s_getNextRequests);
+         for(int i = 0; i < request.getNumVariables(); i++)
+         {
+            const SNMP_ObjectId& name = request.getVariable(i)->getName();
+            response.bindVariable(EmulatedObject(NextEmulatedObject(name), name));
+         }
+      }
+      else if ((request.getCommand() == SNMP_GET_BULK_REQUEST) && (request.getNumVariables() > 0))
+      {
+         InterlockedIncrement(&s_getBulkRequests);
+         if (s_bulkMode == BULK_DROP)
+            continue;
+         if ((s_bulkMode == BULK_REJECT) || ((s_bulkMode == BULK_TOO_BIG) && (request.getMaxRepetitions() > 10)))
+         {
+            if (s_bulkMode == BULK_TOO_BIG)
+               InterlockedIncrement(&s_tooBigResponses);
+            response.setErrorCode((s_bulkMode == BULK_REJECT) ? SNMP_PDU_ERR_GENERIC : SNMP_PDU_ERR_TOO_BIG);
+         }
+         else
+         {
+            const SNMP_ObjectId& name = request.getVariable(0)->getName();
+            int index = NextEmulatedObject(name);
+            int count = std::min(static_cast<int>(request.getMaxRepetitions()), 40);
+            for(int i = 0; i < count; i++)
+            {
+               response.bindVariable(EmulatedObject(index, name));
+               if (index == -1)
+                  break;
+               index = (index < EMULATED_TABLE_SIZE) ? index + 1 : -1;
+            }
+         }
+      }
+
+      BYTE *data;
+      size_t size = response.encode(&data, &context);
+      if (size > 0)
+      {
+         sendto(s_agentSocket, (char *)data, (int)size, 0, (struct sockaddr *)&sender, addrLen);
+         MemFree(data);
+      }
+   }
+   return THREAD_OK;
+}
+
+/**
+ * Start agent emulator on loopback address
+ */
+static void StartAgentEmulator()
+{
+   s_agentSocket = CreateSocket(AF_INET, SOCK_DGRAM, 0);
+   struct sockaddr_in sa;
+   memset(&sa, 0, sizeof(sa));
+   sa.sin_family = AF_INET;
+   sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   bind(s_agentSocket, (struct sockaddr *)&sa, sizeof(sa));
+   socklen_t len = sizeof(sa);
+   getsockname(s_agentSocket, (struct sockaddr *)&sa, &len);
+   s_agentPort = ntohs(sa.sin_port);
+   s_agentThread = ThreadCreateEx(AgentEmulator, 0, NULL);
+}
+
+/**
+ * Stop agent emulator. Socket remains open so requests to emulator port will time out.
+ */
+static void StopAgentEmulator()
+{
+   SNMP_UDPTransport transport;
+   transport.createUDPTransport(InetAddress::LOOPBACK, s_agentPort);
+   transport.setSecurityContext(new SNMP_SecurityContext());
+   SNMP_PDU request(SNMP_SET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   transport.sendMessage(&request, 0);
+   ThreadJoin(s_agentThread);
+}
+
+/**
+ * Walk callback - check that values are returned in order
+ */
+static UINT32 WalkCallback(SNMP_Variable *v, SNMP_Transport *transport, void *arg)
+{
+   int *count = static_cast<int*>(arg);
+   (*count)++;
+   if ((*count <= EMULATED_TABLE_SIZE) && (v->getValueAsInt() != *count))
+      return SNMP_ERR_BAD_RESPONSE;
+   return SNMP_ERR_SUCCESS;
+}
+
+/**
+ * Test SNMP walk
+ */
+static void TestWalk()
+{
+   SNMP_UDPTransport transport;
+   transport.createUDPTransport(InetAddress::LOOPBACK, s_agentPort);
+
+   StartTest(_T("SnmpWalk - GETBULK"));
+   transport.setSnmpVersion(SNMP_VERSION_2C);
+   int count = 0;
+   s_getBulkRequests = 0;
+   s_getNextRequests = 0;
+   AssertEquals(SnmpWalk(&transport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getNextRequests, 0);
+   AssertTrue(s_getBulkRequests < 20);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - GETBULK until end of MIB view"));
+   count = 0;
+   AssertEquals(SnmpWalk(&transport, s_emulatedMibRoot, sizeof(s_emulatedMibRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE + 1);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - GETNEXT"));
+   SnmpSetBulkWalkMaxRepetitions(0);
+   count = 0;
+   s_getBulkRequests = 0;
+   s_getNextRequests = 0;
+   AssertEquals(SnmpWalk(&transport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getBulkRequests, 0);
+   AssertEquals(s_getNextRequests, EMULATED_TABLE_SIZE + 1);
+   SnmpSetBulkWalkMaxRepetitions(64);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - SNMPv1"));
+   transport.setSnmpVersion(SNMP_VERSION_1);
+   count = 0;
+   s_getBulkRequests = 0;
+   AssertEquals(SnmpWalk(&transport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getBulkRequests, 0);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - GETBULK with tooBig responses"));
+   SNMP_UDPTransport tooBigTransport;
+   tooBigTransport.createUDPTransport(InetAddress::LOOPBACK, s_agentPort);
+   s_bulkMode = BULK_TOO_BIG;
+   count = 0;
+   s_getBulkRequests = 0;
+   s_getNextRequests = 0;
+   s_tooBigResponses = 0;
+   AssertEquals(SnmpWalk(&tooBigTransport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertTrue(s_tooBigResponses > 0);
+   AssertEquals(s_getNextRequests, 0);
+   AssertTrue(tooBigTransport.isGetBulkSupported());
+   EndTest();
+
+   StartTest(_T("SnmpWalk - agent rejects GETBULK"));
+   SNMP_UDPTransport rejectTransport;
+   rejectTransport.createUDPTransport(InetAddress::LOOPBACK, s_agentPort);
+   s_bulkMode = BULK_REJECT;
+   count = 0;
+   s_getBulkRequests = 0;
+   s_getNextRequests = 0;
+   AssertEquals(SnmpWalk(&rejectTransport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getBulkRequests, 1);
+   AssertEquals(s_getNextRequests, EMULATED_TABLE_SIZE + 1);
+   AssertFalse(rejectTransport.isGetBulkSupported());
+   count = 0;
+   s_getBulkRequests = 0;
+   AssertEquals(SnmpWalk(&rejectTransport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getBulkRequests, 0);
+   EndTest();
+
+   StartTest(_T("SnmpWalk - GETBULK timeout"));
+   UINT32 timeout = SnmpGetDefaultTimeout();
+   SnmpSetDefaultTimeout(200);
+   SNMP_UDPTransport dropTransport;
+   dropTransport.createUDPTransport(InetAddress::LOOPBACK, s_agentPort);
+   s_bulkMode = BULK_DROP;
+   count = 0;
+   s_getBulkRequests = 0;
+   s_getNextRequests = 0;
+   AssertEquals(SnmpWalk(&dropTransport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getBulkRequests, 1);
+   AssertEquals(s_getNextRequests, EMULATED_TABLE_SIZE + 1);
+   AssertFalse(dropTransport.isGetBulkSupported());
+   count = 0;
+   s_getBulkRequests = 0;
+   AssertEquals(SnmpWalk(&dropTransport, s_emulatedTableRoot, sizeof(s_emulatedTableRoot) / sizeof(UINT32), WalkCallback, &count), SNMP_ERR_SUCCESS);
+   AssertEquals(count, EMULATED_TABLE_SIZE);
+   AssertEquals(s_getBulkRequests, 0);
+   SnmpSetDefaultTimeout(timeout);
+   s_bulkMode = BULK_NORMAL;
+   EndTest();
+}
+
+/**
+ * Asynchronous request completion context
+ */
+struct AsyncRequestResult
+{
+   UINT32 rc;
+   TCHAR value[64];
+   VolatileCounter *counter;
+   CONDITION completed;
+};
+
+/**
+ * Asynchronous request completion callback
+ */
+static void AsyncRequestCallback(UINT32 rc, SNMP_PDU *response, void *context)
+{
+   AsyncRequestResult *r = static_cast<AsyncRequestResult*>(context);
+   r->rc = rc;
+   if ((rc == SNMP_ERR_SUCCESS) && (response->getNumVariables() > 0))
+      response->getVariable(0)->getValueAsString(r->value, 64);
+   if (InterlockedDecrement(r->counter) == 0)
+      ConditionSet(r->completed);
+}
+
+/**
+ * Test asynchronous SNMP client
+ */
+static void TestAsyncClient()
+{
+   UINT16 port = s_agentPort;
+   StartTest(_T("SNMP_AsyncClient::start"));
+   SNMP_AsyncClient client;
+   AssertTrue(client.start());
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncClient::sendRequest"));
+   VolatileCounter counter = 1;
+   AsyncRequestResult result;
+   result.rc = SNMP_ERR_ABORTED;
+   result.value[0] = 0;
+   result.counter = &counter;
+   result.completed = ConditionCreate(true);
+   SNMP_PDU *request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   request->bindVariable(new SNMP_Variable(s_oidSysDescription));
+   AssertEquals(client.sendRequest(InetAddress::LOOPBACK, port, request, NULL, 2000, 3, AsyncRequestCallback, &result), SNMP_ERR_SUCCESS);
+   AssertTrue(ConditionWait(result.completed, 5000));
+   AssertEquals(result.rc, SNMP_ERR_SUCCESS);
+   AssertTrue(!_tcscmp(result.value, s_oidSysDescription.toString()));
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncClient - concurrent requests"));
+   static const int requestCount = 1000;
+   AsyncRequestResult *results = new AsyncRequestResult[requestCount];
+   counter = requestCount;
+   ConditionReset(result.completed);
+   for(int i = 0; i < requestCount; i++)
+   {
+      results[i].rc = SNMP_ERR_ABORTED;
+      results[i].counter = &counter;
+      results[i].completed = result.completed;
+      request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+      request->bindVariable(new SNMP_Variable(s_oidSysLocation));
+      AssertEquals(client.sendRequest(InetAddress::LOOPBACK, port, request, NULL, 2000, 3, AsyncRequestCallback, &results[i]), SNMP_ERR_SUCCESS);
+   }
+   AssertTrue(ConditionWait(result.completed, 10000));
+   for(int i = 0; i < requestCount; i++)
+      AssertEquals(results[i].rc, SNMP_ERR_SUCCESS);
+   AssertEquals(client.getPendingRequestCount(), 0);
+   delete[] results;
+   EndTest();
+
+   StopAgentEmulator();
+
+   StartTest(_T("SNMP_AsyncClient - timeout"));
+   UINT64 retransmits = client.getRetransmitCount();
+   counter = 1;
+   ConditionReset(result.completed);
+   request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   request->bindVariable(new SNMP_Variable(s_oidSysDescription));
+   AssertEquals(client.sendRequest(InetAddress::LOOPBACK, port, request, NULL, 100, 3, AsyncRequestCallback, &result), SNMP_ERR_SUCCESS);
+   AssertTrue(ConditionWait(result.completed, 5000));
+   AssertEquals(result.rc, SNMP_ERR_TIMEOUT);
+   AssertEquals(client.getRetransmitCount() - retransmits, 2);
+   AssertEquals(client.getTimeoutCount(), 1);
+   EndTest();
+
+   StartTest(_T("SNMP_AsyncClient::stop"));
+   counter = 1;
+   ConditionReset(result.completed);
+   request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   request->bindVariable(new SNMP_Variable(s_oidSysDescription));
+   AssertEquals(client.sendRequest(InetAddress::LOOPBACK, port, request, NULL, 60000, 1, AsyncRequestCallback, &result), SNMP_ERR_SUCCESS);
+   client.stop();
+   AssertTrue(ConditionWait(result.completed, 5000));
+   AssertEquals(result.rc, SNMP_ERR_ABORTED);
+   AssertEquals(client.getPendingRequestCount(), 0);
+   request = new SNMP_PDU(SNMP_GET_REQUEST, SnmpNewRequestId(), SNMP_VERSION_2C);
+   request->bindVariable(new SNMP_Variable(s_oidSysDescription));
+   AssertEquals(client.sendRequest(InetAddress::LOOPBACK, port, request, NULL, 1000, 1, AsyncRequestCallback, &result), SNMP_ERR_ABORTED);
+   EndTest();
+
+   ConditionDestroy(result.completed);
+}
+
+/**
+ * Test SNMPv3 key localization (test vectors from RFC 3414 section A.3)
+ */
+static void TestKeyLocalization()
+{
+   static BYTE engineId[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 };
+   static BYTE md5Key[] = { 0x52, 0x6F, 0x5E, 0xED, 0x9F, 0xCC, 0xE2, 0x6F, 0x89, 0x64, 0xC2, 0x93, 0x07, 0x87, 0xD8, 0x2B };
+   static BYTE sha1Key[] = { 0x66, 0x95, 0xFE, 0xBC, 0x92, 0x88, 0xE3, 0x62, 0x82, 0x23, 0x5F, 0xC7, 0x15, 0x1F, 0x12, 0x84, 0x97, 0xB3, 0x8F, 0x3F };
+
+   StartTest(_T("SNMPv3 key localization"));
+   SNMP_SecurityContext ctx1("user", "maplesyrup", SNMP_AUTH_MD5);
+   ctx1.setAuthoritativeEngine(SNMP_Engine(engineId, sizeof(engineId)));
+   AssertTrue(!memcmp(ctx1.getAuthKeyMD5(), md5Key, sizeof(md5Key)));
+   AssertTrue(!memcmp(ctx1.getAuthKeySHA1(), sha1Key, sizeof(sha1Key)));
+   EndTest();
+
+   StartTest(_T("SNMPv3 key cache"));
+   UINT64 hits, misses, hits2, misses2;
+   int size;
+   SnmpGetKeyCacheStatistics(&hits, &misses, &size);
+   AssertTrue(size > 0);
+   SNMP_SecurityContext ctx2("user2", "maplesyrup", SNMP_AUTH_MD5);
+   ctx2.setAuthoritativeEngine(SNMP_Engine(engineId, sizeof(engineId)));
+   SnmpGetKeyCacheStatistics(&hits2, &misses2, &size);
+   AssertEquals(misses2, misses);
+   AssertTrue(hits2 > hits);
+   AssertTrue(!memcmp(ctx2.getAuthKeyMD5(), md5Key, sizeof(md5Key)));
+   AssertTrue(!memcmp(ctx2.getAuthKeySHA1(), sha1Key, sizeof(sha1Key)));
+   EndTest();
+}
+
 /**
  * main()
  */
@@ -152,5 +598,11 @@ int main(int argc, char *argv[])
    TestOidConversion();
    TestOidClass();
    TestVariableClass();
+   TestKeyLocalization();
+
+   StartAgentEmulator();
+   TestWalk();
+   TestAsyncClient();   // will stop agent emulator
+   closesocket(s_agentSocket);
    return 0;
 }